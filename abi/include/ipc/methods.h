@@ -191,6 +191,26 @@
  */
 #define IPC_M_DEBUG  10
 
+/** Ask the pager of an address space area to provide a page.
+ *
+ * This method is sent only by the kernel when it needs to resolve a page
+ * fault in an address space area backed by a user space pager.
+ *
+ * - ARG1 - offset of the page within the address space area
+ * - ARG2 - size of the page
+ * - ARG3 - first pager-defined identifier of the area
+ * - ARG4 - second pager-defined identifier of the area
+ * - ARG5 - third pager-defined identifier of the area
+ *
+ * on answer, the recipient must set:
+ *
+ * - ARG1 - virtual address of a resident anonymous page in the recipient's
+ *          address space holding the page contents (the kernel replaces
+ *          it with the physical address of the frame)
+ *
+ */
+#define IPC_M_PAGE_IN  11
+
 /** Last system IPC method */
 #define IPC_M_LAST_SYSTEM  511
 
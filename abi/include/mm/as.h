@@ -53,6 +53,17 @@ typedef struct {
 	unsigned int flags;
 } as_area_info_t;
 
+/** Description of a user space pager backing an address space area. */
+typedef struct {
+	/** Phone used by the kernel to send IPC_M_PAGE_IN requests */
+	sysarg_t pager;
+	
+	/** Pager-defined identifiers of the area */
+	sysarg_t id1;
+	sysarg_t id2;
+	sysarg_t id3;
+} as_area_pager_info_t;
+
 #endif
 
 /** @}
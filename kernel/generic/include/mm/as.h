@@ -82,6 +82,9 @@
 /** The page fault was caused by memcpy_from_uspace() or memcpy_to_uspace(). */
 #define AS_PF_DEFER  2
 
+/** The backend released all locks and the page fault must be restarted. */
+#define AS_PF_RETRY  3
+
 /** Address space structure.
  *
  * as_t contains the list of as_areas of userspace accessible
@@ -172,6 +175,9 @@ typedef union mem_backend_data {
 		uintptr_t base;
 		size_t frames;
 	};
+	
+	/** user_backend members */
+	as_area_pager_info_t pager_info;
 } mem_backend_data_t;
 
 /** Address space area structure.
@@ -240,6 +246,7 @@ extern void as_hold(as_t *);
 extern void as_release(as_t *);
 extern void as_switch(as_t *, as_t *);
 extern int as_page_fault(uintptr_t, pf_access_t, istate_t *);
+extern bool as_page_fault_relock(as_area_t *, uintptr_t);
 
 extern as_area_t *as_area_create(as_t *, unsigned int, size_t, unsigned int,
     mem_backend_t *, mem_backend_data_t *, uintptr_t *, uintptr_t);
@@ -251,6 +258,7 @@ extern int as_area_change_flags(as_t *, unsigned int, uintptr_t);
 
 extern unsigned int as_area_get_flags(as_area_t *);
 extern bool as_area_check_access(as_area_t *, pf_access_t);
+extern int as_page_frame_ref(as_t *, uintptr_t, uintptr_t *);
 extern size_t as_area_get_size(uintptr_t);
 extern bool used_space_insert(as_area_t *, uintptr_t, size_t);
 extern bool used_space_remove(as_area_t *, uintptr_t, size_t);
@@ -281,9 +289,11 @@ extern void as_deinstall_arch(as_t *);
 extern mem_backend_t anon_backend;
 extern mem_backend_t elf_backend;
 extern mem_backend_t phys_backend;
+extern mem_backend_t user_backend;
 
 /* Address space area related syscalls. */
-extern sysarg_t sys_as_area_create(uintptr_t, size_t, unsigned int, uintptr_t);
+extern sysarg_t sys_as_area_create(uintptr_t, size_t, unsigned int, uintptr_t,
+    as_area_pager_info_t *);
 extern sysarg_t sys_as_area_resize(uintptr_t, size_t, unsigned int);
 extern sysarg_t sys_as_area_change_flags(uintptr_t, unsigned int);
 extern sysarg_t sys_as_area_destroy(uintptr_t);
@@ -112,6 +112,7 @@ static inline bool method_is_forwardable(sysarg_t imethod)
 	case IPC_M_CONNECTION_CLONE:
 	case IPC_M_CLONE_ESTABLISH:
 	case IPC_M_PHONE_HUNGUP:
+	case IPC_M_PAGE_IN:
 		/* This message is meant only for the original recipient. */
 		return false;
 	default:
@@ -136,6 +137,7 @@ static inline bool method_is_immutable(sysarg_t imethod)
 	case IPC_M_DATA_WRITE:
 	case IPC_M_DATA_READ:
 	case IPC_M_STATE_CHANGE_AUTHORIZE:
+	case IPC_M_PAGE_IN:
 		return true;
 	default:
 		return false;
@@ -167,6 +169,7 @@ static inline bool answer_need_old(call_t *call)
 	case IPC_M_DATA_WRITE:
 	case IPC_M_DATA_READ:
 	case IPC_M_STATE_CHANGE_AUTHORIZE:
+	case IPC_M_PAGE_IN:
 		return true;
 	default:
 		return false;
@@ -295,6 +298,24 @@ static inline int answer_preprocess(call_t *answer, ipc_data_t *olddata)
 			IPC_SET_ARG4(answer->data, dst_base);
 			IPC_SET_RETVAL(answer->data, rc);
 		}
+	} else if (IPC_GET_IMETHOD(*olddata) == IPC_M_PAGE_IN) {
+		if (!IPC_GET_RETVAL(answer->data)) {
+			/*
+			 * Only requests sent by the kernel itself are honored.
+			 * These are never forwarded.
+			 */
+			int rc = EPERM;
+			if (!(answer->flags & IPC_CALL_FORWARDED)) {
+				uintptr_t frame;
+				rc = as_page_frame_ref(AS,
+				    IPC_GET_ARG1(answer->data), &frame);
+				if (rc == EOK)
+					IPC_SET_ARG1(answer->data, frame);
+			}
+			
+			IPC_SET_RETVAL(answer->data, rc);
+			return rc;
+		}
 	} else if (IPC_GET_IMETHOD(*olddata) == IPC_M_DATA_READ) {
 		ASSERT(!answer->buffer);
 		if (!IPC_GET_RETVAL(answer->data)) {
@@ -534,6 +555,9 @@ static int request_preprocess(call_t *call, phone_t *phone)
 		IPC_SET_ARG5(call->data, (sysarg_t) other_task_s);
 		break;
 	}
+	case IPC_M_PAGE_IN:
+		/* Only the kernel is allowed to ask pagers for pages. */
+		return EPERM;
 #ifdef CONFIG_UDEBUG
 	case IPC_M_DEBUG:
 		return udebug_request_preprocess(call, phone);
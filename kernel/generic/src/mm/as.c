@@ -1090,6 +1090,56 @@ NO_TRACE bool as_area_check_access(as_area_t *area, pf_access_t access)
 	return true;
 }
 
+/** Take a reference to the frame backing a page of an anonymous area.
+ *
+ * This is used by the IPC_M_PAGE_IN protocol to hand over a page populated
+ * by a user space pager to the address space which incurred the page fault.
+ * Only resident pages of anonymous address space areas are accepted so that
+ * the pager cannot pass on frames which are not regular memory.
+ *
+ * @param as    Address space containing the page.
+ * @param page  Virtual address of the page.
+ * @param frame Place to store the physical address of the frame.
+ *
+ * @return EOK on success, ENOENT if there is no such resident page,
+ *         EPERM if the page does not belong to an anonymous area.
+ *
+ */
+int as_page_frame_ref(as_t *as, uintptr_t page, uintptr_t *frame)
+{
+	page = ALIGN_DOWN(page, PAGE_SIZE);
+	
+	mutex_lock(&as->lock);
+	
+	as_area_t *area = find_area_and_lock(as, page);
+	if (!area) {
+		mutex_unlock(&as->lock);
+		return ENOENT;
+	}
+	
+	if (area->backend != &anon_backend) {
+		mutex_unlock(&area->lock);
+		mutex_unlock(&as->lock);
+		return EPERM;
+	}
+	
+	int rc = ENOENT;
+	
+	page_table_lock(as, false);
+	pte_t *pte = page_mapping_find(as, page, false);
+	if ((pte) && (PTE_VALID(pte)) && (PTE_PRESENT(pte))) {
+		*frame = PTE_GET_FRAME(pte);
+		frame_reference_add(ADDR2PFN(*frame));
+		rc = EOK;
+	}
+	page_table_unlock(as, false);
+	
+	mutex_unlock(&area->lock);
+	mutex_unlock(&as->lock);
+	
+	return rc;
+}
+
 /** Convert address space area flags to page flags.
  *
  * @param aflags Flags of some address space area.
@@ -1263,6 +1313,43 @@ int as_area_change_flags(as_t *as, unsigned int flags, uintptr_t address)
 	return 0;
 }
 
+/** Reacquire the locks released by a sleeping page fault backend.
+ *
+ * A backend that needs to sleep while servicing a page fault (e.g. to wait
+ * for a user space pager) must release the page table lock, the area lock
+ * and the address space lock first. This function takes them again in the
+ * same order as as_page_fault() and verifies that @a area still covers
+ * @a page.
+ *
+ * @param area Address space area the page fault was being serviced in.
+ * @param page Faulting page.
+ *
+ * @return True if all locks are held again and @a area still covers
+ *         @a page. False if the area has been destroyed or changed in the
+ *         meantime, in which case no locks are held.
+ *
+ */
+bool as_page_fault_relock(as_area_t *area, uintptr_t page)
+{
+	mutex_lock(&AS->lock);
+	as_area_t *cur = find_area_and_lock(AS, page);
+	if (cur != area) {
+		if (cur)
+			mutex_unlock(&cur->lock);
+		mutex_unlock(&AS->lock);
+		return false;
+	}
+	
+	if (area->attributes & AS_AREA_ATTR_PARTIAL) {
+		mutex_unlock(&area->lock);
+		mutex_unlock(&AS->lock);
+		return false;
+	}
+	
+	page_table_lock(AS, false);
+	return true;
+}
+
 /** Handle page fault within the current address space.
  *
  * This is the high-level page fault handler. It decides whether the page fault
@@ -1290,6 +1377,7 @@ int as_page_fault(uintptr_t page, pf_access_t access, istate_t *istate)
 	if (!AS)
 		return AS_PF_FAULT;
 	
+retry:
 	mutex_lock(&AS->lock);
 	as_area_t *area = find_area_and_lock(AS, page);
 	if (!area) {
@@ -1344,7 +1432,16 @@ int as_page_fault(uintptr_t page, pf_access_t access, istate_t *istate)
 	/*
 	 * Resort to the backend page fault handler.
 	 */
-	if (area->backend->page_fault(area, page, access) != AS_PF_OK) {
+	int rc = area->backend->page_fault(area, page, access);
+	if (rc == AS_PF_RETRY) {
+		/*
+		 * The backend has slept with all locks released and the area
+		 * has changed meanwhile. Start over.
+		 */
+		goto retry;
+	}
+	
+	if (rc != AS_PF_OK) {
 		page_table_unlock(AS, false);
 		mutex_unlock(&area->lock);
 		mutex_unlock(&AS->lock);
@@ -2050,11 +2147,25 @@ success:
  */
 
 sysarg_t sys_as_area_create(uintptr_t base, size_t size, unsigned int flags,
-    uintptr_t bound)
+    uintptr_t bound, as_area_pager_info_t *pager_info)
 {
+	mem_backend_t *backend = &anon_backend;
+	mem_backend_data_t backend_data;
+	mem_backend_data_t *pbackend_data = NULL;
+	
+	if (pager_info) {
+		memsetb(&backend_data, sizeof(backend_data), 0);
+		if (copy_from_uspace(&backend_data.pager_info, pager_info,
+		    sizeof(as_area_pager_info_t)) != EOK)
+			return (sysarg_t) -1;
+		
+		backend = &user_backend;
+		pbackend_data = &backend_data;
+	}
+	
 	uintptr_t virt = base;
 	as_area_t *area = as_area_create(AS, flags | AS_AREA_CACHEABLE, size,
-	    AS_AREA_ATTR_NONE, &anon_backend, NULL, &virt, bound);
+	    AS_AREA_ATTR_NONE, backend, pbackend_data, &virt, bound);
 	if (area == NULL)
 		return (sysarg_t) -1;
 	
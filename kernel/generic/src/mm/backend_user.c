@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup genericmm
+ * @{
+ */
+
+/**
+ * @file
+ * @brief Backend for address space areas backed by a user space pager.
+ *
+ * Page faults in these areas are resolved by sending IPC_M_PAGE_IN to the
+ * pager over the phone recorded in the area. The pager populates a page of
+ * anonymous memory in its own address space and the kernel maps the frame
+ * backing that page into the faulting address space. As the pager releases
+ * its mapping afterwards, each resolved page is private to the area and
+ * modifications are never written back.
+ */
+
+#include <mm/as.h>
+#include <mm/page.h>
+#include <genarch/mm/page_pt.h>
+#include <genarch/mm/page_ht.h>
+#include <mm/frame.h>
+#include <mm/reserve.h>
+#include <ipc/ipc.h>
+#include <abi/ipc/methods.h>
+#include <synch/mutex.h>
+#include <proc/task.h>
+#include <errno.h>
+#include <typedefs.h>
+#include <align.h>
+#include <panic.h>
+#include <debug.h>
+#include <arch.h>
+
+static bool user_create(as_area_t *);
+static bool user_resize(as_area_t *, size_t);
+static void user_destroy(as_area_t *);
+
+static int user_page_fault(as_area_t *, uintptr_t, pf_access_t);
+static void user_frame_free(as_area_t *, uintptr_t, uintptr_t);
+
+mem_backend_t user_backend = {
+	.create = user_create,
+	.resize = user_resize,
+	.share = NULL,
+	.destroy = user_destroy,
+
+	.page_fault = user_page_fault,
+	.frame_free = user_frame_free,
+};
+
+bool user_create(as_area_t *area)
+{
+	if (area->backend_data.pager_info.pager >= IPC_MAX_PHONES)
+		return false;
+	
+	return reserve_try_alloc(area->pages);
+}
+
+bool user_resize(as_area_t *area, size_t new_pages)
+{
+	if (new_pages > area->pages)
+		return reserve_try_alloc(new_pages - area->pages);
+	else if (new_pages < area->pages)
+		reserve_free(area->pages - new_pages);
+
+	return true;
+}
+
+void user_destroy(as_area_t *area)
+{
+	reserve_free(area->pages);
+}
+
+/** Service a page fault in the address space area backed by a user pager.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * The pager is waited for with all address space locks released, because the
+ * answer is processed under the same locks and other threads of the faulting
+ * task must not be blocked by a user space server. The locks are taken again
+ * afterwards and if the area has changed in the meantime, the page fault is
+ * restarted.
+ *
+ * @param area Pointer to the address space area.
+ * @param addr Faulting virtual address.
+ * @param access Access mode that caused the fault (i.e. read/write/exec).
+ *
+ * @return AS_PF_FAULT on failure (i.e. page fault), AS_PF_OK on success (i.e.
+ *     serviced) or AS_PF_RETRY if the area has changed while all locks were
+ *     released.
+ */
+int user_page_fault(as_area_t *area, uintptr_t addr, pf_access_t access)
+{
+	uintptr_t upage = ALIGN_DOWN(addr, PAGE_SIZE);
+	as_area_pager_info_t pager_info = area->backend_data.pager_info;
+	uintptr_t base = area->base;
+
+	ASSERT(page_table_locked(AS));
+	ASSERT(mutex_locked(&area->lock));
+
+	if (!as_area_check_access(area, access))
+		return AS_PF_FAULT;
+
+	phone_t *phone = &TASK->phones[pager_info.pager];
+	
+	call_t *call = ipc_call_alloc(0);
+	IPC_SET_IMETHOD(call->data, IPC_M_PAGE_IN);
+	IPC_SET_ARG1(call->data, upage - base);
+	IPC_SET_ARG2(call->data, PAGE_SIZE);
+	IPC_SET_ARG3(call->data, pager_info.id1);
+	IPC_SET_ARG4(call->data, pager_info.id2);
+	IPC_SET_ARG5(call->data, pager_info.id3);
+	
+	page_table_unlock(AS, false);
+	mutex_unlock(&area->lock);
+	mutex_unlock(&AS->lock);
+	
+	bool have_frame = false;
+	uintptr_t frame = 0;
+	int rc = ipc_call_sync(phone, call);
+	if (rc == EOK) {
+		/*
+		 * On success, the reference to the frame has been taken on
+		 * our behalf when the answer was processed.
+		 */
+		rc = IPC_GET_RETVAL(call->data);
+		frame = IPC_GET_ARG1(call->data);
+		have_frame = (rc == EOK);
+		ipc_call_free(call);
+	}
+	/* Otherwise the call will be freed by ipc_cleanup(). */
+	
+	if (!as_page_fault_relock(area, upage)) {
+		if (have_frame)
+			frame_free_noreserve(frame);
+		return AS_PF_RETRY;
+	}
+	
+	/*
+	 * The area may have been destroyed and another one created at the same
+	 * address while the locks were released.
+	 */
+	if ((area->backend != &user_backend) || (area->base != base) ||
+	    (area->backend_data.pager_info.pager != pager_info.pager) ||
+	    (area->backend_data.pager_info.id1 != pager_info.id1) ||
+	    (area->backend_data.pager_info.id2 != pager_info.id2) ||
+	    (area->backend_data.pager_info.id3 != pager_info.id3)) {
+		page_table_unlock(AS, false);
+		mutex_unlock(&area->lock);
+		mutex_unlock(&AS->lock);
+		if (have_frame)
+			frame_free_noreserve(frame);
+		return AS_PF_RETRY;
+	}
+	
+	if (!have_frame)
+		return AS_PF_FAULT;
+	
+	if (!as_area_check_access(area, access)) {
+		frame_free_noreserve(frame);
+		return AS_PF_FAULT;
+	}
+	
+	/*
+	 * Another thread may have resolved a fault on the same page while the
+	 * locks were released.
+	 */
+	pte_t *pte = page_mapping_find(AS, upage, false);
+	if ((pte) && (PTE_PRESENT(pte))) {
+		frame_free_noreserve(frame);
+		return AS_PF_OK;
+	}
+	
+	/* Map 'upage' to 'frame'. */
+	page_mapping_insert(AS, upage, frame, as_area_get_flags(area));
+	if (!used_space_insert(area, upage, 1))
+		panic("Cannot insert used space.");
+	
+	return AS_PF_OK;
+}
+
+/** Free a frame that is backed by the user memory backend.
+ *
+ * The address space area and page tables must be already locked.
+ *
+ * @param area Ignored.
+ * @param page Virtual address of the page corresponding to the frame.
+ * @param frame Frame to be released.
+ */
+void user_frame_free(as_area_t *area, uintptr_t page, uintptr_t frame)
+{
+	ASSERT(page_table_locked(area->as));
+	ASSERT(mutex_locked(&area->lock));
+
+	frame_free_noreserve(frame);
+}
+
+/** @}
+ */
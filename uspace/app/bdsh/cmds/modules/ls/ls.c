@@ -136,30 +136,21 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 	int alloc_blocks = 20;
 	int i;
 	int nbdirs = 0;
-	int rc;
-	int len;
-	char *buff;
 	struct dir_elem_t *tmp;
 	struct dir_elem_t *tosort;
 	struct dirent *dp;
+	struct stat s;
 	
 	if (!dirp)
 		return -1;
 
-	buff = (char *) malloc(PATH_MAX);
-	if (!buff) {
-		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
-		return -1;
-	}
-	
 	tosort = (struct dir_elem_t *) malloc(alloc_blocks * sizeof(*tosort));
 	if (!tosort) {
 		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
-		free(buff);
 		return -1;
 	}
 	
-	while ((dp = readdir(dirp))) {
+	while ((dp = readdirplus(dirp, &s))) {
 		if (nbdirs + 1 > alloc_blocks) {
 			alloc_blocks += alloc_blocks;
 			
@@ -180,15 +171,7 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 		}
 
 		str_cpy(tosort[nbdirs].name, str_size(dp->d_name) + 1, dp->d_name);
-		len = snprintf(buff, PATH_MAX - 1, "%s/%s", d, tosort[nbdirs].name);
-		buff[len] = '\0';
-
-		rc = stat(buff, &tosort[nbdirs++].s);
-		if (rc != 0) {
-			printf("ls: skipping bogus node %s\n", buff);
-			printf("rc=%d\n", rc);
-			goto out;
-		}
+		tosort[nbdirs++].s = s;
 	}
 	
 	if (ls.sort) {
@@ -224,7 +207,6 @@ out:
 	for(i = 0; i < nbdirs; i++)
 		free(tosort[i].name);
 	free(tosort);
-	free(buff);
 
 	return nbdirs;
 }
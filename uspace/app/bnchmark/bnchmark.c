@@ -48,11 +48,23 @@
 #include <errno.h>
 #include <time.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define NAME	"bnchmark"
 #define BUFSIZE 8096
 #define MBYTE (1024*1024)
 
+/** Amount of data appended by one run of the sequential-file-append test. */
+#define APPEND_SIZE (4 * MBYTE)
+
+/** Amount of data and chunk size of the large-file-append test. */
+#define LARGE_APPEND_SIZE (1024 * MBYTE)
+#define LARGE_APPEND_CHUNK 4096
+
+/** Percentage of free space used up by the fill-volume test. */
+#define FILL_PERCENT 90
+
 typedef int(*measure_func_t)(void *);
 typedef unsigned long umseconds_t; /* milliseconds */
 
@@ -138,6 +150,111 @@ static int sequential_read_dir(void *data)
 	return EOK;
 }
 
+static int sequential_append_file(void *data)
+{
+	char *path = (char *) data;
+	char *buf = malloc(BUFSIZE);
+	size_t total;
+
+	if (buf == NULL) {
+		return ENOMEM;
+	}
+	memset(buf, 0xaa, BUFSIZE);
+
+	int fd = open(path, O_CREAT | O_WRONLY | O_APPEND);
+	if (fd < 0) {
+		fprintf(stderr, "Failed opening file: %s\n", path);
+		free(buf);
+		return EIO;
+	}
+
+	for (total = 0; total < APPEND_SIZE; total += BUFSIZE) {
+		if (write(fd, buf, BUFSIZE) != BUFSIZE) {
+			fprintf(stderr, "Failed writing file\n");
+			close(fd);
+			free(buf);
+			return EIO;
+		}
+	}
+
+	close(fd);
+	free(buf);
+	return EOK;
+}
+
+static int large_append_file(void *data)
+{
+	char *path = (char *) data;
+	char *buf = malloc(LARGE_APPEND_CHUNK);
+	uint64_t total;
+
+	if (buf == NULL) {
+		return ENOMEM;
+	}
+	memset(buf, 0xaa, LARGE_APPEND_CHUNK);
+
+	int fd = open(path, O_CREAT | O_WRONLY | O_TRUNC | O_APPEND);
+	if (fd < 0) {
+		fprintf(stderr, "Failed opening file: %s\n", path);
+		free(buf);
+		return EIO;
+	}
+
+	for (total = 0; total < LARGE_APPEND_SIZE;
+	    total += LARGE_APPEND_CHUNK) {
+		if (write(fd, buf, LARGE_APPEND_CHUNK) != LARGE_APPEND_CHUNK) {
+			fprintf(stderr, "Failed writing file\n");
+			close(fd);
+			unlink(path);
+			free(buf);
+			return EIO;
+		}
+	}
+
+	close(fd);
+	unlink(path);
+	free(buf);
+	return EOK;
+}
+
+static int fill_volume(void *data)
+{
+	char *path = (char *) data;
+	char *buf = malloc(BUFSIZE);
+	aoff64_t total = 0;
+
+	if (buf == NULL) {
+		return ENOMEM;
+	}
+	memset(buf, 0x55, BUFSIZE);
+
+	int fd = open(path, O_CREAT | O_WRONLY | O_TRUNC);
+	if (fd < 0) {
+		fprintf(stderr, "Failed opening file: %s\n", path);
+		free(buf);
+		return EIO;
+	}
+
+	/* Use up all free space, then release the requested part of it. */
+	while (true) {
+		ssize_t cnt = write(fd, buf, BUFSIZE);
+		if (cnt <= 0)
+			break;
+		total += cnt;
+	}
+
+	if (ftruncate(fd, total * FILL_PERCENT / 100) != EOK) {
+		fprintf(stderr, "Failed truncating file\n");
+		close(fd);
+		free(buf);
+		return EIO;
+	}
+
+	close(fd);
+	free(buf);
+	return EOK;
+}
+
 int main(int argc, char **argv)
 {
 	int rc;
@@ -187,6 +304,15 @@ int main(int argc, char **argv)
 	else if (str_cmp(test_type, "sequential-dir-read") == 0) {
 		fn = sequential_read_dir;
 	}
+	else if (str_cmp(test_type, "sequential-file-append") == 0) {
+		fn = sequential_append_file;
+	}
+	else if (str_cmp(test_type, "large-file-append") == 0) {
+		fn = large_append_file;
+	}
+	else if (str_cmp(test_type, "fill-volume") == 0) {
+		fn = fill_volume;
+	}
 	else {
 		fprintf(stderr, "Error, unknown test type\n");
 		syntax_print();
@@ -214,8 +340,20 @@ static void syntax_print(void)
 	fprintf(stderr, "  <test-type>     one of:\n");
 	fprintf(stderr, "                    sequential-file-read\n");
 	fprintf(stderr, "                    sequential-dir-read\n");
+	fprintf(stderr, "                    sequential-file-append\n");
+	fprintf(stderr, "                    large-file-append\n");
+	fprintf(stderr, "                    fill-volume\n");
 	fprintf(stderr, "  <log-str>       a string to attach to results\n");
 	fprintf(stderr, "  <path>          file/directory to use for testing\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "To measure appending to a nearly full volume, format it\n");
+	fprintf(stderr, "with mkfat, mount it and run fill-volume with a filler\n");
+	fprintf(stderr, "file on it first. The filler occupies %d%% of the free\n",
+	    FILL_PERCENT);
+	fprintf(stderr, "space. Then run sequential-file-append with another file.\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "The large-file-append test appends 1 GiB to <path> in\n");
+	fprintf(stderr, "4 KiB writes and removes the file afterwards.\n");
 }
 
 /**
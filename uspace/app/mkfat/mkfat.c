@@ -54,6 +54,9 @@
 /** Divide and round up. */
 #define div_round_up(a, b) (((a) + (b) - 1) / (b))
 
+/** Sector holding the FAT32 file system information. */
+#define FSINFO_SECTOR  1
+
 /** Default file-system parameters */
 enum {
 	default_sector_size		= 512,
@@ -236,6 +239,8 @@ static int fat_params_compute(struct fat_cfg *cfg)
 	 */
 
 	cfg->reserved_sectors = 1 + cfg->addt_res_sectors;
+	if (cfg->fat_type == FAT32 && cfg->reserved_sectors <= FSINFO_SECTOR)
+		cfg->reserved_sectors = FSINFO_SECTOR + 1;
 	if (cfg->fat_type != FAT32) {
 		cfg->rootdir_sectors = div_round_up(cfg->root_ent_max * DIRENT_SIZE,
 			cfg->sector_size);
@@ -284,10 +289,25 @@ static int fat_blocks_write(struct fat_cfg const *cfg, service_id_t service_id)
 
 	/* Reserved sectors */
 	for (i = 0; i < cfg->reserved_sectors - 1; ++i) {
+		if (cfg->fat_type == FAT32 && addr == FSINFO_SECTOR) {
+			fat32_fsinfo_t *info = (fat32_fsinfo_t *) buffer;
+
+			/*
+			 * Let the file system start allocating right after
+			 * the root directory cluster.
+			 */
+			memcpy(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1));
+			memcpy(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2));
+			memcpy(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3));
+			info->free_clusters = host2uint32_t_le(0xffffffff);
+			info->last_allocated_cluster = host2uint32_t_le(3);
+		}
+
 		rc = block_write_direct(service_id, addr, 1, buffer);
 		if (rc != EOK)
 			return EIO;
 
+		memset(buffer, 0, cfg->sector_size);
 		++addr;
 	}
 
@@ -391,6 +411,7 @@ static void fat_bootsec_create(struct fat_cfg const *cfg, struct fat_bs *bs)
 		bs->fat32.ebs = 0x29;
 		bs->fat32.id = host2uint32_t_be(0x12345678);
 		bs->fat32.root_cluster = 2;
+		bs->fat32.fsinfo_sec = host2uint16_t_le(FSINFO_SECTOR);
 
 		memcpy(bs->fat32.label, "HELENOS_NEW", 11);
 		memcpy(bs->fat32.type, "FAT32   ", 8);
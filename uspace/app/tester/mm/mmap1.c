@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <as.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include "../tester.h"
+
+#define TEST_FILE   "/tmp/mmap1"
+#define FILE_PAGES  3
+#define FILE_TAIL   100
+
+static uint8_t pattern(size_t pos)
+{
+	return (uint8_t) ((pos * 7) ^ (pos >> 8));
+}
+
+static const char *check_mapping(uint8_t *map, size_t length, size_t fsize)
+{
+	size_t i;
+	for (i = 0; i < length; i++) {
+		uint8_t expected = (i < fsize) ? pattern(i) : 0;
+		if (map[i] != expected) {
+			TPRINTF("Mismatch at offset %zu\n", i);
+			return "Mapped data differ from file contents";
+		}
+	}
+	
+	return NULL;
+}
+
+const char *test_mmap1(void)
+{
+	size_t fsize = FILE_PAGES * PAGE_SIZE + FILE_TAIL;
+	size_t length = (FILE_PAGES + 1) * PAGE_SIZE;
+	
+	TPRINTF("Creating %s (%zu bytes)...\n", TEST_FILE, fsize);
+	int fd = open(TEST_FILE, O_CREAT | O_RDWR);
+	if (fd < 0)
+		return "open() failed";
+	
+	size_t i;
+	for (i = 0; i < fsize; i++) {
+		uint8_t byte = pattern(i);
+		if (write(fd, &byte, 1) != 1) {
+			close(fd);
+			return "write() failed";
+		}
+	}
+	
+	TPRINTF("Mapping the file read-only...\n");
+	uint8_t *map = mmap(NULL, length, PROTO_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		close(fd);
+		return "Read-only mmap() failed";
+	}
+	
+	/* The mapping must survive closing the descriptor. */
+	close(fd);
+	
+	const char *err = check_mapping(map, length, fsize);
+	munmap(map, length);
+	if (err != NULL)
+		return err;
+	
+	TPRINTF("Mapping the file privately with an offset...\n");
+	fd = open(TEST_FILE, O_RDWR);
+	if (fd < 0)
+		return "open() failed";
+	
+	map = mmap(NULL, PAGE_SIZE, PROTO_READ | PROTO_WRITE, MAP_PRIVATE,
+	    fd, PAGE_SIZE);
+	if (map == MAP_FAILED) {
+		close(fd);
+		return "Private mmap() failed";
+	}
+	
+	for (i = 0; i < PAGE_SIZE; i++) {
+		if (map[i] != pattern(PAGE_SIZE + i)) {
+			munmap(map, PAGE_SIZE);
+			close(fd);
+			return "Mapped data differ from file contents";
+		}
+		
+		map[i] = ~map[i];
+	}
+	
+	munmap(map, PAGE_SIZE);
+	
+	TPRINTF("Checking the file was not modified...\n");
+	uint8_t byte;
+	if ((lseek(fd, PAGE_SIZE, SEEK_SET) != PAGE_SIZE) ||
+	    (read(fd, &byte, 1) != 1)) {
+		close(fd);
+		return "read() failed";
+	}
+	
+	close(fd);
+	unlink(TEST_FILE);
+	
+	if (byte != pattern(PAGE_SIZE))
+		return "Private mapping modified the file";
+	
+	return NULL;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <mem.h>
+#include <net/checksum.h>
+#include <sys/types.h>
+#include "../tester.h"
+
+#define BUF_SIZE  2048
+#define MAX_OFFS  8
+
+/** Straightforward checksum computation one word at a time. */
+static uint16_t checksum_ref(uint16_t ivalue, const uint8_t *data, size_t size)
+{
+	uint32_t sum = (uint16_t) ~ivalue;
+	size_t i;
+	
+	for (i = 0; i + 1 < size; i += 2)
+		sum += ((uint16_t) data[i] << 8) | data[i + 1];
+	
+	if (size % 2 != 0)
+		sum += (uint16_t) data[size - 1] << 8;
+	
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+	
+	return (uint16_t) ~sum;
+}
+
+const char *test_checksum1(void)
+{
+	uint8_t *src = malloc(BUF_SIZE + MAX_OFFS);
+	uint8_t *dst = malloc(BUF_SIZE + MAX_OFFS);
+	if ((src == NULL) || (dst == NULL)) {
+		free(src);
+		free(dst);
+		return "Out of memory";
+	}
+	
+	size_t i;
+	for (i = 0; i < BUF_SIZE + MAX_OFFS; i++)
+		src[i] = (uint8_t) ((i * 131) ^ (i >> 3));
+	
+	TPRINTF("Checking sums at all alignments...\n");
+	
+	size_t offs;
+	size_t doffs;
+	size_t size;
+	for (offs = 0; offs < MAX_OFFS; offs++) {
+		for (size = 0; size < BUF_SIZE; size = size * 3 / 2 + 1) {
+			uint16_t ref = checksum_ref(INET_CHECKSUM_INIT,
+			    src + offs, size);
+			
+			if (inet_checksum_calc(INET_CHECKSUM_INIT, src + offs,
+			    size) != ref) {
+				TPRINTF("offs=%zu size=%zu\n", offs, size);
+				return "inet_checksum_calc() mismatch";
+			}
+			
+			for (doffs = 0; doffs < MAX_OFFS; doffs++) {
+				memset(dst, 0, BUF_SIZE + MAX_OFFS);
+				if (inet_checksum_copy(INET_CHECKSUM_INIT,
+				    dst + doffs, src + offs, size) != ref) {
+					TPRINTF("offs=%zu doffs=%zu size=%zu\n",
+					    offs, doffs, size);
+					return "inet_checksum_copy() mismatch";
+				}
+				
+				if (bcmp(dst + doffs, src + offs, size) != 0)
+					return "inet_checksum_copy() copy differs";
+			}
+		}
+	}
+	
+	TPRINTF("Checking chained and incremental computation...\n");
+	
+	uint16_t whole = checksum_ref(INET_CHECKSUM_INIT, src, BUF_SIZE);
+	uint16_t part = inet_checksum_calc(INET_CHECKSUM_INIT, src, 12);
+	if (inet_checksum_calc(part, src + 12, BUF_SIZE - 12) != whole)
+		return "Chained checksum mismatch";
+	
+	uint16_t oval = ((uint16_t) src[100] << 8) | src[101];
+	uint16_t nval = oval ^ 0x5a5a;
+	src[100] = nval >> 8;
+	src[101] = nval & 0xff;
+	
+	uint16_t updated = inet_checksum_update16(whole, oval, nval);
+	uint16_t fresh = checksum_ref(INET_CHECKSUM_INIT, src, BUF_SIZE);
+	
+	/* Zero and all ones both represent zero in one's complement */
+	if ((updated != fresh) && !((updated == 0 && fresh == 0xffff) ||
+	    (updated == 0xffff && fresh == 0)))
+		return "Incremental update mismatch";
+	
+	free(src);
+	free(dst);
+	
+	return NULL;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <macros.h>
+#include <mem.h>
+#include <net/pbuf.h>
+#include <sys/types.h>
+#include "../tester.h"
+
+#define HEADROOM  16
+#define TAILROOM  8
+#define DATA_SIZE 100
+
+const char *test_pbuf1(void)
+{
+	TPRINTF("Checking head and tail room...\n");
+	
+	pbuf_t *pbuf = pbuf_alloc(HEADROOM, DATA_SIZE, TAILROOM);
+	if (pbuf == NULL)
+		return "Out of memory";
+	
+	if ((pbuf_headroom(pbuf) != HEADROOM) ||
+	    (pbuf_tailroom(pbuf) != TAILROOM) ||
+	    (pbuf->size != DATA_SIZE)) {
+		pbuf_delref(pbuf);
+		return "Bad initial layout";
+	}
+	
+	size_t i;
+	for (i = 0; i < DATA_SIZE; i++)
+		pbuf->data[i] = (uint8_t) i;
+	
+	uint8_t *payload = pbuf->data;
+	
+	uint8_t *hdr = pbuf_push(pbuf, HEADROOM);
+	if ((hdr != payload - HEADROOM) || (pbuf_headroom(pbuf) != 0)) {
+		pbuf_delref(pbuf);
+		return "Push failed";
+	}
+	
+	memset(hdr, 0xaa, HEADROOM);
+	
+	if (pbuf_push(pbuf, 1) != NULL) {
+		pbuf_delref(pbuf);
+		return "Push beyond headroom succeeded";
+	}
+	
+	if ((pbuf_put(pbuf, TAILROOM) == NULL) ||
+	    (pbuf_put(pbuf, 1) != NULL)) {
+		pbuf_delref(pbuf);
+		return "Put does not respect tailroom";
+	}
+	
+	pbuf_trim(pbuf, HEADROOM + DATA_SIZE);
+	
+	if ((pbuf_pull(pbuf, HEADROOM) != payload) ||
+	    (pbuf->size != DATA_SIZE) || (pbuf->data[5] != 5)) {
+		pbuf_delref(pbuf);
+		return "Pull failed";
+	}
+	
+	if (pbuf_pull(pbuf, DATA_SIZE + 1) != NULL) {
+		pbuf_delref(pbuf);
+		return "Pull beyond data succeeded";
+	}
+	
+	TPRINTF("Checking chains...\n");
+	
+	uint8_t *raw = malloc(DATA_SIZE);
+	if (raw == NULL) {
+		pbuf_delref(pbuf);
+		return "Out of memory";
+	}
+	
+	for (i = 0; i < DATA_SIZE; i++)
+		raw[i] = (uint8_t) (DATA_SIZE + i);
+	
+	pbuf_t *tail = pbuf_adopt(raw, DATA_SIZE);
+	if (tail == NULL) {
+		free(raw);
+		pbuf_delref(pbuf);
+		return "Out of memory";
+	}
+	
+	pbuf_chain_append(pbuf, tail);
+	
+	if (pbuf_chain_size(pbuf) != 2 * DATA_SIZE) {
+		pbuf_delref(pbuf);
+		return "Bad chain size";
+	}
+	
+	uint8_t out[2 * DATA_SIZE];
+	size_t offs;
+	for (offs = 0; offs < 2 * DATA_SIZE; offs += 7) {
+		size_t copied = pbuf_copy_out(pbuf, offs, out, DATA_SIZE);
+		if (copied != min(DATA_SIZE, 2 * DATA_SIZE - offs)) {
+			pbuf_delref(pbuf);
+			return "Bad copy out size";
+		}
+		
+		for (i = 0; i < copied; i++) {
+			if (out[i] != (uint8_t) (offs + i)) {
+				pbuf_delref(pbuf);
+				return "Bad copy out data";
+			}
+		}
+	}
+	
+	TPRINTF("Checking reference counting...\n");
+	
+	/* Second reference keeps the chain alive */
+	pbuf_addref(pbuf);
+	pbuf_delref(pbuf);
+	
+	if (pbuf_copy_out(pbuf, DATA_SIZE, out, 1) != 1 ||
+	    out[0] != DATA_SIZE) {
+		pbuf_delref(pbuf);
+		return "Data lost while still referenced";
+	}
+	
+	pbuf_delref(pbuf);
+	
+	TPRINTF("Checking shared buffers...\n");
+	
+	pbuf = pbuf_alloc_shared(HEADROOM, DATA_SIZE, TAILROOM);
+	if (pbuf == NULL)
+		return "Out of memory";
+	
+	if ((pbuf->area == NULL) ||
+	    (pbuf_headroom(pbuf) != HEADROOM) ||
+	    (pbuf_tailroom(pbuf) != TAILROOM) ||
+	    (pbuf->size != DATA_SIZE)) {
+		pbuf_delref(pbuf);
+		return "Bad shared buffer";
+	}
+	
+	/* Our own shared buffer is kept by reference, not copied */
+	if (pbuf_keep(pbuf) != pbuf) {
+		pbuf_delref(pbuf);
+		return "Shared buffer copied";
+	}
+	
+	pbuf_delref(pbuf);
+	
+	uint8_t *buf = pbuf->buf;
+	pbuf_delref(pbuf);
+	
+	/* Freed space is reused */
+	pbuf = pbuf_alloc_shared(HEADROOM, DATA_SIZE, TAILROOM);
+	if (pbuf == NULL)
+		return "Out of memory";
+	
+	if (pbuf->buf != buf) {
+		pbuf_delref(pbuf);
+		return "Shared buffer space not reused";
+	}
+	
+	pbuf_delref(pbuf);
+	
+	return NULL;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <bool.h>
+#include <sys/types.h>
+#include <adt/ptrie.h>
+#include "../tester.h"
+
+#define PREFIXES  300
+#define ROUNDS    20000
+
+/** Prefix kept both in the trie and in a plain array */
+typedef struct {
+	link_t link;
+	uint32_t addr;
+	int bits;
+	bool inserted;
+} prefix_t;
+
+static uint32_t prefix_mask(int bits)
+{
+	return (bits == 0) ? 0 : (uint32_t) 0xffffffff << (32 - bits);
+}
+
+/** Random address from a small part of the address space to make
+ * prefixes overlap.
+ */
+static uint32_t random_addr(void)
+{
+	uint32_t addr = (((uint32_t) rand() << 16) ^ rand()) & 0xff0f00ff;
+	
+	if (rand() % 3 == 0)
+		addr &= 0xff000000;
+	
+	return addr;
+}
+
+/** Find the longest inserted prefix matching @a addr by a linear scan. */
+static prefix_t *lookup_ref(prefix_t *prefix, uint32_t addr)
+{
+	prefix_t *best = NULL;
+	size_t i;
+	
+	for (i = 0; i < PREFIXES; i++) {
+		if ((!prefix[i].inserted) ||
+		    (((addr ^ prefix[i].addr) & prefix_mask(prefix[i].bits)) != 0))
+			continue;
+		
+		if ((best == NULL) || (prefix[i].bits > best->bits))
+			best = &prefix[i];
+	}
+	
+	return best;
+}
+
+const char *test_ptrie1(void)
+{
+	const char *err = NULL;
+	ptrie_t trie;
+	size_t round;
+	size_t i;
+	
+	prefix_t *prefix = malloc(PREFIXES * sizeof(prefix_t));
+	if (prefix == NULL)
+		return "Out of memory";
+	
+	srand(1);
+	ptrie_init(&trie);
+	
+	for (i = 0; i < PREFIXES; i++) {
+		link_initialize(&prefix[i].link);
+		prefix[i].bits = rand() % 33;
+		prefix[i].addr = random_addr();
+		prefix[i].inserted = false;
+	}
+	
+	TPRINTF("Inserting, removing and looking up random prefixes...\n");
+	
+	for (round = 0; round < ROUNDS; round++) {
+		prefix_t *p = &prefix[rand() % PREFIXES];
+		
+		if (p->inserted) {
+			ptrie_remove(&trie, p->addr, p->bits, &p->link);
+			p->inserted = false;
+		} else {
+			if (ptrie_insert(&trie, p->addr, p->bits, &p->link) != EOK) {
+				err = "Insertion failed";
+				break;
+			}
+			p->inserted = true;
+		}
+		
+		uint32_t addr = random_addr();
+		if (rand() % 2)
+			addr = prefix[rand() % PREFIXES].addr | (rand() & 1);
+		
+		link_t *link = ptrie_lookup(&trie, addr);
+		prefix_t *best = lookup_ref(prefix, addr);
+		
+		if ((link == NULL) != (best == NULL)) {
+			TPRINTF("Round %zu: address %08x\n", round, addr);
+			err = "Lookup result differs in presence";
+			break;
+		}
+		
+		if (link != NULL) {
+			/* Any of several equal prefixes may be returned */
+			p = list_get_instance(link, prefix_t, link);
+			if ((p->bits != best->bits) ||
+			    (((p->addr ^ best->addr) & prefix_mask(p->bits)) != 0)) {
+				TPRINTF("Round %zu: address %08x\n", round, addr);
+				err = "Lookup found a different prefix";
+				break;
+			}
+		}
+	}
+	
+	for (i = 0; i < PREFIXES; i++) {
+		if (prefix[i].inserted)
+			ptrie_remove(&trie, prefix[i].addr, prefix[i].bits,
+			    &prefix[i].link);
+	}
+	
+	if ((err == NULL) && (trie.root != NULL))
+		err = "Trie not empty after removing all prefixes";
+	
+	free(prefix);
+	return err;
+}
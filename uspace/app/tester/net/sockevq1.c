@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <net/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "../tester.h"
+
+#define WAIT_USEC  20000
+
+const char *test_sockevq1(void)
+{
+	socket_event_t ev[2];
+	struct timeval t0, t1;
+	int rc;
+	
+	socket_evq_t *evq = socket_evq_create();
+	if (evq == NULL)
+		return "Out of memory";
+	
+	TPRINTF("Checking invalid arguments...\n");
+	
+	if (socket_evq_add(evq, -1, SOCKET_EV_READ, NULL) != ENOTSOCK) {
+		socket_evq_destroy(evq);
+		return "Adding invalid socket did not fail";
+	}
+	
+	if ((socket_evq_remove(evq, -1) != ENOENT) ||
+	    (socket_evq_modify(evq, -1, 0, NULL) != ENOENT)) {
+		socket_evq_destroy(evq);
+		return "Socket not in queue was found";
+	}
+	
+	if (socket_evq_wait(evq, ev, 0, 0) != EINVAL) {
+		socket_evq_destroy(evq);
+		return "Waiting for no events did not fail";
+	}
+	
+	TPRINTF("Checking timeout...\n");
+	
+	gettimeofday(&t0, NULL);
+	rc = socket_evq_wait(evq, ev, 2, WAIT_USEC);
+	gettimeofday(&t1, NULL);
+	
+	if (rc != 0) {
+		socket_evq_destroy(evq);
+		return "Empty queue reported events";
+	}
+	
+	if (tv_sub(&t1, &t0) < WAIT_USEC) {
+		socket_evq_destroy(evq);
+		return "Wait returned before timeout";
+	}
+	
+	TPRINTF("Checking socket readiness...\n");
+	
+	int sock = socket(PF_INET, SOCK_DGRAM, 0);
+	if (sock < 0) {
+		TPRINTF("No UDP service, skipping (%d)\n", sock);
+		socket_evq_destroy(evq);
+		return NULL;
+	}
+	
+	if (socket_evq_add(evq, sock, SOCKET_EV_READ, &ev) != EOK) {
+		closesocket(sock);
+		socket_evq_destroy(evq);
+		return "Adding socket failed";
+	}
+	
+	if (socket_evq_add(evq, sock, SOCKET_EV_READ, &ev) != EEXIST) {
+		closesocket(sock);
+		socket_evq_destroy(evq);
+		return "Adding socket twice did not fail";
+	}
+	
+	if (socket_evq_wait(evq, ev, 2, 0) != 0) {
+		closesocket(sock);
+		socket_evq_destroy(evq);
+		return "Idle socket reported readable";
+	}
+	
+	socket_evq_modify(evq, sock, SOCKET_EV_READ | SOCKET_EV_WRITE, &ev);
+	rc = socket_evq_wait(evq, ev, 2, 0);
+	if ((rc != 1) || (ev[0].socket_id != sock) ||
+	    (ev[0].events != SOCKET_EV_WRITE) || (ev[0].arg != &ev)) {
+		closesocket(sock);
+		socket_evq_destroy(evq);
+		return "Socket not reported writable";
+	}
+	
+	/* Closing the socket removes it from the queue */
+	closesocket(sock);
+	
+	if ((socket_evq_wait(evq, ev, 2, 0) != 0) ||
+	    (socket_evq_remove(evq, sock) != ENOENT)) {
+		socket_evq_destroy(evq);
+		return "Closed socket still in queue";
+	}
+	
+	socket_evq_destroy(evq);
+	return NULL;
+}
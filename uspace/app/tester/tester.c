@@ -58,6 +58,8 @@ test_t tests[] = {
 #include "fault/fault2.def"
 #include "fault/fault3.def"
 #include "vfs/vfs1.def"
+#include "vfs/vfs2.def"
+#include "vfs/vfs3.def"
 #include "ipc/ping_pong.def"
 #include "ipc/starve.def"
 #include "loop/loop1.def"
@@ -65,6 +67,11 @@ test_t tests[] = {
 #include "mm/malloc2.def"
 #include "mm/malloc3.def"
 #include "mm/mapping1.def"
+#include "mm/mmap1.def"
+#include "net/checksum1.def"
+#include "net/pbuf1.def"
+#include "net/ptrie1.def"
+#include "net/sockevq1.def"
 #include "hw/serial/serial1.def"
 #include "hw/misc/virtchar1.def"
 #include "libext2/libext2_1.def"
@@ -91,6 +91,8 @@ extern const char *test_fault1(void);
 extern const char *test_fault2(void);
 extern const char *test_fault3(void);
 extern const char *test_vfs1(void);
+extern const char *test_vfs2(void);
+extern const char *test_vfs3(void);
 extern const char *test_ping_pong(void);
 extern const char *test_starve_ipc(void);
 extern const char *test_loop1(void);
@@ -98,6 +100,11 @@ extern const char *test_malloc1(void);
 extern const char *test_malloc2(void);
 extern const char *test_malloc3(void);
 extern const char *test_mapping1(void);
+extern const char *test_mmap1(void);
+extern const char *test_checksum1(void);
+extern const char *test_pbuf1(void);
+extern const char *test_ptrie1(void);
+extern const char *test_sockevq1(void);
 extern const char *test_serial1(void);
 extern const char *test_virtchar1(void);
 extern const char *test_libext2_1(void);
@@ -31,12 +31,15 @@
 #include <stdlib.h>
 #include <str.h>
 #include <vfs/vfs.h>
+#include <vfs/aio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <loc.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/typefmt.h>
 #include "../tester.h"
 
 #define TEST_DIRECTORY  "/tmp/testdir"
@@ -105,8 +108,55 @@ const char *test_vfs1(void)
 		}
 	}
 	
+	cnt = pread(fd0, buf, 5, 6);
+	if ((cnt != 5) || (str_lcmp(buf, "ipsum", 5) != 0))
+		return "pread() failed";
+	TPRINTF("Read \"%.5s\" at position 6\n", buf);
+	
+	char vbuf[2][BUF_SIZE];
+	struct iovec iov[2] = {
+		{ .iov_base = vbuf[0], .iov_len = 5 },
+		{ .iov_base = vbuf[1], .iov_len = 6 }
+	};
+	cnt = preadv(fd0, iov, 2, 0);
+	if ((cnt != 11) || (str_lcmp(vbuf[0], "Lorem", 5) != 0) ||
+	    (str_lcmp(vbuf[1], " ipsum", 6) != 0))
+		return "preadv() failed";
+	TPRINTF("Read \"%.5s\" and \"%.6s\" in one request\n", vbuf[0],
+	    vbuf[1]);
+	
+	vfs_aio_t aio[2];
+	vfs_aio_t *aios[2] = { &aio[0], &aio[1] };
+	if ((vfs_aio_read(&aio[0], fd0, vbuf[0], 5, 0) != EOK) ||
+	    (vfs_aio_read(&aio[1], fd0, vbuf[1], 5, 6) != EOK))
+		return "vfs_aio_read() failed";
+	if ((vfs_aio_wait_all(aios, 2) != EOK) ||
+	    (aio[0].result != 5) || (aio[1].result != 5) ||
+	    (str_lcmp(vbuf[0], "Lorem", 5) != 0) ||
+	    (str_lcmp(vbuf[1], "ipsum", 5) != 0))
+		return "vfs_aio_wait_all() failed";
+	TPRINTF("Read \"%.5s\" and \"%.5s\" asynchronously\n", vbuf[0],
+	    vbuf[1]);
+	
 	close(fd0);
 	
+	DIR *dirp = opendir(TEST_DIRECTORY);
+	if (!dirp)
+		return "opendir() failed";
+	struct stat st;
+	struct dirent *dp = readdirplus(dirp, &st);
+	if ((!dp) || (str_cmp(dp->d_name, "testfile") != 0) ||
+	    (!st.is_file) || (st.size != sizeof(text))) {
+		closedir(dirp);
+		return "readdirplus() failed";
+	}
+	TPRINTF("Listed \"%s\" of size %" PRIuOFF64 "\n", dp->d_name,
+	    st.size);
+	dp = readdirplus(dirp, &st);
+	closedir(dirp);
+	if (dp)
+		return "readdirplus() returned an unexpected entry";
+	
 	const char *rv = read_root();
 	if (rv != NULL)
 		return rv;
@@ -115,6 +165,15 @@ const char *test_vfs1(void)
 		return "rename() failed";
 	TPRINTF("Renamed %s to %s\n", TEST_FILE, TEST_FILE2);
 	
+	/* The old name must not be resolvable via any cached lookup. */
+	fd0 = open(TEST_FILE, O_RDONLY);
+	if (fd0 >= 0)
+		return "open() of the old name succeeded";
+	fd0 = open(TEST_FILE2, O_RDONLY);
+	if (fd0 < 0)
+		return "open() of the new name failed";
+	close(fd0);
+	
 	if (unlink(TEST_FILE2))
 		return "unlink() failed";
 	TPRINTF("Unlinked %s\n", TEST_FILE2);
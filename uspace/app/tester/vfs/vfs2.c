@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/typefmt.h>
+#include "../tester.h"
+
+#define DEFAULT_FILE    "/tmp/vfs2.tmp"
+#define DEFAULT_SIZE    1024   /* MiB */
+#define MBYTE           (1024 * 1024)
+
+#define WRITE_SIZE      (64 * 1024)
+#define READ_SIZE       4096
+#define READ_COUNT      4096
+
+/** Fill a buffer with the pattern of the READ_SIZE blocks starting at blk. */
+static void fill_pattern(uint64_t *buf, size_t size, uint64_t blk)
+{
+	size_t i;
+
+	for (i = 0; i < size / sizeof(uint64_t); i++)
+		buf[i] = blk + (i * sizeof(uint64_t)) / READ_SIZE;
+}
+
+/** Random 4 KiB reads over a large file.
+ *
+ * Usage: vfs2 [<file> [<size in MiB>]]
+ *
+ * The file is created and filled with a pattern identifying each 4 KiB
+ * block, then read at random block offsets. The random phase exercises
+ * the file system's translation of file offsets to disk blocks.
+ */
+const char *test_vfs2(void)
+{
+	const char *path = DEFAULT_FILE;
+	size_t size_mb = DEFAULT_SIZE;
+	struct timeval t0, t1;
+	uint64_t *buf;
+	uint64_t blocks;
+	uint64_t blk;
+	const char *err = NULL;
+	unsigned i;
+	int fd;
+
+	if (test_argc >= 1)
+		path = test_argv[0];
+	if (test_argc >= 2) {
+		if (str_size_t(test_argv[1], NULL, 0, true, &size_mb) != EOK ||
+		    size_mb == 0)
+			return "Invalid argument, file size in MiB expected";
+	}
+
+	buf = malloc(WRITE_SIZE);
+	if (buf == NULL)
+		return "Failed allocating buffer";
+
+	fd = open(path, O_CREAT | O_TRUNC | O_RDWR);
+	if (fd < 0) {
+		free(buf);
+		return "open() failed";
+	}
+
+	blocks = ((uint64_t) size_mb * MBYTE) / READ_SIZE;
+	TPRINTF("Writing %zu MiB to %s...", size_mb, path);
+	for (blk = 0; blk < blocks; blk += WRITE_SIZE / READ_SIZE) {
+		fill_pattern(buf, WRITE_SIZE, blk);
+		if (write_all(fd, buf, WRITE_SIZE) != WRITE_SIZE) {
+			TPRINTF("\n");
+			err = "write() failed";
+			goto out;
+		}
+	}
+	TPRINTF("OK\n");
+
+	TPRINTF("Reading %u random blocks...", READ_COUNT);
+	srandom(blocks);
+	gettimeofday(&t0, NULL);
+	for (i = 0; i < READ_COUNT; i++) {
+		blk = ((uint64_t) random() * RAND_MAX + random()) % blocks;
+		if (pread(fd, buf, READ_SIZE, blk * READ_SIZE) != READ_SIZE) {
+			TPRINTF("\n");
+			err = "pread() failed";
+			goto out;
+		}
+		if (buf[0] != blk || buf[READ_SIZE / sizeof(uint64_t) - 1] != blk) {
+			TPRINTF("\nblock %" PRIu64 " read as %" PRIu64 "\n",
+			    blk, buf[0]);
+			err = "Read data differ";
+			goto out;
+		}
+	}
+	gettimeofday(&t1, NULL);
+	TPRINTF("OK\n");
+
+	suseconds_t us = tv_sub(&t1, &t0);
+	TPRINTF("%u reads took %" PRIu64 " ms (%" PRIu64 " us per read)\n",
+	    READ_COUNT, (uint64_t) us / 1000, (uint64_t) us / READ_COUNT);
+
+out:
+	close(fd);
+	unlink(path);
+	free(buf);
+	return err;
+}
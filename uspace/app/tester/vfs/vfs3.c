@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <str.h>
+#include <vfs/vfs.h>
+#include <vfs/vfs_mtab.h>
+#include "../tester.h"
+
+/** File system whose cluster allocation the test exercises */
+#define TEST_FS         "exfat"
+
+/** Initial size of the extended file, not a multiple of any cluster size */
+#define HEAD_SIZE       1000
+/** Size of the extension, written in one request */
+#define EXT_SIZE        (60 * 1024)
+/** Size of the neighbouring file */
+#define NEXT_SIZE       (64 * 1024)
+
+static void fill_pattern(uint8_t *buf, size_t size, size_t offs, uint8_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = (uint8_t) ((offs + i) * 7 + seed);
+}
+
+/** Check that file contents match the pattern. */
+static bool check_file(const char *path, size_t size, uint8_t seed,
+    uint8_t *buf, uint8_t *pat)
+{
+	ssize_t nr;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	nr = read_all(fd, buf, size + 1);
+	close(fd);
+
+	if (nr != (ssize_t) size)
+		return false;
+
+	fill_pattern(pat, size, 0, seed);
+	return bcmp(buf, pat, size) == 0;
+}
+
+/** Find the mount point of a file system of the tested type.
+ *
+ * @return Mount point or NULL if there is none.
+ */
+static char *find_test_fs(void)
+{
+	LIST_INITIALIZE(mtab_list);
+	char *mp = NULL;
+
+	if (get_mtab_list(&mtab_list) != EOK)
+		return NULL;
+
+	while (!list_empty(&mtab_list)) {
+		mtab_ent_t *ent = list_get_instance(list_first(&mtab_list),
+		    mtab_ent_t, link);
+
+		if (mp == NULL && str_cmp(ent->fs_name, TEST_FS) == 0)
+			mp = str_dup(ent->mp);
+
+		list_remove(&ent->link);
+		free(ent);
+	}
+
+	return mp;
+}
+
+/** Extend a file by a write crossing its last cluster boundary.
+ *
+ * Usage: vfs3 [<directory>]
+ *
+ * The directory defaults to the first mounted exFAT file system. The test
+ * is skipped if there is none.
+ *
+ * A short file is created and another file is written right after it, so
+ * that it likely occupies the clusters following the first one. The first
+ * file is then extended by a single large write starting before the end
+ * of its last cluster. Both files must read back intact, i.e. the write
+ * must not spill into clusters of the other file.
+ */
+const char *test_vfs3(void)
+{
+	char *dir = NULL;
+	char *path_a = NULL;
+	char *path_b = NULL;
+	const char *err = NULL;
+	uint8_t *buf = NULL;
+	uint8_t *pat = NULL;
+	int fd;
+
+	if (test_argc >= 1) {
+		dir = str_dup(test_argv[0]);
+		if (dir == NULL)
+			return "Out of memory";
+	} else {
+		dir = find_test_fs();
+		if (dir == NULL) {
+			TPRINTF("No %s file system mounted, skipping\n",
+			    TEST_FS);
+			return NULL;
+		}
+	}
+
+	buf = malloc(NEXT_SIZE + 1);
+	pat = malloc(NEXT_SIZE + 1);
+	if (buf == NULL || pat == NULL ||
+	    asprintf(&path_a, "%s/vfs3a.tmp", dir) < 0 ||
+	    asprintf(&path_b, "%s/vfs3b.tmp", dir) < 0) {
+		err = "Out of memory";
+		goto out;
+	}
+
+	TPRINTF("Creating %s and %s...", path_a, path_b);
+
+	fd = open(path_a, O_CREAT | O_TRUNC | O_RDWR);
+	if (fd < 0) {
+		err = "open() failed";
+		goto out;
+	}
+
+	fill_pattern(buf, HEAD_SIZE, 0, 1);
+	if (write_all(fd, buf, HEAD_SIZE) != HEAD_SIZE) {
+		close(fd);
+		err = "write() failed";
+		goto out;
+	}
+
+	close(fd);
+
+	fd = open(path_b, O_CREAT | O_TRUNC | O_RDWR);
+	if (fd < 0) {
+		err = "open() failed";
+		goto out;
+	}
+
+	fill_pattern(buf, NEXT_SIZE, 0, 2);
+	if (write_all(fd, buf, NEXT_SIZE) != NEXT_SIZE) {
+		close(fd);
+		err = "write() failed";
+		goto out;
+	}
+
+	close(fd);
+	TPRINTF("OK\n");
+
+	TPRINTF("Extending %s...", path_a);
+
+	fd = open(path_a, O_RDWR);
+	if (fd < 0) {
+		err = "open() failed";
+		goto out;
+	}
+
+	/* The first request covers the whole extension */
+	fill_pattern(buf, EXT_SIZE, HEAD_SIZE, 1);
+	if (lseek(fd, HEAD_SIZE, SEEK_SET) != HEAD_SIZE ||
+	    write_all(fd, buf, EXT_SIZE) != EXT_SIZE) {
+		close(fd);
+		err = "write() failed";
+		goto out;
+	}
+
+	close(fd);
+	TPRINTF("OK\n");
+
+	TPRINTF("Verifying...");
+
+	if (!check_file(path_b, NEXT_SIZE, 2, buf, pat)) {
+		TPRINTF("\n");
+		err = "Neighbouring file corrupted";
+		goto out;
+	}
+
+	if (!check_file(path_a, HEAD_SIZE + EXT_SIZE, 1, buf, pat)) {
+		TPRINTF("\n");
+		err = "Extended file differs";
+		goto out;
+	}
+
+	TPRINTF("OK\n");
+
+out:
+	if (path_a != NULL) {
+		unlink(path_a);
+		free(path_a);
+	}
+	if (path_b != NULL) {
+		unlink(path_b);
+		free(path_b);
+	}
+	free(buf);
+	free(pat);
+	free(dir);
+	return err;
+}
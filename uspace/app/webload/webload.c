@@ -0,0 +1,585 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup webload
+ * @{
+ */
+/**
+ * @file HTTP load generator.
+ *
+ * Issues GET requests over several concurrent connections and reports
+ * throughput and latency percentiles.
+ */
+
+#include <bool.h>
+#include <errno.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <sort.h>
+
+#include <net/in.h>
+#include <net/inet.h>
+#include <net/socket.h>
+
+#include <arg_parse.h>
+#include <macros.h>
+#include <str.h>
+#include <str_error.h>
+
+#define NAME  "webload"
+
+#define DEFAULT_PORT         8080
+#define DEFAULT_CONNECTIONS  4
+#define DEFAULT_REQUESTS     1000
+
+#define BUFFER_SIZE  1024
+
+/** Client connection state. */
+typedef struct {
+	/** Connection socket or -1 if not connected */
+	int sd;
+	/** Server is going to close the connection */
+	bool server_close;
+
+	char rbuf[BUFFER_SIZE];
+	size_t rbuf_out;
+	size_t rbuf_in;
+
+	char lbuf[BUFFER_SIZE + 1];
+} client_t;
+
+static struct sockaddr_in server_addr;
+static uint16_t port = DEFAULT_PORT;
+static const char *uri = "/";
+static int connections = DEFAULT_CONNECTIONS;
+static int requests = DEFAULT_REQUESTS;
+static bool keep_alive = true;
+static bool verbose = false;
+
+/** Statistics, protected by @c stats_lock */
+static FIBRIL_MUTEX_INITIALIZE(stats_lock);
+static FIBRIL_CONDVAR_INITIALIZE(done_cv);
+static int req_issued;
+static int req_done;
+static int req_failed;
+static int conn_opened;
+static uint64_t bytes_recv;
+static int clients_running;
+static suseconds_t *latency;
+
+/** Receive one character (with buffering) */
+static int recv_char(client_t *client, char *c)
+{
+	if (client->rbuf_out == client->rbuf_in) {
+		client->rbuf_out = 0;
+		client->rbuf_in = 0;
+
+		ssize_t rc = recv(client->sd, client->rbuf, BUFFER_SIZE, 0);
+		if (rc <= 0)
+			return (rc == 0) ? ENOTCONN : rc;
+
+		client->rbuf_in = rc;
+	}
+
+	*c = client->rbuf[client->rbuf_out++];
+	return EOK;
+}
+
+/** Receive one line with length limit, the line terminator is stripped */
+static int recv_line(client_t *client)
+{
+	char *bp = client->lbuf;
+	char c = '\0';
+
+	while (bp < client->lbuf + BUFFER_SIZE) {
+		char prev = c;
+		int rc = recv_char(client, &c);
+
+		if (rc != EOK)
+			return rc;
+
+		*bp++ = c;
+		if ((prev == '\r') && (c == '\n')) {
+			bp[-2] = '\0';
+			return EOK;
+		}
+	}
+
+	return ELIMIT;
+}
+
+/** Receive and discard response body.
+ *
+ * @param size Body size
+ */
+static int recv_body(client_t *client, size_t size)
+{
+	size_t avail = min(size, client->rbuf_in - client->rbuf_out);
+	client->rbuf_out += avail;
+	size -= avail;
+
+	while (size > 0) {
+		ssize_t rc = recv(client->sd, client->rbuf,
+		    min(size, BUFFER_SIZE), 0);
+		if (rc <= 0)
+			return (rc == 0) ? ENOTCONN : rc;
+
+		size -= rc;
+	}
+
+	return EOK;
+}
+
+/** Check whether header line has the given field name (case-insensitive).
+ *
+ * @return Pointer to the field value or @c NULL
+ */
+static char *header_match(char *line, const char *name)
+{
+	while (*name != '\0') {
+		if (tolower(*line) != tolower(*name))
+			return NULL;
+		line++;
+		name++;
+	}
+
+	if (*line != ':')
+		return NULL;
+
+	line++;
+	while (*line == ' ' || *line == '\t')
+		line++;
+
+	return line;
+}
+
+static int client_connect(client_t *client)
+{
+	int sd = socket(PF_INET, SOCK_STREAM, 0);
+	if (sd < 0)
+		return sd;
+
+	int rc = connect(sd, (struct sockaddr *) &server_addr,
+	    sizeof(server_addr));
+	if (rc != EOK) {
+		closesocket(sd);
+		return rc;
+	}
+
+	client->sd = sd;
+	client->server_close = false;
+	client->rbuf_out = 0;
+	client->rbuf_in = 0;
+
+	fibril_mutex_lock(&stats_lock);
+	conn_opened++;
+	fibril_mutex_unlock(&stats_lock);
+
+	return EOK;
+}
+
+static void client_disconnect(client_t *client)
+{
+	closesocket(client->sd);
+	client->sd = -1;
+}
+
+/** Send request and receive the complete response.
+ *
+ * @param rsize Place to store size of the response body
+ */
+static int client_request(client_t *client, size_t *rsize)
+{
+	char *req;
+	int rc = asprintf(&req, "GET %s HTTP/1.1\r\n"
+	    "Connection: %s\r\n"
+	    "\r\n", uri, keep_alive ? "keep-alive" : "close");
+	if (rc < 0)
+		return ENOMEM;
+
+	rc = send(client->sd, req, str_size(req), 0);
+	free(req);
+	if (rc < 0)
+		return rc;
+
+	/* Status line */
+	rc = recv_line(client);
+	if (rc != EOK)
+		return rc;
+
+	if (str_lcmp(client->lbuf, "HTTP/1.", 7) != 0)
+		return EIO;
+
+	if (str_lcmp(client->lbuf, "HTTP/1.1", 8) != 0)
+		client->server_close = true;
+
+	char *status = str_chr(client->lbuf, ' ');
+	bool ok = (status != NULL) && (str_lcmp(status + 1, "200", 3) == 0);
+
+	/* Header fields */
+	bool have_length = false;
+	size_t length = 0;
+
+	while (true) {
+		rc = recv_line(client);
+		if (rc != EOK)
+			return rc;
+
+		if (client->lbuf[0] == '\0')
+			break;
+
+		char *value = header_match(client->lbuf, "Content-Length");
+		if (value != NULL) {
+			length = strtoul(value, NULL, 10);
+			have_length = true;
+		}
+
+		value = header_match(client->lbuf, "Connection");
+		if (value != NULL && str_lcmp(value, "close", 5) == 0)
+			client->server_close = true;
+	}
+
+	if (!have_length) {
+		/* Body is delimited by closing the connection */
+		client->server_close = true;
+		length = client->rbuf_in - client->rbuf_out;
+		client->rbuf_out = client->rbuf_in;
+
+		while (true) {
+			ssize_t nr = recv(client->sd, client->rbuf,
+			    BUFFER_SIZE, 0);
+			if (nr <= 0)
+				break;
+
+			length += nr;
+		}
+	} else {
+		rc = recv_body(client, length);
+		if (rc != EOK)
+			return rc;
+	}
+
+	*rsize = length;
+	return ok ? EOK : EIO;
+}
+
+/** Client fibril.
+ *
+ * Takes requests from the shared budget until it is exhausted.
+ */
+static int client_fibril(void *arg)
+{
+	client_t *client = (client_t *) arg;
+	struct timeval t0, t1;
+	size_t rsize;
+	int rc;
+
+	client->sd = -1;
+
+	while (true) {
+		fibril_mutex_lock(&stats_lock);
+		if (req_issued >= requests) {
+			fibril_mutex_unlock(&stats_lock);
+			break;
+		}
+		req_issued++;
+		fibril_mutex_unlock(&stats_lock);
+
+		gettimeofday(&t0, NULL);
+
+		rc = EOK;
+		if (client->sd < 0)
+			rc = client_connect(client);
+
+		if (rc == EOK) {
+			rc = client_request(client, &rsize);
+			if (rc != EOK || client->server_close || !keep_alive)
+				client_disconnect(client);
+		}
+
+		gettimeofday(&t1, NULL);
+
+		fibril_mutex_lock(&stats_lock);
+		if (rc == EOK) {
+			latency[req_done++] = tv_sub(&t1, &t0);
+			bytes_recv += rsize;
+		} else {
+			req_failed++;
+			if (verbose)
+				fprintf(stderr, "Request failed (%s)\n",
+				    str_error(rc));
+		}
+		fibril_mutex_unlock(&stats_lock);
+	}
+
+	if (client->sd >= 0)
+		client_disconnect(client);
+
+	fibril_mutex_lock(&stats_lock);
+	clients_running--;
+	fibril_condvar_broadcast(&done_cv);
+	fibril_mutex_unlock(&stats_lock);
+
+	return EOK;
+}
+
+static int latency_cmp(void *a, void *b, void *arg)
+{
+	suseconds_t la = *(suseconds_t *) a;
+	suseconds_t lb = *(suseconds_t *) b;
+
+	if (la < lb)
+		return -1;
+
+	return (la > lb) ? 1 : 0;
+}
+
+/** Return latency percentile, latencies must be sorted. */
+static suseconds_t latency_pct(int pct)
+{
+	return latency[(req_done - 1) * pct / 100];
+}
+
+static void print_results(suseconds_t elapsed)
+{
+	if (elapsed <= 0)
+		elapsed = 1;
+
+	printf("%d requests, %d failed, %d connections opened\n",
+	    req_done + req_failed, req_failed, conn_opened);
+	printf("Time: %ld.%03ld s, %" PRIu64 " requests/s, "
+	    "%" PRIu64 " bytes/s\n", (long) (elapsed / 1000000),
+	    (long) ((elapsed / 1000) % 1000),
+	    (uint64_t) req_done * 1000000 / elapsed,
+	    bytes_recv * 1000000 / elapsed);
+
+	if (req_done == 0)
+		return;
+
+	qsort(latency, req_done, sizeof(suseconds_t), latency_cmp, NULL);
+
+	printf("Latency (us): min %ld, 50%% %ld, 90%% %ld, 99%% %ld, "
+	    "max %ld\n", (long) latency[0], (long) latency_pct(50),
+	    (long) latency_pct(90), (long) latency_pct(99),
+	    (long) latency[req_done - 1]);
+}
+
+static void usage(void)
+{
+	printf("HTTP load generator\n"
+	    "\n"
+	    "Usage: " NAME " [options] [address]\n"
+	    "\n"
+	    "Where options are:\n"
+	    "-p port_number | --port=port_number\n"
+	    "\tServer port (default " STRING(DEFAULT_PORT) ").\n"
+	    "\n"
+	    "-c count | --connections=count\n"
+	    "\tNumber of concurrent connections (default "
+	    STRING(DEFAULT_CONNECTIONS) ").\n"
+	    "\n"
+	    "-n count | --requests=count\n"
+	    "\tTotal number of requests (default "
+	    STRING(DEFAULT_REQUESTS) ").\n"
+	    "\n"
+	    "-u uri | --uri=uri\n"
+	    "\tRequested URI (default /).\n"
+	    "\n"
+	    "-C | --close\n"
+	    "\tOpen a new connection for every request.\n"
+	    "\n"
+	    "-h | --help\n"
+	    "\tShow this application help.\n"
+	    "-v | --verbose\n"
+	    "\tVerbose mode\n"
+	    "\n"
+	    "The default address is 127.0.0.1.\n");
+}
+
+static int parse_option(int argc, char *argv[], int *index)
+{
+	int value;
+	int rc;
+
+	switch (argv[*index][1]) {
+	case 'h':
+		usage();
+		exit(0);
+		break;
+	case 'p':
+		rc = arg_parse_int(argc, argv, index, &value, 0);
+		if (rc != EOK)
+			return rc;
+
+		port = (uint16_t) value;
+		break;
+	case 'c':
+		rc = arg_parse_int(argc, argv, index, &connections, 0);
+		if (rc != EOK)
+			return rc;
+		break;
+	case 'n':
+		rc = arg_parse_int(argc, argv, index, &requests, 0);
+		if (rc != EOK)
+			return rc;
+		break;
+	case 'u':
+		rc = arg_parse_string(argc, argv, index, (char **) &uri, 0);
+		if (rc != EOK)
+			return rc;
+		break;
+	case 'C':
+		keep_alive = false;
+		break;
+	case 'v':
+		verbose = true;
+		break;
+	/* Long options with double dash */
+	case '-':
+		if (str_lcmp(argv[*index] + 2, "help", 5) == 0) {
+			usage();
+			exit(0);
+		} else if (str_lcmp(argv[*index] + 2, "port=", 5) == 0) {
+			rc = arg_parse_int(argc, argv, index, &value, 7);
+			if (rc != EOK)
+				return rc;
+
+			port = (uint16_t) value;
+		} else if (str_lcmp(argv[*index] + 2, "connections=", 12) == 0) {
+			rc = arg_parse_int(argc, argv, index, &connections, 14);
+			if (rc != EOK)
+				return rc;
+		} else if (str_lcmp(argv[*index] + 2, "requests=", 9) == 0) {
+			rc = arg_parse_int(argc, argv, index, &requests, 11);
+			if (rc != EOK)
+				return rc;
+		} else if (str_lcmp(argv[*index] + 2, "uri=", 4) == 0) {
+			rc = arg_parse_string(argc, argv, index, (char **) &uri,
+			    6);
+			if (rc != EOK)
+				return rc;
+		} else if (str_cmp(argv[*index] + 2, "close") == 0) {
+			keep_alive = false;
+		} else if (str_cmp(argv[*index] + 2, "verbose") == 0) {
+			verbose = true;
+		} else {
+			usage();
+			return EINVAL;
+		}
+		break;
+	default:
+		usage();
+		return EINVAL;
+	}
+
+	return EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *addr_str = "127.0.0.1";
+
+	/* Parse command line arguments */
+	for (int i = 1; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			int rc = parse_option(argc, argv, &i);
+			if (rc != EOK)
+				return rc;
+		} else if (i == argc - 1) {
+			addr_str = argv[i];
+		} else {
+			usage();
+			return EINVAL;
+		}
+	}
+
+	if (connections <= 0 || requests <= 0) {
+		usage();
+		return EINVAL;
+	}
+
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_port = htons(port);
+
+	int rc = inet_pton(AF_INET, addr_str, (void *)
+	    &server_addr.sin_addr.s_addr);
+	if (rc != EOK) {
+		fprintf(stderr, "Error parsing network address (%s)\n",
+		    str_error(rc));
+		return 1;
+	}
+
+	latency = calloc(requests, sizeof(suseconds_t));
+	client_t *clients = calloc(connections, sizeof(client_t));
+	if (latency == NULL || clients == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 2;
+	}
+
+	printf("%s: %d requests for %s over %d %s connections\n", NAME,
+	    requests, uri, connections, keep_alive ? "persistent" : "one-shot");
+
+	struct timeval start, end;
+	gettimeofday(&start, NULL);
+
+	for (int i = 0; i < connections; i++) {
+		fid_t fid = fibril_create(client_fibril, &clients[i]);
+		if (fid == 0) {
+			fprintf(stderr, "Error creating client fibril\n");
+			break;
+		}
+
+		fibril_mutex_lock(&stats_lock);
+		clients_running++;
+		fibril_mutex_unlock(&stats_lock);
+
+		fibril_add_ready(fid);
+	}
+
+	fibril_mutex_lock(&stats_lock);
+	while (clients_running > 0)
+		fibril_condvar_wait(&done_cv, &stats_lock);
+	fibril_mutex_unlock(&stats_lock);
+
+	gettimeofday(&end, NULL);
+
+	print_results(tv_sub(&end, &start));
+
+	free(clients);
+	free(latency);
+
+	return (req_failed == 0) ? 0 : 3;
+}
+
+/** @}
+ */
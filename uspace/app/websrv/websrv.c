@@ -41,7 +41,9 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <fibril.h>
 #include <task.h>
+#include <ctype.h>
 
 #include <net/in.h>
 #include <net/inet.h>
@@ -55,35 +57,55 @@
 #define NAME  "websrv"
 
 #define DEFAULT_PORT  8080
-#define BACKLOG_SIZE  3
+#define BACKLOG_SIZE  32
 
 #define WEB_ROOT  "/data/web"
 
 /** Buffer for receiving the request. */
 #define BUFFER_SIZE  1024
 
-static uint16_t port = DEFAULT_PORT;
+/** Buffer for sending the response.
+ *
+ * File contents pass through it only if the socket module cannot send
+ * them from the file directly.
+ */
+#define FBUFFER_SIZE  16384
 
-static char rbuf[BUFFER_SIZE];
-static size_t rbuf_out;
-static size_t rbuf_in;
+/** Time an idle persistent connection is kept open (microseconds). */
+#define KEEPALIVE_TIMEOUT  (10 * 1000 * 1000)
 
-static char lbuf[BUFFER_SIZE + 1];
-static size_t lbuf_used;
+/** Connection being served. */
+typedef struct {
+	/** Connection socket */
+	int sd;
+	/** Event queue used to wait for the next request */
+	socket_evq_t *evq;
+	/** Keep connection open after the current request */
+	bool keep_alive;
+	
+	char rbuf[BUFFER_SIZE];
+	size_t rbuf_out;
+	size_t rbuf_in;
+	
+	char lbuf[BUFFER_SIZE + 1];
+	size_t lbuf_used;
+	
+	/** Requested URI */
+	char uri[BUFFER_SIZE + 1];
+	
+	char fbuf[FBUFFER_SIZE];
+} web_conn_t;
 
-static char fbuf[BUFFER_SIZE];
+static uint16_t port = DEFAULT_PORT;
 
 static bool verbose = false;
 
 /** Responses to send to client. */
 
-static const char *msg_ok =
-    "HTTP/1.0 200 OK\r\n"
-    "\r\n";
+static const char *msg_ok = "200 OK";
 
-static const char *msg_bad_request =
-    "HTTP/1.0 400 Bad Request\r\n"
-    "\r\n"
+static const char *msg_bad_request = "400 Bad Request";
+static const char *body_bad_request =
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>400 Bad Request</title>\r\n"
@@ -94,9 +116,8 @@ static const char *msg_bad_request =
     "</body>\r\n"
     "</html>\r\n";
 
-static const char *msg_not_found =
-    "HTTP/1.0 404 Not Found\r\n"
-    "\r\n"
+static const char *msg_not_found = "404 Not Found";
+static const char *body_not_found =
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>404 Not Found</title>\r\n"
@@ -107,9 +128,8 @@ static const char *msg_not_found =
     "</body>\r\n"
     "</html>\r\n";
 
-static const char *msg_not_implemented =
-    "HTTP/1.0 501 Not Implemented\r\n"
-    "\r\n"
+static const char *msg_not_implemented = "501 Not Implemented";
+static const char *body_not_implemented =
     "<!DOCTYPE HTML PUBLIC \"-//IETF//DTD HTML 2.0//EN\">\r\n"
     "<html><head>\r\n"
     "<title>501 Not Implemented</title>\r\n"
@@ -121,34 +141,35 @@ static const char *msg_not_implemented =
     "</html>\r\n";
 
 /** Receive one character (with buffering) */
-static int recv_char(int fd, char *c)
+static int recv_char(web_conn_t *conn, char *c)
 {
-	if (rbuf_out == rbuf_in) {
-		rbuf_out = 0;
-		rbuf_in = 0;
+	if (conn->rbuf_out == conn->rbuf_in) {
+		conn->rbuf_out = 0;
+		conn->rbuf_in = 0;
 		
-		ssize_t rc = recv(fd, rbuf, BUFFER_SIZE, 0);
+		ssize_t rc = recv(conn->sd, conn->rbuf, BUFFER_SIZE, 0);
 		if (rc <= 0) {
-			fprintf(stderr, "recv() failed (%zd)\n", rc);
-			return rc;
+			if (verbose)
+				fprintf(stderr, "recv() failed (%zd)\n", rc);
+			return (rc == 0) ? ENOTCONN : rc;
 		}
 		
-		rbuf_in = rc;
+		conn->rbuf_in = rc;
 	}
 	
-	*c = rbuf[rbuf_out++];
+	*c = conn->rbuf[conn->rbuf_out++];
 	return EOK;
 }
 
 /** Receive one line with length limit */
-static int recv_line(int fd)
+static int recv_line(web_conn_t *conn)
 {
-	char *bp = lbuf;
+	char *bp = conn->lbuf;
 	char c = '\0';
 	
-	while (bp < lbuf + BUFFER_SIZE) {
+	while (bp < conn->lbuf + BUFFER_SIZE) {
 		char prev = c;
-		int rc = recv_char(fd, &c);
+		int rc = recv_char(conn, &c);
 		
 		if (rc != EOK)
 			return rc;
@@ -158,15 +179,73 @@ static int recv_line(int fd)
 			break;
 	}
 	
-	lbuf_used = bp - lbuf;
+	conn->lbuf_used = bp - conn->lbuf;
 	*bp = '\0';
 	
-	if (bp == lbuf + BUFFER_SIZE)
+	if (bp == conn->lbuf + BUFFER_SIZE)
 		return ELIMIT;
 	
 	return EOK;
 }
 
+/** Wait until the next request starts arriving.
+ *
+ * Pipelined requests are already buffered and need no waiting.
+ *
+ * @return EOK if data is available, ETIMEOUT if the connection
+ *         stayed idle for too long
+ */
+static int wait_request(web_conn_t *conn)
+{
+	socket_event_t ev;
+	
+	if (conn->rbuf_out < conn->rbuf_in || conn->evq == NULL)
+		return EOK;
+	
+	int rc = socket_evq_wait(conn->evq, &ev, 1, KEEPALIVE_TIMEOUT);
+	if (rc < 0)
+		return rc;
+	
+	return (rc == 0) ? ETIMEOUT : EOK;
+}
+
+/** Check whether header line has the given field name (case-insensitive).
+ *
+ * @return Pointer to the field value or @c NULL
+ */
+static char *header_match(char *line, const char *name)
+{
+	while (*name != '\0') {
+		if (tolower(*line) != tolower(*name))
+			return NULL;
+		line++;
+		name++;
+	}
+	
+	if (*line != ':')
+		return NULL;
+	
+	line++;
+	while (*line == ' ' || *line == '\t')
+		line++;
+	
+	return line;
+}
+
+/** Check whether header value starts with the given token. */
+static bool value_is(const char *value, const char *token)
+{
+	while (*token != '\0') {
+		if (tolower(*value) != tolower(*token))
+			return false;
+		value++;
+		token++;
+	}
+	
+	return *value == '\r' || *value == ' ' || *value == ',' ||
+	    *value == ';';
+}
+
 static bool uri_is_valid(char *uri)
 {
 	if (uri[0] != '/')
@@ -186,14 +265,37 @@ static bool uri_is_valid(char *uri)
 	return true;
 }
 
-static int send_response(int conn_sd, const char *msg)
+/** Format response header into the send buffer.
+ *
+ * @return Size of the header
+ */
+static size_t format_header(web_conn_t *conn, const char *status,
+    aoff64_t content_length)
+{
+	int rc = snprintf(conn->fbuf, FBUFFER_SIZE,
+	    "HTTP/1.1 %s\r\n"
+	    "Content-Length: %" PRIu64 "\r\n"
+	    "%s"
+	    "\r\n", status, content_length,
+	    conn->keep_alive ? "" : "Connection: close\r\n");
+	
+	assert(rc > 0 && rc < FBUFFER_SIZE);
+	return rc;
+}
+
+static int send_response(web_conn_t *conn, const char *status,
+    const char *body)
 {
-	size_t response_size = str_size(msg);
+	size_t body_size = str_size(body);
+	size_t hdr_size = format_header(conn, status, body_size);
 	
 	if (verbose)
 	    fprintf(stderr, "Sending response\n");
 	
-	ssize_t rc = send(conn_sd, (void *) msg, response_size, 0);
+	assert(hdr_size + body_size <= FBUFFER_SIZE);
+	memcpy(conn->fbuf + hdr_size, body, body_size);
+	
+	int rc = send(conn->sd, conn->fbuf, hdr_size + body_size, 0);
 	if (rc < 0) {
 		fprintf(stderr, "send() failed\n");
 		return rc;
@@ -202,8 +304,50 @@ static int send_response(int conn_sd, const char *msg)
 	return EOK;
 }
 
-static int uri_get(const char *uri, int conn_sd)
+/** Send file contents by copying them through the response buffer.
+ *
+ * Used if the socket module does not support sending from a file.
+ */
+static int send_file_copy(web_conn_t *conn, int fd, aoff64_t pos,
+    aoff64_t remain)
+{
+	while (remain > 0) {
+		size_t xfer = min(remain, (aoff64_t) FBUFFER_SIZE);
+		size_t used = 0;
+		
+		while (used < xfer) {
+			ssize_t nr = pread(fd, conn->fbuf + used, xfer - used,
+			    pos);
+			if (nr <= 0)
+				return EIO;
+			
+			used += nr;
+			pos += nr;
+		}
+		
+		int rc = send(conn->sd, conn->fbuf, used, 0);
+		if (rc < 0)
+			return rc;
+		
+		remain -= used;
+	}
+	
+	return EOK;
+}
+
+/** Send file contents.
+ *
+ * The file is handed to the socket module by sendfile(), so its contents
+ * are copied from the file system server straight into the TCP server.
+ *
+ * The announced Content-Length must be honoured exactly, otherwise the
+ * client would lose track of the following responses. If the file cannot
+ * be sent completely, the connection is closed instead.
+ */
+static int uri_get(web_conn_t *conn, const char *uri)
 {
+	struct stat st;
+	
 	if (str_cmp(uri, "/") == 0)
 		uri = "/index.html";
 	
@@ -213,74 +357,175 @@ static int uri_get(const char *uri, int conn_sd)
 		return ENOMEM;
 	
 	int fd = open(fname, O_RDONLY);
-	if (fd < 0) {
-		rc = send_response(conn_sd, msg_not_found);
-		free(fname);
-		return rc;
-	}
-	
 	free(fname);
 	
-	rc = send_response(conn_sd, msg_ok);
-	if (rc != EOK)
+	if (fd < 0)
+		return send_response(conn, msg_not_found, body_not_found);
+	
+	rc = fstat(fd, &st);
+	if (rc != EOK || !st.is_file) {
+		close(fd);
+		return send_response(conn, msg_not_found, body_not_found);
+	}
+	
+	size_t hdr_size = format_header(conn, msg_ok, st.size);
+	rc = send(conn->sd, conn->fbuf, hdr_size, 0);
+	if (rc < 0) {
+		fprintf(stderr, "send() failed\n");
+		close(fd);
 		return rc;
+	}
 	
-	while (true) {
-		ssize_t nr = read(fd, fbuf, BUFFER_SIZE);
-		if (nr == 0)
-			break;
+	aoff64_t pos = 0;
+	while (pos < st.size) {
+		size_t xfer = min(st.size - pos, (aoff64_t) SSIZE_MAX);
 		
-		if (nr < 0) {
-			close(fd);
-			return EIO;
+		ssize_t nsent = sendfile(conn->sd, fd, pos, xfer);
+		if (nsent == ENOTSUP) {
+			rc = send_file_copy(conn, fd, pos, st.size - pos);
+			break;
 		}
 		
-		rc = send(conn_sd, fbuf, nr, 0);
-		if (rc < 0) {
-			fprintf(stderr, "send() failed\n");
-			close(fd);
-			return rc;
+		if (nsent <= 0) {
+			rc = (nsent < 0) ? (int) nsent : EIO;
+			break;
 		}
+		
+		pos += nsent;
 	}
 	
 	close(fd);
 	
+	if (rc != EOK) {
+		fprintf(stderr, "Error sending file (%s)\n", str_error(rc));
+		conn->keep_alive = false;
+		return rc;
+	}
+	
 	return EOK;
 }
 
-static int req_process(int conn_sd)
+/** Receive and process one request.
+ *
+ * Request headers are consumed up to the empty line, so that the next
+ * (possibly pipelined) request can be read from the same connection.
+ */
+static int req_process(web_conn_t *conn)
 {
-	int rc = recv_line(conn_sd);
+	int rc = recv_line(conn);
 	if (rc != EOK) {
-		fprintf(stderr, "recv_line() failed\n");
+		if (verbose)
+			fprintf(stderr, "recv_line() failed\n");
+		conn->keep_alive = false;
 		return rc;
 	}
 	
 	if (verbose)
-		fprintf(stderr, "Request: %s", lbuf);
+		fprintf(stderr, "Request: %s", conn->lbuf);
 	
-	if (str_lcmp(lbuf, "GET ", 4) != 0) {
-		rc = send_response(conn_sd, msg_not_implemented);
-		return rc;
-	}
+	bool is_get = (str_lcmp(conn->lbuf, "GET ", 4) == 0);
+	
+	/* Extract URI and protocol version */
+	char *uri = str_chr(conn->lbuf, ' ');
+	if (uri == NULL)
+		uri = conn->lbuf + conn->lbuf_used - 2;
+	else
+		uri++;
 	
-	char *uri = lbuf + 4;
 	char *end_uri = str_chr(uri, ' ');
 	if (end_uri == NULL) {
-		end_uri = lbuf + lbuf_used - 2;
+		/* HTTP/0.9 simple request */
+		end_uri = conn->lbuf + conn->lbuf_used - 2;
 		assert(*end_uri == '\r');
+		conn->keep_alive = false;
+	} else {
+		conn->keep_alive =
+		    (str_lcmp(end_uri + 1, "HTTP/1.1\r\n", 10) == 0);
 	}
 	
 	*end_uri = '\0';
+	str_cpy(conn->uri, BUFFER_SIZE + 1, uri);
+	
 	if (verbose)
-		fprintf(stderr, "Requested URI: %s\n", uri);
+		fprintf(stderr, "Requested URI: %s\n", conn->uri);
 	
-	if (!uri_is_valid(uri)) {
-		rc = send_response(conn_sd, msg_bad_request);
-		return rc;
+	/* Process header fields */
+	while (true) {
+		rc = recv_line(conn);
+		if (rc != EOK) {
+			conn->keep_alive = false;
+			return rc;
+		}
+		
+		if (str_cmp(conn->lbuf, "\r\n") == 0)
+			break;
+		
+		char *value = header_match(conn->lbuf, "Connection");
+		if (value != NULL) {
+			if (value_is(value, "close"))
+				conn->keep_alive = false;
+			else if (value_is(value, "keep-alive"))
+				conn->keep_alive = true;
+		}
+	}
+	
+	if (!is_get) {
+		/* A request body may follow which we cannot skip reliably */
+		conn->keep_alive = false;
+		return send_response(conn, msg_not_implemented,
+		    body_not_implemented);
 	}
 	
-	return uri_get(uri, conn_sd);
+	if (!uri_is_valid(conn->uri))
+		return send_response(conn, msg_bad_request, body_bad_request);
+	
+	return uri_get(conn, conn->uri);
+}
+
+/** Connection fibril.
+ *
+ * Serves requests on one connection until the client closes it, asks
+ * for it to be closed or leaves it idle for too long.
+ */
+static int connection_fibril(void *arg)
+{
+	web_conn_t *conn = (web_conn_t *) arg;
+	int rc;
+	
+	conn->evq = socket_evq_create();
+	if (conn->evq != NULL) {
+		rc = socket_evq_add(conn->evq, conn->sd, SOCKET_EV_READ, NULL);
+		if (rc != EOK) {
+			socket_evq_destroy(conn->evq);
+			conn->evq = NULL;
+		}
+	}
+	
+	do {
+		rc = wait_request(conn);
+		if (rc != EOK)
+			break;
+		
+		rc = req_process(conn);
+		if (rc != EOK && conn->keep_alive)
+			fprintf(stderr, "Error processing request (%s)\n",
+			    str_error(rc));
+	} while (conn->keep_alive);
+	
+	if (conn->evq != NULL)
+		socket_evq_destroy(conn->evq);
+	
+	rc = closesocket(conn->sd);
+	if (rc != EOK) {
+		fprintf(stderr, "Error closing connection socket (%s)\n",
+		    str_error(rc));
+	}
+	
+	if (verbose)
+		fprintf(stderr, "Connection closed (sd=%d)\n", conn->sd);
+	
+	free(conn);
+	return EOK;
 }
 
 static void usage(void)
@@ -409,7 +654,8 @@ int main(int argc, char *argv[])
 		    &raddr_len);
 		
 		if (conn_sd < 0) {
-			fprintf(stderr, "accept() failed (%s)\n", str_error(rc));
+			fprintf(stderr, "accept() failed (%s)\n",
+			    str_error(conn_sd));
 			continue;
 		}
 		
@@ -418,24 +664,28 @@ int main(int argc, char *argv[])
 			    "waiting for request\n", conn_sd);
 		}
 		
-		rbuf_out = 0;
-		rbuf_in = 0;
+		web_conn_t *conn = malloc(sizeof(web_conn_t));
+		if (conn == NULL) {
+			fprintf(stderr, "Out of memory\n");
+			closesocket(conn_sd);
+			continue;
+		}
 		
-		rc = req_process(conn_sd);
-		if (rc != EOK)
-			fprintf(stderr, "Error processing request (%s)\n",
-			    str_error(rc));
+		conn->sd = conn_sd;
+		conn->evq = NULL;
+		conn->keep_alive = false;
+		conn->rbuf_out = 0;
+		conn->rbuf_in = 0;
 		
-		rc = closesocket(conn_sd);
-		if (rc != EOK) {
-			fprintf(stderr, "Error closing connection socket (%s)\n",
-			    str_error(rc));
-			closesocket(listen_sd);
-			return 5;
+		fid_t fid = fibril_create(connection_fibril, conn);
+		if (fid == 0) {
+			fprintf(stderr, "Error creating connection fibril\n");
+			closesocket(conn_sd);
+			free(conn);
+			continue;
 		}
 		
-		if (verbose)
-			fprintf(stderr, "Connection closed\n");
+		fibril_add_ready(fid);
 	}
 	
 	/* Not reached */
@@ -85,6 +85,7 @@ typedef struct {
 	void *bb_buf;
 	aoff64_t bb_addr;
 	size_t pblock_size;  /**< Physical block size. */
+	unsigned long write_gen;  /**< Number of writes to the device. */
 	cache_t *cache;
 } devcon_t;
 
@@ -131,6 +132,7 @@ static int devcon_add(service_id_t service_id, async_sess_t *sess,
 	devcon->bb_buf = NULL;
 	devcon->bb_addr = 0;
 	devcon->pblock_size = bsize;
+	devcon->write_gen = 0;
 	devcon->cache = NULL;
 	
 	fibril_mutex_lock(&dcl_lock);
@@ -778,6 +780,149 @@ int block_read_direct(service_id_t service_id, aoff64_t ba, size_t cnt, void *bu
 	return rc;
 }
 
+/** Number of times a chunk of a range read is retried after a write. */
+#define RANGE_READ_RETRIES  3
+
+/** Read a range of logical blocks through the cache one by one.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (logical).
+ * @param cnt		Number of blocks.
+ * @param bsize		Logical block size.
+ * @param dst		Buffer for storing the data.
+ *
+ * @return		EOK on success or negative error code on failure.
+ */
+static int block_read_range_cached(service_id_t service_id, aoff64_t ba,
+    size_t cnt, size_t bsize, uint8_t *dst)
+{
+	for (size_t i = 0; i < cnt; i++) {
+		block_t *b;
+		int rc;
+
+		rc = block_get(&b, service_id, ba + i, BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			return rc;
+
+		memcpy(dst + i * bsize, b->data, bsize);
+
+		rc = block_put(b);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Read a range of logical blocks in as few device requests as possible.
+ *
+ * The range is transferred from the device in chunks as large as the
+ * communication area allows. Blocks which are present in the cache take
+ * precedence over the device contents so that dirty blocks of a write-back
+ * cache are seen by the caller. Should any block have been written to the
+ * device while a chunk was in transfer, the chunk is read again. After
+ * RANGE_READ_RETRIES such attempts, the chunk is read block by block through
+ * the cache instead.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (logical).
+ * @param cnt		Number of blocks.
+ * @param buf		Buffer for storing the data.
+ *
+ * @return		EOK on success or negative error code on failure.
+ */
+int block_read_range(service_id_t service_id, aoff64_t ba, size_t cnt,
+    void *buf)
+{
+	devcon_t *devcon;
+	cache_t *cache;
+	uint8_t *dst = buf;
+	int rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+	assert(devcon->cache);
+
+	cache = devcon->cache;
+
+	size_t max = devcon->comm_size / cache->lblock_size;
+	assert(max > 0);
+
+	unsigned retries = 0;
+
+	while (cnt > 0) {
+		size_t chunk = min(cnt, max);
+		unsigned long gen;
+
+		if (retries == RANGE_READ_RETRIES) {
+			/* Do not race with steady write traffic forever. */
+			rc = block_read_range_cached(service_id, ba, chunk,
+			    cache->lblock_size, dst);
+			if (rc != EOK)
+				return rc;
+
+			retries = 0;
+			ba += chunk;
+			cnt -= chunk;
+			dst += chunk * cache->lblock_size;
+			continue;
+		}
+
+		fibril_mutex_lock(&devcon->comm_area_lock);
+		gen = devcon->write_gen;
+		rc = read_blocks(devcon, ba_ltop(devcon, ba),
+		    chunk * cache->blocks_cluster);
+		if (rc == EOK)
+			memcpy(dst, devcon->comm_area,
+			    chunk * cache->lblock_size);
+		fibril_mutex_unlock(&devcon->comm_area_lock);
+		if (rc != EOK)
+			return rc;
+
+		/*
+		 * Holding the cache lock, no cached block can leave the cache.
+		 * A block written back and evicted after the transfer started
+		 * would be missed by the lookups below, though, so check the
+		 * write generation first.
+		 */
+		fibril_mutex_lock(&cache->lock);
+		fibril_mutex_lock(&devcon->comm_area_lock);
+		bool stale = (devcon->write_gen != gen);
+		fibril_mutex_unlock(&devcon->comm_area_lock);
+		if (stale) {
+			fibril_mutex_unlock(&cache->lock);
+			retries++;
+			continue;
+		}
+
+		for (size_t i = 0; i < chunk; i++) {
+			unsigned long key[2] = {
+				LOWER32(ba + i),
+				UPPER32(ba + i)
+			};
+			link_t *l = hash_table_find(&cache->block_hash, key);
+			if (!l)
+				continue;
+
+			block_t *b = hash_table_get_instance(l, block_t,
+			    hash_link);
+			fibril_mutex_lock(&b->lock);
+			if (!b->toxic)
+				memcpy(dst + i * cache->lblock_size, b->data,
+				    cache->lblock_size);
+			fibril_mutex_unlock(&b->lock);
+		}
+		fibril_mutex_unlock(&cache->lock);
+
+		retries = 0;
+		ba += chunk;
+		cnt -= chunk;
+		dst += chunk * cache->lblock_size;
+	}
+
+	return EOK;
+}
+
 /** Write blocks directly to device (bypass cache).
  *
  * @param service_id	Service ID of the block device.
@@ -970,6 +1115,8 @@ static int write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt)
 {
 	assert(devcon);
 	
+	devcon->write_gen++;
+	
 	async_exch_t *exch = async_exchange_begin(devcon->sess);
 	int rc = async_req_3_0(exch, BD_WRITE_BLOCKS, LOWER32(ba),
 	    UPPER32(ba), cnt);
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/**
+ * @file Prefix trie
+ *
+ * Each node stores a prefix. Its children extend that prefix and are
+ * indexed by the first bit following it. Chains of nodes with a single
+ * child and no items are never created, so the trie has less than two
+ * nodes per stored prefix.
+ */
+
+#include <adt/ptrie.h>
+#include <assert.h>
+#include <bitops.h>
+#include <bool.h>
+#include <errno.h>
+#include <macros.h>
+#include <stdlib.h>
+
+/** Return netmask for prefix length @a bits (0 to 32). */
+static uint32_t ptrie_mask(int bits)
+{
+	return (bits == 0) ? 0 : (uint32_t) 0xffffffff << (32 - bits);
+}
+
+/** Return bit @a idx of address, counting from the most significant one. */
+static unsigned ptrie_bit(uint32_t addr, int idx)
+{
+	return (addr >> (31 - idx)) & 1;
+}
+
+/** Return length of the common prefix of two prefixes. */
+static int ptrie_common(uint32_t a, int abits, uint32_t b, int bbits)
+{
+	uint32_t diff = a ^ b;
+	int common = (diff == 0) ? 32 : 31 - (int) fnzb32(diff);
+
+	return min(common, min(abits, bbits));
+}
+
+static ptrie_node_t *ptrie_node_new(uint32_t prefix, int bits)
+{
+	ptrie_node_t *node = malloc(sizeof(ptrie_node_t));
+	if (node == NULL)
+		return NULL;
+
+	node->child[0] = NULL;
+	node->child[1] = NULL;
+	node->prefix = prefix;
+	node->bits = bits;
+	list_initialize(&node->items);
+
+	return node;
+}
+
+/** Initialize prefix trie. */
+void ptrie_init(ptrie_t *trie)
+{
+	trie->root = NULL;
+}
+
+/** Insert item into prefix trie.
+ *
+ * Several items can be stored with the same prefix, lookup returns the
+ * one inserted first.
+ *
+ * @param trie		Prefix trie
+ * @param addr		Address, bits beyond the prefix are ignored
+ * @param bits		Prefix length (0 to 32)
+ * @param item		Link of the item
+ * @return		EOK on success, EINVAL if the prefix length is
+ *			invalid, ENOMEM if out of memory
+ */
+int ptrie_insert(ptrie_t *trie, uint32_t addr, int bits, link_t *item)
+{
+	ptrie_node_t **np;
+	ptrie_node_t *node;
+	ptrie_node_t *leaf;
+	ptrie_node_t *branch;
+	int common;
+
+	if (bits < 0 || bits > 32)
+		return EINVAL;
+
+	addr &= ptrie_mask(bits);
+	np = &trie->root;
+
+	while (*np != NULL) {
+		node = *np;
+		common = ptrie_common(node->prefix, node->bits, addr, bits);
+
+		if (common == node->bits) {
+			if (node->bits == bits) {
+				/* Node for this prefix exists */
+				list_append(item, &node->items);
+				return EOK;
+			}
+
+			/* Node prefix is a prefix of ours, descend */
+			np = &node->child[ptrie_bit(addr, node->bits)];
+			continue;
+		}
+
+		leaf = ptrie_node_new(addr, bits);
+		if (leaf == NULL)
+			return ENOMEM;
+
+		if (common == bits) {
+			/* Our prefix is a prefix of the node's one */
+			leaf->child[ptrie_bit(node->prefix, bits)] = node;
+			*np = leaf;
+		} else {
+			/* Prefixes diverge, add branching node */
+			branch = ptrie_node_new(addr & ptrie_mask(common),
+			    common);
+			if (branch == NULL) {
+				free(leaf);
+				return ENOMEM;
+			}
+
+			branch->child[ptrie_bit(addr, common)] = leaf;
+			branch->child[ptrie_bit(node->prefix, common)] = node;
+			*np = branch;
+		}
+
+		list_append(item, &leaf->items);
+		return EOK;
+	}
+
+	leaf = ptrie_node_new(addr, bits);
+	if (leaf == NULL)
+		return ENOMEM;
+
+	list_append(item, &leaf->items);
+	*np = leaf;
+	return EOK;
+}
+
+/** Remove node if it is no longer needed.
+ *
+ * @param np	Pointer to the node in its parent or trie root
+ * @return	@c true if the node was removed
+ */
+static bool ptrie_node_prune(ptrie_node_t **np)
+{
+	ptrie_node_t *node = *np;
+
+	if (!list_empty(&node->items))
+		return false;
+
+	if (node->child[0] != NULL && node->child[1] != NULL)
+		return false;
+
+	*np = (node->child[0] != NULL) ? node->child[0] : node->child[1];
+	free(node);
+	return true;
+}
+
+/** Remove item from prefix trie.
+ *
+ * @param trie		Prefix trie
+ * @param addr		Address the item was inserted with
+ * @param bits		Prefix length the item was inserted with
+ * @param item		Link of the item
+ */
+void ptrie_remove(ptrie_t *trie, uint32_t addr, int bits, link_t *item)
+{
+	ptrie_node_t **np;
+	ptrie_node_t **pp;
+
+	addr &= ptrie_mask(bits);
+	np = &trie->root;
+	pp = NULL;
+
+	while ((*np)->bits != bits) {
+		assert((*np)->bits < bits);
+		pp = np;
+		np = &(*np)->child[ptrie_bit(addr, (*np)->bits)];
+		assert(*np != NULL);
+	}
+
+	assert((*np)->prefix == addr);
+	list_remove(item);
+
+	/* Removing a leaf can leave its parent as a needless branch */
+	if (ptrie_node_prune(np) && pp != NULL)
+		(void) ptrie_node_prune(pp);
+}
+
+/** Find item with the longest prefix matching address.
+ *
+ * @param trie		Prefix trie
+ * @param addr		Address
+ * @return		Link of the item or @c NULL if no prefix matches
+ */
+link_t *ptrie_lookup(ptrie_t *trie, uint32_t addr)
+{
+	ptrie_node_t *node;
+	ptrie_node_t *best;
+
+	best = NULL;
+	node = trie->root;
+
+	while (node != NULL) {
+		if ((addr & ptrie_mask(node->bits)) != node->prefix)
+			break;
+
+		if (!list_empty(&node->items))
+			best = node;
+
+		if (node->bits == 32)
+			break;
+
+		node = node->child[ptrie_bit(addr, node->bits)];
+	}
+
+	if (best == NULL)
+		return NULL;
+
+	return list_first(&best->items);
+}
+
+/** @}
+ */
@@ -56,8 +56,33 @@
  */
 void *as_area_create(void *base, size_t size, unsigned int flags)
 {
-	return (void *) __SYSCALL4(SYS_AS_AREA_CREATE, (sysarg_t) base,
-	    (sysarg_t) size, (sysarg_t) flags, (sysarg_t) __entry);
+	return (void *) __SYSCALL5(SYS_AS_AREA_CREATE, (sysarg_t) base,
+	    (sysarg_t) size, (sysarg_t) flags, (sysarg_t) __entry, 0);
+}
+
+/** Create address space area backed by a user space pager.
+ *
+ * Page faults in the area are resolved by the kernel sending IPC_M_PAGE_IN
+ * requests to the pager. Each page provided by the pager is private to the
+ * area, modifications are never propagated back to the pager.
+ *
+ * @param base       Starting virtual address of the area.
+ *                   If set to AS_AREA_ANY ((void *) -1),
+ *                   the kernel finds a mappable area.
+ * @param size       Size of the area.
+ * @param flags      Flags describing type of the area.
+ * @param pager_info Pager phone and pager-defined area identifiers.
+ *
+ * @return Starting virtual address of the created area on success.
+ * @return AS_MAP_FAILED ((void *) -1) otherwise.
+ *
+ */
+void *as_area_create_pager(void *base, size_t size, unsigned int flags,
+    as_area_pager_info_t *pager_info)
+{
+	return (void *) __SYSCALL5(SYS_AS_AREA_CREATE, (sysarg_t) base,
+	    (sysarg_t) size, (sysarg_t) flags, (sysarg_t) __entry,
+	    (sysarg_t) pager_info);
 }
 
 /** Resize address space area.
@@ -2092,6 +2092,22 @@ void async_exchange_end(async_exch_t *exch)
 	fibril_mutex_unlock(&async_sess_mutex);
 }
 
+/** Get the phone of an exchange.
+ *
+ * The phone can be handed over to the kernel, e.g. as the pager of an
+ * address space area. The caller must not finish the exchange for as long
+ * as the phone is in use.
+ *
+ * @param exch Exchange.
+ *
+ * @return Phone of the exchange.
+ *
+ */
+int async_exchange_phone(async_exch_t *exch)
+{
+	return exch->phone;
+}
+
 /** Wrapper for IPC_M_SHARE_IN calls using the async framework.
  *
  * @param exch  Exchange for sending the message.
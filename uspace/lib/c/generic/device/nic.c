@@ -40,6 +40,7 @@
 #include <errno.h>
 #include <async.h>
 #include <malloc.h>
+#include <net/pbuf.h>
 #include <stdio.h>
 #include <ipc/services.h>
 
@@ -72,6 +73,39 @@ int nic_send_frame(async_sess_t *dev_sess, void *data, size_t size)
 	return retval;
 }
 
+/** Send frame held in a packet buffer from NIC
+ *
+ * The frame is passed by reference if @a pbuf was allocated by
+ * pbuf_alloc_shared(), otherwise it is copied.
+ *
+ * @param[in] dev_sess
+ * @param[in] share    Areas shared with the NIC
+ * @param[in] pbuf     Buffer holding the frame
+ *
+ * @return EOK If the operation was successfully completed
+ *
+ */
+int nic_send_frame_pbuf(async_sess_t *dev_sess, pbuf_share_t *share,
+    pbuf_t *pbuf)
+{
+	async_exch_t *exch = async_exchange_begin(dev_sess);
+	
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, DEV_IFACE_ID(NIC_DEV_IFACE),
+	    NIC_SEND_MESSAGE, &answer);
+	sysarg_t retval = pbuf_send(share, exch, pbuf);
+	
+	async_exchange_end(exch);
+	
+	if (retval != EOK) {
+		async_forget(req);
+		return retval;
+	}
+	
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 /** Create callback connection from NIC service
  *
  * @param[in] dev_sess
@@ -33,12 +33,17 @@
 #include <ipc/inet.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <net/pbuf.h>
 
 static void inet_cb_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg);
 
 static async_sess_t *inet_sess = NULL;
 static inet_ev_ops_t *inet_ev_ops = NULL;
 static uint8_t inet_protocol = 0;
+/** Our areas holding datagrams to be sent, shared with inetsrv */
+static pbuf_share_t inet_send_share;
+/** Areas of inetsrv holding received datagrams */
+static pbuf_share_t inet_recv_share;
 
 static int inet_callback_create(void)
 {
@@ -76,6 +81,9 @@ int inet_init(uint8_t protocol, inet_ev_ops_t *ev_ops)
 	assert(inet_ev_ops == NULL);
 	assert(inet_protocol == 0);
 	
+	pbuf_share_init(&inet_send_share);
+	pbuf_share_init(&inet_recv_share);
+	
 	rc = loc_service_get_id(SERVICE_NAME_INET, &inet_svc,
 	    IPC_FLAG_BLOCKING);
 	if (rc != EOK)
@@ -104,14 +112,26 @@ int inet_init(uint8_t protocol, inet_ev_ops_t *ev_ops)
 	return EOK;
 }
 
+/** Send datagram.
+ *
+ * If @a dgram carries a buffer allocated by pbuf_alloc_shared() with
+ * INET_HEADROOM and INET_TAILROOM, the datagram is passed by reference
+ * and headers are added in place on the way to the network interface.
+ */
 int inet_send(inet_dgram_t *dgram, uint8_t ttl, inet_df_t df)
 {
+	int rc;
+
 	async_exch_t *exch = async_exchange_begin(inet_sess);
 
 	ipc_call_t answer;
 	aid_t req = async_send_5(exch, INET_SEND, dgram->src.ipv4,
 	    dgram->dest.ipv4, dgram->tos, ttl, df, &answer);
-	int rc = async_data_write_start(exch, dgram->data, dgram->size);
+	if (dgram->pbuf != NULL && dgram->pbuf->data == dgram->data &&
+	    dgram->pbuf->size == dgram->size)
+		rc = pbuf_send(&inet_send_share, exch, dgram->pbuf);
+	else
+		rc = async_data_write_start(exch, dgram->data, dgram->size);
 	async_exchange_end(exch);
 
 	if (rc != EOK) {
@@ -152,13 +172,21 @@ static void inet_ev_recv(ipc_callid_t callid, ipc_call_t *call)
 	dgram.dest.ipv4 = IPC_GET_ARG2(*call);
 	dgram.tos = IPC_GET_ARG3(*call);
 
-	rc = async_data_write_accept(&dgram.data, false, 0, 0, 0, &dgram.size);
+	rc = pbuf_receive(&inet_recv_share, &dgram.pbuf, 0, 0);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return;
 	}
 
+	dgram.data = dgram.pbuf->data;
+	dgram.size = dgram.pbuf->size;
+
+	/*
+	 * The buffer can be borrowed from inetsrv and valid only until
+	 * the call is answered. Receiver keeps the data with pbuf_keep().
+	 */
 	rc = inet_ev_ops->recv(&dgram);
+	pbuf_delref(dgram.pbuf);
 	async_answer_0(callid, rc);
 }
 
@@ -41,6 +41,7 @@
 #include <ipc/iplink.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <net/pbuf.h>
 #include <stdlib.h>
 
 static void iplink_cb_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg);
@@ -54,6 +55,8 @@ int iplink_open(async_sess_t *sess, iplink_ev_ops_t *ev_ops,
 	
 	iplink->sess = sess;
 	iplink->ev_ops = ev_ops;
+	pbuf_share_init(&iplink->send_share);
+	pbuf_share_init(&iplink->recv_share);
 	
 	async_exch_t *exch = async_exchange_begin(sess);
 	
@@ -76,17 +79,31 @@ error:
 void iplink_close(iplink_t *iplink)
 {
 	/* XXX Synchronize with iplink_cb_conn */
+	pbuf_share_fini(&iplink->send_share);
+	pbuf_share_fini(&iplink->recv_share);
 	free(iplink);
 }
 
+/** Send SDU over the link.
+ *
+ * If @a sdu carries a buffer allocated by pbuf_alloc_shared(), the link
+ * gets the SDU by reference. The link can use head and tail room of the
+ * buffer to add link headers and trailers in place.
+ */
 int iplink_send(iplink_t *iplink, iplink_sdu_t *sdu)
 {
+	int rc;
+
 	async_exch_t *exch = async_exchange_begin(iplink->sess);
 
 	ipc_call_t answer;
 	aid_t req = async_send_2(exch, IPLINK_SEND, sdu->lsrc.ipv4,
 	    sdu->ldest.ipv4, &answer);
-	int rc = async_data_write_start(exch, sdu->data, sdu->size);
+	if (sdu->pbuf != NULL && sdu->pbuf->data == sdu->data &&
+	    sdu->pbuf->size == sdu->size)
+		rc = pbuf_send(&iplink->send_share, exch, sdu->pbuf);
+	else
+		rc = async_data_write_start(exch, sdu->data, sdu->size);
 	async_exchange_end(exch);
 
 	if (rc != EOK) {
@@ -146,14 +163,18 @@ static void iplink_ev_recv(iplink_t *iplink, ipc_callid_t callid,
 	sdu.lsrc.ipv4 = IPC_GET_ARG1(*call);
 	sdu.ldest.ipv4 = IPC_GET_ARG2(*call);
 
-	rc = async_data_write_accept(&sdu.data, false, 0, 0, 0, &sdu.size);
+	rc = pbuf_receive(&iplink->recv_share, &sdu.pbuf, 0, 0);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return;
 	}
 
+	sdu.data = sdu.pbuf->data;
+	sdu.size = sdu.pbuf->size;
+
+	/* A borrowed buffer is valid only until the call is answered */
 	rc = iplink->ev_ops->recv(iplink, &sdu);
-	free(sdu.data);
+	pbuf_delref(sdu.pbuf);
 	async_answer_0(callid, rc);
 }
 
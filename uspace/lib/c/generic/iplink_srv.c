@@ -35,6 +35,7 @@
  */
 #include <errno.h>
 #include <ipc/iplink.h>
+#include <net/pbuf.h>
 #include <stdlib.h>
 #include <sys/types.h>
 
@@ -83,14 +84,18 @@ static void iplink_send_srv(iplink_srv_t *srv, ipc_callid_t callid,
 	sdu.lsrc.ipv4 = IPC_GET_ARG1(*call);
 	sdu.ldest.ipv4 = IPC_GET_ARG2(*call);
 
-	rc = async_data_write_accept(&sdu.data, false, 0, 0, 0, &sdu.size);
+	rc = pbuf_receive(&srv->send_share, &sdu.pbuf, srv->headroom,
+	    srv->tailroom);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return;
 	}
 
+	sdu.data = sdu.pbuf->data;
+	sdu.size = sdu.pbuf->size;
+
 	rc = srv->ops->send(srv, &sdu);
-	free(sdu.data);
+	pbuf_delref(sdu.pbuf);
 	async_answer_0(callid, rc);
 }
 
@@ -101,6 +106,10 @@ void iplink_srv_init(iplink_srv_t *srv)
 	srv->ops = NULL;
 	srv->arg = NULL;
 	srv->client_sess = NULL;
+	srv->headroom = 0;
+	srv->tailroom = 0;
+	pbuf_share_init(&srv->send_share);
+	pbuf_share_init(&srv->recv_share);
 }
 
 int iplink_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
@@ -160,11 +169,20 @@ int iplink_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		}
 	}
 
+	pbuf_share_fini(&srv->send_share);
+	pbuf_share_fini(&srv->recv_share);
 	return srv->ops->close(srv);
 }
 
+/** Deliver received SDU to the client.
+ *
+ * If @a sdu carries a buffer allocated by pbuf_alloc_shared(), the client
+ * gets the SDU by reference.
+ */
 int iplink_ev_recv(iplink_srv_t *srv, iplink_srv_sdu_t *sdu)
 {
+	int rc;
+
 	if (srv->client_sess == NULL)
 		return EIO;
 
@@ -173,7 +191,11 @@ int iplink_ev_recv(iplink_srv_t *srv, iplink_srv_sdu_t *sdu)
 	ipc_call_t answer;
 	aid_t req = async_send_2(exch, IPLINK_EV_RECV, sdu->lsrc.ipv4,
 	    sdu->ldest.ipv4, &answer);
-	int rc = async_data_write_start(exch, sdu->data, sdu->size);
+	if (sdu->pbuf != NULL && sdu->pbuf->data == sdu->data &&
+	    sdu->pbuf->size == sdu->size)
+		rc = pbuf_send(&srv->recv_share, exch, sdu->pbuf);
+	else
+		rc = async_data_write_start(exch, sdu->data, sdu->size);
 	async_exchange_end(exch);
 
 	if (rc != EOK) {
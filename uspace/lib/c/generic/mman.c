@@ -36,6 +36,74 @@
 #include <sys/types.h>
 #include <as.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <macros.h>
+#include <fibril_synch.h>
+#include <adt/list.h>
+#include <vfs/vfs.h>
+
+/** Memory mapped file.
+ *
+ * The mapping holds its own file descriptor so that the file stays open
+ * even if the descriptor passed to mmap() is closed.
+ */
+typedef struct {
+	link_t link;
+	void *base;
+	int fd;
+} file_mapping_t;
+
+static FIBRIL_MUTEX_INITIALIZE(file_mappings_mutex);
+static LIST_INITIALIZE(file_mappings);
+
+/** Map a file into memory.
+ *
+ * The pages of the mapping are read on demand by VFS acting as the pager
+ * of the address space area. Only read-only mappings and private mappings
+ * are supported as modified pages are never written back to the file.
+ */
+static void *mmap_file(void *start, size_t length, int prot, int flags,
+    int fd, aoff64_t offset)
+{
+	if ((offset % PAGE_SIZE) != 0)
+		return MAP_FAILED;
+	
+	if ((flags & MAP_SHARED) && (prot & PROTO_WRITE))
+		return MAP_FAILED;
+	
+	file_mapping_t *mapping = malloc(sizeof(file_mapping_t));
+	if (mapping == NULL)
+		return MAP_FAILED;
+	
+	mapping->fd = fd_clone(fd);
+	if (mapping->fd < 0) {
+		free(mapping);
+		return MAP_FAILED;
+	}
+	
+	as_area_pager_info_t pager_info = {
+		.pager = vfs_pager_phone(),
+		.id1 = mapping->fd,
+		.id2 = LOWER32(offset),
+		.id3 = UPPER32(offset)
+	};
+	
+	mapping->base = as_area_create_pager(start, length, prot, &pager_info);
+	if (mapping->base == AS_MAP_FAILED) {
+		close(mapping->fd);
+		free(mapping);
+		return MAP_FAILED;
+	}
+	
+	link_initialize(&mapping->link);
+	
+	fibril_mutex_lock(&file_mappings_mutex);
+	list_append(&mapping->link, &file_mappings);
+	fibril_mutex_unlock(&file_mappings_mutex);
+	
+	return mapping->base;
+}
 
 void *mmap(void *start, size_t length, int prot, int flags, int fd,
     aoff64_t offset)
@@ -47,14 +115,37 @@ void *mmap(void *start, size_t length, int prot, int flags, int fd,
 //		return MAP_FAILED;
 	
 	if (!(flags & MAP_ANONYMOUS))
-		return MAP_FAILED;
+		return mmap_file(start, length, prot, flags, fd, offset);
 	
 	return as_area_create(start, length, prot);
 }
 
 int munmap(void *start, size_t length)
 {
-	return as_area_destroy(start);
+	int rc = as_area_destroy(start);
+	if (rc != EOK)
+		return rc;
+	
+	file_mapping_t *mapping = NULL;
+	
+	fibril_mutex_lock(&file_mappings_mutex);
+	list_foreach(file_mappings, link) {
+		file_mapping_t *cur = list_get_instance(link, file_mapping_t,
+		    link);
+		if (cur->base == start) {
+			list_remove(&cur->link);
+			mapping = cur;
+			break;
+		}
+	}
+	fibril_mutex_unlock(&file_mappings_mutex);
+	
+	if (mapping != NULL) {
+		close(mapping->fd);
+		free(mapping);
+	}
+	
+	return EOK;
 }
 
 /** @}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Internet checksum (RFC 1071)
+ *
+ * The one's complement sum does not depend on byte order, so data is summed
+ * using aligned native 32-bit loads into a 64-bit accumulator, which is
+ * only folded and converted to network order at the end.
+ */
+
+#include <byteorder.h>
+#include <mem.h>
+#include <net/checksum.h>
+#include <unistd.h>
+
+/** Fold 64-bit accumulator into 16-bit one's complement sum. */
+static uint16_t inet_csum_fold(uint64_t acc)
+{
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffff) + (acc >> 16);
+	acc = (acc & 0xffff) + (acc >> 16);
+	acc = (acc & 0xffff) + (acc >> 16);
+
+	return (uint16_t) acc;
+}
+
+/** Sum data in native byte order.
+ *
+ * @param src	Data, must be aligned to 2 bytes
+ * @param size	Data size in bytes
+ * @return	Unfolded sum
+ */
+static uint64_t inet_csum_native(const uint8_t *src, size_t size)
+{
+	const uint32_t *s32;
+	uint64_t acc;
+	uint16_t tail;
+
+	acc = 0;
+
+	if (((uintptr_t) src & 2) != 0 && size >= 2) {
+		acc += *(const uint16_t *) src;
+		src += 2;
+		size -= 2;
+	}
+
+	s32 = (const uint32_t *) src;
+
+	while (size >= 16) {
+		acc += s32[0];
+		acc += s32[1];
+		acc += s32[2];
+		acc += s32[3];
+		s32 += 4;
+		size -= 16;
+	}
+
+	while (size >= 4) {
+		acc += *s32++;
+		size -= 4;
+	}
+
+	src = (const uint8_t *) s32;
+
+	if (size >= 2) {
+		acc += *(const uint16_t *) src;
+		src += 2;
+		size -= 2;
+	}
+
+	if (size > 0) {
+		/* Odd byte is padded with zero */
+		tail = 0;
+		*(uint8_t *) &tail = *src;
+		acc += tail;
+	}
+
+	return acc;
+}
+
+/** Copy and sum data in native byte order.
+ *
+ * @param dst	Destination buffer, must be aligned as @a src modulo 4
+ * @param src	Data, must be aligned to 2 bytes
+ * @param size	Data size in bytes
+ * @return	Unfolded sum
+ */
+static uint64_t inet_csum_native_copy(uint8_t *dst, const uint8_t *src,
+    size_t size)
+{
+	const uint32_t *s32;
+	uint32_t *d32;
+	uint32_t w;
+	uint64_t acc;
+	uint16_t tail;
+
+	acc = 0;
+
+	if (((uintptr_t) src & 2) != 0 && size >= 2) {
+		*(uint16_t *) dst = *(const uint16_t *) src;
+		acc += *(const uint16_t *) src;
+		src += 2;
+		dst += 2;
+		size -= 2;
+	}
+
+	s32 = (const uint32_t *) src;
+	d32 = (uint32_t *) dst;
+
+	while (size >= 4) {
+		w = *s32++;
+		*d32++ = w;
+		acc += w;
+		size -= 4;
+	}
+
+	src = (const uint8_t *) s32;
+	dst = (uint8_t *) d32;
+
+	if (size >= 2) {
+		*(uint16_t *) dst = *(const uint16_t *) src;
+		acc += *(const uint16_t *) src;
+		src += 2;
+		dst += 2;
+		size -= 2;
+	}
+
+	if (size > 0) {
+		*dst = *src;
+		tail = 0;
+		*(uint8_t *) &tail = *src;
+		acc += tail;
+	}
+
+	return acc;
+}
+
+/** Compute one's complement sum of data as big-endian 16-bit words.
+ *
+ * @param dst	Buffer to copy data to or @c NULL
+ * @param src	Data
+ * @param size	Data size in bytes
+ * @return	Sum in host byte order, not complemented
+ */
+static uint16_t inet_csum_sum(uint8_t *dst, const uint8_t *src, size_t size)
+{
+	uint16_t sum;
+
+	if (size == 0)
+		return 0;
+
+	if (((uintptr_t) src & 1) != 0) {
+		/*
+		 * The first byte is the upper half of a word. Summing the
+		 * rest from an aligned address yields its sum with bytes
+		 * swapped.
+		 */
+		if (dst != NULL)
+			*dst++ = *src;
+
+		sum = inet_csum_sum(dst, src + 1, size - 1);
+		return inet_csum_fold(((uint32_t) src[0] << 8) +
+		    uint16_t_byteorder_swap(sum));
+	}
+
+	if (dst != NULL && (((uintptr_t) dst ^ (uintptr_t) src) & 3) != 0) {
+		/* Buffers cannot be aligned at the same time */
+		memcpy(dst, src, size);
+		dst = NULL;
+	}
+
+	/* Native sum is the network order sum with bytes swapped on LE */
+	if (dst != NULL)
+		return uint16_t_be2host(inet_csum_fold(
+		    inet_csum_native_copy(dst, src, size)));
+	else
+		return uint16_t_be2host(inet_csum_fold(
+		    inet_csum_native(src, size)));
+}
+
+/** Compute Internet checksum.
+ *
+ * @param ivalue	Checksum of preceding data or INET_CHECKSUM_INIT
+ * @param data		Data
+ * @param size		Data size in bytes
+ * @return		Checksum in host byte order
+ */
+uint16_t inet_checksum_calc(uint16_t ivalue, const void *data, size_t size)
+{
+	uint32_t sum;
+
+	sum = (uint16_t) ~ivalue + inet_csum_sum(NULL, data, size);
+	return (uint16_t) ~inet_csum_fold(sum);
+}
+
+/** Copy data and compute its Internet checksum in one pass.
+ *
+ * @param ivalue	Checksum of preceding data or INET_CHECKSUM_INIT
+ * @param dst		Destination buffer
+ * @param src		Source data
+ * @param size		Data size in bytes
+ * @return		Checksum in host byte order
+ */
+uint16_t inet_checksum_copy(uint16_t ivalue, void *dst, const void *src,
+    size_t size)
+{
+	uint32_t sum;
+
+	sum = (uint16_t) ~ivalue + inet_csum_sum(dst, src, size);
+	return (uint16_t) ~inet_csum_fold(sum);
+}
+
+/** Update checksum after changing a 16-bit field (RFC 1624, eqn. 3).
+ *
+ * @param csum		Checksum covering the field
+ * @param oval		Old field value in host byte order
+ * @param nval		New field value in host byte order
+ * @return		Updated checksum
+ */
+uint16_t inet_checksum_update16(uint16_t csum, uint16_t oval, uint16_t nval)
+{
+	uint32_t sum;
+
+	sum = (uint16_t) ~csum + (uint16_t) ~oval + nval;
+	return (uint16_t) ~inet_csum_fold(sum);
+}
+
+/** Update checksum after changing a 32-bit field (RFC 1624, eqn. 3).
+ *
+ * @param csum		Checksum covering the field
+ * @param oval		Old field value in host byte order
+ * @param nval		New field value in host byte order
+ * @return		Updated checksum
+ */
+uint16_t inet_checksum_update32(uint16_t csum, uint32_t oval, uint32_t nval)
+{
+	csum = inet_checksum_update16(csum, oval >> 16, nval >> 16);
+	return inet_checksum_update16(csum, oval & 0xffff, nval & 0xffff);
+}
+
+/** @}
+ */
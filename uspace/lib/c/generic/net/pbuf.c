@@ -0,0 +1,808 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Packet buffers
+ */
+
+#include <abi/ipc/methods.h>
+#include <as.h>
+#include <assert.h>
+#include <async.h>
+#include <bool.h>
+#include <errno.h>
+#include <ipc/pbuf.h>
+#include <macros.h>
+#include <mem.h>
+#include <net/pbuf.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/** Size of the area used by pbuf_alloc_shared() */
+#define PBUF_AREA_SIZE		(1024 * 1024)
+/** Allocation unit within the area */
+#define PBUF_BLOCK_SIZE		2048
+#define PBUF_AREA_BLOCKS	(PBUF_AREA_SIZE / PBUF_BLOCK_SIZE)
+
+/** Address space area holding packet buffers */
+typedef struct pbuf_area {
+	/** Identifier of the area, unique within this task */
+	sysarg_t id;
+	/** Start of the area */
+	uint8_t *base;
+	/** Size of the area in bytes */
+	size_t size;
+	/** Area was created by this task, not mapped from a peer */
+	bool owned;
+	/** Allocated blocks (owned area only) */
+	bool used[PBUF_AREA_BLOCKS];
+} pbuf_area_t;
+
+/** Area shared over a connection */
+typedef struct {
+	link_t link;
+	/** Identifier of the area in the sending task */
+	sysarg_t id;
+	/** Local mapping of the area (receiving side) */
+	pbuf_area_t *area;
+	/** Peer refused to map the area (sending side) */
+	bool refused;
+} pbuf_share_area_t;
+
+/** Protects the fields below and allocation in the owned area */
+static FIBRIL_MUTEX_INITIALIZE(pbuf_area_lock);
+/** Area for pbuf_alloc_shared(), created on first use */
+static pbuf_area_t *pbuf_own_area;
+/** The owned area could not be created */
+static bool pbuf_own_area_failed;
+/** Last assigned area identifier */
+static sysarg_t pbuf_area_last_id;
+
+/** Allocate packet buffer.
+ *
+ * The buffer structure and its storage are allocated in one block.
+ *
+ * @param headroom	Space to reserve in front of data
+ * @param size		Size of (uninitialized) data
+ * @param tailroom	Space to reserve after data
+ * @return		New buffer with reference count one or @c NULL
+ */
+pbuf_t *pbuf_alloc(size_t headroom, size_t size, size_t tailroom)
+{
+	pbuf_t *pbuf;
+	size_t buf_size;
+
+	buf_size = headroom + size + tailroom;
+
+	pbuf = malloc(sizeof(pbuf_t) + buf_size);
+	if (pbuf == NULL)
+		return NULL;
+
+	atomic_set(&pbuf->refcnt, 1);
+	pbuf->next = NULL;
+	pbuf->buf = (uint8_t *) (pbuf + 1);
+	pbuf->buf_size = buf_size;
+	pbuf->data = pbuf->buf + headroom;
+	pbuf->size = size;
+	pbuf->area = NULL;
+
+	return pbuf;
+}
+
+/** Create structure describing an area mapped in this task. */
+static pbuf_area_t *pbuf_area_create(void *base, size_t size, bool owned)
+{
+	pbuf_area_t *area;
+
+	area = calloc(1, sizeof(pbuf_area_t));
+	if (area == NULL)
+		return NULL;
+
+	fibril_mutex_lock(&pbuf_area_lock);
+	area->id = ++pbuf_area_last_id;
+	fibril_mutex_unlock(&pbuf_area_lock);
+
+	area->base = base;
+	area->size = size;
+	area->owned = owned;
+	return area;
+}
+
+/** Get the owned area, creating it if needed.
+ *
+ * Called with pbuf_area_lock held, drops it while creating the area.
+ */
+static pbuf_area_t *pbuf_own_area_get(void)
+{
+	pbuf_area_t *area;
+	void *base;
+
+	if (pbuf_own_area != NULL || pbuf_own_area_failed)
+		return pbuf_own_area;
+
+	fibril_mutex_unlock(&pbuf_area_lock);
+
+	area = NULL;
+	base = as_area_create(AS_AREA_ANY, PBUF_AREA_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	if (base != AS_MAP_FAILED) {
+		area = pbuf_area_create(base, PBUF_AREA_SIZE, true);
+		if (area == NULL)
+			as_area_destroy(base);
+	}
+
+	fibril_mutex_lock(&pbuf_area_lock);
+
+	if (pbuf_own_area != NULL) {
+		/* Another fibril was faster */
+		if (area != NULL) {
+			as_area_destroy(area->base);
+			free(area);
+		}
+	} else if (area != NULL) {
+		pbuf_own_area = area;
+	} else {
+		pbuf_own_area_failed = true;
+	}
+
+	return pbuf_own_area;
+}
+
+/** Allocate packet buffer in the shared area.
+ *
+ * The buffer can be passed to other tasks by pbuf_send() without copying.
+ * If the area is exhausted or cannot be created, the buffer is allocated
+ * like with pbuf_alloc().
+ *
+ * @param headroom	Space to reserve in front of data
+ * @param size		Size of (uninitialized) data
+ * @param tailroom	Space to reserve after data
+ * @return		New buffer with reference count one or @c NULL
+ */
+pbuf_t *pbuf_alloc_shared(size_t headroom, size_t size, size_t tailroom)
+{
+	pbuf_area_t *area;
+	pbuf_t *pbuf;
+	size_t buf_size;
+	size_t blocks;
+	size_t run;
+	size_t i;
+
+	buf_size = headroom + size + tailroom;
+	blocks = max(1, (buf_size + PBUF_BLOCK_SIZE - 1) / PBUF_BLOCK_SIZE);
+	if (blocks > PBUF_AREA_BLOCKS)
+		return pbuf_alloc(headroom, size, tailroom);
+
+	pbuf = malloc(sizeof(pbuf_t));
+	if (pbuf == NULL)
+		return NULL;
+
+	fibril_mutex_lock(&pbuf_area_lock);
+
+	area = pbuf_own_area_get();
+	if (area == NULL) {
+		fibril_mutex_unlock(&pbuf_area_lock);
+		free(pbuf);
+		return pbuf_alloc(headroom, size, tailroom);
+	}
+
+	/* First fit */
+	run = 0;
+	for (i = 0; i < PBUF_AREA_BLOCKS && run < blocks; i++) {
+		if (area->used[i])
+			run = 0;
+		else
+			run++;
+	}
+
+	if (run < blocks) {
+		fibril_mutex_unlock(&pbuf_area_lock);
+		free(pbuf);
+		return pbuf_alloc(headroom, size, tailroom);
+	}
+
+	i -= blocks;
+	for (run = 0; run < blocks; run++)
+		area->used[i + run] = true;
+
+	fibril_mutex_unlock(&pbuf_area_lock);
+
+	atomic_set(&pbuf->refcnt, 1);
+	pbuf->next = NULL;
+	pbuf->buf = area->base + i * PBUF_BLOCK_SIZE;
+	pbuf->buf_size = buf_size;
+	pbuf->data = pbuf->buf + headroom;
+	pbuf->size = size;
+	pbuf->area = area;
+
+	return pbuf;
+}
+
+/** Return storage of a buffer to the owned area. */
+static void pbuf_area_free(pbuf_t *pbuf)
+{
+	pbuf_area_t *area = pbuf->area;
+	size_t first;
+	size_t blocks;
+	size_t i;
+
+	first = (pbuf->buf - area->base) / PBUF_BLOCK_SIZE;
+	blocks = max(1, (pbuf->buf_size + PBUF_BLOCK_SIZE - 1) /
+	    PBUF_BLOCK_SIZE);
+
+	fibril_mutex_lock(&pbuf_area_lock);
+	for (i = 0; i < blocks; i++)
+		area->used[first + i] = false;
+	fibril_mutex_unlock(&pbuf_area_lock);
+}
+
+/** Create packet buffer around existing storage.
+ *
+ * @param buf		Storage allocated with malloc(), ownership is
+ *			transferred to the packet buffer on success
+ * @param size		Size of @a buf, all of it is valid data
+ * @return		New buffer with reference count one or @c NULL
+ */
+pbuf_t *pbuf_adopt(void *buf, size_t size)
+{
+	pbuf_t *pbuf;
+
+	pbuf = malloc(sizeof(pbuf_t));
+	if (pbuf == NULL)
+		return NULL;
+
+	atomic_set(&pbuf->refcnt, 1);
+	pbuf->next = NULL;
+	pbuf->buf = buf;
+	pbuf->buf_size = size;
+	pbuf->data = buf;
+	pbuf->size = size;
+	pbuf->area = NULL;
+
+	return pbuf;
+}
+
+/** Add reference to packet buffer.
+ *
+ * @param pbuf	Packet buffer
+ */
+void pbuf_addref(pbuf_t *pbuf)
+{
+	/* Borrowed buffers cannot be retained, see pbuf_keep() */
+	assert(pbuf->area == NULL || pbuf->area->owned);
+	atomic_inc(&pbuf->refcnt);
+}
+
+/** Remove reference from packet buffer.
+ *
+ * When the last reference is dropped the buffer is freed together with
+ * the reference it holds to the rest of the chain.
+ *
+ * @param pbuf	Packet buffer
+ */
+void pbuf_delref(pbuf_t *pbuf)
+{
+	pbuf_t *next;
+
+	while (pbuf != NULL) {
+		if (atomic_predec(&pbuf->refcnt) != 0)
+			break;
+
+		next = pbuf->next;
+		if (pbuf->area != NULL) {
+			if (pbuf->area->owned)
+				pbuf_area_free(pbuf);
+		} else if (pbuf->buf != (uint8_t *) (pbuf + 1)) {
+			free(pbuf->buf);
+		}
+		free(pbuf);
+		pbuf = next;
+	}
+}
+
+/** Obtain a reference to packet buffer data which outlives the current call.
+ *
+ * A buffer borrowed from a peer by pbuf_receive() becomes invalid once
+ * the call which carried it is answered, so its data is copied into a new
+ * buffer with the same head and tail room. Any other buffer just gets
+ * a new reference.
+ *
+ * @param pbuf	Packet buffer
+ * @return	Buffer to retain (@a pbuf or its copy) or @c NULL if out of
+ *		memory
+ */
+pbuf_t *pbuf_keep(pbuf_t *pbuf)
+{
+	pbuf_t *copy;
+
+	if (pbuf->area == NULL || pbuf->area->owned) {
+		pbuf_addref(pbuf);
+		return pbuf;
+	}
+
+	assert(pbuf->next == NULL);
+
+	copy = pbuf_alloc(pbuf_headroom(pbuf), pbuf->size,
+	    pbuf_tailroom(pbuf));
+	if (copy == NULL)
+		return NULL;
+
+	memcpy(copy->data, pbuf->data, pbuf->size);
+	return copy;
+}
+
+/** Return free space in front of data. */
+size_t pbuf_headroom(pbuf_t *pbuf)
+{
+	return pbuf->data - pbuf->buf;
+}
+
+/** Return free space after data. */
+size_t pbuf_tailroom(pbuf_t *pbuf)
+{
+	return pbuf->buf_size - pbuf_headroom(pbuf) - pbuf->size;
+}
+
+/** Extend data to the front, e.g. to prepend a header.
+ *
+ * @param pbuf	Packet buffer
+ * @param size	Number of bytes to add
+ * @return	New start of data or @c NULL if there is not enough headroom
+ */
+void *pbuf_push(pbuf_t *pbuf, size_t size)
+{
+	if (pbuf_headroom(pbuf) < size)
+		return NULL;
+
+	pbuf->data -= size;
+	pbuf->size += size;
+	return pbuf->data;
+}
+
+/** Remove data from the front, e.g. to strip a header.
+ *
+ * @param pbuf	Packet buffer
+ * @param size	Number of bytes to remove
+ * @return	New start of data or @c NULL if there is not enough data
+ */
+void *pbuf_pull(pbuf_t *pbuf, size_t size)
+{
+	if (pbuf->size < size)
+		return NULL;
+
+	pbuf->data += size;
+	pbuf->size -= size;
+	return pbuf->data;
+}
+
+/** Extend data at the end, e.g. to append a trailer or padding.
+ *
+ * @param pbuf	Packet buffer
+ * @param size	Number of bytes to add
+ * @return	Start of the added area or @c NULL if there is not enough
+ *		tailroom
+ */
+void *pbuf_put(pbuf_t *pbuf, size_t size)
+{
+	uint8_t *tail;
+
+	if (pbuf_tailroom(pbuf) < size)
+		return NULL;
+
+	tail = pbuf->data + pbuf->size;
+	pbuf->size += size;
+	return tail;
+}
+
+/** Shorten data by removing bytes from the end.
+ *
+ * @param pbuf	Packet buffer
+ * @param size	New data size, not greater than the current one
+ */
+void pbuf_trim(pbuf_t *pbuf, size_t size)
+{
+	assert(size <= pbuf->size);
+	pbuf->size = size;
+}
+
+/** Append buffer to the end of a chain.
+ *
+ * The reference to @a tail is transferred to the chain.
+ *
+ * @param head	First buffer of the chain
+ * @param tail	Buffer (chain) to append
+ */
+void pbuf_chain_append(pbuf_t *head, pbuf_t *tail)
+{
+	while (head->next != NULL)
+		head = head->next;
+
+	head->next = tail;
+}
+
+/** Return total size of data in a chain. */
+size_t pbuf_chain_size(pbuf_t *pbuf)
+{
+	size_t size;
+
+	size = 0;
+	while (pbuf != NULL) {
+		size += pbuf->size;
+		pbuf = pbuf->next;
+	}
+
+	return size;
+}
+
+/** Gather data from a chain into a contiguous buffer.
+ *
+ * @param pbuf	First buffer of the chain
+ * @param offs	Offset into chain data to start copying at
+ * @param dst	Destination buffer
+ * @param size	Maximum number of bytes to copy
+ * @return	Number of bytes actually copied
+ */
+size_t pbuf_copy_out(pbuf_t *pbuf, size_t offs, void *dst, size_t size)
+{
+	uint8_t *bdst = (uint8_t *) dst;
+	size_t copied;
+	size_t xfer;
+
+	while (pbuf != NULL && offs >= pbuf->size) {
+		offs -= pbuf->size;
+		pbuf = pbuf->next;
+	}
+
+	copied = 0;
+	while (pbuf != NULL && copied < size) {
+		xfer = min(pbuf->size - offs, size - copied);
+		memcpy(bdst + copied, pbuf->data + offs, xfer);
+		copied += xfer;
+		offs = 0;
+		pbuf = pbuf->next;
+	}
+
+	return copied;
+}
+
+/** Initialize set of areas shared over a connection. */
+void pbuf_share_init(pbuf_share_t *share)
+{
+	fibril_mutex_initialize(&share->lock);
+	list_initialize(&share->areas);
+}
+
+/** Forget all areas shared over a connection.
+ *
+ * Mappings of the peer's areas are destroyed. The set can be reused for
+ * a new connection afterwards.
+ */
+void pbuf_share_fini(pbuf_share_t *share)
+{
+	pbuf_share_area_t *sarea;
+	link_t *link;
+
+	fibril_mutex_lock(&share->lock);
+
+	while (!list_empty(&share->areas)) {
+		link = list_first(&share->areas);
+		sarea = list_get_instance(link, pbuf_share_area_t, link);
+		list_remove(link);
+
+		if (sarea->area != NULL) {
+			as_area_destroy(sarea->area->base);
+			free(sarea->area);
+		}
+
+		free(sarea);
+	}
+
+	fibril_mutex_unlock(&share->lock);
+}
+
+/** Find area in a share. Called with the share locked. */
+static pbuf_share_area_t *pbuf_share_find(pbuf_share_t *share, sysarg_t id)
+{
+	list_foreach(share->areas, link) {
+		pbuf_share_area_t *sarea = list_get_instance(link,
+		    pbuf_share_area_t, link);
+
+		if (sarea->id == id)
+			return sarea;
+	}
+
+	return NULL;
+}
+
+/** Pass packet buffer data to the peer by a data write. */
+static int pbuf_send_copy(async_exch_t *exch, pbuf_t *pbuf)
+{
+	size_t size;
+	void *data;
+	int rc;
+
+	if (pbuf->next == NULL)
+		return async_data_write_start(exch, pbuf->data, pbuf->size);
+
+	size = pbuf_chain_size(pbuf);
+	data = malloc(size);
+	if (data == NULL)
+		return ENOMEM;
+
+	pbuf_copy_out(pbuf, 0, data, size);
+	rc = async_data_write_start(exch, data, size);
+	free(data);
+
+	return rc;
+}
+
+/** Pass packet buffer data to the peer by reference. */
+static int pbuf_send_ref(async_exch_t *exch, pbuf_t *pbuf)
+{
+	pbuf_area_t *area = pbuf->area;
+
+	return async_req_5_0(exch, PBUF_REF, area->id, pbuf->buf - area->base,
+	    pbuf->buf_size, pbuf->data - pbuf->buf, pbuf->size);
+}
+
+/** Pass packet buffer data to the peer.
+ *
+ * Used in place of async_data_write_start() within a protocol request.
+ * A buffer in a shared area is passed by reference, sharing the area
+ * with the peer first if it has not been shared over this connection yet.
+ * Other buffers, and all buffers if the peer refuses to map the area,
+ * are copied by a data write.
+ *
+ * The data must not be modified until the request is answered.
+ *
+ * @param share	Areas shared with the peer
+ * @param exch	Exchange to the peer
+ * @param pbuf	Buffer (chain) to pass
+ * @return	EOK on success or negative error code
+ */
+int pbuf_send(pbuf_share_t *share, async_exch_t *exch, pbuf_t *pbuf)
+{
+	pbuf_area_t *area = pbuf->area;
+	pbuf_share_area_t *sarea;
+	int rc;
+
+	if (area == NULL || pbuf->next != NULL)
+		return pbuf_send_copy(exch, pbuf);
+
+	fibril_mutex_lock(&share->lock);
+
+	sarea = pbuf_share_find(share, area->id);
+	if (sarea != NULL) {
+		fibril_mutex_unlock(&share->lock);
+		if (sarea->refused)
+			return pbuf_send_copy(exch, pbuf);
+		return pbuf_send_ref(exch, pbuf);
+	}
+
+	sarea = calloc(1, sizeof(pbuf_share_area_t));
+	if (sarea == NULL) {
+		fibril_mutex_unlock(&share->lock);
+		return pbuf_send_copy(exch, pbuf);
+	}
+
+	link_initialize(&sarea->link);
+	sarea->id = area->id;
+
+	rc = async_share_out_start(exch, area->base,
+	    AS_AREA_READ | AS_AREA_WRITE);
+	if (rc != EOK) {
+		sarea->refused = true;
+		list_append(&sarea->link, &share->areas);
+		fibril_mutex_unlock(&share->lock);
+		return pbuf_send_copy(exch, pbuf);
+	}
+
+	/*
+	 * The peer binds the mapping to the identifier when the reference
+	 * arrives. Keep the share locked until then so that no other fibril
+	 * refers to the area before.
+	 */
+	rc = pbuf_send_ref(exch, pbuf);
+	if (rc == EOK)
+		list_append(&sarea->link, &share->areas);
+	else
+		free(sarea);
+
+	fibril_mutex_unlock(&share->lock);
+	return rc;
+}
+
+/** Map area shared by the peer. */
+static pbuf_area_t *pbuf_share_accept(pbuf_share_t *share,
+    ipc_callid_t callid, ipc_call_t *call)
+{
+	pbuf_area_t *area;
+	void *base;
+	int rc;
+
+	if (share == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		return NULL;
+	}
+
+	rc = async_share_out_finalize(callid, &base);
+	if (rc != EOK || base == AS_MAP_FAILED)
+		return NULL;
+
+	area = pbuf_area_create(base, IPC_GET_ARG2(*call), false);
+	if (area == NULL)
+		as_area_destroy(base);
+
+	return area;
+}
+
+/** Accept PBUF_REF into a borrowed buffer. */
+static int pbuf_ref_accept(pbuf_share_t *share, pbuf_area_t *narea,
+    ipc_callid_t callid, ipc_call_t *call, pbuf_t **rpbuf)
+{
+	pbuf_share_area_t *sarea;
+	pbuf_area_t *area;
+	pbuf_t *pbuf;
+	sysarg_t id = IPC_GET_ARG1(*call);
+	size_t buf_offs = IPC_GET_ARG2(*call);
+	size_t buf_size = IPC_GET_ARG3(*call);
+	size_t data_offs = IPC_GET_ARG4(*call);
+	size_t size = IPC_GET_ARG5(*call);
+
+	if (share == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		return ENOTSUP;
+	}
+
+	fibril_mutex_lock(&share->lock);
+
+	sarea = pbuf_share_find(share, id);
+	if (narea != NULL) {
+		if (sarea == NULL) {
+			sarea = calloc(1, sizeof(pbuf_share_area_t));
+			if (sarea == NULL) {
+				fibril_mutex_unlock(&share->lock);
+				as_area_destroy(narea->base);
+				free(narea);
+				async_answer_0(callid, ENOMEM);
+				return ENOMEM;
+			}
+
+			link_initialize(&sarea->link);
+			sarea->id = id;
+			list_append(&sarea->link, &share->areas);
+		} else {
+			as_area_destroy(sarea->area->base);
+			free(sarea->area);
+		}
+
+		sarea->area = narea;
+	}
+
+	fibril_mutex_unlock(&share->lock);
+
+	if (sarea == NULL) {
+		async_answer_0(callid, ENOENT);
+		return ENOENT;
+	}
+
+	area = sarea->area;
+	if (buf_offs > area->size || buf_size > area->size - buf_offs ||
+	    data_offs > buf_size || size > buf_size - data_offs) {
+		async_answer_0(callid, EINVAL);
+		return EINVAL;
+	}
+
+	pbuf = malloc(sizeof(pbuf_t));
+	if (pbuf == NULL) {
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+
+	atomic_set(&pbuf->refcnt, 1);
+	pbuf->next = NULL;
+	pbuf->buf = area->base + buf_offs;
+	pbuf->buf_size = buf_size;
+	pbuf->data = pbuf->buf + data_offs;
+	pbuf->size = size;
+	pbuf->area = area;
+
+	async_answer_0(callid, EOK);
+
+	*rpbuf = pbuf;
+	return EOK;
+}
+
+/** Receive packet buffer data passed by pbuf_send().
+ *
+ * Used in place of async_data_write_accept(). Data passed by reference is
+ * not copied, the returned buffer is borrowed from the peer's area and is
+ * valid only until the request which carried it is answered (see
+ * pbuf_keep()). Copied data is placed in the shared area, so either way
+ * the buffer can be passed on by pbuf_send() without another copy. The
+ * buffer must be released with pbuf_delref() as usual. Head and tail room
+ * are reserved only when the data is copied, a borrowed buffer has
+ * whatever room the sender left.
+ *
+ * @param share		Areas of the peer mapped by this task or @c NULL to
+ *			refuse mapping them
+ * @param rpbuf		Place to store the buffer
+ * @param headroom	Space to reserve in front of copied data
+ * @param tailroom	Space to reserve after copied data
+ * @return		EOK on success or negative error code
+ */
+int pbuf_receive(pbuf_share_t *share, pbuf_t **rpbuf, size_t headroom,
+    size_t tailroom)
+{
+	pbuf_area_t *narea;
+	ipc_callid_t callid;
+	ipc_call_t call;
+	pbuf_t *pbuf;
+	int rc;
+
+	narea = NULL;
+	callid = async_get_call(&call);
+	if (IPC_GET_IMETHOD(call) == IPC_M_SHARE_OUT) {
+		narea = pbuf_share_accept(share, callid, &call);
+		callid = async_get_call(&call);
+	}
+
+	if (IPC_GET_IMETHOD(call) == PBUF_REF)
+		return pbuf_ref_accept(share, narea, callid, &call, rpbuf);
+
+	if (narea != NULL) {
+		as_area_destroy(narea->base);
+		free(narea);
+	}
+
+	if (IPC_GET_IMETHOD(call) != IPC_M_DATA_WRITE) {
+		async_answer_0(callid, EINVAL);
+		return EINVAL;
+	}
+
+	/* Copy into the shared area so that the data can be passed on */
+	pbuf = pbuf_alloc_shared(headroom, IPC_GET_ARG2(call), tailroom);
+	if (pbuf == NULL) {
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+
+	rc = async_data_write_finalize(callid, pbuf->data, pbuf->size);
+	if (rc != EOK) {
+		pbuf_delref(pbuf);
+		return rc;
+	}
+
+	*rpbuf = pbuf;
+	return EOK;
+}
+
+/** @}
+ */
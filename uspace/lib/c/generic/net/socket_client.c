@@ -45,11 +45,15 @@
 #include <task.h>
 #include <ns.h>
 #include <ipc/services.h>
+#include <abi/ipc/methods.h>
 #include <ipc/socket.h>
 #include <net/in.h>
 #include <net/socket.h>
 #include <adt/dynamic_fifo.h>
 #include <adt/int_map.h>
+#include <adt/list.h>
+#include <sys/time.h>
+#include <vfs/vfs.h>
 
 /** Initial received packet queue size. */
 #define SOCKET_INITIAL_RECEIVED_SIZE	4
@@ -132,8 +136,67 @@ struct socket {
 	 * Used while waiting for the received packets or accepted sockets.
 	 */
 	int blocked;
+
+	/**
+	 * Events the socket is ready for (SOCKET_EV_xxx).
+	 * Locked by the event queue lock.
+	 */
+	unsigned evq_ready;
+	/**
+	 * Event queue registrations of the socket.
+	 * Locked by the event queue lock.
+	 */
+	list_t evq_regs;
 };
 
+/** Socket event queue.
+ *
+ * Registrations whose socket is ready for any of the events of interest
+ * are kept in the ready list, so waiting does not need to scan all
+ * registered sockets. Notification is level-triggered, a registration
+ * stays in the ready list until the socket stops being ready.
+ */
+struct socket_evq {
+	/** Registrations, socket_evq_reg_t. */
+	list_t regs;
+	/** Registrations with pending events, socket_evq_reg_t. */
+	list_t ready;
+	/** Signaled when a registration is added to the ready list. */
+	fibril_condvar_t ready_cv;
+};
+
+/** Registration of a socket with an event queue. */
+typedef struct {
+	/** Link to socket_t.evq_regs. */
+	link_t sock_link;
+	/** Link to socket_evq_t.regs. */
+	link_t evq_link;
+	/** Link to socket_evq_t.ready. */
+	link_t ready_link;
+	/** The registration is in the ready list. */
+	bool queued;
+	/** Event queue. */
+	socket_evq_t *evq;
+	/** Registered socket. */
+	socket_t *socket;
+	/** Events of interest (SOCKET_EV_xxx). */
+	unsigned events;
+	/** Argument reported with events. */
+	void *arg;
+} socket_evq_reg_t;
+
+/** File transfer in progress on a socket. */
+typedef struct {
+	/** Link to socket_client_globals.sendfiles. */
+	link_t link;
+	/** Socket identifier. */
+	int socket_id;
+	/** File descriptor of the file being sent. */
+	int fildes;
+	/** Position in the file where the transfer started. */
+	aoff64_t pos;
+} socket_sendfile_t;
+
 /** Sockets map.
  * Maps socket identifiers to the socket specific data.
  * @see int_map.h
@@ -157,11 +220,33 @@ static struct socket_client_globals {
 	 * No socket lock may be locked if this lock is unlocked.
 	 */
 	fibril_rwlock_t lock;
+
+	/** Event queue lock.
+	 * Locks all event queues and socket readiness. It may be locked
+	 * while holding any other lock, but no other lock may be locked
+	 * while holding it.
+	 */
+	fibril_mutex_t evq_lock;
+
+	/** File transfers in progress, socket_sendfile_t. */
+	list_t sendfiles;
+	/** Locks the sendfiles list. No other lock may be locked while
+	 * holding it.
+	 */
+	fibril_mutex_t sendfile_lock;
 } socket_globals = {
 	.tcp_sess = NULL,
 	.udp_sess = NULL,
 	.sockets = NULL,
-	.lock = FIBRIL_RWLOCK_INITIALIZER(socket_globals.lock)
+	.lock = FIBRIL_RWLOCK_INITIALIZER(socket_globals.lock),
+	.evq_lock = FIBRIL_MUTEX_INITIALIZER(socket_globals.evq_lock),
+	.sendfiles = {
+		.head = {
+			.prev = &socket_globals.sendfiles.head,
+			.next = &socket_globals.sendfiles.head
+		}
+	},
+	.sendfile_lock = FIBRIL_MUTEX_INITIALIZER(socket_globals.sendfile_lock)
 };
 
 INT_MAP_IMPLEMENT(sockets, socket_t);
@@ -189,6 +274,112 @@ static sockets_t *socket_get_sockets(void)
 	return socket_globals.sockets;
 }
 
+/** Move registration to or from the ready list of its event queue.
+ *
+ * @param[in] reg	The registration.
+ */
+static void socket_evq_reg_update(socket_evq_reg_t *reg)
+{
+	socket_evq_t *evq = reg->evq;
+	bool pending;
+
+	assert(fibril_mutex_is_locked(&socket_globals.evq_lock));
+
+	pending = (reg->socket->evq_ready & reg->events) != 0;
+	if (pending && !reg->queued) {
+		list_append(&reg->ready_link, &evq->ready);
+		reg->queued = true;
+		fibril_condvar_broadcast(&evq->ready_cv);
+	} else if (!pending && reg->queued) {
+		list_remove(&reg->ready_link);
+		reg->queued = false;
+	}
+}
+
+/** Remove registration from its socket and event queue and free it.
+ *
+ * @param[in] reg	The registration.
+ */
+static void socket_evq_reg_destroy(socket_evq_reg_t *reg)
+{
+	assert(fibril_mutex_is_locked(&socket_globals.evq_lock));
+
+	if (reg->queued)
+		list_remove(&reg->ready_link);
+	list_remove(&reg->sock_link);
+	list_remove(&reg->evq_link);
+	free(reg);
+}
+
+/** Update socket readiness and notify event queues.
+ *
+ * @param[in] socket	The socket.
+ * @param[in] events	Events to update (SOCKET_EV_xxx).
+ * @param[in] ready	Whether the socket is ready for @a events.
+ */
+static void socket_set_ready(socket_t *socket, unsigned events, bool ready)
+{
+	fibril_mutex_lock(&socket_globals.evq_lock);
+
+	if (ready)
+		socket->evq_ready |= events;
+	else
+		socket->evq_ready &= ~events;
+
+	list_foreach(socket->evq_regs, link) {
+		socket_evq_reg_update(list_get_instance(link, socket_evq_reg_t,
+		    sock_link));
+	}
+
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+}
+
+/** Find a file transfer in progress on a socket.
+ *
+ * @param[in] socket_id	Socket identifier.
+ * @return		The file transfer or NULL if there is none.
+ */
+static socket_sendfile_t *socket_sendfile_find(int socket_id)
+{
+	assert(fibril_mutex_is_locked(&socket_globals.sendfile_lock));
+
+	list_foreach(socket_globals.sendfiles, link) {
+		socket_sendfile_t *sf = list_get_instance(link,
+		    socket_sendfile_t, link);
+		if (sf->socket_id == socket_id)
+			return sf;
+	}
+
+	return NULL;
+}
+
+/** Pass a data read of the socket module on to the file being sent.
+ *
+ * @param[in] callid	The data read message identifier.
+ * @param[in] call	The data read message call structure.
+ */
+static void socket_sendfile_read(ipc_callid_t callid, ipc_call_t *call)
+{
+	socket_sendfile_t *sf;
+	int fildes;
+	aoff64_t pos;
+
+	fibril_mutex_lock(&socket_globals.sendfile_lock);
+	sf = socket_sendfile_find((int) IPC_GET_ARG4(*call));
+	if (!sf) {
+		fibril_mutex_unlock(&socket_globals.sendfile_lock);
+		async_answer_0(callid, ENOENT);
+		return;
+	}
+
+	fildes = sf->fildes;
+	pos = sf->pos + IPC_GET_ARG5(*call);
+	fibril_mutex_unlock(&socket_globals.sendfile_lock);
+
+	/* The file system server answers the data read directly */
+	(void) vfs_pread_forward(fildes, callid, pos);
+}
+
 /** Default thread for new connections.
  *
  * @param[in] iid	The initial message identifier.
@@ -230,6 +421,7 @@ loop:
 			if (rc == EOK) {
 				/* Signal the received packet */
 				fibril_condvar_signal(&socket->receive_signal);
+				socket_set_ready(socket, SOCKET_EV_READ, true);
 			}
 			fibril_mutex_unlock(&socket->receive_lock);
 			break;
@@ -242,6 +434,7 @@ loop:
 			if (rc == EOK) {
 				/* Signal the accepted socket */
 				fibril_condvar_signal(&socket->accept_signal);
+				socket_set_ready(socket, SOCKET_EV_ACCEPT, true);
 			}
 			fibril_mutex_unlock(&socket->accept_lock);
 			break;
@@ -265,6 +458,10 @@ loop:
 		fibril_rwlock_read_unlock(&socket_globals.lock);
 		break;
 
+	case IPC_M_DATA_READ:
+		socket_sendfile_read(callid, &call);
+		goto loop;
+
 	default:
 		rc = ENOTSUP;
 	}
@@ -359,6 +556,8 @@ static void socket_initialize(socket_t *socket, int socket_id,
 	fibril_mutex_initialize(&socket->accept_lock);
 	fibril_condvar_initialize(&socket->accept_signal);
 	fibril_rwlock_initialize(&socket->sending_lock);
+	socket->evq_ready = SOCKET_EV_WRITE;
+	list_initialize(&socket->evq_regs);
 }
 
 /** Creates a new socket.
@@ -700,6 +899,9 @@ int accept(int socket_id, struct sockaddr * cliaddr, socklen_t * addrlen)
 			;
 	}
 
+	socket_set_ready(socket, SOCKET_EV_ACCEPT,
+	    dyn_fifo_value(&socket->accepted) > 0);
+
 	fibril_mutex_unlock(&socket->accept_lock);
 	return result;
 }
@@ -741,6 +943,14 @@ static void socket_destroy(socket_t *socket)
 	while ((accepted_id = dyn_fifo_pop(&socket->accepted)) >= 0)
 		socket_destroy(sockets_find(socket_get_sockets(), accepted_id));
 
+	/* Remove the socket from all event queues */
+	fibril_mutex_lock(&socket_globals.evq_lock);
+	while (!list_empty(&socket->evq_regs)) {
+		socket_evq_reg_destroy(list_get_instance(
+		    list_first(&socket->evq_regs), socket_evq_reg_t, sock_link));
+	}
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+
 	dyn_fifo_destroy(&socket->received);
 	dyn_fifo_destroy(&socket->accepted);
 	sockets_exclude(socket_get_sockets(), socket->socket_id, free);
@@ -955,6 +1165,95 @@ sendto(int socket_id, const void *data, size_t datalength, int flags,
 	    flags, toaddr, addrlen);
 }
 
+/** Sends data from a file via the socket.
+ *
+ * The socket module reads the data from the file system server through
+ * this task, which forwards its requests to VFS, so the data is copied
+ * by the kernel directly from the file system server into the socket
+ * module. Neither the current position in the file nor the position of
+ * any other file transfer is affected.
+ *
+ * Only one file transfer may be in progress on a socket at a time.
+ *
+ * @param[in] socket_id	Socket identifier.
+ * @param[in] fildes	File descriptor of the file to send.
+ * @param[in] pos	Position in the file where to start.
+ * @param[in] count	Number of bytes to send.
+ * @return		Number of bytes sent on success. This is less than
+ *			@a count if the end of the file was reached.
+ * @return		ENOTSOCK if the socket is not found.
+ * @return		EBUSY if another file transfer is in progress on
+ *			the socket.
+ * @return		ENOTSUP if the socket module does not support file
+ *			transfers.
+ * @return		Other error codes as defined for the
+ *			NET_SOCKET_SENDFILE message.
+ */
+ssize_t sendfile(int socket_id, int fildes, aoff64_t pos, size_t count)
+{
+	socket_t *socket;
+	socket_sendfile_t sf;
+	aid_t message_id;
+	sysarg_t result;
+	ipc_call_t answer;
+
+	if (!count)
+		return 0;
+
+	/* The number of bytes sent must be representable */
+	if (count > SSIZE_MAX)
+		count = SSIZE_MAX;
+
+	fibril_rwlock_read_lock(&socket_globals.lock);
+
+	/* Find socket */
+	socket = sockets_find(socket_get_sockets(), socket_id);
+	if (!socket) {
+		fibril_rwlock_read_unlock(&socket_globals.lock);
+		return ENOTSOCK;
+	}
+
+	fibril_mutex_lock(&socket_globals.sendfile_lock);
+	if (socket_sendfile_find(socket_id)) {
+		fibril_mutex_unlock(&socket_globals.sendfile_lock);
+		fibril_rwlock_read_unlock(&socket_globals.lock);
+		return EBUSY;
+	}
+
+	link_initialize(&sf.link);
+	sf.socket_id = socket_id;
+	sf.fildes = fildes;
+	sf.pos = pos;
+	list_append(&sf.link, &socket_globals.sendfiles);
+	fibril_mutex_unlock(&socket_globals.sendfile_lock);
+
+	fibril_rwlock_read_lock(&socket->sending_lock);
+
+	/* Request send, the data is read while the request is processed */
+	async_exch_t *exch = async_exchange_begin(socket->sess);
+	message_id = async_send_2(exch, NET_SOCKET_SENDFILE,
+	    (sysarg_t) socket->socket_id, (sysarg_t) count, &answer);
+	async_exchange_end(exch);
+
+	if (message_id != 0)
+		async_wait_for(message_id, &result);
+	else
+		result = ENOMEM;
+
+	fibril_rwlock_read_unlock(&socket->sending_lock);
+
+	fibril_mutex_lock(&socket_globals.sendfile_lock);
+	list_remove(&sf.link);
+	fibril_mutex_unlock(&socket_globals.sendfile_lock);
+
+	fibril_rwlock_read_unlock(&socket_globals.lock);
+
+	if (result != EOK)
+		return (ssize_t) result;
+
+	return (ssize_t) IPC_GET_ARG1(answer);
+}
+
 /** Receives data via the socket.
  *
  * @param[in] message	The action message.
@@ -1088,6 +1387,8 @@ recvfrom_core(sysarg_t message, int socket_id, void *data, size_t datalength,
 	if (result == EOK) {
 		/* Dequeue the received packet */
 		dyn_fifo_pop(&socket->received);
+		socket_set_ready(socket, SOCKET_EV_READ,
+		    dyn_fifo_value(&socket->received) >= 0);
 		/* Return read data length */
 		retval = SOCKET_GET_READ_DATA_LENGTH(answer);
 		/* Set address length */
@@ -1236,5 +1537,237 @@ setsockopt(int socket_id, int level, int optname, const void *value,
 	    (sysarg_t) optname, value, optlen);
 }
 
+/** Creates a socket event queue.
+ *
+ * @return		The new event queue or NULL if there is not enough
+ *			memory left.
+ */
+socket_evq_t *socket_evq_create(void)
+{
+	socket_evq_t *evq;
+
+	evq = (socket_evq_t *) malloc(sizeof(socket_evq_t));
+	if (!evq)
+		return NULL;
+
+	list_initialize(&evq->regs);
+	list_initialize(&evq->ready);
+	fibril_condvar_initialize(&evq->ready_cv);
+
+	return evq;
+}
+
+/** Destroys a socket event queue.
+ *
+ * No fibril may be waiting on the queue.
+ *
+ * @param[in] evq	The event queue.
+ */
+void socket_evq_destroy(socket_evq_t *evq)
+{
+	fibril_mutex_lock(&socket_globals.evq_lock);
+	while (!list_empty(&evq->regs)) {
+		socket_evq_reg_destroy(list_get_instance(list_first(&evq->regs),
+		    socket_evq_reg_t, evq_link));
+	}
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+
+	free(evq);
+}
+
+/** Adds socket to an event queue.
+ *
+ * The socket is removed from the queue automatically when it is closed.
+ *
+ * @param[in] evq	The event queue.
+ * @param[in] socket_id	Socket identifier.
+ * @param[in] events	Events of interest (SOCKET_EV_xxx).
+ * @param[in] arg	Argument to report with the socket events.
+ * @return		EOK on success.
+ * @return		ENOTSOCK if the socket is not found.
+ * @return		EEXIST if the socket is already in the queue.
+ * @return		ENOMEM if there is not enough memory left.
+ */
+int socket_evq_add(socket_evq_t *evq, int socket_id, unsigned events,
+    void *arg)
+{
+	socket_t *socket;
+	socket_evq_reg_t *reg;
+
+	fibril_rwlock_read_lock(&socket_globals.lock);
+
+	socket = sockets_find(socket_get_sockets(), socket_id);
+	if (!socket) {
+		fibril_rwlock_read_unlock(&socket_globals.lock);
+		return ENOTSOCK;
+	}
+
+	fibril_mutex_lock(&socket_globals.evq_lock);
+
+	list_foreach(socket->evq_regs, link) {
+		reg = list_get_instance(link, socket_evq_reg_t, sock_link);
+		if (reg->evq == evq) {
+			fibril_mutex_unlock(&socket_globals.evq_lock);
+			fibril_rwlock_read_unlock(&socket_globals.lock);
+			return EEXIST;
+		}
+	}
+
+	reg = (socket_evq_reg_t *) malloc(sizeof(socket_evq_reg_t));
+	if (!reg) {
+		fibril_mutex_unlock(&socket_globals.evq_lock);
+		fibril_rwlock_read_unlock(&socket_globals.lock);
+		return ENOMEM;
+	}
+
+	link_initialize(&reg->sock_link);
+	link_initialize(&reg->evq_link);
+	link_initialize(&reg->ready_link);
+	reg->queued = false;
+	reg->evq = evq;
+	reg->socket = socket;
+	reg->events = events;
+	reg->arg = arg;
+
+	list_append(&reg->sock_link, &socket->evq_regs);
+	list_append(&reg->evq_link, &evq->regs);
+	socket_evq_reg_update(reg);
+
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+	fibril_rwlock_read_unlock(&socket_globals.lock);
+	return EOK;
+}
+
+/** Changes events of interest of a socket in an event queue.
+ *
+ * @param[in] evq	The event queue.
+ * @param[in] socket_id	Socket identifier.
+ * @param[in] events	New events of interest (SOCKET_EV_xxx).
+ * @param[in] arg	New argument to report with the socket events.
+ * @return		EOK on success.
+ * @return		ENOENT if the socket is not in the queue.
+ */
+int socket_evq_modify(socket_evq_t *evq, int socket_id, unsigned events,
+    void *arg)
+{
+	socket_evq_reg_t *reg;
+
+	fibril_mutex_lock(&socket_globals.evq_lock);
+
+	list_foreach(evq->regs, link) {
+		reg = list_get_instance(link, socket_evq_reg_t, evq_link);
+		if (reg->socket->socket_id == socket_id) {
+			reg->events = events;
+			reg->arg = arg;
+			socket_evq_reg_update(reg);
+			fibril_mutex_unlock(&socket_globals.evq_lock);
+			return EOK;
+		}
+	}
+
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+	return ENOENT;
+}
+
+/** Removes socket from an event queue.
+ *
+ * @param[in] evq	The event queue.
+ * @param[in] socket_id	Socket identifier.
+ * @return		EOK on success.
+ * @return		ENOENT if the socket is not in the queue.
+ */
+int socket_evq_remove(socket_evq_t *evq, int socket_id)
+{
+	socket_evq_reg_t *reg;
+
+	fibril_mutex_lock(&socket_globals.evq_lock);
+
+	list_foreach(evq->regs, link) {
+		reg = list_get_instance(link, socket_evq_reg_t, evq_link);
+		if (reg->socket->socket_id == socket_id) {
+			socket_evq_reg_destroy(reg);
+			fibril_mutex_unlock(&socket_globals.evq_lock);
+			return EOK;
+		}
+	}
+
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+	return ENOENT;
+}
+
+/** Waits for events on sockets in an event queue.
+ *
+ * Sockets which are still ready after being reported are moved to the end
+ * of the queue so that subsequent calls report other sockets first.
+ *
+ * @param[in] evq	The event queue.
+ * @param[out] events	Buffer for the events.
+ * @param[in] max	Maximum number of events to return.
+ * @param[in] timeout	Timeout in microseconds, zero not to block or
+ *			negative to wait indefinitely.
+ * @return		Number of events stored in @a events, zero if the
+ *			timeout expired.
+ * @return		EINVAL if @a max is zero.
+ */
+int socket_evq_wait(socket_evq_t *evq, socket_event_t *events, size_t max,
+    suseconds_t timeout)
+{
+	socket_evq_reg_t *reg;
+	struct timeval deadline;
+	struct timeval now;
+	suseconds_t left;
+	link_t *link;
+	size_t count;
+	size_t i;
+
+	if (max == 0)
+		return EINVAL;
+
+	if (timeout > 0) {
+		gettimeofday(&deadline, NULL);
+		tv_add(&deadline, timeout);
+	}
+
+	fibril_mutex_lock(&socket_globals.evq_lock);
+
+	while (list_empty(&evq->ready) && timeout != 0) {
+		if (timeout < 0) {
+			fibril_condvar_wait(&evq->ready_cv,
+			    &socket_globals.evq_lock);
+			continue;
+		}
+
+		gettimeofday(&now, NULL);
+		left = tv_sub(&deadline, &now);
+		if (left <= 0)
+			break;
+
+		(void) fibril_condvar_wait_timeout(&evq->ready_cv,
+		    &socket_globals.evq_lock, left);
+	}
+
+	count = 0;
+	list_foreach(evq->ready, rlink) {
+		if (count >= max)
+			break;
+
+		reg = list_get_instance(rlink, socket_evq_reg_t, ready_link);
+		events[count].socket_id = reg->socket->socket_id;
+		events[count].events = reg->socket->evq_ready & reg->events;
+		events[count].arg = reg->arg;
+		++count;
+	}
+
+	/* Rotate the reported registrations to the end */
+	for (i = 0; i < count; i++) {
+		link = list_first(&evq->ready);
+		list_remove(link);
+		list_append(link, &evq->ready);
+	}
+
+	fibril_mutex_unlock(&socket_globals.evq_lock);
+	return (int) count;
+}
+
 /** @}
  */
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ *
+ * Asynchronous file I/O.
+ *
+ * Each operation is a positional read or write sent to VFS without waiting
+ * for the answer, so that a single fibril can keep several operations in
+ * flight, possibly on the same file. The operations are completed by waiting
+ * for them, either one by one or all at once.
+ */
+
+#include <vfs/aio.h>
+#include <vfs/vfs.h>
+#include <ipc/vfs.h>
+#include <abi/ipc/methods.h>
+#include <macros.h>
+#include <errno.h>
+#include <assert.h>
+
+static int vfs_aio_submit(vfs_aio_t *aio, int fildes, void *buf, size_t nbyte,
+    aoff64_t pos, bool read)
+{
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	aio->req = async_send_3(exch, read ? VFS_IN_PREAD : VFS_IN_PWRITE,
+	    fildes, LOWER32(pos), UPPER32(pos), &aio->answer);
+	if (aio->req == 0) {
+		vfs_exchange_end(exch);
+		return ENOMEM;
+	}
+	
+	if (read)
+		aio->xfer = async_data_read(exch, buf, nbyte, &aio->xfer_answer);
+	else
+		aio->xfer = async_send_2(exch, IPC_M_DATA_WRITE,
+		    (sysarg_t) buf, (sysarg_t) nbyte, &aio->xfer_answer);
+	
+	if (aio->xfer == 0) {
+		/*
+		 * VFS is waiting for the data transfer which will never come.
+		 * Send it a different call instead, so that it refuses the
+		 * request, and collect the answer.
+		 */
+		aid_t ping = async_send_0(exch, VFS_IN_PING, NULL);
+		vfs_exchange_end(exch);
+		
+		if (ping == 0) {
+			async_forget(aio->req);
+			return ENOMEM;
+		}
+		
+		async_wait_for(ping, NULL);
+		async_wait_for(aio->req, NULL);
+		return ENOMEM;
+	}
+	
+	vfs_exchange_end(exch);
+	
+	aio->pending = true;
+	aio->result = 0;
+	return EOK;
+}
+
+/** Start reading data from a file at the given position.
+ *
+ * @param aio    Structure describing the operation.
+ * @param fildes File descriptor.
+ * @param buf    Buffer to read data into. It must stay valid until the
+ *               operation is waited for.
+ * @param nbyte  Maximum number of bytes to read.
+ * @param pos    Position in the file where to start reading.
+ *
+ * @return EOK if the operation was started or a negative error code.
+ *
+ */
+int vfs_aio_read(vfs_aio_t *aio, int fildes, void *buf, size_t nbyte,
+    aoff64_t pos)
+{
+	return vfs_aio_submit(aio, fildes, buf, nbyte, pos, true);
+}
+
+/** Start writing data to a file at the given position.
+ *
+ * @param aio    Structure describing the operation.
+ * @param fildes File descriptor.
+ * @param buf    Data to write. The buffer must stay valid until the
+ *               operation is waited for.
+ * @param nbyte  Number of bytes to write.
+ * @param pos    Position in the file where to start writing.
+ *
+ * @return EOK if the operation was started or a negative error code.
+ *
+ */
+int vfs_aio_write(vfs_aio_t *aio, int fildes, const void *buf, size_t nbyte,
+    aoff64_t pos)
+{
+	return vfs_aio_submit(aio, fildes, (void *) buf, nbyte, pos, false);
+}
+
+/** Wait for an asynchronous operation to complete.
+ *
+ * @param aio Operation started by vfs_aio_read() or vfs_aio_write().
+ *
+ * @return Number of bytes moved or a negative error code.
+ *
+ */
+ssize_t vfs_aio_wait(vfs_aio_t *aio)
+{
+	if (!aio->pending)
+		return aio->result;
+	
+	sysarg_t xrc;
+	async_wait_for(aio->xfer, &xrc);
+	
+	sysarg_t rc;
+	async_wait_for(aio->req, &rc);
+	
+	aio->pending = false;
+	
+	if (rc != EOK)
+		aio->result = (ssize_t) rc;
+	else if (xrc != EOK)
+		aio->result = (ssize_t) xrc;
+	else
+		aio->result = (ssize_t) IPC_GET_ARG1(aio->answer);
+	
+	return aio->result;
+}
+
+/** Wait for several asynchronous operations to complete.
+ *
+ * The result of each operation is stored in its result member.
+ *
+ * @param aios Array of operations.
+ * @param cnt  Number of operations.
+ *
+ * @return EOK if all the operations succeeded, otherwise the error code of
+ *         the first failed operation.
+ *
+ */
+int vfs_aio_wait_all(vfs_aio_t *aios[], size_t cnt)
+{
+	int rc = EOK;
+	size_t i;
+	
+	for (i = 0; i < cnt; i++) {
+		ssize_t res = vfs_aio_wait(aios[i]);
+		if ((res < 0) && (rc == EOK))
+			rc = (int) res;
+	}
+	
+	return rc;
+}
+
+/** Check whether an asynchronous operation has completed.
+ *
+ * If the operation has completed, its result is collected as if by
+ * vfs_aio_wait().
+ *
+ * @param aio Operation started by vfs_aio_read() or vfs_aio_write().
+ *
+ * @return True if the operation has completed, false otherwise.
+ *
+ */
+bool vfs_aio_done(vfs_aio_t *aio)
+{
+	if (!aio->pending)
+		return true;
+	
+	sysarg_t rc;
+	if (async_wait_timeout(aio->req, &rc, 0) == ETIMEOUT)
+		return false;
+	
+	/* The answer to the data transfer always precedes the answer. */
+	sysarg_t xrc;
+	async_wait_for(aio->xfer, &xrc);
+	
+	aio->pending = false;
+	
+	if (rc != EOK)
+		aio->result = (ssize_t) rc;
+	else if (xrc != EOK)
+		aio->result = (ssize_t) xrc;
+	else
+		aio->result = (ssize_t) IPC_GET_ARG1(aio->answer);
+	
+	return true;
+}
+
+/** @}
+ */
@@ -42,6 +42,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <ipc/services.h>
 #include <ns.h>
@@ -54,9 +55,15 @@
 #include <ipc/vfs.h>
 #include <ipc/loc.h>
 
+/** Size of the buffer used by readdirplus(). */
+#define READDIRPLUS_BUF_SIZE  (16 * 1024)
+
 static FIBRIL_MUTEX_INITIALIZE(vfs_mutex);
 static async_sess_t *vfs_sess = NULL;
 
+static FIBRIL_MUTEX_INITIALIZE(vfs_pager_mutex);
+static async_exch_t *vfs_pager_exch = NULL;
+
 static FIBRIL_MUTEX_INITIALIZE(cwd_mutex);
 
 static int cwd_fd = -1;
@@ -91,6 +98,28 @@ void vfs_exchange_end(async_exch_t *exch)
 	async_exchange_end(exch);
 }
 
+/** Get the phone used by the kernel to page in memory mapped files.
+ *
+ * The phone belongs to an exchange which is kept open for the lifetime of
+ * the task so that the IPC_M_PAGE_IN requests sent by the kernel cannot
+ * interleave with any other VFS protocol exchange.
+ *
+ * @return Phone connected to VFS.
+ *
+ */
+int vfs_pager_phone(void)
+{
+	fibril_mutex_lock(&vfs_pager_mutex);
+	
+	if (vfs_pager_exch == NULL)
+		vfs_pager_exch = vfs_exchange_begin();
+	
+	int phone = async_exchange_phone(vfs_pager_exch);
+	fibril_mutex_unlock(&vfs_pager_mutex);
+	
+	return phone;
+}
+
 char *absolutize(const char *path, size_t *retlen)
 {
 	char *ncwd_path;
@@ -397,6 +426,320 @@ ssize_t write(int fildes, const void *buf, size_t nbyte)
 	else
 		return -1;
 }
+/** Read data from a file at the given position.
+ *
+ * Unlike read(), this function neither uses nor updates the current position
+ * in the open file, so it does not serialize with other operations on the
+ * same file descriptor.
+ *
+ * @param fildes File descriptor.
+ * @param buf    Buffer to read data into.
+ * @param nbyte  Maximum number of bytes to read.
+ * @param pos    Position in the file where to start reading.
+ *
+ * @return Number of bytes read on success or a negative error code.
+ *
+ */
+ssize_t pread(int fildes, void *buf, size_t nbyte, aoff64_t pos)
+{
+	sysarg_t rc;
+	ipc_call_t answer;
+	aid_t req;
+	
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	req = async_send_3(exch, VFS_IN_PREAD, fildes, LOWER32(pos),
+	    UPPER32(pos), &answer);
+	rc = async_data_read_start(exch, buf, nbyte);
+	if (rc != EOK) {
+		vfs_exchange_end(exch);
+
+		sysarg_t rc_orig;
+		async_wait_for(req, &rc_orig);
+
+		if (rc_orig == EOK)
+			return (ssize_t) rc;
+		else
+			return (ssize_t) rc_orig;
+	}
+	vfs_exchange_end(exch);
+	async_wait_for(req, &rc);
+	if (rc == EOK)
+		return (ssize_t) IPC_GET_ARG1(answer);
+	else
+		return rc;
+}
+
+/** Forward a data read to VFS as a read from a file at the given position.
+ *
+ * The data read received from another task is answered by the file system
+ * server, so the kernel copies the data from the server straight into the
+ * other task and it never passes through this one. As with pread(), the
+ * current position in the open file is neither used nor updated.
+ *
+ * @param fildes File descriptor.
+ * @param callid Hash of the IPC_M_DATA_READ call to forward. The call is
+ *               answered in any case, but not necessarily by the time this
+ *               function returns.
+ * @param pos    Position in the file where to start reading.
+ *
+ * @return EOK on success or a negative error code.
+ *
+ */
+int vfs_pread_forward(int fildes, ipc_callid_t callid, aoff64_t pos)
+{
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	aid_t req = async_send_3(exch, VFS_IN_PREAD, fildes, LOWER32(pos),
+	    UPPER32(pos), NULL);
+	if (req == 0) {
+		vfs_exchange_end(exch);
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+	
+	int rc = async_forward_fast(callid, exch, 0, 0, 0, IPC_FF_ROUTE_FROM_ME);
+	if (rc != EOK) {
+		/*
+		 * The kernel has answered the data read. VFS is waiting for
+		 * it nevertheless, so make it refuse the request instead.
+		 */
+		aid_t ping = async_send_0(exch, VFS_IN_PING, NULL);
+		vfs_exchange_end(exch);
+		
+		if (ping == 0) {
+			async_forget(req);
+			return rc;
+		}
+		
+		async_wait_for(ping, NULL);
+		async_wait_for(req, NULL);
+		return rc;
+	}
+	
+	vfs_exchange_end(exch);
+	
+	/* The result is reported to the sender of the data read. */
+	async_forget(req);
+	return EOK;
+}
+
+/** Write data to a file at the given position.
+ *
+ * Unlike write(), this function neither uses nor updates the current position
+ * in the open file, so it does not serialize with other operations on the
+ * same file descriptor.
+ *
+ * @param fildes File descriptor.
+ * @param buf    Data to write.
+ * @param nbyte  Number of bytes to write.
+ * @param pos    Position in the file where to start writing.
+ *
+ * @return Number of bytes written on success or a negative error code.
+ *
+ */
+ssize_t pwrite(int fildes, const void *buf, size_t nbyte, aoff64_t pos)
+{
+	sysarg_t rc;
+	ipc_call_t answer;
+	aid_t req;
+	
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	req = async_send_3(exch, VFS_IN_PWRITE, fildes, LOWER32(pos),
+	    UPPER32(pos), &answer);
+	rc = async_data_write_start(exch, buf, nbyte);
+	if (rc != EOK) {
+		vfs_exchange_end(exch);
+
+		sysarg_t rc_orig;
+		async_wait_for(req, &rc_orig);
+
+		if (rc_orig == EOK)
+			return (ssize_t) rc;
+		else
+			return (ssize_t) rc_orig;
+	}
+	vfs_exchange_end(exch);
+	async_wait_for(req, &rc);
+	if (rc == EOK)
+		return (ssize_t) IPC_GET_ARG1(answer);
+	else
+		return rc;
+}
+
+/** Read or write several buffers in one VFS request.
+ *
+ * Each buffer is passed to VFS in one or more data transfers of at most
+ * VFS_XFER_MAX bytes. The sizes of all the transfers are sent to VFS in
+ * advance, so that VFS can move the data without waiting for us while it
+ * holds the file locked. Like read() and write(), the request may move less
+ * data than requested.
+ *
+ * @param fildes     File descriptor.
+ * @param iov        Array of buffers.
+ * @param iovcnt     Number of buffers.
+ * @param pos        Position in the file, used only if positional is true.
+ * @param positional If true, use pos instead of the current file position.
+ * @param read       True for reading, false for writing.
+ *
+ * @return Number of bytes moved on success or a negative error code.
+ *
+ */
+static ssize_t rdwrv_internal(int fildes, const struct iovec *iov, int iovcnt,
+    aoff64_t pos, bool positional, bool read)
+{
+	if ((iovcnt < 0) || (iovcnt > IOV_MAX))
+		return EINVAL;
+	
+	size_t cnt = 0;
+	size_t total = 0;
+	int i;
+	
+	for (i = 0; i < iovcnt; i++) {
+		if (iov[i].iov_len > SSIZE_MAX - total)
+			return EINVAL;
+		
+		total += iov[i].iov_len;
+		cnt += (iov[i].iov_len + VFS_XFER_MAX - 1) / VFS_XFER_MAX;
+	}
+	
+	if (cnt == 0)
+		return 0;
+	if (cnt > VFS_XFER_CNT)
+		return EINVAL;
+	
+	size_t *sizes = malloc(cnt * sizeof(size_t));
+	if (sizes == NULL)
+		return ENOMEM;
+	
+	size_t j = 0;
+	for (i = 0; i < iovcnt; i++) {
+		size_t left = iov[i].iov_len;
+		
+		while (left > 0) {
+			sizes[j] = min(left, VFS_XFER_MAX);
+			left -= sizes[j++];
+		}
+	}
+	
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	ipc_call_t answer;
+	aid_t req = async_send_5(exch, read ? VFS_IN_READV : VFS_IN_WRITEV,
+	    fildes, cnt, LOWER32(pos), UPPER32(pos), positional, &answer);
+	
+	int xrc = async_data_write_start(exch, sizes, cnt * sizeof(size_t));
+	free(sizes);
+	if (xrc != EOK) {
+		vfs_exchange_end(exch);
+		
+		sysarg_t rc_orig;
+		async_wait_for(req, &rc_orig);
+		
+		if (rc_orig == EOK)
+			return (ssize_t) xrc;
+		else
+			return (ssize_t) rc_orig;
+	}
+	
+	/*
+	 * All the announced transfers need to be made even if some of them
+	 * fail, otherwise VFS would wait for them forever.
+	 */
+	for (i = 0; i < iovcnt; i++) {
+		uint8_t *base = iov[i].iov_base;
+		size_t left = iov[i].iov_len;
+		
+		while (left > 0) {
+			size_t size = min(left, VFS_XFER_MAX);
+			int rc;
+			
+			if (read)
+				rc = async_data_read_start(exch, base, size);
+			else
+				rc = async_data_write_start(exch, base, size);
+			
+			if ((rc != EOK) && (xrc == EOK))
+				xrc = rc;
+			
+			base += size;
+			left -= size;
+		}
+	}
+	
+	vfs_exchange_end(exch);
+	
+	sysarg_t rc;
+	async_wait_for(req, &rc);
+	if (rc != EOK)
+		return (ssize_t) rc;
+	
+	if ((xrc != EOK) && (IPC_GET_ARG1(answer) == 0))
+		return (ssize_t) xrc;
+	
+	return (ssize_t) IPC_GET_ARG1(answer);
+}
+
+/** Read data from a file into several buffers.
+ *
+ * @param fildes File descriptor.
+ * @param iov    Array of buffers to read data into.
+ * @param iovcnt Number of buffers.
+ *
+ * @return Number of bytes read on success or a negative error code.
+ *
+ */
+ssize_t readv(int fildes, const struct iovec *iov, int iovcnt)
+{
+	return rdwrv_internal(fildes, iov, iovcnt, 0, false, true);
+}
+
+/** Write data from several buffers to a file.
+ *
+ * @param fildes File descriptor.
+ * @param iov    Array of buffers with the data to write.
+ * @param iovcnt Number of buffers.
+ *
+ * @return Number of bytes written on success or a negative error code.
+ *
+ */
+ssize_t writev(int fildes, const struct iovec *iov, int iovcnt)
+{
+	return rdwrv_internal(fildes, iov, iovcnt, 0, false, false);
+}
+
+/** Read data from a file at the given position into several buffers.
+ *
+ * @param fildes File descriptor.
+ * @param iov    Array of buffers to read data into.
+ * @param iovcnt Number of buffers.
+ * @param pos    Position in the file where to start reading.
+ *
+ * @return Number of bytes read on success or a negative error code.
+ *
+ */
+ssize_t preadv(int fildes, const struct iovec *iov, int iovcnt, aoff64_t pos)
+{
+	return rdwrv_internal(fildes, iov, iovcnt, pos, true, true);
+}
+
+/** Write data from several buffers to a file at the given position.
+ *
+ * @param fildes File descriptor.
+ * @param iov    Array of buffers with the data to write.
+ * @param iovcnt Number of buffers.
+ * @param pos    Position in the file where to start writing.
+ *
+ * @return Number of bytes written on success or a negative error code.
+ *
+ */
+ssize_t pwritev(int fildes, const struct iovec *iov, int iovcnt, aoff64_t pos)
+{
+	return rdwrv_internal(fildes, iov, iovcnt, pos, true, false);
+}
+
+
 
 /** Read entire buffer.
  *
@@ -579,14 +922,18 @@ DIR *opendir(const char *dirname)
 	}
 	
 	int ret = open_internal(abs, abs_size, L_DIRECTORY, 0);
-	free(abs);
-	
 	if (ret < 0) {
+		free(abs);
 		free(dirp);
 		return NULL;
 	}
 	
 	dirp->fd = ret;
+	dirp->path = abs;
+	dirp->plus_buf = NULL;
+	dirp->plus_len = 0;
+	dirp->plus_off = 0;
+	dirp->plus_unsupported = false;
 	return dirp;
 }
 
@@ -598,14 +945,118 @@ struct dirent *readdir(DIR *dirp)
 	return &dirp->res;
 }
 
+/** Read the next batch of directory entries with their attributes.
+ *
+ * @param dirp Directory stream.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int readdirplus_fill(DIR *dirp)
+{
+	if (dirp->plus_buf == NULL) {
+		dirp->plus_buf = malloc(READDIRPLUS_BUF_SIZE);
+		if (dirp->plus_buf == NULL)
+			return ENOMEM;
+	}
+	
+	sysarg_t rc;
+	ipc_call_t answer;
+	aid_t req;
+	
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	req = async_send_1(exch, VFS_IN_READDIRPLUS, dirp->fd, &answer);
+	rc = async_data_read_start(exch, dirp->plus_buf, READDIRPLUS_BUF_SIZE);
+	if (rc != EOK) {
+		vfs_exchange_end(exch);
+		
+		sysarg_t rc_orig;
+		async_wait_for(req, &rc_orig);
+		
+		if (rc_orig == EOK)
+			return (int) rc;
+		else
+			return (int) rc_orig;
+	}
+	vfs_exchange_end(exch);
+	async_wait_for(req, &rc);
+	if (rc != EOK)
+		return (int) rc;
+	
+	dirp->plus_len = IPC_GET_ARG1(answer);
+	dirp->plus_off = 0;
+	return EOK;
+}
+
+/** Read a directory entry together with its attributes.
+ *
+ * The entries are transferred from the file system in batches, so that
+ * listing a directory does not cost a lookup and a stat request per entry.
+ * If the file system does not support this, each entry is stat-ed
+ * separately. Do not mix with readdir() on the same directory stream.
+ *
+ * @param dirp Directory stream.
+ * @param st   Place to store the attributes of the entry.
+ *
+ * @return Next directory entry or NULL at the end of the directory or
+ *         on error.
+ *
+ */
+struct dirent *readdirplus(DIR *dirp, struct stat *st)
+{
+	if ((!dirp->plus_unsupported) && (dirp->plus_off >= dirp->plus_len)) {
+		int rc = readdirplus_fill(dirp);
+		if (rc == ENOTSUP)
+			dirp->plus_unsupported = true;
+		else if (rc != EOK)
+			return NULL;
+	}
+	
+	if (dirp->plus_unsupported) {
+		struct dirent *dp = readdir(dirp);
+		if (dp == NULL)
+			return NULL;
+		
+		char *path;
+		bool slash = (str_size(dirp->path) > 0) &&
+		    (dirp->path[str_size(dirp->path) - 1] == '/');
+		if (asprintf(&path, "%s%s%s", dirp->path, slash ? "" : "/",
+		    dp->d_name) < 0)
+			return NULL;
+		
+		int rc = stat(path, st);
+		free(path);
+		if (rc != EOK)
+			return NULL;
+		
+		return dp;
+	}
+	
+	/* End of the directory. */
+	if (dirp->plus_len == 0)
+		return NULL;
+	
+	dirent_plus_t *rec = (dirent_plus_t *) (dirp->plus_buf + dirp->plus_off);
+	dirp->plus_off += rec->reclen;
+	
+	*st = rec->stat;
+	str_cpy(dirp->res.d_name, NAME_MAX + 1, (char *) (rec + 1));
+	return &dirp->res;
+}
+
 void rewinddir(DIR *dirp)
 {
+	dirp->plus_len = 0;
+	dirp->plus_off = 0;
 	(void) lseek(dirp->fd, 0, SEEK_SET);
 }
 
 int closedir(DIR *dirp)
 {
 	(void) close(dirp->fd);
+	free(dirp->plus_buf);
+	free(dirp->path);
 	free(dirp);
 	return 0;
 }
@@ -815,6 +1266,29 @@ int dup2(int oldfd, int newfd)
 	return (int) rc;
 }
 
+/** Duplicate a file descriptor onto the highest available descriptor.
+ *
+ * @param fildes File descriptor to duplicate.
+ *
+ * @return New file descriptor on success or a negative error code.
+ *
+ */
+int fd_clone(int fildes)
+{
+	async_exch_t *exch = vfs_exchange_begin();
+	
+	sysarg_t ret;
+	sysarg_t rc = async_req_2_1(exch, VFS_IN_DUP, fildes, (sysarg_t) -1,
+	    &ret);
+	
+	vfs_exchange_end(exch);
+	
+	if (rc == EOK)
+		return (int) ret;
+	
+	return (int) rc;
+}
+
 int fd_wait(void)
 {
 	async_exch_t *exch = vfs_exchange_begin();
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/**
+ * @file Prefix trie
+ *
+ * Path-compressed binary trie mapping IPv4 network prefixes to items.
+ * Lookup cost is bounded by the address width, not the number of prefixes.
+ */
+
+#ifndef LIBC_PTRIE_H_
+#define LIBC_PTRIE_H_
+
+#include <adt/list.h>
+#include <sys/types.h>
+
+/** Prefix trie node */
+typedef struct ptrie_node {
+	/** Subtries for the next prefix bit being 0 and 1 */
+	struct ptrie_node *child[2];
+	/** Prefix, bits beyond @c bits are zero */
+	uint32_t prefix;
+	/** Prefix length */
+	int bits;
+	/** Items with exactly this prefix, empty for branching nodes */
+	list_t items;
+} ptrie_node_t;
+
+/** Prefix trie */
+typedef struct {
+	ptrie_node_t *root;
+} ptrie_t;
+
+extern void ptrie_init(ptrie_t *);
+extern int ptrie_insert(ptrie_t *, uint32_t, int, link_t *);
+extern void ptrie_remove(ptrie_t *, uint32_t, int, link_t *);
+extern link_t *ptrie_lookup(ptrie_t *, uint32_t);
+
+#endif
+
+/** @}
+ */
@@ -57,6 +57,8 @@ static inline size_t PAGES2SIZE(size_t pages)
 }
 
 extern void *as_area_create(void *, size_t, unsigned int);
+extern void *as_area_create_pager(void *, size_t, unsigned int,
+    as_area_pager_info_t *);
 extern int as_area_resize(void *, size_t, unsigned int);
 extern int as_area_change_flags(void *, unsigned int);
 extern int as_area_destroy(void *);
@@ -335,6 +335,7 @@ extern void async_poke(void);
 
 extern async_exch_t *async_exchange_begin(async_sess_t *);
 extern void async_exchange_end(async_exch_t *);
+extern int async_exchange_phone(async_exch_t *);
 
 /*
  * FIXME These functions just work around problems with parallel exchange
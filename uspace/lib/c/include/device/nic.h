@@ -36,6 +36,7 @@
 #define LIBC_DEVICE_NIC_H_
 
 #include <async.h>
+#include <net/pbuf.h>
 #include <nic/nic.h>
 #include <ipc/common.h>
 
@@ -90,6 +91,7 @@ typedef enum {
 } nic_event_t;
 
 extern int nic_send_frame(async_sess_t *, void *, size_t);
+extern int nic_send_frame_pbuf(async_sess_t *, pbuf_share_t *, pbuf_t *);
 extern int nic_callback_create(async_sess_t *, async_client_conn_t, void *);
 extern int nic_get_state(async_sess_t *, nic_device_state_t *);
 extern int nic_set_state(async_sess_t *, nic_device_state_t);
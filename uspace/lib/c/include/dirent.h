@@ -35,19 +35,50 @@
 #ifndef LIBC_DIRENT_H_
 #define LIBC_DIRENT_H_
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #define NAME_MAX  256
 
+/** Alignment of the records transferred by VFS_IN_READDIRPLUS. */
+#define DIRENT_PLUS_ALIGN  8
+
 struct dirent {
 	char d_name[NAME_MAX + 1];
 };
 
+/** Header of a record transferred by VFS_IN_READDIRPLUS.
+ *
+ * The NULL-terminated name of the entry immediately follows the header.
+ * The records are stored one after another, each padded to a multiple of
+ * DIRENT_PLUS_ALIGN bytes.
+ */
+typedef struct {
+	/** Size of the record including the name and padding. */
+	size_t reclen;
+	/** Attributes of the entry. */
+	struct stat stat;
+} dirent_plus_t;
+
 typedef struct {
 	int fd;
 	struct dirent res;
+	
+	/** Absolute path of the directory. */
+	char *path;
+	/** Buffer of records read by readdirplus(). */
+	uint8_t *plus_buf;
+	/** Number of valid bytes in the record buffer. */
+	size_t plus_len;
+	/** Offset of the next record in the record buffer. */
+	size_t plus_off;
+	/** Set if the file system does not support VFS_IN_READDIRPLUS. */
+	bool plus_unsupported;
 } DIR;
 
 extern DIR *opendir(const char *);
 extern struct dirent *readdir(DIR *);
+extern struct dirent *readdirplus(DIR *, struct stat *);
 extern void rewinddir(DIR *);
 extern int closedir(DIR *);
 
@@ -35,6 +35,8 @@
 #ifndef LIBC_INET_INET_H_
 #define LIBC_INET_INET_H_
 
+#include <ipc/inet.h>
+#include <net/pbuf.h>
 #include <sys/types.h>
 
 #define INET_TTL_MAX 255
@@ -49,6 +51,8 @@ typedef struct {
 	uint8_t tos;
 	void *data;
 	size_t size;
+	/** Buffer holding @c data, can be @c NULL for a datagram to be sent */
+	pbuf_t *pbuf;
 } inet_dgram_t;
 
 typedef struct {
@@ -36,6 +36,7 @@
 #define LIBC_INET_IPLINK_H_
 
 #include <async.h>
+#include <net/pbuf.h>
 #include <sys/types.h>
 
 struct iplink_ev_ops;
@@ -43,6 +44,10 @@ struct iplink_ev_ops;
 typedef struct {
 	async_sess_t *sess;
 	struct iplink_ev_ops *ev_ops;
+	/** Our areas holding SDUs to be sent, shared with the link */
+	pbuf_share_t send_share;
+	/** Link's areas holding received SDUs */
+	pbuf_share_t recv_share;
 } iplink_t;
 
 typedef struct {
@@ -59,6 +64,8 @@ typedef struct {
 	void *data;
 	/** Size of @c data in bytes */
 	size_t size;
+	/** Buffer holding @c data, can be @c NULL for an SDU to be sent */
+	pbuf_t *pbuf;
 } iplink_sdu_t;
 
 typedef struct iplink_ev_ops {
@@ -38,6 +38,7 @@
 #include <async.h>
 #include <fibril_synch.h>
 #include <bool.h>
+#include <net/pbuf.h>
 #include <sys/types.h>
 
 struct iplink_ops;
@@ -48,6 +49,14 @@ typedef struct {
 	struct iplink_ops *ops;
 	void *arg;
 	async_sess_t *client_sess;
+	/** Space reserved in front of SDUs to be sent for link headers */
+	size_t headroom;
+	/** Space reserved after SDUs to be sent for link trailers */
+	size_t tailroom;
+	/** Client's areas holding SDUs to be sent */
+	pbuf_share_t send_share;
+	/** Our areas holding received SDUs, shared with the client */
+	pbuf_share_t recv_share;
 } iplink_srv_t;
 
 typedef struct {
@@ -64,6 +73,8 @@ typedef struct {
 	void *data;
 	/** Size of @c data in bytes */
 	size_t size;
+	/** Buffer holding @c data, can be @c NULL for a received SDU */
+	pbuf_t *pbuf;
 } iplink_srv_sdu_t;
 
 typedef struct iplink_ops {
@@ -37,6 +37,11 @@
 
 #include <ipc/common.h>
 
+/** Space to reserve in front of datagram data for IP and link headers */
+#define INET_HEADROOM  64
+/** Space to reserve after datagram data for link trailers */
+#define INET_TAILROOM  32
+
 /** Inet ports */
 typedef enum {
 	/** Default port */
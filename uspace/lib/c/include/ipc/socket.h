@@ -55,6 +55,14 @@ typedef enum {
 	NET_SOCKET_SEND,
 	/** Sends data via the datagram socket. @see sendto() */
 	NET_SOCKET_SENDTO,
+	/** Sends data from a file via the stream socket. @see sendfile()
+	 *
+	 * The module obtains the data by IPC_M_DATA_READ calls on the
+	 * callback connection, with the socket identifier in the fourth
+	 * argument and the offset from the start of the transfer in the
+	 * fifth argument.
+	 */
+	NET_SOCKET_SENDFILE,
 	/** Receives data from the stream socket. @see socket() */
 	NET_SOCKET_RECV,
 	/** Receives data from the datagram socket. @see socket() */
@@ -197,7 +205,7 @@ typedef enum {
  */
 #define SOCKET_GET_OPT_NAME(call) \
 	({ \
-		int opt_name = (int) IPC_GET_ARG4(call); \
+		int opt_name = (int) IPC_GET_ARG2(call); \
 		opt_name; \
 	})
 
@@ -44,6 +44,11 @@
 #define MAX_MNTOPTS_LEN 256
 #define PLB_SIZE        (2 * MAX_PATH_LEN)
 
+/** Maximum size of one data transfer of VFS_IN_READV and VFS_IN_WRITEV. */
+#define VFS_XFER_MAX    (64 * 1024)
+/** Maximum number of data transfers of VFS_IN_READV and VFS_IN_WRITEV. */
+#define VFS_XFER_CNT    1024
+
 /* Basic types. */
 typedef int16_t fs_handle_t;
 typedef uint32_t fs_index_t;
@@ -59,6 +64,11 @@ typedef struct {
 	unsigned int instance;
 	bool concurrent_read_write;
 	bool write_retains_size;
+	/**
+	 * The namespace of the fs changes only as a result of VFS requests,
+	 * so VFS can cache the outcome of lookups.
+	 */
+	bool lookup_cacheable;
 } vfs_info_t;
 
 typedef enum {
@@ -81,6 +91,11 @@ typedef enum {
 	VFS_IN_DUP,
 	VFS_IN_WAIT_HANDLE,
 	VFS_IN_MTAB_GET,
+	VFS_IN_PREAD,
+	VFS_IN_PWRITE,
+	VFS_IN_READV,
+	VFS_IN_WRITEV,
+	VFS_IN_READDIRPLUS,
 } vfs_in_request_t;
 
 typedef enum {
@@ -97,6 +112,9 @@ typedef enum {
 	VFS_OUT_STAT,
 	VFS_OUT_LOOKUP,
 	VFS_OUT_DESTROY,
+	VFS_OUT_READDIRPLUS,
+	VFS_OUT_READV,
+	VFS_OUT_WRITEV,
 	VFS_OUT_LAST
 } vfs_out_request_t;
 
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Packet buffers
+ *
+ * A packet buffer is a reference-counted data buffer with a movable window
+ * of valid data. Space left free in front of and behind the window allows
+ * protocol layers to prepend headers and append trailers without copying
+ * the payload. Buffers can be linked into chains to represent data
+ * scattered over several buffers.
+ *
+ * Buffers allocated with pbuf_alloc_shared() lie in an address space area
+ * which is shared with the peer on first use, so that pbuf_send() and
+ * pbuf_receive() pass them between tasks by reference instead of copying
+ * the data. A buffer received this way is borrowed from the sender and
+ * only valid until the call which carried it is answered.
+ */
+
+#ifndef LIBC_NET_PBUF_H_
+#define LIBC_NET_PBUF_H_
+
+#include <adt/list.h>
+#include <async.h>
+#include <atomic.h>
+#include <fibril_synch.h>
+#include <sys/types.h>
+
+struct pbuf_area;
+
+/** Packet buffer */
+typedef struct pbuf {
+	/** Reference count */
+	atomic_t refcnt;
+	/** Next buffer in chain or @c NULL */
+	struct pbuf *next;
+	/** Start of allocated storage */
+	uint8_t *buf;
+	/** Size of allocated storage in bytes */
+	size_t buf_size;
+	/** Start of valid data, points into @c buf */
+	uint8_t *data;
+	/** Size of valid data in bytes */
+	size_t size;
+	/** Shared area containing @c buf or @c NULL */
+	struct pbuf_area *area;
+} pbuf_t;
+
+/** Areas shared with the peer of one connection
+ *
+ * The sending side tracks which of its areas the peer has already mapped,
+ * the receiving side tracks its mappings of the peer's areas.
+ */
+typedef struct {
+	fibril_mutex_t lock;
+	/** Shared areas, pbuf_share_area_t */
+	list_t areas;
+} pbuf_share_t;
+
+extern pbuf_t *pbuf_alloc(size_t, size_t, size_t);
+extern pbuf_t *pbuf_alloc_shared(size_t, size_t, size_t);
+extern pbuf_t *pbuf_adopt(void *, size_t);
+extern void pbuf_addref(pbuf_t *);
+extern void pbuf_delref(pbuf_t *);
+extern pbuf_t *pbuf_keep(pbuf_t *);
+
+extern size_t pbuf_headroom(pbuf_t *);
+extern size_t pbuf_tailroom(pbuf_t *);
+extern void *pbuf_push(pbuf_t *, size_t);
+extern void *pbuf_pull(pbuf_t *, size_t);
+extern void *pbuf_put(pbuf_t *, size_t);
+extern void pbuf_trim(pbuf_t *, size_t);
+
+extern void pbuf_chain_append(pbuf_t *, pbuf_t *);
+extern size_t pbuf_chain_size(pbuf_t *);
+extern size_t pbuf_copy_out(pbuf_t *, size_t, void *, size_t);
+
+extern void pbuf_share_init(pbuf_share_t *);
+extern void pbuf_share_fini(pbuf_share_t *);
+extern int pbuf_send(pbuf_share_t *, async_exch_t *, pbuf_t *);
+extern int pbuf_receive(pbuf_share_t *, pbuf_t **, size_t, size_t);
+
+#endif
+
+/** @}
+ */
@@ -45,6 +45,7 @@
 #include <net/inet.h>
 #include <errno.h>
 #include <byteorder.h>
+#include <sys/time.h>
 
 /** @name Socket application programming interface
  */
@@ -59,6 +60,7 @@ extern int closesocket(int);
 extern int send(int, void *, size_t, int);
 extern int sendto(int, const void *, size_t, int, const struct sockaddr *,
     socklen_t);
+extern ssize_t sendfile(int, int, aoff64_t, size_t);
 extern ssize_t recv(int, void *, size_t, int);
 extern ssize_t recvfrom(int, void *, size_t, int, struct sockaddr *, socklen_t *);
 extern int getsockopt(int, int, int, void *, size_t *);
@@ -66,6 +68,44 @@ extern int setsockopt(int, int, int, const void *, size_t);
 
 /*@}*/
 
+/** @name Socket readiness notification
+ */
+/*@{*/
+
+/** Data or end of stream can be received without blocking. */
+#define SOCKET_EV_READ		0x01
+/** Connection can be accepted without blocking. */
+#define SOCKET_EV_ACCEPT	0x02
+/** Data can be sent.
+ *
+ * The socket modules do not report free send buffer space, so sockets are
+ * always ready for writing and send() may still block for flow control.
+ */
+#define SOCKET_EV_WRITE		0x04
+
+/** Socket event queue. */
+typedef struct socket_evq socket_evq_t;
+
+/** Socket readiness event. */
+typedef struct {
+	/** Socket identifier. */
+	int socket_id;
+	/** Events the socket is ready for (SOCKET_EV_xxx). */
+	unsigned events;
+	/** Argument given when the socket was added to the queue. */
+	void *arg;
+} socket_event_t;
+
+extern socket_evq_t *socket_evq_create(void);
+extern void socket_evq_destroy(socket_evq_t *);
+extern int socket_evq_add(socket_evq_t *, int, unsigned, void *);
+extern int socket_evq_modify(socket_evq_t *, int, unsigned, void *);
+extern int socket_evq_remove(socket_evq_t *, int);
+extern int socket_evq_wait(socket_evq_t *, socket_event_t *, size_t,
+    suseconds_t);
+
+/*@}*/
+
 #endif
 
 /** @}
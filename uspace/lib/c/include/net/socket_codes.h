@@ -71,6 +71,35 @@ typedef enum sock_type {
 	SOCK_RAW = 3
 } sock_type_t;
 
+/** @name Socket option levels */
+/*@{*/
+
+#define SOL_SOCKET	0xffff
+
+/*@}*/
+
+/** @name Socket-level options */
+/*@{*/
+
+enum {
+	/** Send buffer size (int) */
+	SO_SNDBUF = 0x1001,
+	/** Receive buffer size (int) */
+	SO_RCVBUF = 0x1002
+};
+
+/*@}*/
+
+/** @name TCP-level options (level IPPROTO_TCP) */
+/*@{*/
+
+enum {
+	/** Disable Nagle algorithm (int, boolean) */
+	TCP_NODELAY = 0x0001
+};
+
+/*@}*/
+
 /** Type definition of the socket length. */
 typedef int32_t socklen_t;
 
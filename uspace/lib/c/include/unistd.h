@@ -61,6 +61,8 @@ extern int dup2(int, int);
 
 extern ssize_t write(int, const void *, size_t);
 extern ssize_t read(int, void *, size_t);
+extern ssize_t pwrite(int, const void *, size_t, aoff64_t);
+extern ssize_t pread(int, void *, size_t, aoff64_t);
 
 extern ssize_t read_all(int, void *, size_t);
 extern ssize_t write_all(int, const void *, size_t);
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file
+ */
+
+#ifndef LIBC_VFS_AIO_H_
+#define LIBC_VFS_AIO_H_
+
+#include <sys/types.h>
+#include <async.h>
+#include <bool.h>
+
+/** Asynchronous file read or write.
+ *
+ * The structure is owned by the caller and must stay in place until the
+ * operation is waited for.
+ */
+typedef struct {
+	/** VFS_IN_PREAD or VFS_IN_PWRITE request. */
+	aid_t req;
+	/** Data transfer which accompanies the request. */
+	aid_t xfer;
+	ipc_call_t answer;
+	ipc_call_t xfer_answer;
+	
+	/** True while the operation is in flight. */
+	bool pending;
+	/** Number of bytes moved or a negative error code. */
+	ssize_t result;
+} vfs_aio_t;
+
+extern int vfs_aio_read(vfs_aio_t *, int, void *, size_t, aoff64_t);
+extern int vfs_aio_write(vfs_aio_t *, int, const void *, size_t, aoff64_t);
+extern ssize_t vfs_aio_wait(vfs_aio_t *);
+extern int vfs_aio_wait_all(vfs_aio_t *[], size_t);
+extern bool vfs_aio_done(vfs_aio_t *);
+
+#endif
+
+/** @}
+ */
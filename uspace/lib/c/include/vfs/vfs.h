@@ -56,10 +56,13 @@ extern int unmount(const char *);
 extern int fhandle(FILE *, int *);
 
 extern int fd_wait(void);
+extern int fd_clone(int);
 extern int get_mtab_list(list_t *mtab_list);
 
 extern async_exch_t *vfs_exchange_begin(void);
 extern void vfs_exchange_end(async_exch_t *);
+extern int vfs_pager_phone(void);
+extern int vfs_pread_forward(int, ipc_callid_t, aoff64_t);
 
 #endif
 
@@ -38,6 +38,7 @@
 #include <async.h>
 #include <errno.h>
 #include <ipc/services.h>
+#include <net/pbuf.h>
 #include <sys/time.h>
 #include "ops/nic.h"
 
@@ -47,19 +48,23 @@ static void remote_nic_send_frame(ddf_fun_t *dev, void *iface,
 	nic_iface_t *nic_iface = (nic_iface_t *) iface;
 	assert(nic_iface->send_frame);
 	
-	void *data;
-	size_t size;
+	pbuf_share_t *share = NULL;
+	pbuf_t *pbuf;
 	int rc;
 	
-	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	if (nic_iface->get_send_share != NULL)
+		share = nic_iface->get_send_share(dev);
+	
+	/* The frame can be borrowed from the client until we answer */
+	rc = pbuf_receive(share, &pbuf, 0, 0);
 	if (rc != EOK) {
 		async_answer_0(callid, EINVAL);
 		return;
 	}
 	
-	rc = nic_iface->send_frame(dev, data, size);
+	rc = nic_iface->send_frame(dev, pbuf->data, pbuf->size);
 	async_answer_0(callid, rc);
-	free(data);
+	pbuf_delref(pbuf);
 }
 
 static void remote_nic_callback_create(ddf_fun_t *dev, void *iface,
@@ -37,6 +37,7 @@
 #define LIBDRV_OPS_NIC_H_
 
 #include <ipc/services.h>
+#include <net/pbuf.h>
 #include <nic/nic.h>
 #include <sys/time.h>
 #include "../ddf/driver.h"
@@ -50,6 +51,8 @@ typedef struct nic_iface {
 	int (*get_address)(ddf_fun_t *, nic_address_t *);
 	
 	/** Optional methods */
+	/** Client's areas holding frames to be sent, copy frames if not set */
+	pbuf_share_t *(*get_send_share)(ddf_fun_t *);
 	int (*set_address)(ddf_fun_t *, const nic_address_t *);
 	int (*get_stats)(ddf_fun_t *, nic_device_stats_t *);
 	int (*get_device_info)(ddf_fun_t *, nic_device_info_t *);
@@ -41,6 +41,7 @@
 #include "libext2_inode.h"
 #include "libext2_filesystem.h"
 #include "libext2_directory.h"
+#include "libext2_htree.h"
 
 #endif
 
@@ -168,8 +168,8 @@ int ext2_directory_iterator_seek(ext2_directory_iterator_t *it, aoff64_t pos)
 			}
 		}
 		
-		rc = ext2_filesystem_get_inode_data_block_index(it->fs,
-		    it->inode_ref->inode, next_block_idx, &next_block_phys_idx);
+		rc = ext2_filesystem_map_inode_blocks(it->fs, it->inode_ref,
+		    next_block_idx, 1, &next_block_phys_idx);
 		if (rc != EOK) {
 			return rc;
 		}
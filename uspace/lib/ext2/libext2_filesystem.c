@@ -61,7 +61,7 @@ int ext2_filesystem_init(ext2_filesystem_t *fs, service_id_t service_id)
 	
 	fs->device = service_id;
 	
-	rc = block_init(EXCHANGE_SERIALIZE, fs->device, 2048);
+	rc = block_init(EXCHANGE_SERIALIZE, fs->device, EXT2_COMM_SIZE);
 	if (rc != EOK) {
 		return rc;
 	}
@@ -234,12 +234,17 @@ int ext2_filesystem_get_inode_ref(ext2_filesystem_t *fs, uint32_t index,
 	uint32_t block_size;
 	ext2_block_group_ref_t *bg_ref;
 	ext2_inode_ref_t *newref;
+	int i;
 	
 	newref = malloc(sizeof(ext2_inode_ref_t));
 	if (newref == NULL) {
 		return ENOMEM;
 	}
 	
+	for (i = 0; i < EXT2_INODE_INDIRECT_LEVELS; i++) {
+		newref->indirect[i] = NULL;
+	}
+	
 	inodes_per_group = ext2_superblock_get_inodes_per_group(fs->superblock);
 	
 	/* inode numbers are 1-based, but it is simpler to work with 0-based
@@ -299,13 +304,53 @@ int ext2_filesystem_get_inode_ref(ext2_filesystem_t *fs, uint32_t index,
 int ext2_filesystem_put_inode_ref(ext2_inode_ref_t *ref)
 {
 	int rc;
+	int rc2;
+	int i;
 	
 	rc = block_put(ref->block);
+	
+	for (i = 0; i < EXT2_INODE_INDIRECT_LEVELS; i++) {
+		if (ref->indirect[i] == NULL) {
+			continue;
+		}
+		
+		rc2 = block_put(ref->indirect[i]);
+		if (rc == EOK) {
+			rc = rc2;
+		}
+	}
+	
 	free(ref);
 	
 	return rc;
 }
 
+/**
+ * Compute the number of data blocks addressed by a single block reference
+ * on each level of indirection and the first data block index past each
+ * level.
+ * 
+ * @param fs Pointer to filesystem information
+ * @param limits Array of 4 items where to store the limits
+ * @param blocks_per_level Array of 4 items where to store the block counts
+ */
+static void ext2_filesystem_indirect_limits(ext2_filesystem_t *fs,
+    aoff64_t *limits, aoff64_t *blocks_per_level)
+{
+	uint32_t block_ids_per_block;
+	int i;
+	
+	block_ids_per_block = ext2_superblock_get_block_size(fs->superblock) /
+	    sizeof(uint32_t);
+	limits[0] = EXT2_INODE_DIRECT_BLOCKS;
+	blocks_per_level[0] = 1;
+	for (i = 1; i < 4; i++) {
+		blocks_per_level[i]  = blocks_per_level[i-1] *
+		    block_ids_per_block;
+		limits[i] = limits[i-1] + blocks_per_level[i];
+	}
+}
+
 /**
  * Find a filesystem block number where iblock-th data block
  * of the given inode is located.
@@ -339,13 +384,7 @@ int ext2_filesystem_get_inode_data_block_index(ext2_filesystem_t *fs, ext2_inode
 	 * TODO: compute this once when loading filesystem and store in ext2_filesystem_t
 	 */
 	block_ids_per_block = ext2_superblock_get_block_size(fs->superblock) / sizeof(uint32_t);
-	limits[0] = EXT2_INODE_DIRECT_BLOCKS;
-	blocks_per_level[0] = 1;
-	for (i = 1; i < 4; i++) {
-		blocks_per_level[i]  = blocks_per_level[i-1] *
-		    block_ids_per_block;
-		limits[i] = limits[i-1] + blocks_per_level[i];
-	}
+	ext2_filesystem_indirect_limits(fs, limits, blocks_per_level);
 	
 	/* Determine the indirection level needed to get the desired block */
 	level = -1;
@@ -407,6 +446,131 @@ int ext2_filesystem_get_inode_data_block_index(ext2_filesystem_t *fs, ext2_inode
 	return EOK;
 }
 
+/**
+ * Get an indirect block of the given inode, reusing the block cached
+ * in the inode reference for the same level of indirection if possible.
+ * 
+ * The returned block stays owned by the inode reference and must not be
+ * put by the caller.
+ * 
+ * @param fs Pointer to filesystem information
+ * @param inode_ref Inode reference the indirect block belongs to
+ * @param level Number of indirection levels below the block (1 to 3)
+ * @param block_id Filesystem block number of the indirect block
+ * @param block Pointer where to store the block
+ * 
+ * @return 		EOK on success or negative error code on failure
+ */
+static int ext2_filesystem_get_indirect_block(ext2_filesystem_t *fs,
+    ext2_inode_ref_t *inode_ref, int level, uint32_t block_id,
+    block_t **block)
+{
+	int rc;
+	block_t **cached;
+	
+	assert(level > 0 && level <= EXT2_INODE_INDIRECT_LEVELS);
+	cached = &inode_ref->indirect[level - 1];
+	
+	if (*cached != NULL) {
+		if ((*cached)->lba == block_id) {
+			*block = *cached;
+			return EOK;
+		}
+		
+		rc = block_put(*cached);
+		*cached = NULL;
+		if (rc != EOK) {
+			return rc;
+		}
+	}
+	
+	rc = block_get(block, fs->device, block_id, BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	*cached = *block;
+	
+	return EOK;
+}
+
+/**
+ * Find filesystem block numbers where a run of consecutive data blocks
+ * of the given inode is located.
+ * 
+ * Indirect blocks visited on the way are cached in the inode reference,
+ * so a run of blocks sharing an indirect block costs a single block_get()
+ * and later calls with the same reference continue where this one left off.
+ * 
+ * @param fs Pointer to filesystem information
+ * @param inode_ref Inode reference of the file
+ * @param iblock Index of the first data block of the run
+ * @param count Number of data blocks in the run
+ * @param fblocks Array of count items where to store the filesystem block
+ *                numbers, 0 for blocks that are not allocated yet
+ * 
+ * @return 		EOK on success or negative error code on failure
+ */
+int ext2_filesystem_map_inode_blocks(ext2_filesystem_t *fs,
+    ext2_inode_ref_t *inode_ref, aoff64_t iblock, size_t count,
+    uint32_t *fblocks)
+{
+	int rc;
+	aoff64_t limits[4];
+	aoff64_t blocks_per_level[4];
+	aoff64_t block_offset_in_level;
+	uint32_t current_block;
+	uint32_t offset_in_block;
+	size_t i;
+	int level;
+	block_t *block;
+	
+	ext2_filesystem_indirect_limits(fs, limits, blocks_per_level);
+	
+	for (i = 0; i < count; i++, iblock++) {
+		if (iblock < EXT2_INODE_DIRECT_BLOCKS) {
+			fblocks[i] = ext2_inode_get_direct_block(
+			    inode_ref->inode, (uint32_t) iblock);
+			continue;
+		}
+		
+		/* Determine the indirection level of this block */
+		for (level = 1; level < 4; level++) {
+			if (iblock < limits[level]) {
+				break;
+			}
+		}
+		
+		if (level == 4) {
+			return EIO;
+		}
+		
+		block_offset_in_level = iblock - limits[level-1];
+		current_block = ext2_inode_get_indirect_block(inode_ref->inode,
+		    level-1);
+		
+		while (current_block != 0 && level > 0) {
+			rc = ext2_filesystem_get_indirect_block(fs, inode_ref,
+			    level, current_block, &block);
+			if (rc != EOK) {
+				return rc;
+			}
+			
+			offset_in_block = block_offset_in_level /
+			    blocks_per_level[level-1];
+			block_offset_in_level %= blocks_per_level[level-1];
+			current_block = uint32_t_le2host(
+			    ((uint32_t *) block->data)[offset_in_block]);
+			level--;
+		}
+		
+		/* A zero reference on any level means a sparse file */
+		fblocks[i] = current_block;
+	}
+	
+	return EOK;
+}
+
 /**
  * Allocate a given number of blocks and store their ids in blocks
  * 
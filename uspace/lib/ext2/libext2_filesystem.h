@@ -48,9 +48,13 @@ typedef struct ext2_filesystem {
 
 // allow maximum this block size
 #define EXT2_MAX_BLOCK_SIZE			8096
+// size of the block device communication area, bounds clustered reads
+#define EXT2_COMM_SIZE				(64 * 1024)
 #define EXT2_REV0_FIRST_INODE		11
 #define EXT2_REV0_INODE_SIZE		128
 
+#define EXT2_FEATURE_COMPAT_DIR_INDEX		0x20
+
 #define EXT2_FEATURE_RO_SPARSE_SUPERBLOCK	1
 #define EXT2_FEATURE_RO_LARGE_FILE			2
 #define EXT2_FEATURE_I_TYPE_IN_DIR			2
@@ -69,6 +73,8 @@ extern int ext2_filesystem_get_inode_ref(ext2_filesystem_t *, uint32_t,
 extern int ext2_filesystem_put_inode_ref(ext2_inode_ref_t *);
 extern int ext2_filesystem_get_inode_data_block_index(ext2_filesystem_t *, ext2_inode_t*,
     aoff64_t, uint32_t*);
+extern int ext2_filesystem_map_inode_blocks(ext2_filesystem_t *,
+    ext2_inode_ref_t *, aoff64_t, size_t, uint32_t *);
 extern int ext2_filesystem_allocate_blocks(ext2_filesystem_t *, uint32_t *, size_t, uint32_t);
 extern void ext2_filesystem_fini(ext2_filesystem_t *);
 
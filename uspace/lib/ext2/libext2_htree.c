@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libext2
+ * @{
+ */
+/**
+ * @file
+ * @brief	Lookup in hash-indexed (HTree) directories.
+ *
+ * An indexed directory keeps its entries in ordinary directory blocks, but
+ * sorted into blocks by the hash of their names. The first block of the
+ * directory and, for large directories, one more level of blocks hidden
+ * behind empty directory entries map hash ranges to those blocks. Only the
+ * read path is implemented, directories are never modified here.
+ */
+
+#include "libext2.h"
+#include "libext2_htree.h"
+#include <byteorder.h>
+#include <errno.h>
+#include <mem.h>
+#include <assert.h>
+
+/* Offset of the root information within the first block of the directory */
+#define EXT2_HTREE_ROOT_INFO_OFFSET	24
+
+/* Offset of the index entries within a non-root index node */
+#define EXT2_HTREE_NODE_ENTRIES_OFFSET	8
+
+#define TEA_DELTA	0x9E3779B9
+
+#define ROL32(x, s)	(((x) << (s)) | ((x) >> (32 - (s))))
+
+#define MD4_F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define MD4_G(x, y, z)	(((x) & (y)) + (((x) ^ (y)) & (z)))
+#define MD4_H(x, y, z)	((x) ^ (y) ^ (z))
+#define MD4_ROUND(f, a, b, c, d, x, s) \
+	((a) += f((b), (c), (d)) + (x), (a) = ROL32((a), (s)))
+#define MD4_K1	0
+#define MD4_K2	013240474631U
+#define MD4_K3	015666365641U
+
+/** Get a name character as the signed or unsigned char of the creator. */
+static uint32_t ext2_htree_char(const uint8_t *name, size_t i,
+    bool unsigned_chars)
+{
+	if (unsigned_chars)
+		return name[i];
+	
+	return (uint32_t) (int32_t) (int8_t) name[i];
+}
+
+/** Hash function of the first indexed directories. */
+static uint32_t ext2_htree_legacy_hash(const uint8_t *name, size_t len,
+    bool unsigned_chars)
+{
+	uint32_t hash;
+	uint32_t hash0 = 0x12a3fe2d;
+	uint32_t hash1 = 0x37abe8f9;
+	size_t i;
+	
+	for (i = 0; i < len; i++) {
+		hash = hash1 + (hash0 ^
+		    (ext2_htree_char(name, i, unsigned_chars) * 7152373));
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+	
+	return hash0 << 1;
+}
+
+/** Pack up to num words of a name into the input of a hash transform. */
+static void ext2_htree_str2hashbuf(const uint8_t *name, size_t len,
+    uint32_t *buf, int num, bool unsigned_chars)
+{
+	uint32_t pad;
+	uint32_t val;
+	size_t i;
+	
+	pad = (uint32_t) len | ((uint32_t) len << 8);
+	pad |= pad << 16;
+	
+	val = pad;
+	if (len > (size_t) num * 4)
+		len = num * 4;
+	
+	for (i = 0; i < len; i++) {
+		val = ext2_htree_char(name, i, unsigned_chars) + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	
+	if (--num >= 0)
+		*buf++ = val;
+	
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+static void ext2_htree_half_md4(uint32_t *buf, const uint32_t *in)
+{
+	uint32_t a = buf[0];
+	uint32_t b = buf[1];
+	uint32_t c = buf[2];
+	uint32_t d = buf[3];
+	
+	MD4_ROUND(MD4_F, a, b, c, d, in[0] + MD4_K1, 3);
+	MD4_ROUND(MD4_F, d, a, b, c, in[1] + MD4_K1, 7);
+	MD4_ROUND(MD4_F, c, d, a, b, in[2] + MD4_K1, 11);
+	MD4_ROUND(MD4_F, b, c, d, a, in[3] + MD4_K1, 19);
+	MD4_ROUND(MD4_F, a, b, c, d, in[4] + MD4_K1, 3);
+	MD4_ROUND(MD4_F, d, a, b, c, in[5] + MD4_K1, 7);
+	MD4_ROUND(MD4_F, c, d, a, b, in[6] + MD4_K1, 11);
+	MD4_ROUND(MD4_F, b, c, d, a, in[7] + MD4_K1, 19);
+	
+	MD4_ROUND(MD4_G, a, b, c, d, in[1] + MD4_K2, 3);
+	MD4_ROUND(MD4_G, d, a, b, c, in[3] + MD4_K2, 5);
+	MD4_ROUND(MD4_G, c, d, a, b, in[5] + MD4_K2, 9);
+	MD4_ROUND(MD4_G, b, c, d, a, in[7] + MD4_K2, 13);
+	MD4_ROUND(MD4_G, a, b, c, d, in[0] + MD4_K2, 3);
+	MD4_ROUND(MD4_G, d, a, b, c, in[2] + MD4_K2, 5);
+	MD4_ROUND(MD4_G, c, d, a, b, in[4] + MD4_K2, 9);
+	MD4_ROUND(MD4_G, b, c, d, a, in[6] + MD4_K2, 13);
+	
+	MD4_ROUND(MD4_H, a, b, c, d, in[3] + MD4_K3, 3);
+	MD4_ROUND(MD4_H, d, a, b, c, in[7] + MD4_K3, 9);
+	MD4_ROUND(MD4_H, c, d, a, b, in[2] + MD4_K3, 11);
+	MD4_ROUND(MD4_H, b, c, d, a, in[6] + MD4_K3, 15);
+	MD4_ROUND(MD4_H, a, b, c, d, in[1] + MD4_K3, 3);
+	MD4_ROUND(MD4_H, d, a, b, c, in[5] + MD4_K3, 9);
+	MD4_ROUND(MD4_H, c, d, a, b, in[0] + MD4_K3, 11);
+	MD4_ROUND(MD4_H, b, c, d, a, in[4] + MD4_K3, 15);
+	
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+static void ext2_htree_tea(uint32_t *buf, const uint32_t *in)
+{
+	uint32_t sum = 0;
+	uint32_t b0 = buf[0];
+	uint32_t b1 = buf[1];
+	int n;
+	
+	for (n = 0; n < 16; n++) {
+		sum += TEA_DELTA;
+		b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+		b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+	}
+	
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/**
+ * Compute the directory index hash of a name
+ * 
+ * @param name Name to hash
+ * @param len Length of the name in bytes
+ * @param version Hash algorithm, one of EXT2_HTREE_*
+ * @param seed Array of 4 items with the hash seed from the superblock
+ * @param hash Pointer where to store the hash
+ * 
+ * @return 		EOK on success or ENOTSUP for unknown algorithm
+ */
+int ext2_htree_hash(const uint8_t *name, size_t len, int version,
+    const uint32_t *seed, uint32_t *hash)
+{
+	uint32_t buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	uint32_t in[8];
+	bool unsigned_chars = false;
+	uint32_t h;
+	int i;
+	
+	/* An all-zero seed means the default one */
+	for (i = 0; i < 4; i++) {
+		if (seed[i] != 0)
+			break;
+	}
+	
+	if (i < 4) {
+		for (i = 0; i < 4; i++)
+			buf[i] = seed[i];
+	}
+	
+	switch (version) {
+	case EXT2_HTREE_LEGACY_UNSIGNED:
+		unsigned_chars = true;
+		/* Fallthrough */
+	case EXT2_HTREE_LEGACY:
+		h = ext2_htree_legacy_hash(name, len, unsigned_chars);
+		break;
+	case EXT2_HTREE_HALF_MD4_UNSIGNED:
+		unsigned_chars = true;
+		/* Fallthrough */
+	case EXT2_HTREE_HALF_MD4:
+		while (true) {
+			ext2_htree_str2hashbuf(name, len, in, 8, unsigned_chars);
+			ext2_htree_half_md4(buf, in);
+			if (len <= 32)
+				break;
+			len -= 32;
+			name += 32;
+		}
+		h = buf[1];
+		break;
+	case EXT2_HTREE_TEA_UNSIGNED:
+		unsigned_chars = true;
+		/* Fallthrough */
+	case EXT2_HTREE_TEA:
+		while (true) {
+			ext2_htree_str2hashbuf(name, len, in, 4, unsigned_chars);
+			ext2_htree_tea(buf, in);
+			if (len <= 16)
+				break;
+			len -= 16;
+			name += 16;
+		}
+		h = buf[0];
+		break;
+	default:
+		return ENOTSUP;
+	}
+	
+	/* The lowest bit marks hash collisions in the index */
+	h &= ~1;
+	if (h == (EXT2_HTREE_EOF << 1))
+		h = (EXT2_HTREE_EOF - 1) << 1;
+	
+	*hash = h;
+	return EOK;
+}
+
+/**
+ * Find the index entry covering a hash within an index node
+ * 
+ * @param entries First entry of the node, holding the count and limit
+ * @param count Number of entries in the node
+ * @param hash Hash to look for
+ * @param next Pointer where to store the entry following the result,
+ *             or NULL if the result is the last entry of the node
+ * 
+ * @return Entry covering the hash
+ */
+static ext2_htree_entry_t *ext2_htree_node_search(ext2_htree_entry_t *entries,
+    uint16_t count, uint32_t hash, ext2_htree_entry_t **next)
+{
+	ext2_htree_entry_t *p = entries + 1;
+	ext2_htree_entry_t *q = entries + count - 1;
+	ext2_htree_entry_t *m;
+	
+	/* The first entry has no hash and covers everything below the second */
+	while (p <= q) {
+		m = p + (q - p) / 2;
+		if (uint32_t_le2host(m->hash) > hash)
+			q = m - 1;
+		else
+			p = m + 1;
+	}
+	
+	*next = (p < entries + count) ? p : NULL;
+	return p - 1;
+}
+
+/**
+ * Get and validate an index node
+ * 
+ * @param fs Pointer to filesystem information
+ * @param inode_ref Reference to the directory inode
+ * @param iblock Logical block of the node within the directory
+ * @param offset Offset of the count and limit within the block
+ * @param block Pointer where to store the block
+ * @param count Pointer where to store the number of entries in the node
+ * 
+ * @return 		EOK on success, EIO if the node is damaged
+ */
+static int ext2_htree_node_get(ext2_filesystem_t *fs,
+    ext2_inode_ref_t *inode_ref, uint32_t iblock, size_t offset,
+    block_t **block, uint16_t *count)
+{
+	int rc;
+	uint32_t fblock;
+	uint32_t block_size;
+	ext2_htree_count_limit_t *cl;
+	uint16_t limit;
+	
+	block_size = ext2_superblock_get_block_size(fs->superblock);
+	
+	rc = ext2_filesystem_map_inode_blocks(fs, inode_ref, iblock, 1, &fblock);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	if (fblock == 0) {
+		return EIO;
+	}
+	
+	rc = block_get(block, fs->device, fblock, BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	cl = (*block)->data + offset;
+	limit = uint16_t_le2host(cl->limit);
+	*count = uint16_t_le2host(cl->count);
+	
+	if (*count == 0 || *count > limit ||
+	    offset + limit * sizeof(ext2_htree_entry_t) > block_size) {
+		block_put(*block);
+		return EIO;
+	}
+	
+	return EOK;
+}
+
+/**
+ * Look up a name in a leaf block of an indexed directory
+ * 
+ * @return 		EOK if found, ENOENT if not or EIO if the block
+ *			is damaged
+ */
+static int ext2_htree_leaf_find(ext2_filesystem_t *fs,
+    ext2_inode_ref_t *inode_ref, uint32_t iblock, const uint8_t *name,
+    size_t name_size, uint32_t *inode)
+{
+	int rc;
+	uint32_t fblock;
+	uint32_t block_size;
+	block_t *block;
+	ext2_directory_entry_ll_t *entry;
+	size_t offset;
+	uint16_t entry_length;
+	
+	block_size = ext2_superblock_get_block_size(fs->superblock);
+	
+	rc = ext2_filesystem_map_inode_blocks(fs, inode_ref, iblock, 1, &fblock);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	if (fblock == 0) {
+		return EIO;
+	}
+	
+	rc = block_get(&block, fs->device, fblock, BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	rc = ENOENT;
+	for (offset = 0; offset + 8 <= block_size; offset += entry_length) {
+		entry = block->data + offset;
+		entry_length = ext2_directory_entry_ll_get_entry_length(entry);
+		
+		if (entry_length < 8 || offset + entry_length > block_size) {
+			rc = EIO;
+			break;
+		}
+		
+		if (ext2_directory_entry_ll_get_inode(entry) == 0) {
+			continue;
+		}
+		
+		if (ext2_directory_entry_ll_get_name_length(fs->superblock,
+		    entry) == name_size && name_size <= entry_length - 8U &&
+		    bcmp(name, &entry->name, name_size) == 0) {
+			*inode = ext2_directory_entry_ll_get_inode(entry);
+			rc = EOK;
+			break;
+		}
+	}
+	
+	block_put(block);
+	return rc;
+}
+
+/**
+ * Look up a name in an indexed directory
+ * 
+ * Only the single leaf block the name hashes to is searched. When the
+ * entries with the hash of the name may continue in the next leaf or the
+ * index cannot be used, ENOTSUP is returned and the caller is expected to
+ * fall back to a linear scan of the directory.
+ * 
+ * @param fs Pointer to filesystem information
+ * @param inode_ref Reference to the directory inode
+ * @param name Name to look up
+ * @param name_size Length of the name in bytes
+ * @param inode Pointer where to store the inode number of the entry
+ * 
+ * @return 		EOK if found, ENOENT if the directory has no such
+ *			entry, ENOTSUP if the index cannot answer or other
+ *			negative error code
+ */
+int ext2_htree_find(ext2_filesystem_t *fs, ext2_inode_ref_t *inode_ref,
+    const uint8_t *name, size_t name_size, uint32_t *inode)
+{
+	int rc;
+	block_t *block;
+	ext2_htree_root_info_t *root_info;
+	ext2_htree_entry_t *entries;
+	ext2_htree_entry_t *at;
+	ext2_htree_entry_t *next;
+	uint32_t seed[4];
+	uint32_t hash;
+	uint32_t next_hash = 0;
+	bool has_next = false;
+	uint32_t leaf;
+	uint16_t count;
+	size_t offset;
+	int version;
+	int levels;
+	
+	if (!(ext2_superblock_get_features_compatible(fs->superblock) &
+	    EXT2_FEATURE_COMPAT_DIR_INDEX)) {
+		return ENOTSUP;
+	}
+	
+	if (!(ext2_inode_get_flags(inode_ref->inode) & EXT2_INODE_FLAG_INDEX)) {
+		return ENOTSUP;
+	}
+	
+	/* Read the root, the counts follow the variable-length root info */
+	rc = ext2_filesystem_map_inode_blocks(fs, inode_ref, 0, 1, &leaf);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	if (leaf == 0) {
+		return ENOTSUP;
+	}
+	
+	rc = block_get(&block, fs->device, leaf, BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	root_info = block->data + EXT2_HTREE_ROOT_INFO_OFFSET;
+	version = root_info->hash_version;
+	levels = root_info->indirect_levels;
+	offset = EXT2_HTREE_ROOT_INFO_OFFSET + root_info->info_length;
+	
+	if (uint32_t_le2host(root_info->reserved_zero) != 0 ||
+	    root_info->info_length < sizeof(ext2_htree_root_info_t) ||
+	    levels > EXT2_HTREE_MAX_INDIRECT_LEVELS) {
+		block_put(block);
+		return ENOTSUP;
+	}
+	
+	rc = block_put(block);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	if (version <= EXT2_HTREE_TEA &&
+	    (ext2_superblock_get_flags(fs->superblock) &
+	    EXT2_SUPERBLOCK_FLAGS_UNSIGNED_HASH)) {
+		version += EXT2_HTREE_LEGACY_UNSIGNED;
+	}
+	
+	ext2_superblock_get_hash_seed(fs->superblock, seed);
+	rc = ext2_htree_hash(name, name_size, version, seed, &hash);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	/* Descend from the root to the leaf covering the hash */
+	leaf = 0;
+	while (true) {
+		rc = ext2_htree_node_get(fs, inode_ref, leaf, offset, &block,
+		    &count);
+		if (rc == EIO) {
+			return ENOTSUP;
+		} else if (rc != EOK) {
+			return rc;
+		}
+		
+		entries = block->data + offset;
+		at = ext2_htree_node_search(entries, count, hash, &next);
+		leaf = uint32_t_le2host(at->block) & 0x0fffffff;
+		
+		/* Keep the nearest following hash range, maybe from a parent */
+		if (next != NULL) {
+			next_hash = uint32_t_le2host(next->hash);
+			has_next = true;
+		}
+		
+		rc = block_put(block);
+		if (rc != EOK) {
+			return rc;
+		}
+		
+		if (levels-- == 0) {
+			break;
+		}
+		
+		offset = EXT2_HTREE_NODE_ENTRIES_OFFSET;
+	}
+	
+	rc = ext2_htree_leaf_find(fs, inode_ref, leaf, name, name_size, inode);
+	if (rc == EIO) {
+		return ENOTSUP;
+	}
+	
+	/* Colliding hashes may have been split into the next leaf */
+	if (rc == ENOENT && has_next && (next_hash & 1) &&
+	    (next_hash & ~1) == hash) {
+		return ENOTSUP;
+	}
+	
+	return rc;
+}
+
+/** @}
+ */
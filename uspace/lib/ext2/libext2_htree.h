@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libext2
+ * @{
+ */
+/**
+ * @file
+ */
+
+#ifndef LIBEXT2_LIBEXT2_HTREE_H_
+#define LIBEXT2_LIBEXT2_HTREE_H_
+
+#include "libext2_filesystem.h"
+#include "libext2_inode.h"
+
+/**
+ * Information stored after the dot entries in the first block
+ * of an indexed directory
+ */
+typedef struct ext2_htree_root_info {
+	uint32_t reserved_zero;
+	uint8_t hash_version; // Hash algorithm used by this directory
+	uint8_t info_length; // Length of this structure
+	uint8_t indirect_levels; // Depth of the tree minus one
+	uint8_t unused_flags;
+} __attribute__ ((packed)) ext2_htree_root_info_t;
+
+/**
+ * Index entry, the hash of the first entry is replaced by the count
+ * and limit of the index node
+ */
+typedef struct ext2_htree_entry {
+	uint32_t hash; // Lowest hash mapped to the block
+	uint32_t block; // Logical block number within the directory
+} __attribute__ ((packed)) ext2_htree_entry_t;
+
+typedef struct ext2_htree_count_limit {
+	uint16_t limit; // Number of entries that fit into the node
+	uint16_t count; // Number of entries used
+} __attribute__ ((packed)) ext2_htree_count_limit_t;
+
+#define EXT2_HTREE_LEGACY		0
+#define EXT2_HTREE_HALF_MD4		1
+#define EXT2_HTREE_TEA			2
+#define EXT2_HTREE_LEGACY_UNSIGNED	3
+#define EXT2_HTREE_HALF_MD4_UNSIGNED	4
+#define EXT2_HTREE_TEA_UNSIGNED		5
+
+#define EXT2_HTREE_MAX_INDIRECT_LEVELS	1
+#define EXT2_HTREE_EOF			0x7fffffffU
+
+extern int ext2_htree_hash(const uint8_t *, size_t, int, const uint32_t *,
+    uint32_t *);
+extern int ext2_htree_find(ext2_filesystem_t *, ext2_inode_ref_t *,
+    const uint8_t *, size_t, uint32_t *);
+
+#endif
+
+/** @}
+ */
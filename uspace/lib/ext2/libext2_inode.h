@@ -72,7 +72,9 @@ typedef struct ext2_inode {
 #define EXT2_INODE_MODE_SOCKET		0xC000
 #define EXT2_INODE_MODE_ACCESS_MASK	0x0FFF
 #define EXT2_INODE_MODE_TYPE_MASK	0xF000
+#define EXT2_INODE_FLAG_INDEX		0x1000
 #define EXT2_INODE_DIRECT_BLOCKS	12
+#define EXT2_INODE_INDIRECT_LEVELS	3
 
 #define EXT2_INODE_ROOT_INDEX		2
 
@@ -80,6 +82,10 @@ typedef struct ext2_inode_ref {
 	block_t *block; // Reference to a block containing this inode
 	ext2_inode_t *inode;
 	uint32_t index; // Index number of this inode
+	/* Most recently used indirect block on each level of indirection,
+	 * kept referenced for as long as the inode reference exists
+	 */
+	block_t *indirect[EXT2_INODE_INDIRECT_LEVELS];
 } ext2_inode_ref_t;
 
 extern uint32_t ext2_inode_get_mode(ext2_superblock_t *, ext2_inode_t *);
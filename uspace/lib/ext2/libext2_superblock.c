@@ -286,6 +286,41 @@ uint32_t ext2_superblock_get_features_read_only(ext2_superblock_t *sb)
 	return uint32_t_le2host(sb->features_read_only);
 }
 
+/**
+ * Get the seed of the directory index hash
+ * 
+ * @param sb pointer to superblock
+ * @param seed array of 4 items where to store the seed
+ */
+void ext2_superblock_get_hash_seed(ext2_superblock_t *sb, uint32_t *seed)
+{
+	int i;
+	
+	for (i = 0; i < 4; i++) {
+		seed[i] = uint32_t_le2host(sb->hash_seed[i]);
+	}
+}
+
+/**
+ * Get the default directory index hash algorithm
+ * 
+ * @param sb pointer to superblock
+ */
+uint8_t ext2_superblock_get_default_hash_version(ext2_superblock_t *sb)
+{
+	return sb->default_hash_version;
+}
+
+/**
+ * Get miscellaneous superblock flags
+ * 
+ * @param sb pointer to superblock
+ */
+uint32_t ext2_superblock_get_flags(ext2_superblock_t *sb)
+{
+	return uint32_t_le2host(sb->flags);
+}
+
 /**
  * Compute count of block groups present in the filesystem
  * 
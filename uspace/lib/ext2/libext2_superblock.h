@@ -69,6 +69,11 @@ typedef struct ext2_superblock {
 	uint32_t	features_read_only;
 	uint8_t		uuid[16]; // UUID TODO: Create a library for UUIDs
 	uint8_t		volume_name[16];
+	uint8_t		unused6[100];
+	uint32_t	hash_seed[4]; // Seed of the directory index hash
+	uint8_t		default_hash_version; // Directory index hash algorithm
+	uint8_t		unused7[99];
+	uint32_t	flags; // Miscellaneous flags
 
 // TODO: add __attribute__((aligned(...)) for better performance?
 //       (it is necessary to ensure the superblock is correctly aligned then
@@ -83,6 +88,9 @@ typedef struct ext2_superblock {
 #define EXT2_SUPERBLOCK_OS_LINUX	0
 #define EXT2_SUPERBLOCK_OS_HURD		1
 
+#define EXT2_SUPERBLOCK_FLAGS_SIGNED_HASH	1
+#define EXT2_SUPERBLOCK_FLAGS_UNSIGNED_HASH	2
+
 
 extern uint16_t	ext2_superblock_get_magic(ext2_superblock_t *);
 extern uint32_t	ext2_superblock_get_first_block(ext2_superblock_t *);
@@ -108,6 +116,9 @@ extern uint32_t	ext2_superblock_get_inodes_per_group(ext2_superblock_t *);
 extern uint32_t	ext2_superblock_get_features_compatible(ext2_superblock_t *);
 extern uint32_t	ext2_superblock_get_features_incompatible(ext2_superblock_t *);
 extern uint32_t	ext2_superblock_get_features_read_only(ext2_superblock_t *);
+extern void	ext2_superblock_get_hash_seed(ext2_superblock_t *, uint32_t *);
+extern uint8_t	ext2_superblock_get_default_hash_version(ext2_superblock_t *);
+extern uint32_t	ext2_superblock_get_flags(ext2_superblock_t *);
 
 extern int ext2_superblock_read_direct(service_id_t, ext2_superblock_t **);
 extern int ext2_superblock_check_sanity(ext2_superblock_t *);
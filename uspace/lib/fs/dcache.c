@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libfs
+ * @{
+ */
+/**
+ * @file
+ * Directory lookup caches shared by the FS implementations.
+ *
+ * The lookup cache of a directory maps the names of all entries present in
+ * the directory to their positions, so a miss means that the name does not
+ * exist. The names are stored in the form of keys computed by the file
+ * system, e.g. converted to lower case.
+ *
+ * The caches of all directories are kept on one LRU list and the least
+ * recently used ones are evicted when their total size exceeds the memory
+ * budget.
+ */
+
+#include "libfs.h"
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <fibril_synch.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <str.h>
+
+/** Memory budget shared by the lookup caches of all directories. */
+#define DCACHE_BUDGET   (4 * 1024 * 1024)
+
+/** Number of buckets of a directory lookup cache. */
+#define DCACHE_BUCKETS  128
+
+/** Name of a directory entry hashed in the lookup cache. */
+typedef struct {
+	link_t link;
+	/** Position of the entry within the directory. */
+	aoff64_t pos;
+	/** Key of the name of the entry. */
+	char key[];
+} dcache_entry_t;
+
+struct fs_dcache {
+	link_t lru_link;
+	/** Directory node which the cache is attached to or NULL. */
+	fs_dcache_node_t *node;
+	hash_table_t names;
+	/** Memory used by this cache. */
+	size_t mem;
+};
+
+/**
+ * Lock protecting the LRU list and the attached lookup caches together with
+ * the fs_dcache_node_t structures of all directory nodes.
+ */
+static FIBRIL_MUTEX_INITIALIZE(dcache_lock);
+static LIST_INITIALIZE(dcache_lru);
+static size_t dcache_mem = 0;
+
+static hash_index_t dcache_hash(unsigned long key[])
+{
+	const char *name = (const char *) key[0];
+	hash_index_t h = 0;
+	
+	while (*name)
+		h = h * 31 + (uint8_t) *name++;
+	
+	return h % DCACHE_BUCKETS;
+}
+
+static int dcache_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	dcache_entry_t *e = hash_table_get_instance(item, dcache_entry_t, link);
+	
+	return str_cmp(e->key, (const char *) key[0]) == 0;
+}
+
+static void dcache_remove_callback(link_t *item)
+{
+	free(hash_table_get_instance(item, dcache_entry_t, link));
+}
+
+static hash_table_operations_t dcache_ops = {
+	.hash = dcache_hash,
+	.compare = dcache_compare,
+	.remove_callback = dcache_remove_callback
+};
+
+static size_t dcache_entry_size(const char *key)
+{
+	return sizeof(dcache_entry_t) + str_size(key) + 1;
+}
+
+/** Detach the lookup cache from its directory and free it.
+ *
+ * Must be called with dcache_lock held.
+ */
+static void dcache_destroy(fs_dcache_t *dc)
+{
+	list_remove(&dc->lru_link);
+	dcache_mem -= dc->mem;
+	dc->node->dcache = NULL;
+	fs_dcache_free(dc);
+}
+
+/** Evict least recently used lookup caches until the budget is met.
+ *
+ * Must be called with dcache_lock held.
+ */
+static void dcache_trim(void)
+{
+	while ((dcache_mem > DCACHE_BUDGET) && (!list_empty(&dcache_lru))) {
+		dcache_destroy(list_get_instance(list_last(&dcache_lru),
+		    fs_dcache_t, lru_link));
+	}
+}
+
+/** Initialize the lookup cache state of a directory node. */
+void fs_dcache_node_initialize(fs_dcache_node_t *node)
+{
+	node->dcache = NULL;
+	node->gen = 0;
+}
+
+/** Get the generation of a directory.
+ *
+ * The generation is to be read before the directory is scanned to build its
+ * lookup cache and passed to fs_dcache_attach() afterwards.
+ */
+unsigned fs_dcache_gen(fs_dcache_node_t *node)
+{
+	unsigned gen;
+	
+	fibril_mutex_lock(&dcache_lock);
+	gen = node->gen;
+	fibril_mutex_unlock(&dcache_lock);
+	
+	return gen;
+}
+
+/** Create an empty lookup cache which is not attached to any directory.
+ *
+ * @return Lookup cache or NULL if out of memory.
+ *
+ */
+fs_dcache_t *fs_dcache_create(void)
+{
+	fs_dcache_t *dc = malloc(sizeof(fs_dcache_t));
+	if (!dc)
+		return NULL;
+	
+	if (!hash_table_create(&dc->names, DCACHE_BUCKETS, 1, &dcache_ops)) {
+		free(dc);
+		return NULL;
+	}
+	
+	link_initialize(&dc->lru_link);
+	dc->node = NULL;
+	dc->mem = sizeof(fs_dcache_t) + DCACHE_BUCKETS * sizeof(list_t);
+	
+	return dc;
+}
+
+/** Insert a name into a lookup cache.
+ *
+ * The cache must not be attached to a directory.
+ *
+ * @param dc  Lookup cache.
+ * @param key Key of the name.
+ * @param pos Position of the entry within the directory.
+ *
+ * @return EOK on success, ENOMEM if out of memory or ELIMIT if the cache
+ *         has grown too large to be kept.
+ *
+ */
+int fs_dcache_insert(fs_dcache_t *dc, const char *key, aoff64_t pos)
+{
+	size_t size = dcache_entry_size(key);
+	
+	if (dc->mem + size > DCACHE_BUDGET / 2)
+		return ELIMIT;
+	
+	dcache_entry_t *e = malloc(size);
+	if (!e)
+		return ENOMEM;
+	
+	link_initialize(&e->link);
+	e->pos = pos;
+	str_cpy(e->key, str_size(key) + 1, key);
+	
+	unsigned long hkey[] = { (unsigned long) e->key };
+	hash_table_insert(&dc->names, hkey, &e->link);
+	dc->mem += size;
+	
+	return EOK;
+}
+
+/** Free a lookup cache which is not attached to any directory. */
+void fs_dcache_free(fs_dcache_t *dc)
+{
+	hash_table_clear(&dc->names);
+	hash_table_destroy(&dc->names);
+	free(dc);
+}
+
+/** Attach a complete lookup cache to its directory.
+ *
+ * The cache is freed instead if the directory has changed since @a gen was
+ * obtained or if it already has a cache.
+ *
+ * @param node Directory node.
+ * @param dc   Lookup cache holding all names present in the directory.
+ * @param gen  Generation of the directory read before it was scanned.
+ *
+ */
+void fs_dcache_attach(fs_dcache_node_t *node, fs_dcache_t *dc, unsigned gen)
+{
+	fibril_mutex_lock(&dcache_lock);
+	if ((node->dcache == NULL) && (node->gen == gen)) {
+		dc->node = node;
+		node->dcache = dc;
+		list_prepend(&dc->lru_link, &dcache_lru);
+		dcache_mem += dc->mem;
+		dcache_trim();
+		dc = NULL;
+	}
+	fibril_mutex_unlock(&dcache_lock);
+	
+	if (dc)
+		fs_dcache_free(dc);
+}
+
+/** Look a name up in the lookup cache of a directory.
+ *
+ * @param node Directory node.
+ * @param key  Key of the name.
+ * @param alt  Alternative key to try if @a key is not found or NULL.
+ * @param pos  Place to store the position of the entry.
+ *
+ * @return EOK if the name was found, ENOENT if it is not present in the
+ *         directory or EAGAIN if the directory has no lookup cache.
+ *
+ */
+int fs_dcache_lookup(fs_dcache_node_t *node, const char *key, const char *alt,
+    aoff64_t *pos)
+{
+	fibril_mutex_lock(&dcache_lock);
+	
+	fs_dcache_t *dc = node->dcache;
+	if (!dc) {
+		fibril_mutex_unlock(&dcache_lock);
+		return EAGAIN;
+	}
+	
+	unsigned long hkey[] = { (unsigned long) key };
+	link_t *item = hash_table_find(&dc->names, hkey);
+	if ((!item) && (alt)) {
+		hkey[0] = (unsigned long) alt;
+		item = hash_table_find(&dc->names, hkey);
+	}
+	
+	if (item)
+		*pos = hash_table_get_instance(item, dcache_entry_t, link)->pos;
+	
+	list_remove(&dc->lru_link);
+	list_prepend(&dc->lru_link, &dcache_lru);
+	
+	fibril_mutex_unlock(&dcache_lock);
+	
+	return item ? EOK : ENOENT;
+}
+
+/** Update the lookup cache of a directory after a new entry was written.
+ *
+ * @param node Directory node.
+ * @param key  Key of the name of the new entry or NULL if the entry cannot
+ *             be cached, in which case the cache is dropped.
+ * @param pos  Position of the new entry.
+ *
+ */
+void fs_dcache_add(fs_dcache_node_t *node, const char *key, aoff64_t pos)
+{
+	fibril_mutex_lock(&dcache_lock);
+	
+	node->gen++;
+	
+	fs_dcache_t *dc = node->dcache;
+	if (dc) {
+		size_t mem = dc->mem;
+		
+		if ((key == NULL) || (fs_dcache_insert(dc, key, pos) != EOK)) {
+			/* The cache would not be complete any more. */
+			dcache_destroy(dc);
+		} else {
+			dcache_mem += dc->mem - mem;
+			dcache_trim();
+		}
+	}
+	
+	fibril_mutex_unlock(&dcache_lock);
+}
+
+/** Remove an entry from the lookup cache of one directory. */
+static bool dcache_remove(fs_dcache_t *dc, const char *key, aoff64_t pos)
+{
+	unsigned long hkey[] = { (unsigned long) key };
+	link_t *item = hash_table_find(&dc->names, hkey);
+	if (!item)
+		return false;
+	
+	dcache_entry_t *e = hash_table_get_instance(item, dcache_entry_t, link);
+	if (e->pos != pos)
+		return false;
+	
+	size_t size = dcache_entry_size(e->key);
+	hash_table_remove(&dc->names, hkey, 1);
+	dc->mem -= size;
+	dcache_mem -= size;
+	
+	return true;
+}
+
+/** Update the lookup cache of a directory after an entry was removed.
+ *
+ * The cache is dropped if the entry is not found in it.
+ *
+ * @param node Directory node.
+ * @param key  Key of the name of the removed entry or NULL.
+ * @param alt  Alternative key to try if @a key is not found or NULL.
+ * @param pos  Position of the removed entry.
+ *
+ */
+void fs_dcache_remove(fs_dcache_node_t *node, const char *key,
+    const char *alt, aoff64_t pos)
+{
+	fibril_mutex_lock(&dcache_lock);
+	
+	node->gen++;
+	
+	fs_dcache_t *dc = node->dcache;
+	if ((dc) && ((key == NULL) || ((!dcache_remove(dc, key, pos)) &&
+	    ((alt == NULL) || (!dcache_remove(dc, alt, pos))))))
+		dcache_destroy(dc);
+	
+	fibril_mutex_unlock(&dcache_lock);
+}
+
+/** Drop the lookup cache of a directory.
+ *
+ * Must be called before the node structure is freed or reused and whenever
+ * the directory changes in a way not reported to the cache.
+ */
+void fs_dcache_invalidate(fs_dcache_node_t *node)
+{
+	fibril_mutex_lock(&dcache_lock);
+	
+	if (node->dcache)
+		dcache_destroy(node->dcache);
+	node->gen++;
+	
+	fibril_mutex_unlock(&dcache_lock);
+}
+
+/** @}
+ */
@@ -44,7 +44,9 @@
 #include <dirent.h>
 #include <mem.h>
 #include <sys/stat.h>
+#include <align.h>
 #include <stdlib.h>
+#include <str.h>
 
 #define on_error(rc, action) \
 	do { \
@@ -71,6 +73,8 @@ static void libfs_unmount(libfs_ops_t *, ipc_callid_t, ipc_call_t *);
 static void libfs_lookup(libfs_ops_t *, fs_handle_t, ipc_callid_t,
     ipc_call_t *);
 static void libfs_stat(libfs_ops_t *, fs_handle_t, ipc_callid_t, ipc_call_t *);
+static void libfs_readdirplus(libfs_ops_t *, fs_handle_t, ipc_callid_t,
+    ipc_call_t *);
 static void libfs_open_node(libfs_ops_t *, fs_handle_t, ipc_callid_t,
     ipc_call_t *);
 
@@ -162,6 +166,75 @@ static void vfs_out_write(ipc_callid_t rid, ipc_call_t *req)
 		async_answer_0(rid, rc);
 }
 
+/** Read or write several consecutive extents of a node in one request.
+ *
+ * The request is followed by the array of sizes of the extents and by one
+ * data transfer per extent, each served by the read or write operation of the
+ * file system. The request is answered as soon as an extent fails or is moved
+ * only partially. The transfers which follow are then refused by the
+ * connection loop.
+ */
+static void vfs_out_rdwrv(ipc_callid_t rid, ipc_call_t *req, bool read)
+{
+	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
+	fs_index_t index = (fs_index_t) IPC_GET_ARG2(*req);
+	aoff64_t pos = (aoff64_t) MERGE_LOUP32(IPC_GET_ARG3(*req),
+	    IPC_GET_ARG4(*req));
+	size_t cnt = (size_t) IPC_GET_ARG5(*req);
+	
+	if ((cnt == 0) || (cnt > VFS_XFER_CNT)) {
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+	
+	size_t *sizes;
+	int rc = async_data_write_accept((void **) &sizes, false,
+	    cnt * sizeof(size_t), cnt * sizeof(size_t), 0, NULL);
+	if (rc != EOK) {
+		async_answer_0(rid, rc);
+		return;
+	}
+	
+	size_t total = 0;
+	aoff64_t nsize = 0;
+	size_t i;
+	
+	for (i = 0; i < cnt; i++) {
+		size_t bytes;
+		
+		if (read)
+			rc = vfs_out_ops->read(service_id, index, pos + total,
+			    &bytes);
+		else
+			rc = vfs_out_ops->write(service_id, index, pos + total,
+			    &bytes, &nsize);
+		
+		if (rc != EOK)
+			break;
+		
+		total += bytes;
+		if (bytes < sizes[i])
+			break;
+	}
+	
+	free(sizes);
+	
+	if ((rc == EOK) || (total > 0))
+		async_answer_3(rid, EOK, total, LOWER32(nsize), UPPER32(nsize));
+	else
+		async_answer_0(rid, rc);
+}
+
+static void vfs_out_readv(ipc_callid_t rid, ipc_call_t *req)
+{
+	vfs_out_rdwrv(rid, req, true);
+}
+
+static void vfs_out_writev(ipc_callid_t rid, ipc_call_t *req)
+{
+	vfs_out_rdwrv(rid, req, false);
+}
+
 static void vfs_out_truncate(ipc_callid_t rid, ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
@@ -207,6 +280,11 @@ static void vfs_out_stat(ipc_callid_t rid, ipc_call_t *req)
 	libfs_stat(libfs_ops, reg.fs_handle, rid, req);
 }
 
+static void vfs_out_readdirplus(ipc_callid_t rid, ipc_call_t *req)
+{
+	libfs_readdirplus(libfs_ops, reg.fs_handle, rid, req);
+}
+
 static void vfs_out_sync(ipc_callid_t rid, ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*req);
@@ -276,6 +354,15 @@ static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case VFS_OUT_SYNC:
 			vfs_out_sync(callid, &call);
 			break;
+		case VFS_OUT_READDIRPLUS:
+			vfs_out_readdirplus(callid, &call);
+			break;
+		case VFS_OUT_READV:
+			vfs_out_readv(callid, &call);
+			break;
+		case VFS_OUT_WRITEV:
+			vfs_out_writev(callid, &call);
+			break;
 		default:
 			async_answer_0(callid, ENOTSUP);
 			break;
@@ -490,6 +577,9 @@ static char plb_get_char(unsigned pos)
  * The path passed in the PLB must be in the canonical file system path format
  * as returned by the canonify() function.
  *
+ * If the path does not exist, the ENOENT answer carries the handle of the file
+ * system which failed the lookup so that VFS can decide whether to cache it.
+ *
  * @param ops       libfs operations structure with function pointers to
  *                  file system implementation
  * @param fs_handle File system handle of the file system where to perform
@@ -600,7 +690,7 @@ void libfs_lookup(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
 		if (!tmp) {
 			if (next <= last) {
 				/* There are unprocessed components */
-				async_answer_0(rid, ENOENT);
+				async_answer_1(rid, ENOENT, fs_handle);
 				goto out;
 			}
 			
@@ -645,7 +735,7 @@ void libfs_lookup(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
 				goto out;
 			}
 			
-			async_answer_0(rid, ENOENT);
+			async_answer_1(rid, ENOENT, fs_handle);
 			goto out;
 		}
 		
@@ -729,7 +819,7 @@ void libfs_lookup(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
 			goto out;
 		}
 		
-		async_answer_0(rid, ENOENT);
+		async_answer_1(rid, ENOENT, fs_handle);
 		goto out;
 	}
 	
@@ -801,6 +891,32 @@ out:
 		(void) ops->node_put(tmp);
 }
 
+/** Fill in the attributes of a node.
+ *
+ * @param ops        libfs operations structure with function pointers to
+ *                   file system implementation
+ * @param fs_handle  File system handle of the file system where to perform
+ *                   the request.
+ * @param service_id Service ID of the file system instance.
+ * @param fn         Node whose attributes are to be filled in.
+ * @param stat       Structure to fill in.
+ *
+ */
+static void libfs_stat_fill(libfs_ops_t *ops, fs_handle_t fs_handle,
+    service_id_t service_id, fs_node_t *fn, struct stat *stat)
+{
+	memset(stat, 0, sizeof(struct stat));
+	
+	stat->fs_handle = fs_handle;
+	stat->service_id = service_id;
+	stat->index = ops->index_get(fn);
+	stat->lnkcnt = ops->lnkcnt_get(fn);
+	stat->is_file = ops->is_file(fn);
+	stat->is_directory = ops->is_directory(fn);
+	stat->size = ops->size_get(fn);
+	stat->service = ops->service_get(fn);
+}
+
 void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
     ipc_call_t *request)
 {
@@ -822,16 +938,8 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
 	}
 	
 	struct stat stat;
-	memset(&stat, 0, sizeof(struct stat));
-	
-	stat.fs_handle = fs_handle;
-	stat.service_id = service_id;
+	libfs_stat_fill(ops, fs_handle, service_id, fn, &stat);
 	stat.index = index;
-	stat.lnkcnt = ops->lnkcnt_get(fn);
-	stat.is_file = ops->is_file(fn);
-	stat.is_directory = ops->is_directory(fn);
-	stat.size = ops->size_get(fn);
-	stat.service = ops->service_get(fn);
 	
 	ops->node_put(fn);
 	
@@ -839,6 +947,143 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_callid_t rid,
 	async_answer_0(rid, EOK);
 }
 
+/** State of one VFS_OUT_READDIRPLUS request. */
+typedef struct {
+	libfs_ops_t *ops;
+	fs_handle_t fs_handle;
+	service_id_t service_id;
+	
+	/** Buffer with the records. */
+	uint8_t *buf;
+	/** Size of the buffer. */
+	size_t size;
+	/** Number of bytes used by the records stored so far. */
+	size_t used;
+	/** Position following the last stored entry. */
+	aoff64_t pos;
+	/** Set if the first entry does not fit into the buffer. */
+	bool overflow;
+} libfs_readdirplus_t;
+
+static bool libfs_readdirplus_cb(void *arg, const char *name, fs_node_t *fn,
+    aoff64_t next)
+{
+	libfs_readdirplus_t *rdp = (libfs_readdirplus_t *) arg;
+	size_t name_size = str_size(name) + 1;
+	size_t reclen = ALIGN_UP(sizeof(dirent_plus_t) + name_size,
+	    DIRENT_PLUS_ALIGN);
+	
+	if (rdp->size - rdp->used < reclen) {
+		rdp->ops->node_put(fn);
+		if (rdp->used == 0)
+			rdp->overflow = true;
+		return false;
+	}
+	
+	dirent_plus_t *rec = (dirent_plus_t *) (rdp->buf + rdp->used);
+	memset(rec, 0, reclen);
+	rec->reclen = reclen;
+	libfs_stat_fill(rdp->ops, rdp->fs_handle, rdp->service_id, fn,
+	    &rec->stat);
+	memcpy(rec + 1, name, name_size);
+	
+	rdp->ops->node_put(fn);
+	
+	rdp->used += reclen;
+	rdp->pos = next;
+	return true;
+}
+
+/** Read directory entries together with their attributes.
+ *
+ * The entries are returned in a buffer of dirent_plus_t records. The answer
+ * carries the number of bytes used by the records and the position following
+ * the last returned entry. No records are returned at the end of the
+ * directory. Entries which are mount points are described by the attributes
+ * of the covered node.
+ *
+ * @param ops       libfs operations structure with function pointers to
+ *                  file system implementation
+ * @param fs_handle File system handle of the file system where to perform
+ *                  the request.
+ * @param rid       Request ID of the VFS_OUT_READDIRPLUS request.
+ * @param request   VFS_OUT_READDIRPLUS request data itself.
+ *
+ */
+void libfs_readdirplus(libfs_ops_t *ops, fs_handle_t fs_handle,
+    ipc_callid_t rid, ipc_call_t *request)
+{
+	service_id_t service_id = (service_id_t) IPC_GET_ARG1(*request);
+	fs_index_t index = (fs_index_t) IPC_GET_ARG2(*request);
+	aoff64_t pos = (aoff64_t) MERGE_LOUP32(IPC_GET_ARG3(*request),
+	    IPC_GET_ARG4(*request));
+	
+	ipc_callid_t callid;
+	size_t size;
+	if (!async_data_read_receive(&callid, &size)) {
+		async_answer_0(callid, EINVAL);
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+	
+	if (ops->readdir == NULL) {
+		async_answer_0(callid, ENOTSUP);
+		async_answer_0(rid, ENOTSUP);
+		return;
+	}
+	
+	fs_node_t *fn;
+	int rc = ops->node_get(&fn, service_id, index);
+	if ((rc == EOK) && (fn == NULL))
+		rc = ENOENT;
+	if ((rc == EOK) && (!ops->is_directory(fn))) {
+		ops->node_put(fn);
+		rc = ENOTDIR;
+	}
+	if (rc != EOK) {
+		async_answer_0(callid, rc);
+		async_answer_0(rid, rc);
+		return;
+	}
+	
+	libfs_readdirplus_t rdp;
+	rdp.ops = ops;
+	rdp.fs_handle = fs_handle;
+	rdp.service_id = service_id;
+	rdp.size = min(size, VFS_XFER_MAX);
+	rdp.used = 0;
+	rdp.pos = pos;
+	rdp.overflow = false;
+	
+	rdp.buf = malloc(rdp.size);
+	if (rdp.buf == NULL) {
+		ops->node_put(fn);
+		async_answer_0(callid, ENOMEM);
+		async_answer_0(rid, ENOMEM);
+		return;
+	}
+	
+	rc = ops->readdir(fn, pos, libfs_readdirplus_cb, &rdp);
+	ops->node_put(fn);
+	
+	/* Return what was read before a failure. */
+	if (rdp.used > 0)
+		rc = EOK;
+	else if ((rc == EOK) && (rdp.overflow))
+		rc = ELIMIT;
+	
+	if (rc != EOK) {
+		free(rdp.buf);
+		async_answer_0(callid, rc);
+		async_answer_0(rid, rc);
+		return;
+	}
+	
+	async_data_read_finalize(callid, rdp.buf, rdp.used);
+	free(rdp.buf);
+	async_answer_3(rid, EOK, rdp.used, LOWER32(rdp.pos), UPPER32(rdp.pos));
+}
+
 /** Open VFS triplet.
  *
  * @param ops     libfs operations structure with function pointers to
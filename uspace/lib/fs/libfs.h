@@ -66,6 +66,21 @@ typedef struct {
 	void *data;         /**< Data of the file system implementation. */
 } fs_node_t;
 
+/** Callback reporting one entry to libfs_ops_t.readdir's caller.
+ *
+ * The callback consumes the reference to the node of the entry.
+ *
+ * @param arg  Argument passed to libfs_ops_t.readdir.
+ * @param name Name of the entry.
+ * @param fn   Node of the entry.
+ * @param next Position at which the next entry is to be looked for.
+ *
+ * @return True if the iteration should continue, false otherwise.
+ *
+ */
+typedef bool (* libfs_readdir_cb_t)(void *, const char *, fs_node_t *,
+    aoff64_t);
+
 typedef struct {
 	/*
 	 * The first set of methods are functions that return an integer error
@@ -82,6 +97,7 @@ typedef struct {
 	int (* link)(fs_node_t *, fs_node_t *, const char *);
 	int (* unlink)(fs_node_t *, fs_node_t *, const char *);
 	int (* has_children)(bool *, fs_node_t *);
+	int (* readdir)(fs_node_t *, aoff64_t, libfs_readdir_cb_t, void *);
 	/*
 	 * The second set of methods are usually mere getters that do not
 	 * return an integer error code.
@@ -94,6 +110,17 @@ typedef struct {
 	service_id_t (* service_get)(fs_node_t *);
 } libfs_ops_t;
 
+/** Lookup cache of the names present in one directory. */
+typedef struct fs_dcache fs_dcache_t;
+
+/** Lookup cache state embedded in a directory node. */
+typedef struct {
+	/** Lookup cache of the directory or NULL. */
+	fs_dcache_t *dcache;
+	/** Incremented whenever the directory entries change. */
+	unsigned gen;
+} fs_dcache_node_t;
+
 typedef struct {
 	int fs_handle;           /**< File system handle. */
 	uint8_t *plb_ro;         /**< Read-only PLB view. */
@@ -108,6 +135,19 @@ extern int fs_instance_create(service_id_t, void *);
 extern int fs_instance_get(service_id_t, void **);
 extern int fs_instance_destroy(service_id_t);
 
+extern void fs_dcache_node_initialize(fs_dcache_node_t *);
+extern unsigned fs_dcache_gen(fs_dcache_node_t *);
+extern fs_dcache_t *fs_dcache_create(void);
+extern int fs_dcache_insert(fs_dcache_t *, const char *, aoff64_t);
+extern void fs_dcache_free(fs_dcache_t *);
+extern void fs_dcache_attach(fs_dcache_node_t *, fs_dcache_t *, unsigned);
+extern int fs_dcache_lookup(fs_dcache_node_t *, const char *, const char *,
+    aoff64_t *);
+extern void fs_dcache_add(fs_dcache_node_t *, const char *, aoff64_t);
+extern void fs_dcache_remove(fs_dcache_node_t *, const char *, const char *,
+    aoff64_t);
+extern void fs_dcache_invalidate(fs_dcache_node_t *);
+
 #endif
 
 /** @}
@@ -42,6 +42,7 @@
 #include <ddf/driver.h>
 #include <device/hw_res_parsed.h>
 #include <ops/nic.h>
+#include <net/pbuf.h>
 
 #define DEVICE_CATEGORY_NIC "nic"
 
@@ -67,6 +68,8 @@ typedef struct {
 	link_t link;
 	void *data;
 	size_t size;
+	/** Buffer holding @c data, it is passed to the client by reference */
+	pbuf_t *pbuf;
 } nic_frame_t;
 
 typedef list_t nic_frame_list_t;
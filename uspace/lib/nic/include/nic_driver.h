@@ -79,6 +79,10 @@ struct nic {
 	nic_address_t default_mac;
 	/** Client callback session */
 	async_sess_t *client_session;
+	/** Our areas holding received frames, shared with the client */
+	pbuf_share_t ev_share;
+	/** Client's areas holding frames to be sent */
+	pbuf_share_t send_share;
 	/** Phone to APIC or i8259 */
 	async_sess_t *irc_session;
 	/** Current polling mode of the NIC */
@@ -39,12 +39,13 @@
 #define NIC_EV_H__
 
 #include <async.h>
+#include <net/pbuf.h>
 #include <nic/nic.h>
 #include <sys/types.h>
 
 extern int nic_ev_addr_changed(async_sess_t *, const nic_address_t *);
 extern int nic_ev_device_state(async_sess_t *, sysarg_t);
-extern int nic_ev_received(async_sess_t *, void *, size_t);
+extern int nic_ev_received(async_sess_t *, pbuf_share_t *, pbuf_t *);
 
 #endif
 
@@ -39,6 +39,7 @@
 #define NIC_IMPL_H__
 
 #include <assert.h>
+#include <net/pbuf.h>
 #include <nic/nic.h>
 #include <ddf/driver.h>
 
@@ -48,6 +49,7 @@
 extern int nic_get_address_impl(ddf_fun_t *dev_fun, nic_address_t *address);
 extern int nic_send_frame_impl(ddf_fun_t *dev_fun, void *data, size_t size);
 extern int nic_callback_create_impl(ddf_fun_t *dev_fun);
+extern pbuf_share_t *nic_get_send_share_impl(ddf_fun_t *dev_fun);
 extern int nic_get_state_impl(ddf_fun_t *dev_fun, nic_device_state_t *state);
 extern int nic_set_state_impl(ddf_fun_t *dev_fun, nic_device_state_t state);
 extern int nic_get_stats_impl(ddf_fun_t *dev_fun, nic_device_stats_t *stats);
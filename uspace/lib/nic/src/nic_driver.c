@@ -107,6 +107,8 @@ void nic_driver_implement(driver_ops_t *driver_ops, ddf_dev_ops_t *dev_ops,
 			iface->send_frame = nic_send_frame_impl;
 		if (!iface->callback_create)
 			iface->callback_create = nic_callback_create_impl;
+		if (!iface->get_send_share)
+			iface->get_send_share = nic_get_send_share_impl;
 		if (!iface->get_address)
 			iface->get_address = nic_get_address_impl;
 		if (!iface->get_stats)
@@ -284,12 +286,14 @@ nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
 		link_initialize(&frame->link);
 	}
 
-	frame->data = malloc(size);
-	if (frame->data == NULL) {
+	/* Frames are passed to the client without copying */
+	frame->pbuf = pbuf_alloc_shared(0, size, 0);
+	if (frame->pbuf == NULL) {
 		free(frame);
 		return NULL;
 	}
 
+	frame->data = frame->pbuf->data;
 	frame->size = size;
 	return frame;
 }
@@ -304,8 +308,9 @@ void nic_release_frame(nic_t *nic_data, nic_frame_t *frame)
 	if (!frame)
 		return;
 
-	if (frame->data != NULL) {
-		free(frame->data);
+	if (frame->pbuf != NULL) {
+		pbuf_delref(frame->pbuf);
+		frame->pbuf = NULL;
 		frame->data = NULL;
 		frame->size = 0;
 	}
@@ -602,8 +607,9 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
-		nic_ev_received(nic_data->client_session, frame->data,
-		    frame->size);
+		pbuf_trim(frame->pbuf, frame->size);
+		nic_ev_received(nic_data->client_session, &nic_data->ev_share,
+		    frame->pbuf);
 	} else {
 		switch (frame_type) {
 		case NIC_FRAME_UNICAST:
@@ -671,6 +677,8 @@ static nic_t *nic_create(void)
 	nic_data->fun = NULL;
 	nic_data->state = NIC_STATE_STOPPED;
 	nic_data->client_session = NULL;
+	pbuf_share_init(&nic_data->ev_share);
+	pbuf_share_init(&nic_data->send_share);
 	nic_data->irc_session = NULL;
 	nic_data->poll_mode = NIC_POLL_IMMEDIATE;
 	nic_data->default_poll_mode = NIC_POLL_IMMEDIATE;
@@ -728,6 +736,9 @@ static void nic_destroy(nic_t *nic_data) {
 		async_hangup(nic_data->client_session);
 	}
 
+	pbuf_share_fini(&nic_data->ev_share);
+	pbuf_share_fini(&nic_data->send_share);
+
 	free(nic_data->specific);
 	free(nic_data);
 }
@@ -74,13 +74,13 @@ int nic_ev_device_state(async_sess_t *sess, sysarg_t state)
 }
 
 /** Frame received. */
-int nic_ev_received(async_sess_t *sess, void *data, size_t size)
+int nic_ev_received(async_sess_t *sess, pbuf_share_t *share, pbuf_t *pbuf)
 {
 	async_exch_t *exch = async_exchange_begin(sess);
 
 	ipc_call_t answer;
 	aid_t req = async_send_0(exch, NIC_EV_RECEIVED, &answer);
-	sysarg_t retval = async_data_write_start(exch, data, size);
+	sysarg_t retval = pbuf_send(share, exch, pbuf);
 
 	async_exchange_end(exch);
 
@@ -200,10 +200,27 @@ int nic_callback_create_impl(ddf_fun_t *fun)
 		return ENOMEM;
 	}
 	
+	/* The new client has not mapped any of our areas yet */
+	pbuf_share_fini(&nic->ev_share);
+	
 	fibril_rwlock_write_unlock(&nic->main_lock);
 	return EOK;
 }
 
+/**
+ * Default implementation of the get_send_share method.
+ * Frames to be sent are passed by reference from areas shared by the client.
+ *
+ * @param	fun
+ *
+ * @return Areas of the client mapped by the driver
+ */
+pbuf_share_t *nic_get_send_share_impl(ddf_fun_t *fun)
+{
+	nic_t *nic = (nic_t *) fun->driver_data;
+	return &nic->send_share;
+}
+
 /**
  * Default implementation of the get_address method.
  * Retrieves the NIC's physical address.
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Waiting for events on file descriptors.
+ *
+ * Sockets are waited for using a socket event queue. Other descriptors
+ * refer to files, which are always ready for reading and writing.
+ */
+
+#define LIBPOSIX_INTERNAL
+
+#include "internal/common.h"
+#include "poll.h"
+
+#include "errno.h"
+#include "stdlib.h"
+
+#include "libc/net/socket.h"
+#include "libc/sys/stat.h"
+
+/** Per-descriptor state of a poll() call. */
+typedef struct {
+	/** Index of the first entry for the same socket */
+	posix_nfds_t first;
+	/** Socket events of interest, summed over all entries */
+	unsigned want;
+	/** Socket events the socket is ready for */
+	unsigned got;
+} poll_entry_t;
+
+/** Convert poll() events to socket events. */
+static unsigned poll_to_socket_events(short events)
+{
+	unsigned sev = 0;
+	
+	if ((events & (POLLIN | POLLRDNORM)) != 0)
+		sev |= SOCKET_EV_READ | SOCKET_EV_ACCEPT;
+	if ((events & (POLLOUT | POLLWRNORM)) != 0)
+		sev |= SOCKET_EV_WRITE;
+	
+	return sev;
+}
+
+/** Convert socket events to poll() events. */
+static short socket_to_poll_events(unsigned sev)
+{
+	short events = 0;
+	
+	if ((sev & (SOCKET_EV_READ | SOCKET_EV_ACCEPT)) != 0)
+		events |= POLLIN | POLLRDNORM;
+	if ((sev & SOCKET_EV_WRITE) != 0)
+		events |= POLLOUT | POLLWRNORM;
+	
+	return events;
+}
+
+/**
+ * Wait for events on a set of file descriptors or sockets.
+ *
+ * @param fds Descriptors and requested events. Negative descriptors
+ *     are ignored.
+ * @param nfds Number of elements in fds.
+ * @param timeout Timeout in milliseconds or -1 to wait indefinitely.
+ * @return Number of descriptors with returned events (zero if the timeout
+ *     expired), -1 on error.
+ */
+int posix_poll(struct posix_pollfd fds[], posix_nfds_t nfds, int timeout)
+{
+	socket_evq_t *evq;
+	socket_event_t *events;
+	poll_entry_t *ent;
+	posix_nfds_t i, j;
+	struct stat st;
+	size_t max;
+	int nready;
+	int rc;
+	
+	max = nfds > 0 ? nfds : 1;
+	evq = socket_evq_create();
+	events = malloc(max * sizeof(socket_event_t));
+	ent = malloc(max * sizeof(poll_entry_t));
+	if (evq == NULL || events == NULL || ent == NULL) {
+		rc = -EAGAIN;
+		goto error;
+	}
+	
+	nready = 0;
+	for (i = 0; i < nfds; i++) {
+		fds[i].revents = 0;
+		ent[i].first = i;
+		ent[i].want = poll_to_socket_events(fds[i].events);
+		ent[i].got = 0;
+		
+		if (fds[i].fd < 0)
+			continue;
+		
+		/* libc returns negated error codes */
+		rc = socket_evq_add(evq, fds[i].fd, ent[i].want,
+		    (void *) (uintptr_t) i);
+		if (rc == -EEXIST) {
+			/* Same socket listed again, merge with the first entry */
+			for (j = 0; fds[j].fd != fds[i].fd; j++)
+				;
+			ent[i].first = j;
+			ent[j].want |= ent[i].want;
+			rc = socket_evq_modify(evq, fds[i].fd, ent[j].want,
+			    (void *) (uintptr_t) j);
+		} else if (rc == -ENOTSOCK) {
+			/* Regular files never block */
+			ent[i].first = nfds;
+			if (fstat(fds[i].fd, &st) == EOK) {
+				fds[i].revents = fds[i].events &
+				    (POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM);
+			} else {
+				fds[i].revents = POLLNVAL;
+			}
+			
+			if (fds[i].revents != 0)
+				++nready;
+			rc = EOK;
+		}
+		
+		if (rc != EOK)
+			goto error;
+	}
+	
+	/* Only check the sockets if some descriptor is ready already */
+	if (nready > 0)
+		timeout = 0;
+	
+	rc = socket_evq_wait(evq, events, max,
+	    timeout < 0 ? -1 : (suseconds_t) timeout * 1000);
+	if (rc < 0)
+		goto error;
+	
+	for (j = 0; j < (posix_nfds_t) rc; j++)
+		ent[(uintptr_t) events[j].arg].got = events[j].events;
+	
+	for (i = 0; i < nfds; i++) {
+		if (fds[i].fd < 0 || ent[i].first == nfds)
+			continue;
+		
+		fds[i].revents = socket_to_poll_events(ent[ent[i].first].got) &
+		    fds[i].events;
+		if (fds[i].revents != 0)
+			++nready;
+	}
+	
+	socket_evq_destroy(evq);
+	free(events);
+	free(ent);
+	return nready;
+	
+error:
+	if (evq != NULL)
+		socket_evq_destroy(evq);
+	free(events);
+	free(ent);
+	errno = -rc;
+	return -1;
+}
+
+/** @}
+ */
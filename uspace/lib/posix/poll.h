@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Waiting for events on file descriptors.
+ */
+
+#ifndef POSIX_POLL_H_
+#define POSIX_POLL_H_
+
+/* values are the same as on Linux */
+
+#define POLLIN      0x0001   /* data other than high-priority may be read */
+#define POLLPRI     0x0002   /* high-priority data may be read */
+#define POLLOUT     0x0004   /* normal data may be written */
+#define POLLERR     0x0008   /* error occurred */
+#define POLLHUP     0x0010   /* device has been disconnected */
+#define POLLNVAL    0x0020   /* invalid file descriptor */
+#define POLLRDNORM  0x0040   /* normal data may be read */
+#define POLLRDBAND  0x0080   /* priority data may be read */
+#define POLLWRNORM  0x0100   /* same as POLLOUT */
+#define POLLWRBAND  0x0200   /* priority data may be written */
+
+typedef unsigned int posix_nfds_t;
+
+struct posix_pollfd {
+	int fd;          /* file descriptor or socket identifier */
+	short events;    /* requested events */
+	short revents;   /* returned events */
+};
+
+extern int posix_poll(struct posix_pollfd fds[], posix_nfds_t nfds,
+    int timeout);
+
+#ifndef LIBPOSIX_INTERNAL
+	#define nfds_t posix_nfds_t
+	#define pollfd posix_pollfd
+	#define poll posix_poll
+#endif
+
+#endif /* POSIX_POLL_H_ */
+
+/** @}
+ */
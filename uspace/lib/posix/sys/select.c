@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Synchronous I/O multiplexing.
+ */
+
+#define LIBPOSIX_INTERNAL
+
+#include "../internal/common.h"
+#include "select.h"
+
+#include "../errno.h"
+#include "../poll.h"
+#include "../stdlib.h"
+#include "../string.h"
+
+/**
+ * Clear descriptor set.
+ *
+ * @param set Descriptor set.
+ */
+void __posix_fd_zero(posix_fd_set *set)
+{
+	memset(set, 0, sizeof(posix_fd_set));
+}
+
+/**
+ * Wait for descriptors to become ready for reading or writing.
+ *
+ * Implemented on top of poll(). There are no exceptional conditions,
+ * so errorfds is always returned empty.
+ *
+ * @param nfds Range of descriptors to check, from zero to nfds - 1.
+ * @param readfds Descriptors to check for reading, replaced by those ready.
+ * @param writefds Descriptors to check for writing, replaced by those ready.
+ * @param errorfds Descriptors to check for errors, cleared.
+ * @param timeout Maximum time to wait or NULL to wait indefinitely.
+ * @return Total number of bits set in the returned sets, -1 on error.
+ */
+int posix_select(int nfds, posix_fd_set *restrict readfds,
+    posix_fd_set *restrict writefds, posix_fd_set *restrict errorfds,
+    struct timeval *restrict timeout)
+{
+	struct posix_pollfd *fds;
+	posix_nfds_t count;
+	posix_nfds_t i;
+	int msec;
+	int fd;
+	int rc;
+	
+	if (nfds < 0 || nfds > FD_SETSIZE ||
+	    (timeout != NULL && (timeout->tv_sec < 0 || timeout->tv_usec < 0))) {
+		errno = EINVAL;
+		return -1;
+	}
+	
+	fds = malloc((nfds > 0 ? nfds : 1) * sizeof(struct posix_pollfd));
+	if (fds == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+	
+	count = 0;
+	for (fd = 0; fd < nfds; fd++) {
+		short events = 0;
+		
+		if (readfds != NULL && FD_ISSET(fd, readfds))
+			events |= POLLIN;
+		if (writefds != NULL && FD_ISSET(fd, writefds))
+			events |= POLLOUT;
+		
+		if (events != 0) {
+			fds[count].fd = fd;
+			fds[count].events = events;
+			++count;
+		}
+	}
+	
+	if (timeout == NULL)
+		msec = -1;
+	else
+		msec = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+	
+	rc = posix_poll(fds, count, msec);
+	if (rc < 0) {
+		free(fds);
+		return -1;
+	}
+	
+	for (i = 0; i < count; i++) {
+		if ((fds[i].revents & POLLNVAL) != 0) {
+			free(fds);
+			errno = EBADF;
+			return -1;
+		}
+	}
+	
+	if (readfds != NULL)
+		__posix_fd_zero(readfds);
+	if (writefds != NULL)
+		__posix_fd_zero(writefds);
+	if (errorfds != NULL)
+		__posix_fd_zero(errorfds);
+	
+	rc = 0;
+	for (i = 0; i < count; i++) {
+		if (readfds != NULL && (fds[i].revents & POLLIN) != 0) {
+			FD_SET(fds[i].fd, readfds);
+			++rc;
+		}
+		if (writefds != NULL && (fds[i].revents & POLLOUT) != 0) {
+			FD_SET(fds[i].fd, writefds);
+			++rc;
+		}
+	}
+	
+	free(fds);
+	return rc;
+}
+
+/** @}
+ */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Synchronous I/O multiplexing.
+ */
+
+#ifndef POSIX_SYS_SELECT_H_
+#define POSIX_SYS_SELECT_H_
+
+#include "../libc/sys/time.h"
+#include "types.h"
+
+/*
+ * Socket identifiers are not small integers, so only descriptors below
+ * FD_SETSIZE can be waited for. Use poll() to wait for sockets.
+ */
+#undef FD_SETSIZE
+#define FD_SETSIZE 1024
+
+#define __POSIX_NFDBITS (8 * sizeof(unsigned long))
+
+typedef struct {
+	unsigned long fds_bits[FD_SETSIZE / __POSIX_NFDBITS];
+} posix_fd_set;
+
+#undef FD_CLR
+#undef FD_ISSET
+#undef FD_SET
+#undef FD_ZERO
+#define FD_CLR(fd, set) ((set)->fds_bits[(fd) / __POSIX_NFDBITS] &= \
+    ~(1UL << ((fd) % __POSIX_NFDBITS)))
+#define FD_ISSET(fd, set) (((set)->fds_bits[(fd) / __POSIX_NFDBITS] & \
+    (1UL << ((fd) % __POSIX_NFDBITS))) != 0)
+#define FD_SET(fd, set) ((set)->fds_bits[(fd) / __POSIX_NFDBITS] |= \
+    (1UL << ((fd) % __POSIX_NFDBITS)))
+#define FD_ZERO(set) __posix_fd_zero(set)
+
+extern void __posix_fd_zero(posix_fd_set *set);
+
+extern int posix_select(int nfds, posix_fd_set *restrict readfds,
+    posix_fd_set *restrict writefds, posix_fd_set *restrict errorfds,
+    struct timeval *restrict timeout);
+
+#ifndef LIBPOSIX_INTERNAL
+	#define fd_set posix_fd_set
+	#define select posix_select
+#endif
+
+#endif /* POSIX_SYS_SELECT_H_ */
+
+/** @}
+ */
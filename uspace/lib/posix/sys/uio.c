@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Vectored input and output.
+ */
+
+#define LIBPOSIX_INTERNAL
+
+#include "../internal/common.h"
+#include "uio.h"
+
+#include "../errno.h"
+
+/**
+ * Read from a file into several buffers.
+ *
+ * @param fildes File descriptor of the opened file.
+ * @param iov Buffers to which the read bytes shall be stored.
+ * @param iovcnt Number of buffers.
+ * @return Number of read bytes on success, -1 otherwise.
+ */
+ssize_t posix_readv(int fildes, const struct iovec *iov, int iovcnt)
+{
+	return errnify(readv, fildes, iov, iovcnt);
+}
+
+/**
+ * Write to a file from several buffers.
+ *
+ * @param fildes File descriptor of the opened file.
+ * @param iov Buffers to write.
+ * @param iovcnt Number of buffers.
+ * @return Number of written bytes on success, -1 otherwise.
+ */
+ssize_t posix_writev(int fildes, const struct iovec *iov, int iovcnt)
+{
+	return errnify(writev, fildes, iov, iovcnt);
+}
+
+/**
+ * Read from a file at the given offset into several buffers.
+ *
+ * @param fildes File descriptor of the opened file.
+ * @param iov Buffers to which the read bytes shall be stored.
+ * @param iovcnt Number of buffers.
+ * @param offset Offset in the file where to start reading.
+ * @return Number of read bytes on success, -1 otherwise.
+ */
+ssize_t posix_preadv(int fildes, const struct iovec *iov, int iovcnt,
+    posix_off_t offset)
+{
+	if (offset < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return errnify(preadv, fildes, iov, iovcnt, (aoff64_t) offset);
+}
+
+/**
+ * Write to a file at the given offset from several buffers.
+ *
+ * @param fildes File descriptor of the opened file.
+ * @param iov Buffers to write.
+ * @param iovcnt Number of buffers.
+ * @param offset Offset in the file where to start writing.
+ * @return Number of written bytes on success, -1 otherwise.
+ */
+ssize_t posix_pwritev(int fildes, const struct iovec *iov, int iovcnt,
+    posix_off_t offset)
+{
+	if (offset < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return errnify(pwritev, fildes, iov, iovcnt, (aoff64_t) offset);
+}
+
+/** @}
+ */
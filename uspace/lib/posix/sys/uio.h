@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libposix
+ * @{
+ */
+/** @file Vectored input and output.
+ */
+
+#ifndef POSIX_SYS_UIO_H_
+#define POSIX_SYS_UIO_H_
+
+#include "../libc/sys/uio.h"
+#include "types.h"
+
+extern ssize_t posix_readv(int fildes, const struct iovec *iov, int iovcnt);
+extern ssize_t posix_writev(int fildes, const struct iovec *iov, int iovcnt);
+extern ssize_t posix_preadv(int fildes, const struct iovec *iov, int iovcnt,
+    posix_off_t offset);
+extern ssize_t posix_pwritev(int fildes, const struct iovec *iov, int iovcnt,
+    posix_off_t offset);
+
+#ifndef LIBPOSIX_INTERNAL
+	#define readv posix_readv
+	#define writev posix_writev
+	#define preadv posix_preadv
+	#define pwritev posix_pwritev
+#endif
+
+#endif /* POSIX_SYS_UIO_H_ */
+
+/** @}
+ */
@@ -221,6 +221,43 @@ ssize_t posix_write(int fildes, const void *buf, size_t nbyte)
 	return errnify(write, fildes, buf, nbyte);
 }
 
+/**
+ * Read from a file at the given offset.
+ *
+ * @param fildes File descriptor of the opened file.
+ * @param buf Buffer to which the read bytes shall be stored.
+ * @param nbyte Upper limit on the number of read bytes.
+ * @param offset Offset in the file where to start reading.
+ * @return Number of read bytes on success, -1 otherwise.
+ */
+ssize_t posix_pread(int fildes, void *buf, size_t nbyte, posix_off_t offset)
+{
+	if (offset < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return errnify(pread, fildes, buf, nbyte, (aoff64_t) offset);
+}
+
+/**
+ * Write to a file at the given offset.
+ *
+ * @param fildes File descriptor of the opened file.
+ * @param buf Buffer to write.
+ * @param nbyte Size of the buffer.
+ * @param offset Offset in the file where to start writing.
+ * @return Number of written bytes on success, -1 otherwise.
+ */
+ssize_t posix_pwrite(int fildes, const void *buf, size_t nbyte,
+    posix_off_t offset)
+{
+	if (offset < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	return errnify(pwrite, fildes, buf, nbyte, (aoff64_t) offset);
+}
+
 /**
  * Requests outstanding data to be written to the underlying storage device.
  *
@@ -72,6 +72,10 @@ extern posix_gid_t posix_getgid(void);
 extern int posix_close(int fildes);
 extern ssize_t posix_read(int fildes, void *buf, size_t nbyte);
 extern ssize_t posix_write(int fildes, const void *buf, size_t nbyte);
+extern ssize_t posix_pread(int fildes, void *buf, size_t nbyte,
+    posix_off_t offset);
+extern ssize_t posix_pwrite(int fildes, const void *buf, size_t nbyte,
+    posix_off_t offset);
 extern int posix_fsync(int fildes);
 extern int posix_ftruncate(int fildes, posix_off_t length);
 extern int posix_rmdir(const char *path);
@@ -165,6 +169,8 @@ extern int posix_pipe(int fildes[2]);
 	#define close posix_close
 	#define read posix_read
 	#define write posix_write
+	#define pread posix_pread
+	#define pwrite posix_pwrite
 	#define fsync posix_fsync
 	#define ftruncate posix_ftruncate
 	#define rmdir posix_rmdir
@@ -598,6 +598,36 @@ static int cdfs_has_children(bool *has_children, fs_node_t *fn)
 	return EOK;
 }
 
+static int cdfs_read_entries(fs_node_t *fn, aoff64_t pos,
+    libfs_readdir_cb_t cb, void *arg)
+{
+	cdfs_node_t *node = CDFS_NODE(fn);
+	
+	if (node->type != CDFS_DIRECTORY)
+		return ENOTDIR;
+	
+	if ((!node->processed) && (!cdfs_readdir(node->service_id, fn)))
+		return EIO;
+	
+	link_t *link;
+	for (link = list_nth(&node->cs_list, pos);
+	    (link != NULL) && (link != &node->cs_list.head);
+	    link = link->next) {
+		cdfs_dentry_t *dentry =
+		    list_get_instance(link, cdfs_dentry_t, link);
+		
+		fs_node_t *cfn = get_cached_node(node->service_id,
+		    dentry->index);
+		if (cfn == NULL)
+			return ENOMEM;
+		
+		if (!cb(arg, dentry->name, cfn, ++pos))
+			break;
+	}
+	
+	return EOK;
+}
+
 static fs_index_t cdfs_index_get(fs_node_t *fn)
 {
 	cdfs_node_t *node = CDFS_NODE(fn);
@@ -644,6 +674,7 @@ libfs_ops_t cdfs_libfs_ops = {
 	.link = cdfs_link_node,
 	.unlink = cdfs_unlink_node,
 	.has_children = cdfs_has_children,
+	.readdir = cdfs_read_entries,
 	.index_get = cdfs_index_get,
 	.size_get = cdfs_size_get,
 	.lnkcnt_get = cdfs_lnkcnt_get,
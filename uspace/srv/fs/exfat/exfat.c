@@ -54,6 +54,7 @@ vfs_info_t exfat_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.lookup_cacheable = true,
 	.instance = 0,
 };
 
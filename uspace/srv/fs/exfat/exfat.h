@@ -49,6 +49,12 @@
 #define BS_BLOCK		0
 #define BS_SIZE			512
 
+/** Size of the libblock communication area. */
+#define EXFAT_COMM_SIZE		(64 * 1024)
+
+/** Largest contiguous file moved elsewhere to stay contiguous on growth. */
+#define EXFAT_RELOCATE_SIZE	(256 * 1024)
+
 #define BPS(bs)			((uint32_t) (1 << (bs->bytes_per_sector)))
 #define SPC(bs)			((uint32_t) (1 << (bs->sec_per_cluster)))
 #define BPC(bs)			((uint32_t) (BPS(bs) * SPC(bs)))
@@ -162,8 +168,23 @@ typedef struct exfat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	exfat_cluster_t	currc_cached_value;
+
+	/** Name lookup cache of a directory node. */
+	fs_dcache_node_t dcache;
 } exfat_node_t;
 
+typedef struct exfat_instance {
+	/*
+	 * Number of free clusters described by each sector of the allocation
+	 * bitmap, protected by the bitmap lock in exfat_bitmap.c.
+	 */
+	uint16_t	*bitmap_free;
+	/** Number of sectors of the allocation bitmap. */
+	size_t		bitmap_sectors;
+	/** Cluster where the search for free clusters continues. */
+	exfat_cluster_t	next_free;
+} exfat_instance_t;
+
 
 extern vfs_out_ops_t exfat_ops;
 extern libfs_ops_t exfat_libfs_ops;
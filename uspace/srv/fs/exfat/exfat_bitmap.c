@@ -45,176 +45,576 @@
 #include <assert.h>
 #include <fibril_synch.h>
 #include <mem.h>
+#include <malloc.h>
+#include <macros.h>
+#include <bitops.h>
 
 
-int exfat_bitmap_is_free(exfat_bs_t *bs, service_id_t service_id, 
-    exfat_cluster_t clst)
+/** Number of clusters described by one sector of the bitmap. */
+#define BITMAP_SECTOR_BITS(bs)	(BPS(bs) * 8)
+
+/** Number of clusters described by one word of the bitmap. */
+#define BITMAP_WORD_BITS	32
+
+/** Get the index of a cluster in the bitmap. */
+#define BITMAP_IDX(clst)	((uint64_t) (clst) - EXFAT_CLST_FIRST)
+
+/*
+ * Serializes all accesses to the allocation bitmaps and their summaries so
+ * that finding free clusters and marking them as used is atomic.
+ */
+static FIBRIL_MUTEX_INITIALIZE(exfat_bitmap_lock);
+
+/** Get the index of the lowest set bit of a non-zero word. */
+static inline unsigned bitmap_lsb(uint32_t word)
 {
-	fs_node_t *fn;
-	block_t *b = NULL;
-	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	return fnzb32(word & (~word + 1));
+}
+
+/** Get the number of clusters described by a sector of the bitmap. */
+static unsigned bitmap_sector_clusters(exfat_bs_t *bs, uint64_t sector)
+{
+	uint64_t first = sector * BITMAP_SECTOR_BITS(bs);
+
+	return min(BITMAP_SECTOR_BITS(bs), DATA_CNT(bs) - first);
+}
+
+/** Find the first free cluster within a sector of the bitmap.
+ *
+ * Words describing only used clusters are skipped at once.
+ *
+ * @param data		Sector of the bitmap.
+ * @param from		First bit to examine.
+ * @param to		Bit following the last bit to examine.
+ *
+ * @return		Index of the first free bit or to if there is none.
+ */
+static unsigned bitmap_sector_find(const uint32_t *data, unsigned from,
+    unsigned to)
+{
+	unsigned i = from;
+
+	while (i < to) {
+		uint32_t word = ~uint32_t_le2host(data[i / BITMAP_WORD_BITS]) >>
+		    (i % BITMAP_WORD_BITS);
+		if (word != 0)
+			return min(i + bitmap_lsb(word), to);
+		i = ALIGN_DOWN(i, BITMAP_WORD_BITS) + BITMAP_WORD_BITS;
+	}
+
+	return to;
+}
+
+/** Count free clusters forming a run within a sector of the bitmap.
+ *
+ * @param data		Sector of the bitmap.
+ * @param from		First bit of the run.
+ * @param to		Bit following the last bit to examine.
+ *
+ * @return		Number of free bits starting at from.
+ */
+static unsigned bitmap_sector_run(const uint32_t *data, unsigned from,
+    unsigned to)
+{
+	unsigned i = from;
+
+	while (i < to) {
+		uint32_t word = uint32_t_le2host(data[i / BITMAP_WORD_BITS]) >>
+		    (i % BITMAP_WORD_BITS);
+		if (word != 0) {
+			i += bitmap_lsb(word);
+			break;
+		}
+		i = ALIGN_DOWN(i, BITMAP_WORD_BITS) + BITMAP_WORD_BITS;
+	}
+
+	return min(i, to) - from;
+}
+
+/** Count free clusters in a sector of the bitmap.
+ *
+ * @param data		Sector of the bitmap.
+ * @param to		Number of valid bits in the sector.
+ *
+ * @return		Number of free bits.
+ */
+static unsigned bitmap_sector_count(const uint32_t *data, unsigned to)
+{
+	unsigned i, cnt = 0;
+
+	for (i = 0; i < to; i += BITMAP_WORD_BITS) {
+		uint32_t word = ~uint32_t_le2host(data[i / BITMAP_WORD_BITS]);
+		if (to - i < BITMAP_WORD_BITS)
+			word &= (1U << (to - i)) - 1;
+		while (word != 0) {
+			word &= word - 1;
+			cnt++;
+		}
+	}
+
+	return cnt;
+}
+
+/** Find the first free cluster in a range of clusters.
+ *
+ * Sectors of the bitmap without free clusters are skipped without reading
+ * them. Must be called with exfat_bitmap_lock held.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param bitmapp	Bitmap node.
+ * @param instance	exFAT instance.
+ * @param start		First cluster of the range.
+ * @param end		Cluster following the last cluster of the range.
+ * @param clst		Place to store the free cluster.
+ *
+ * @return		EOK on success, ENOSPC if there is no free cluster in
+ *			the range or a negative error code.
+ */
+static int bitmap_find(exfat_bs_t *bs, exfat_node_t *bitmapp,
+    exfat_instance_t *instance, exfat_cluster_t start, exfat_cluster_t end,
+    exfat_cluster_t *clst)
+{
+	uint32_t sbits = BITMAP_SECTOR_BITS(bs);
+	uint64_t i = BITMAP_IDX(start);
+	uint64_t n = BITMAP_IDX(end);
+	block_t *b;
+	unsigned bit, to;
 	int rc;
-	bool alloc;
 
-	clst -= EXFAT_CLST_FIRST;
-	
-	rc = exfat_bitmap_get(&fn, service_id);
-	if (rc != EOK)
-		return rc;
-	bitmapp = EXFAT_NODE(fn);
-	
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	while (i < n) {
+		uint64_t sector = i / sbits;
+
+		if (instance->bitmap_free[sector] == 0) {
+			i = (sector + 1) * sbits;
+			continue;
+		}
+
+		to = min(sbits, n - sector * sbits);
+		rc = exfat_block_get(&b, bs, bitmapp, sector, BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			return rc;
+		bit = bitmap_sector_find(b->data, i % sbits, to);
+		rc = block_put(b);
+		if (rc != EOK)
+			return rc;
+
+		if (bit < to) {
+			*clst = sector * sbits + bit + EXFAT_CLST_FIRST;
+			return EOK;
+		}
+		i = (sector + 1) * sbits;
 	}
-	bitmap = (uint8_t *)b->data;
-	alloc = bitmap[offset % BPS(bs)] & (1 << (clst % 8));
 
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+	return ENOSPC;
+}
+
+/** Count free clusters forming a contiguous run.
+ *
+ * Sectors of the bitmap describing only free clusters are not read. Must be
+ * called with exfat_bitmap_lock held.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param bitmapp	Bitmap node.
+ * @param instance	exFAT instance.
+ * @param start		First cluster of the run.
+ * @param max		Maximum number of clusters to count.
+ * @param cnt		Place to store the number of free clusters in the run.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int bitmap_run(exfat_bs_t *bs, exfat_node_t *bitmapp,
+    exfat_instance_t *instance, exfat_cluster_t start, exfat_cluster_t max,
+    exfat_cluster_t *cnt)
+{
+	uint32_t sbits = BITMAP_SECTOR_BITS(bs);
+	uint64_t i = BITMAP_IDX(start);
+	uint64_t n = min(i + max, (uint64_t) DATA_CNT(bs));
+	block_t *b;
+	unsigned from, to, run;
+	int rc;
+
+	*cnt = 0;
+	while (i < n) {
+		uint64_t sector = i / sbits;
+
+		from = i % sbits;
+		to = min(sbits, n - sector * sbits);
+		if (instance->bitmap_free[sector] == 0)
+			break;
+
+		if (instance->bitmap_free[sector] ==
+		    bitmap_sector_clusters(bs, sector)) {
+			run = to - from;
+		} else {
+			rc = exfat_block_get(&b, bs, bitmapp, sector,
+			    BLOCK_FLAGS_NONE);
+			if (rc != EOK)
+				return rc;
+			run = bitmap_sector_run(b->data, from, to);
+			rc = block_put(b);
+			if (rc != EOK)
+				return rc;
+		}
+
+		*cnt += run;
+		if (from + run < to)
+			break;
+		i += run;
+	}
+
+	return EOK;
+}
+
+/** Mark a range of clusters as used or free.
+ *
+ * Must be called with exfat_bitmap_lock held.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param bitmapp	Bitmap node.
+ * @param instance	exFAT instance.
+ * @param firstc	First cluster of the range.
+ * @param count		Number of clusters in the range.
+ * @param used		True to mark the clusters as used, false to free them.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int bitmap_mark(exfat_bs_t *bs, exfat_node_t *bitmapp,
+    exfat_instance_t *instance, exfat_cluster_t firstc, exfat_cluster_t count,
+    bool used)
+{
+	uint32_t sbits = BITMAP_SECTOR_BITS(bs);
+	uint64_t i = BITMAP_IDX(firstc);
+	uint64_t n = i + count;
+	block_t *b;
+	uint8_t *bitmap;
+	unsigned bit, to;
+	int rc = EOK;
+
+	if (firstc < EXFAT_CLST_FIRST || n > DATA_CNT(bs))
+		return EINVAL;
+
+	while (i < n) {
+		uint64_t sector = i / sbits;
+
+		to = min(sbits, n - sector * sbits);
+		rc = exfat_block_get(&b, bs, bitmapp, sector, BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			break;
+
+		bitmap = (uint8_t *) b->data;
+		for (bit = i % sbits; bit < to; bit++) {
+			uint8_t mask = 1 << (bit % 8);
+
+			if (((bitmap[bit / 8] & mask) != 0) == used)
+				continue;
+			bitmap[bit / 8] ^= mask;
+			if (used)
+				instance->bitmap_free[sector]--;
+			else
+				instance->bitmap_free[sector]++;
+		}
+
+		b->dirty = true;
+		rc = block_put(b);
+		if (rc != EOK)
+			break;
+		i = sector * sbits + to;
+	}
+
+	if (rc != EOK && used && i > BITMAP_IDX(firstc)) {
+		/* The clusters were free, release those marked so far. */
+		(void) bitmap_mark(bs, bitmapp, instance, firstc,
+		    i - BITMAP_IDX(firstc), false);
 	}
-	rc = exfat_node_put(fn);
+
+	return rc;
+}
+
+/** Get the bitmap node and the instance and lock the bitmap. */
+static int bitmap_lock(service_id_t service_id, fs_node_t **fn,
+    exfat_instance_t **instance)
+{
+	int rc;
+
+	rc = fs_instance_get(service_id, (void **) instance);
 	if (rc != EOK)
 		return rc;
 
-	if (alloc)
-		return ENOENT;
+	rc = exfat_bitmap_get(fn, service_id);
+	if (rc != EOK)
+		return rc;
 
+	fibril_mutex_lock(&exfat_bitmap_lock);
 	return EOK;
 }
 
-int exfat_bitmap_set_cluster(exfat_bs_t *bs, service_id_t service_id, 
-    exfat_cluster_t clst)
+/** Unlock the bitmap and put the bitmap node. */
+static int bitmap_unlock(fs_node_t *fn, int rc)
 {
+	int rc2;
+
+	fibril_mutex_unlock(&exfat_bitmap_lock);
+	rc2 = exfat_node_put(fn);
+
+	return (rc != EOK) ? rc : rc2;
+}
+
+/** Build the summary of the allocation bitmap of a file system instance.
+ *
+ * The bitmap is scanned once and the free clusters described by each of its
+ * sectors are counted.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int exfat_bitmap_init(exfat_bs_t *bs, service_id_t service_id)
+{
+	exfat_instance_t *instance;
 	fs_node_t *fn;
-	block_t *b = NULL;
-	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	block_t *b;
+	uint64_t sector;
 	int rc;
 
-	clst -= EXFAT_CLST_FIRST;
-	
+	instance = malloc(sizeof(exfat_instance_t));
+	if (!instance)
+		return ENOMEM;
+
+	instance->bitmap_sectors = ((uint64_t) DATA_CNT(bs) +
+	    BITMAP_SECTOR_BITS(bs) - 1) / BITMAP_SECTOR_BITS(bs);
+	instance->next_free = EXFAT_CLST_FIRST;
+	instance->bitmap_free = malloc(instance->bitmap_sectors *
+	    sizeof(uint16_t));
+	if (!instance->bitmap_free) {
+		free(instance);
+		return ENOMEM;
+	}
+
 	rc = exfat_bitmap_get(&fn, service_id);
 	if (rc != EOK)
-		return rc;
-	bitmapp = EXFAT_NODE(fn);
-	
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs), BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
-		return rc;
+		goto error;
+
+	for (sector = 0; sector < instance->bitmap_sectors; sector++) {
+		rc = exfat_block_get(&b, bs, EXFAT_NODE(fn), sector,
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			break;
+		instance->bitmap_free[sector] = bitmap_sector_count(b->data,
+		    bitmap_sector_clusters(bs, sector));
+		rc = block_put(b);
+		if (rc != EOK)
+			break;
 	}
-	bitmap = (uint8_t *)b->data;
-	bitmap[offset % BPS(bs)] |= (1 << (clst % 8));
 
-	b->dirty = true;
-	rc = block_put(b);
-	if (rc != EOK) {
+	if (rc == EOK)
+		rc = exfat_node_put(fn);
+	else
 		(void) exfat_node_put(fn);
-		return rc;
-	}
-	
-	return exfat_node_put(fn);
+	if (rc != EOK)
+		goto error;
+
+	rc = fs_instance_create(service_id, instance);
+	if (rc != EOK)
+		goto error;
+
+	return EOK;
+
+error:
+	free(instance->bitmap_free);
+	free(instance);
+	return rc;
 }
 
-int exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id, 
+/** Release the summary of the allocation bitmap of a file system instance.
+ *
+ * @param service_id	Service ID of the file system.
+ */
+void exfat_bitmap_fini(service_id_t service_id)
+{
+	exfat_instance_t *instance;
+
+	if (fs_instance_get(service_id, (void **) &instance) != EOK)
+		return;
+
+	fs_instance_destroy(service_id);
+	free(instance->bitmap_free);
+	free(instance);
+}
+
+int exfat_bitmap_is_free(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t clst)
 {
+	exfat_instance_t *instance;
 	fs_node_t *fn;
-	block_t *b = NULL;
-	exfat_node_t *bitmapp;
-	uint8_t *bitmap;
+	exfat_cluster_t run = 0;
 	int rc;
 
-	clst -= EXFAT_CLST_FIRST;
-	
-	rc = exfat_bitmap_get(&fn, service_id);
+	rc = bitmap_lock(service_id, &fn, &instance);
 	if (rc != EOK)
 		return rc;
-	bitmapp = EXFAT_NODE(fn);
-	
-	aoff64_t offset = clst / 8;
-	rc = exfat_block_get(&b, bs, bitmapp, offset / BPS(bs),
-	    BLOCK_FLAGS_NONE);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
+
+	if (clst >= EXFAT_CLST_FIRST)
+		rc = bitmap_run(bs, EXFAT_NODE(fn), instance, clst, 1, &run);
+
+	rc = bitmap_unlock(fn, rc);
+	if (rc != EOK)
 		return rc;
-	}
-	bitmap = (uint8_t *)b->data;
-	bitmap[offset % BPS(bs)] &= ~(1 << (clst % 8));
 
-	b->dirty = true;
-	rc = block_put(b);
-	if (rc != EOK) {
-		(void) exfat_node_put(fn);
+	if (run == 0)
+		return ENOENT;
+
+	return EOK;
+}
+
+/** Mark a range of clusters as used or free with the bitmap locked. */
+static int bitmap_update(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t firstc, exfat_cluster_t count, bool used)
+{
+	exfat_instance_t *instance;
+	fs_node_t *fn;
+	int rc;
+
+	rc = bitmap_lock(service_id, &fn, &instance);
+	if (rc != EOK)
 		return rc;
-	}
-	
-	return exfat_node_put(fn);
+
+	rc = bitmap_mark(bs, EXFAT_NODE(fn), instance, firstc, count, used);
+
+	return bitmap_unlock(fn, rc);
+}
+
+int exfat_bitmap_set_cluster(exfat_bs_t *bs, service_id_t service_id, 
+    exfat_cluster_t clst)
+{
+	return exfat_bitmap_set_clusters(bs, service_id, clst, 1);
+}
+
+int exfat_bitmap_clear_cluster(exfat_bs_t *bs, service_id_t service_id, 
+    exfat_cluster_t clst)
+{
+	return exfat_bitmap_clear_clusters(bs, service_id, clst, 1);
 }
 
 int exfat_bitmap_set_clusters(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t firstc, exfat_cluster_t count)
 {
-	int rc;
-	exfat_cluster_t clst;
-	clst = firstc;
-
-	while (clst < firstc + count ) {
-		rc = exfat_bitmap_set_cluster(bs, service_id, clst);
-		if (rc != EOK) {
-			if (clst - firstc > 0)
-				(void) exfat_bitmap_clear_clusters(bs, service_id,
-				    firstc, clst - firstc);
-			return rc;
-		}
-		clst++;
-	}
-	return EOK;
+	return bitmap_update(bs, service_id, firstc, count, true);
 }
 
 int exfat_bitmap_clear_clusters(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t firstc, exfat_cluster_t count)
 {
-	int rc;
-	exfat_cluster_t clst;
-	clst = firstc;
-
-	while (clst < firstc + count) {
-		rc = exfat_bitmap_clear_cluster(bs, service_id, clst);
-		if (rc != EOK)
-			return rc;
-		clst++;
-	}
-	return EOK;
+	return bitmap_update(bs, service_id, firstc, count, false);
 }
 
+/** Allocate a contiguous run of clusters.
+ *
+ * The run is searched for using the next-fit strategy, starting where the
+ * previous allocation ended.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param firstc	Place to store the first cluster of the run.
+ * @param count		Number of clusters to allocate.
+ *
+ * @return		EOK on success, ENOSPC if there is no long enough run
+ *			or a negative error code.
+ */
 int exfat_bitmap_alloc_clusters(exfat_bs_t *bs, service_id_t service_id, 
     exfat_cluster_t *firstc, exfat_cluster_t count)
 {
-	exfat_cluster_t startc, endc;
-	startc = EXFAT_CLST_FIRST;
-
-	while (startc < DATA_CNT(bs) + 2) {
-		endc = startc;
-		while (exfat_bitmap_is_free(bs, service_id, endc) == EOK) {
-			if ((endc - startc) + 1 == count) {
-				*firstc = startc;
-				return exfat_bitmap_set_clusters(bs, service_id, startc, count);
-			} else
-				endc++;
+	exfat_instance_t *instance;
+	exfat_node_t *bitmapp;
+	fs_node_t *fn;
+	exfat_cluster_t end = DATA_CNT(bs) + EXFAT_CLST_FIRST;
+	exfat_cluster_t start, from, to, clst, run;
+	unsigned pass;
+	int rc;
+
+	rc = bitmap_lock(service_id, &fn, &instance);
+	if (rc != EOK)
+		return rc;
+	bitmapp = EXFAT_NODE(fn);
+
+	start = instance->next_free;
+	if (start < EXFAT_CLST_FIRST || start >= end)
+		start = EXFAT_CLST_FIRST;
+
+	from = start;
+	to = end;
+	rc = ENOSPC;
+	for (pass = 0; pass < 2 && rc == ENOSPC; pass++) {
+		rc = bitmap_find(bs, bitmapp, instance, from, to, &clst);
+		while (rc == EOK) {
+			rc = bitmap_run(bs, bitmapp, instance, clst, count, &run);
+			if (rc != EOK)
+				break;
+			if (run == count)
+				goto found;
+			rc = bitmap_find(bs, bitmapp, instance, clst + run, to,
+			    &clst);
 		}
-		startc = endc+1;
+
+		/* Wrap around. */
+		from = EXFAT_CLST_FIRST;
+		to = start;
 	}
-	return ENOSPC;
+
+	return bitmap_unlock(fn, rc);
+
+found:
+	rc = bitmap_mark(bs, bitmapp, instance, clst, count, true);
+	if (rc == EOK) {
+		*firstc = clst;
+		instance->next_free = clst + count;
+	}
+
+	return bitmap_unlock(fn, rc);
 }
 
+/** Allocate a single cluster anywhere in the file system.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param clst		Place to store the allocated cluster.
+ *
+ * @return		EOK on success, ENOSPC if there is no free cluster
+ *			or a negative error code.
+ */
+int exfat_bitmap_alloc_cluster(exfat_bs_t *bs, service_id_t service_id,
+    exfat_cluster_t *clst)
+{
+	exfat_instance_t *instance;
+	exfat_node_t *bitmapp;
+	fs_node_t *fn;
+	exfat_cluster_t end = DATA_CNT(bs) + EXFAT_CLST_FIRST;
+	exfat_cluster_t start;
+	int rc;
+
+	rc = bitmap_lock(service_id, &fn, &instance);
+	if (rc != EOK)
+		return rc;
+	bitmapp = EXFAT_NODE(fn);
+
+	start = instance->next_free;
+	if (start < EXFAT_CLST_FIRST || start >= end)
+		start = EXFAT_CLST_FIRST;
+
+	rc = bitmap_find(bs, bitmapp, instance, start, end, clst);
+	if (rc == ENOSPC) {
+		rc = bitmap_find(bs, bitmapp, instance, EXFAT_CLST_FIRST,
+		    start, clst);
+	}
+
+	if (rc == EOK) {
+		rc = bitmap_mark(bs, bitmapp, instance, *clst, 1, true);
+		if (rc == EOK)
+			instance->next_free = *clst + 1;
+	}
+
+	return bitmap_unlock(fn, rc);
+}
 
 int exfat_bitmap_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep, 
     exfat_cluster_t count)
@@ -223,18 +623,27 @@ int exfat_bitmap_append_clusters(exfat_bs_t *bs, exfat_node_t *nodep,
 		return exfat_bitmap_alloc_clusters(bs, nodep->idx->service_id, 
 		    &nodep->firstc, count);
 	} else {
-		exfat_cluster_t lastc, clst;
+		exfat_instance_t *instance;
+		fs_node_t *fn;
+		exfat_cluster_t lastc, run;
+		int rc;
+
 		lastc = nodep->firstc + ROUND_UP(nodep->size, BPC(bs)) / BPC(bs) - 1;
 
-		clst = lastc + 1;
-		while (exfat_bitmap_is_free(bs, nodep->idx->service_id, clst) == EOK) {
-			if (clst - lastc == count){
-				return exfat_bitmap_set_clusters(bs, nodep->idx->service_id, 
-				    lastc + 1, count);
-			} else
-				clst++;
+		rc = bitmap_lock(nodep->idx->service_id, &fn, &instance);
+		if (rc != EOK)
+			return rc;
+
+		rc = bitmap_run(bs, EXFAT_NODE(fn), instance, lastc + 1, count,
+		    &run);
+		if (rc == EOK && run != count)
+			rc = ENOSPC;
+		if (rc == EOK) {
+			rc = bitmap_mark(bs, EXFAT_NODE(fn), instance, lastc + 1,
+			    count, true);
 		}
-		return ENOSPC;
+
+		return bitmap_unlock(fn, rc);
 	}
 }
 
@@ -41,8 +41,13 @@
 struct exfat_node;
 struct exfat_bs;
 
+extern int exfat_bitmap_init(struct exfat_bs *, service_id_t);
+extern void exfat_bitmap_fini(service_id_t);
+
 extern int exfat_bitmap_alloc_clusters(struct exfat_bs *, service_id_t, 
     exfat_cluster_t *, exfat_cluster_t);
+extern int exfat_bitmap_alloc_cluster(struct exfat_bs *, service_id_t,
+    exfat_cluster_t *);
 extern int exfat_bitmap_append_clusters(struct exfat_bs *, struct exfat_node *, 
     exfat_cluster_t);
 extern int exfat_bitmap_free_clusters(struct exfat_bs *, struct exfat_node *, 
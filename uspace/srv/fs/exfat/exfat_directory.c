@@ -45,6 +45,73 @@
 #include <malloc.h>
 #include <str.h>
 #include <align.h>
+#include <ctype.h>
+
+/** Compute lookup cache key of a name.
+ *
+ * The key is the name converted to lower case.
+ *
+ * @return		False if the name is too long to be present in any
+ *			directory.
+ */
+static bool exfat_dcache_key(char *key, const char *name)
+{
+	size_t i;
+
+	for (i = 0; name[i] != '\0'; i++) {
+		if (i + 1 >= EXFAT_FILENAME_LEN + 1)
+			return false;
+		key[i] = tolower(name[i]);
+	}
+	key[i] = '\0';
+
+	return true;
+}
+
+/** Update the directory lookup cache after writing a new entry.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name of the new entry.
+ * @param pos		Position of the file dentry of the new entry.
+ * @param rc		Result of the write. The cache is dropped on failure as
+ *			the directory may have been modified partially.
+ */
+static void exfat_directory_cache_add(exfat_node_t *nodep, const char *name,
+    aoff64_t pos, int rc)
+{
+	char key[EXFAT_FILENAME_LEN + 1];
+
+	if (rc != EOK || !exfat_dcache_key(key, name))
+		fs_dcache_add(&nodep->dcache, NULL, pos);
+	else
+		fs_dcache_add(&nodep->dcache, key, pos);
+}
+
+/** Remove a name from the directory lookup cache.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name of the removed entry.
+ * @param pos		Position of the file dentry of the removed entry.
+ */
+void exfat_directory_cache_remove(exfat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	char key[EXFAT_FILENAME_LEN + 1];
+
+	if (!exfat_dcache_key(key, name))
+		fs_dcache_remove(&nodep->dcache, NULL, NULL, pos);
+	else
+		fs_dcache_remove(&nodep->dcache, key, NULL, pos);
+}
+
+/** Free the lookup cache of a directory node.
+ *
+ * Must be called before the node structure is freed or reused.
+ */
+void exfat_directory_cache_destroy(exfat_node_t *nodep)
+{
+	fs_dcache_invalidate(&nodep->dcache);
+}
 
 void exfat_directory_init(exfat_directory_t *di)
 {
@@ -336,7 +403,8 @@ int exfat_directory_sync_file(exfat_directory_t *di, exfat_file_dentry_t *df,
 	return EOK;
 }
 
-int exfat_directory_write_file(exfat_directory_t *di, const char *name)
+static int exfat_directory_write_entries(exfat_directory_t *di,
+    const char *name)
 {
 	fs_node_t *fn;
 	exfat_node_t *uctablep;
@@ -442,6 +510,17 @@ int exfat_directory_write_file(exfat_directory_t *di, const char *name)
 	return exfat_directory_seek(di, pos);
 }
 
+int exfat_directory_write_file(exfat_directory_t *di, const char *name)
+{
+	int rc;
+
+	rc = exfat_directory_write_entries(di, name);
+	if (di->nodep)
+		exfat_directory_cache_add(di->nodep, name, di->pos, rc);
+
+	return rc;
+}
+
 int exfat_directory_erase_file(exfat_directory_t *di, aoff64_t pos)
 {
 	int rc, count;
@@ -526,6 +605,112 @@ int exfat_directory_lookup_free(exfat_directory_t *di, size_t count)
 }
 
 
+/** Scan the whole directory and build its lookup cache.
+ *
+ * The scan also looks for the requested name, so that the directory is not
+ * read twice when the cache cannot be built.
+ *
+ * @param di		Directory.
+ * @param key		Lookup cache key of the requested name.
+ * @param pos		Output argument holding the position of the file
+ *			dentry of the requested entry.
+ *
+ * @return		EOK if the name was found, ENOENT if it is not
+ *			present or a negative error code.
+ */
+static int exfat_directory_cache_build(exfat_directory_t *di, const char *key,
+    aoff64_t *pos)
+{
+	char name[EXFAT_FILENAME_LEN + 1];
+	char ekey[EXFAT_FILENAME_LEN + 1];
+	exfat_node_t *nodep = di->nodep;
+	exfat_file_dentry_t df;
+	exfat_stream_dentry_t ds;
+	fs_dcache_t *dc;
+	unsigned gen;
+	int rc = ENOENT;
+	int erc;
+
+	gen = fs_dcache_gen(&nodep->dcache);
+	dc = fs_dcache_create();
+
+	exfat_directory_seek(di, 0);
+	while ((erc = exfat_directory_read_file(di, name, EXFAT_FILENAME_LEN,
+	    &df, &ds)) == EOK) {
+		/*
+		 * A name without a key cannot be looked up, so the cache stays
+		 * complete without it.
+		 */
+		if (exfat_dcache_key(ekey, name)) {
+			if (rc == ENOENT && str_cmp(ekey, key) == 0) {
+				*pos = di->pos;
+				rc = EOK;
+			}
+
+			if (dc && fs_dcache_insert(dc, ekey, di->pos) != EOK) {
+				/* Too large to be cached. */
+				fs_dcache_free(dc);
+				dc = NULL;
+			}
+		}
+
+		erc = exfat_directory_next(di);
+		if (erc != EOK)
+			break;
+	}
+
+	if (dc) {
+		if (erc == ENOENT)
+			fs_dcache_attach(&nodep->dcache, dc, gen);
+		else {
+			/* The scan did not reach the end of the directory. */
+			fs_dcache_free(dc);
+		}
+	}
+
+	return rc;
+}
+
+/** Find a directory entry by name.
+ *
+ * The lookup uses the lookup cache of the directory, which is built on the
+ * first lookup.
+ *
+ * @param di		Directory.
+ * @param name		Name of the entry to look for.
+ *
+ * @return		EOK on success with di positioned at the file dentry,
+ *			ENOENT if the name is not present or a negative error
+ *			code.
+ */
+int exfat_directory_lookup_name(exfat_directory_t *di, const char *name)
+{
+	char key[EXFAT_FILENAME_LEN + 1];
+	exfat_dentry_t *d;
+	aoff64_t pos = 0;
+	int rc;
+
+	if (!exfat_dcache_key(key, name))
+		return ENOENT;
+
+	rc = fs_dcache_lookup(&di->nodep->dcache, key, NULL, &pos);
+	if (rc == EAGAIN)
+		rc = exfat_directory_cache_build(di, key, &pos);
+	if (rc != EOK)
+		return rc;
+
+	rc = exfat_directory_seek(di, pos);
+	if (rc != EOK)
+		return rc;
+	rc = exfat_directory_get(di, &d);
+	if (rc != EOK)
+		return rc;
+	if (exfat_classify_dentry(d) != EXFAT_DENTRY_FILE)
+		return EIO;
+
+	return EOK;
+}
+
 /**
  * @}
- */ 
+ */
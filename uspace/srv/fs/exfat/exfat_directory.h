@@ -78,6 +78,11 @@ extern int exfat_directory_erase_file(exfat_directory_t *, aoff64_t);
 extern int exfat_directory_expand(exfat_directory_t *);
 extern int exfat_directory_lookup_free(exfat_directory_t *, size_t);
 extern int exfat_directory_print(exfat_directory_t *);
+extern int exfat_directory_lookup_name(exfat_directory_t *, const char *);
+
+extern void exfat_directory_cache_remove(exfat_node_t *, const char *,
+    aoff64_t);
+extern void exfat_directory_cache_destroy(exfat_node_t *);
 
 
 #endif
@@ -310,36 +310,36 @@ exfat_alloc_clusters(exfat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 		return ENOMEM;
 
 	fibril_mutex_lock(&exfat_alloc_lock);
-	for (clst = EXFAT_CLST_FIRST; clst < DATA_CNT(bs) + 2 && found < nclsts;
-	    clst++) {
-		/* Need to rewrite because of multiple exfat_bitmap_get calls */
-		if (exfat_bitmap_is_free(bs, service_id, clst) == EOK) {
-			/*
-			 * The cluster is free. Put it into our stack
-			 * of found clusters and mark it as non-free.
-			 */
-			lifo[found] = clst;
-			rc = exfat_set_cluster(bs, service_id, clst,
-			    (found == 0) ?  EXFAT_CLST_EOF : lifo[found - 1]);
-			if (rc != EOK)
-				goto exit_error;
-			found++;
-			rc = exfat_bitmap_set_cluster(bs, service_id, clst);
+	while (found < nclsts) {
+		/* Take the next free cluster and mark it as used at once. */
+		rc = exfat_bitmap_alloc_cluster(bs, service_id, &clst);
+		if (rc != EOK)
+			goto exit_error;
+
+		/*
+		 * Put the cluster into our stack of found clusters and append
+		 * it to the previously found one. The bitmap hands out clusters
+		 * in ascending order until it wraps around, so the chain mostly
+		 * runs forward on the disk.
+		 */
+		lifo[found] = clst;
+		found++;
+		rc = exfat_set_cluster(bs, service_id, clst, EXFAT_CLST_EOF);
+		if (rc != EOK)
+			goto exit_error;
+		if (found > 1) {
+			rc = exfat_set_cluster(bs, service_id, lifo[found - 2],
+			    clst);
 			if (rc != EOK)
 				goto exit_error;
-
 		}
 	}
 
-	if (rc == EOK && found == nclsts) {
-		*mcl = lifo[found - 1];
-		*lcl = lifo[0];
-		free(lifo);
-		fibril_mutex_unlock(&exfat_alloc_lock);
-		return EOK;
-	}
-
-	rc = ENOSPC;
+	*mcl = lifo[0];
+	*lcl = lifo[found - 1];
+	free(lifo);
+	fibril_mutex_unlock(&exfat_alloc_lock);
+	return EOK;
 
 exit_error:
 
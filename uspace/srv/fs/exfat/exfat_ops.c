@@ -81,6 +81,7 @@ static int exfat_destroy_node(fs_node_t *);
 static int exfat_link(fs_node_t *, fs_node_t *, const char *);
 static int exfat_unlink(fs_node_t *, fs_node_t *, const char *);
 static int exfat_has_children(bool *, fs_node_t *);
+static int exfat_readdir(fs_node_t *, aoff64_t, libfs_readdir_cb_t, void *);
 static fs_index_t exfat_index_get(fs_node_t *);
 static aoff64_t exfat_size_get(fs_node_t *);
 static unsigned exfat_lnkcnt_get(fs_node_t *);
@@ -108,6 +109,7 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	fs_dcache_node_initialize(&node->dcache);
 }
 
 static int exfat_node_sync(exfat_node_t *node)
@@ -198,6 +200,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		exfat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -236,12 +239,14 @@ static int exfat_node_get_new(exfat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				exfat_directory_cache_destroy(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		exfat_directory_cache_destroy(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -396,6 +401,68 @@ static int exfat_node_get_core(exfat_node_t **nodepp, exfat_idx_t *idxp)
 	return EOK;
 }
 
+/** Move a contiguous file to a free run large enough to grow it in place.
+ *
+ * @param bs       Buffer holding the boot sector of the file system.
+ * @param nodep    Node of the contiguous regular file.
+ * @param clusters Number of clusters the node is about to grow by.
+ *
+ * @return EOK on success, ENOSPC if there is no such run or another error
+ *         code from errno.h.
+ *
+ */
+static int exfat_node_relocate(exfat_bs_t *bs, exfat_node_t *nodep,
+    exfat_cluster_t clusters)
+{
+	service_id_t service_id = nodep->idx->service_id;
+	exfat_cluster_t count = ROUND_UP(nodep->size, BPC(bs)) / BPC(bs);
+	exfat_cluster_t oldc = nodep->firstc;
+	exfat_cluster_t newc;
+	block_t *src, *dst;
+	int rc;
+
+	rc = exfat_bitmap_alloc_clusters(bs, service_id, &newc,
+	    count + clusters);
+	if (rc != EOK)
+		return rc;
+
+	for (aoff64_t i = 0; i < (aoff64_t) count * SPC(bs); i++) {
+		rc = block_get(&src, service_id, DATA_FS(bs) +
+		    (oldc - EXFAT_CLST_FIRST) * SPC(bs) + i, BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			goto error;
+		rc = block_get(&dst, service_id, DATA_FS(bs) +
+		    (newc - EXFAT_CLST_FIRST) * SPC(bs) + i,
+		    BLOCK_FLAGS_NOREAD);
+		if (rc != EOK) {
+			(void) block_put(src);
+			goto error;
+		}
+		memcpy(dst->data, src->data, BPS(bs));
+		dst->dirty = true;
+		rc = block_put(dst);
+		if (rc != EOK) {
+			(void) block_put(src);
+			goto error;
+		}
+		rc = block_put(src);
+		if (rc != EOK)
+			goto error;
+	}
+
+	nodep->firstc = newc;
+	nodep->dirty = true;		/* need to sync node */
+
+	if (count == 0)
+		return EOK;
+	return exfat_bitmap_clear_clusters(bs, service_id, oldc, count);
+
+error:
+	(void) exfat_bitmap_clear_clusters(bs, service_id, newc,
+	    count + clusters);
+	return rc;
+}
+
 int exfat_node_expand(service_id_t service_id, exfat_node_t *nodep,
     exfat_cluster_t clusters)
 {
@@ -407,6 +474,19 @@ int exfat_node_expand(service_id_t service_id, exfat_node_t *nodep,
 		rc = exfat_bitmap_append_clusters(bs, nodep, clusters);
 		if (rc != ENOSPC)
 			return rc;
+
+		/*
+		 * A small file is rather moved to a larger free run than
+		 * turned into a cluster chain, so that it keeps the NoFatChain
+		 * flag and can still be read in large contiguous requests.
+		 */
+		if (nodep->type == EXFAT_FILE &&
+		    nodep->size <= EXFAT_RELOCATE_SIZE) {
+			rc = exfat_node_relocate(bs, nodep, clusters);
+			if (rc != ENOSPC)
+				return rc;
+		}
+
 		if (rc == ENOSPC) {
 			nodep->fragmented = true;
 			nodep->dirty = true;		/* need to sync node */
@@ -459,6 +539,8 @@ static int exfat_node_shrink(service_id_t service_id, exfat_node_t *nodep,
 		rc = exfat_bitmap_free_clusters(bs, nodep, clsts);
 		if (rc != EOK)
 			return rc;
+		if (size == 0)
+			nodep->firstc = 0;
 	} else {
 		/*
 		 * The node will be shrunk, clusters will be deallocated.
@@ -467,6 +549,11 @@ static int exfat_node_shrink(service_id_t service_id, exfat_node_t *nodep,
 			rc = exfat_chop_clusters(bs, nodep, 0);
 			if (rc != EOK)
 				return rc;
+			/*
+			 * With no clusters left, the node can be given a
+			 * contiguous run again when it grows.
+			 */
+			nodep->fragmented = false;
 		} else {
 			exfat_cluster_t lastc;
 			rc = exfat_cluster_walk(bs, service_id, nodep->firstc,
@@ -505,12 +592,41 @@ int exfat_uctable_get(fs_node_t **rfn, service_id_t service_id)
 }
 
 
+/** Get the node described by the current entry of a directory.
+ *
+ * @param rfn        Place to store the node.
+ * @param parentp    Directory being read.
+ * @param service_id Service ID of the file system instance.
+ * @param di         Directory positioned at the entry.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int exfat_node_get_by_dentry(fs_node_t **rfn, exfat_node_t *parentp,
+    service_id_t service_id, exfat_directory_t *di)
+{
+	exfat_node_t *nodep;
+	aoff64_t o = di->pos % (BPS(di->bs) / sizeof(exfat_dentry_t));
+	exfat_idx_t *idx = exfat_idx_get_by_pos(service_id, parentp->firstc,
+	    di->bnum * DPS(di->bs) + o);
+	if (!idx) {
+		/*
+		 * Can happen if memory is low or if we
+		 * run out of 32-bit indices.
+		 */
+		return ENOMEM;
+	}
+	int rc = exfat_node_get_core(&nodep, idx);
+	fibril_mutex_unlock(&idx->lock);
+	if (rc != EOK)
+		return rc;
+	*rfn = FS_NODE(nodep);
+	return EOK;
+}
+
 int exfat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
 	exfat_node_t *parentp = EXFAT_NODE(pfn);
-	char name[EXFAT_FILENAME_LEN + 1];
-	exfat_file_dentry_t df;
-	exfat_stream_dentry_t ds;
 	service_id_t service_id;
 	int rc;
 
@@ -523,41 +639,22 @@ int exfat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	if (rc != EOK)
 		return rc;
 
-	while (exfat_directory_read_file(&di, name, EXFAT_FILENAME_LEN, &df,
-	    &ds) == EOK) {
-		if (stricmp(name, component) == 0) {
-			/* hit */
-			exfat_node_t *nodep;
-			aoff64_t o = di.pos %
-			    (BPS(di.bs) / sizeof(exfat_dentry_t));
-			exfat_idx_t *idx = exfat_idx_get_by_pos(service_id,
-				parentp->firstc, di.bnum * DPS(di.bs) + o);
-			if (!idx) {
-				/*
-				 * Can happen if memory is low or if we
-				 * run out of 32-bit indices.
-				 */
-				rc = exfat_directory_close(&di);
-				return (rc == EOK) ? ENOMEM : rc;
-			}
-			rc = exfat_node_get_core(&nodep, idx);
-			fibril_mutex_unlock(&idx->lock);
-			if (rc != EOK) {
-				(void) exfat_directory_close(&di);
-				return rc;
-			}
-			*rfn = FS_NODE(nodep);
-			rc = exfat_directory_close(&di);
-			if (rc != EOK)
-				(void) exfat_node_put(*rfn);
+	rc = exfat_directory_lookup_name(&di, component);
+	if (rc == EOK) {
+		/* hit */
+		rc = exfat_node_get_by_dentry(rfn, parentp, service_id, &di);
+		if (rc != EOK) {
+			(void) exfat_directory_close(&di);
 			return rc;
-		} else {
-			rc = exfat_directory_next(&di);
-			if (rc != EOK)
-				break;
 		}
+		rc = exfat_directory_close(&di);
+		if (rc != EOK)
+			(void) exfat_node_put(*rfn);
+		return rc;
 	}
 	(void) exfat_directory_close(&di);
+	if (rc != ENOENT)
+		return rc;
 	*rfn = NULL;
 	return EOK;
 }
@@ -614,6 +711,7 @@ int exfat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		exfat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -708,6 +806,7 @@ int exfat_destroy_node(fs_node_t *fn)
 	} 
 
 	exfat_idx_destroy(nodep->idx);
+	exfat_directory_cache_destroy(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -804,8 +903,11 @@ int exfat_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (rc != EOK)
 		goto error;
 	rc = exfat_directory_erase_file(&di, childp->idx->pdi);
-	if (rc != EOK)
+	if (rc != EOK) {
+		exfat_directory_cache_destroy(parentp);
 		goto error;
+	}
+	exfat_directory_cache_remove(parentp, nm, childp->idx->pdi);
 	rc = exfat_directory_close(&di);
 	if (rc != EOK)
 		goto error;
@@ -879,6 +981,46 @@ exit:
 	return rc;
 }
 
+int exfat_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg)
+{
+	exfat_node_t *nodep = EXFAT_NODE(fn);
+	char name[EXFAT_FILENAME_LEN + 1];
+	exfat_file_dentry_t df;
+	exfat_stream_dentry_t ds;
+	service_id_t service_id;
+	int rc;
+
+	fibril_mutex_lock(&nodep->idx->lock);
+	service_id = nodep->idx->service_id;
+	fibril_mutex_unlock(&nodep->idx->lock);
+
+	exfat_directory_t di;
+	rc = exfat_directory_open(nodep, &di);
+	if (rc != EOK)
+		return rc;
+	rc = exfat_directory_seek(&di, pos);
+
+	while ((rc == EOK) && ((rc = exfat_directory_read_file(&di, name,
+	    EXFAT_FILENAME_LEN, &df, &ds)) == EOK)) {
+		fs_node_t *cfn;
+		rc = exfat_node_get_by_dentry(&cfn, nodep, service_id, &di);
+		if (rc != EOK)
+			break;
+		if (!cb(arg, name, cfn, di.pos + 1))
+			break;
+		rc = exfat_directory_next(&di);
+	}
+
+	if (rc == ENOENT)
+		rc = EOK;
+	if (rc != EOK) {
+		(void) exfat_directory_close(&di);
+		return rc;
+	}
+	return exfat_directory_close(&di);
+}
+
 
 fs_index_t exfat_index_get(fs_node_t *fn)
 {
@@ -923,6 +1065,7 @@ libfs_ops_t exfat_libfs_ops = {
 	.link = exfat_link,
 	.unlink = exfat_unlink,
 	.has_children = exfat_has_children,
+	.readdir = exfat_readdir,
 	.index_get = exfat_index_get,
 	.size_get = exfat_size_get,
 	.lnkcnt_get = exfat_lnkcnt_get,
@@ -985,7 +1128,7 @@ exfat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		cmode = CACHE_MODE_WB;
 
 	/* initialize libblock */
-	rc = block_init(EXCHANGE_SERIALIZE, service_id, BS_SIZE);
+	rc = block_init(EXCHANGE_SERIALIZE, service_id, EXFAT_COMM_SIZE);
 	if (rc != EOK)
 		return rc;
 
@@ -1145,6 +1288,18 @@ exfat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		return ENOMEM;
 	}
 
+	/* Summarize the allocation bitmap. */
+	rc = exfat_bitmap_init(bs, service_id);
+	if (rc != EOK) {
+		free(rootp);
+		free(bitmapp);
+		free(uctablep);
+		(void) block_cache_fini(service_id);
+		block_fini(service_id);
+		exfat_idx_fini_by_service_id(service_id);
+		return rc;
+	}
+
 	/* exfat_fsinfo(bs, service_id); */
 
 	*index = rootp->idx->index;
@@ -1185,6 +1340,7 @@ static int exfat_unmounted(service_id_t service_id)
 	 * associated data. Write back this file system's dirty blocks and
 	 * stop using libblock for this instance.
 	 */
+	exfat_bitmap_fini(service_id);
 	(void) exfat_node_fini_by_service_id(service_id);
 	exfat_idx_fini_by_service_id(service_id);
 	(void) block_cache_fini(service_id);
@@ -1193,6 +1349,104 @@ static int exfat_unmounted(service_id_t service_id)
 	return EOK;
 }
 
+/** Read a range of a regular file.
+ *
+ * A range within one block is passed to the client directly from the block
+ * cache. A longer range is assembled from all the blocks it spans so that the
+ * whole request is satisfied at once. The blocks of a file without a cluster
+ * chain form a single run on the device, which is read in large requests.
+ *
+ * @param callid IPC_M_DATA_READ request to answer.
+ * @param bs     Buffer holding the boot sector of the file system.
+ * @param nodep  Node of the regular file.
+ * @param pos    Position in the file.
+ * @param size   Number of bytes to read, all of them within the file.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int exfat_read_file(ipc_callid_t callid, exfat_bs_t *bs, exfat_node_t *nodep,
+    aoff64_t pos, size_t size)
+{
+	block_t *b;
+	int rc;
+
+	if (pos % BPS(bs) + size <= BPS(bs)) {
+		rc = exfat_block_get(&b, bs, nodep, pos / BPS(bs),
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			async_answer_0(callid, rc);
+			return rc;
+		}
+		(void) async_data_read_finalize(callid,
+		    b->data + pos % BPS(bs), size);
+		return block_put(b);
+	}
+
+	if (!nodep->fragmented) {
+		if (nodep->firstc < EXFAT_CLST_FIRST) {
+			async_answer_0(callid, ELIMIT);
+			return ELIMIT;
+		}
+
+		aoff64_t first = pos / BPS(bs);
+		size_t blocks = (pos + size - 1) / BPS(bs) - first + 1;
+
+		uint8_t *buf = malloc(blocks * BPS(bs));
+		if (!buf) {
+			async_answer_0(callid, ENOMEM);
+			return ENOMEM;
+		}
+
+		rc = block_read_range(nodep->idx->service_id, DATA_FS(bs) +
+		    (nodep->firstc - EXFAT_CLST_FIRST) * SPC(bs) + first,
+		    blocks, buf);
+		if (rc != EOK) {
+			free(buf);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+
+		(void) async_data_read_finalize(callid, buf + pos % BPS(bs),
+		    size);
+		free(buf);
+		return EOK;
+	}
+
+	uint8_t *buf = malloc(size);
+	if (!buf) {
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+
+	size_t done = 0;
+	while (done < size) {
+		aoff64_t cur = pos + done;
+		size_t chunk = min(size - done, BPS(bs) - cur % BPS(bs));
+
+		rc = exfat_block_get(&b, bs, nodep, cur / BPS(bs),
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			free(buf);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+		memcpy(buf + done, b->data + cur % BPS(bs), chunk);
+		rc = block_put(b);
+		if (rc != EOK) {
+			free(buf);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+
+		done += chunk;
+	}
+
+	(void) async_data_read_finalize(callid, buf, size);
+	free(buf);
+	return EOK;
+}
+
 static int
 exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *rbytes)
@@ -1201,7 +1455,6 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	exfat_node_t *nodep;
 	exfat_bs_t *bs;
 	size_t bytes = 0;
-	block_t *b;
 	int rc;
 
 	rc = exfat_node_get(&fn, service_id, index);
@@ -1222,28 +1475,15 @@ exfat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	bs = block_bb_get(service_id);
 
 	if (nodep->type == EXFAT_FILE) {
-		/*
-		 * Our strategy for regular file reads is to read one block at
-		 * most and make use of the possibility to return less data than
-		 * requested. This keeps the code very simple.
-		 */
 		if (pos >= nodep->size) {
 			/* reading beyond the EOF */
 			bytes = 0;
 			(void) async_data_read_finalize(callid, NULL, 0);
 		} else {
-			bytes = min(len, BPS(bs) - pos % BPS(bs));
-			bytes = min(bytes, nodep->size - pos);
-			rc = exfat_block_get(&b, bs, nodep, pos / BPS(bs),
-			    BLOCK_FLAGS_NONE);
-			if (rc != EOK) {
-				exfat_node_put(fn);
-				async_answer_0(callid, rc);
-				return rc;
-			}
-			(void) async_data_read_finalize(callid,
-			    b->data + pos % BPS(bs), bytes);
-			rc = block_put(b);
+			/* Larger reads are short to bound the buffer size */
+			bytes = min(len, nodep->size - pos);
+			bytes = min(bytes, EXFAT_COMM_SIZE);
+			rc = exfat_read_file(callid, bs, nodep, pos, bytes);
 			if (rc != EOK) {
 				exfat_node_put(fn);
 				return rc;
@@ -1335,6 +1575,60 @@ static int exfat_sync(service_id_t service_id, fs_index_t index)
 	return rc;
 }
 
+/** Write a range spanning several blocks of a regular file.
+ *
+ * The clusters holding the range must already be allocated. Blocks which are
+ * overwritten as a whole are not read from the device.
+ *
+ * @param callid IPC_M_DATA_WRITE request to answer.
+ * @param bs     Buffer holding the boot sector of the file system.
+ * @param nodep  Node of the regular file.
+ * @param pos    Position in the file.
+ * @param size   Number of bytes to write.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int exfat_write_blocks(ipc_callid_t callid, exfat_bs_t *bs,
+    exfat_node_t *nodep, aoff64_t pos, size_t size)
+{
+	block_t *b;
+	int rc;
+
+	uint8_t *buf = malloc(size);
+	if (!buf) {
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+
+	rc = async_data_write_finalize(callid, buf, size);
+	if (rc != EOK) {
+		free(buf);
+		return rc;
+	}
+
+	size_t done = 0;
+	while (done < size) {
+		aoff64_t cur = pos + done;
+		size_t chunk = min(size - done, BPS(bs) - cur % BPS(bs));
+
+		rc = exfat_block_get(&b, bs, nodep, cur / BPS(bs),
+		    chunk == BPS(bs) ? BLOCK_FLAGS_NOREAD : BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			break;
+		memcpy(b->data + cur % BPS(bs), buf + done, chunk);
+		b->dirty = true;		/* need to sync block */
+		rc = block_put(b);
+		if (rc != EOK)
+			break;
+
+		done += chunk;
+	}
+
+	free(buf);
+	return rc;
+}
+
 static int
 exfat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -1366,34 +1660,58 @@ exfat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	bs = block_bb_get(service_id);
 
 	/*
-	 * In all scenarios, we will attempt to write out only one block worth
-	 * of data at maximum. There might be some more efficient approaches,
-	 * but this one greatly simplifies fat_write(). Note that we can afford
-	 * to do this because the client must be ready to handle the return
-	 * value signalizing a smaller number of bytes written.
+	 * We will attempt to write out only one block worth of data at
+	 * maximum, unless the node is contiguous, in which case up to the size
+	 * of the communication area is written at once. Note that we can
+	 * afford to do this because the client must be ready to handle the
+	 * return value signalizing a smaller number of bytes written.
 	 */
 	bytes = min(len, BPS(bs) - pos % BPS(bs));
-	if (bytes == BPS(bs))
-		flags |= BLOCK_FLAGS_NOREAD;
+	if (!nodep->fragmented && len > bytes)
+		bytes = min(len, EXFAT_COMM_SIZE - pos % BPS(bs));
 
+	/*
+	 * Allocate clusters for any part of the range lying beyond the last
+	 * cluster of the node, even if the write starts before it.
+	 */
 	boundary = ROUND_UP(nodep->size, BPC(bs));
-	if (pos >= boundary) {
+	if (ROUND_UP(pos + bytes, BPC(bs)) > boundary) {
 		unsigned nclsts;
 		nclsts = (ROUND_UP(pos + bytes, BPC(bs)) - boundary) / BPC(bs);
 		rc = exfat_node_expand(service_id, nodep, nclsts);
 		if (rc != EOK) {
-			/* could not expand node */
-			(void) exfat_node_put(fn);
-			async_answer_0(callid, rc);
-			return rc;
+			if (pos >= boundary) {
+				/* could not expand node */
+				(void) exfat_node_put(fn);
+				async_answer_0(callid, rc);
+				return rc;
+			}
+
+			/* Write only what fits in the allocated clusters */
+			bytes = boundary - pos;
 		}
 	}
 
+	if (bytes == BPS(bs))
+		flags |= BLOCK_FLAGS_NOREAD;
+
 	if (pos + bytes > nodep->size) {
 		nodep->size = pos + bytes;
 		nodep->dirty = true;	/* need to sync node */
 	}
 
+	if (pos % BPS(bs) + bytes > BPS(bs)) {
+		rc = exfat_write_blocks(callid, bs, nodep, pos, bytes);
+		if (rc != EOK) {
+			(void) exfat_node_put(fn);
+			return rc;
+		}
+
+		*wbytes = bytes;
+		*nsize = nodep->size;
+		return exfat_node_put(fn);
+	}
+
 	/*
 	 * This is the easier case - we are either overwriting already
 	 * existing contents or writing behind the EOF, but still within
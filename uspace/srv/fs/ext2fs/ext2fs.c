@@ -51,6 +51,7 @@
 
 vfs_info_t ext2fs_vfs_info = {
 	.name = NAME,
+	.lookup_cacheable = true,
 	.instance = 0,
 };
 
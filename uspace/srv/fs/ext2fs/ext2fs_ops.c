@@ -50,6 +50,7 @@
 #include <adt/hash_table.h>
 #include <adt/list.h>
 #include <assert.h>
+#include <dirent.h>
 #include <fibril_synch.h>
 #include <sys/mman.h>
 #include <align.h>
@@ -70,6 +71,7 @@ typedef struct ext2fs_instance {
 	link_t link;
 	service_id_t service_id;
 	ext2_filesystem_t *filesystem;
+	size_t dev_block_size;
 	unsigned int open_nodes_count;
 } ext2fs_instance_t;
 
@@ -89,6 +91,8 @@ static int ext2fs_read_directory(ipc_callid_t, aoff64_t, size_t,
     ext2fs_instance_t *, ext2_inode_ref_t *, size_t *);
 static int ext2fs_read_file(ipc_callid_t, aoff64_t, size_t, ext2fs_instance_t *,
     ext2_inode_ref_t *, size_t *);
+static int ext2fs_read_file_clustered(ipc_callid_t, aoff64_t, size_t,
+    ext2fs_instance_t *, ext2_inode_ref_t *, size_t *);
 static bool ext2fs_is_dots(const uint8_t *, size_t);
 static int ext2fs_node_get_core(fs_node_t **, ext2fs_instance_t *, fs_index_t);
 static int ext2fs_node_put_core(ext2fs_node_t *);
@@ -106,6 +110,7 @@ static int ext2fs_destroy_node(fs_node_t *);
 static int ext2fs_link(fs_node_t *, fs_node_t *, const char *);
 static int ext2fs_unlink(fs_node_t *, fs_node_t *, const char *);
 static int ext2fs_has_children(bool *, fs_node_t *);
+static int ext2fs_readdir(fs_node_t *, aoff64_t, libfs_readdir_cb_t, void *);
 static fs_index_t ext2fs_index_get(fs_node_t *);
 static aoff64_t ext2fs_size_get(fs_node_t *);
 static unsigned ext2fs_lnkcnt_get(fs_node_t *);
@@ -237,11 +242,6 @@ int ext2fs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 		return ENOTDIR;
 	}
 	
-	rc = ext2_directory_iterator_init(&it, fs, eparent->inode_ref, 0);
-	if (rc != EOK) {
-		return rc;
-	}
-
 	/* Find length of component in bytes
 	 * TODO: check for library function call that does this
 	 */
@@ -250,6 +250,20 @@ int ext2fs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 		component_size++;
 	}
 	
+	/* Use the hash index if the directory has one */
+	rc = ext2_htree_find(fs, eparent->inode_ref,
+	    (const uint8_t *) component, component_size, &inode);
+	if (rc == EOK) {
+		return ext2fs_node_get_core(rfn, eparent->instance, inode);
+	} else if (rc != ENOTSUP) {
+		return rc;
+	}
+	
+	rc = ext2_directory_iterator_init(&it, fs, eparent->inode_ref, 0);
+	if (rc != EOK) {
+		return rc;
+	}
+	
 	while (it.current != NULL) {
 		inode = ext2_directory_entry_ll_get_inode(it.current);
 		
@@ -512,6 +526,70 @@ int ext2fs_has_children(bool *has_children, fs_node_t *fn)
 	return EOK;
 }
 
+int ext2fs_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg)
+{
+	EXT2FS_DBG("");
+	ext2fs_node_t *enode = EXT2FS_NODE(fn);
+	ext2_directory_iterator_t it;
+	ext2_filesystem_t *fs;
+	fs_node_t *cfn;
+	char name[NAME_MAX + 1];
+	size_t name_size;
+	uint32_t inode;
+	int rc;
+	
+	fs = enode->instance->filesystem;
+	
+	if (!ext2_inode_is_type(fs->superblock, enode->inode_ref->inode,
+	    EXT2_INODE_MODE_DIRECTORY)) {
+		return ENOTDIR;
+	}
+	
+	rc = ext2_directory_iterator_init(&it, fs, enode->inode_ref, pos);
+	if (rc != EOK) {
+		return rc;
+	}
+	
+	while (it.current != NULL) {
+		inode = ext2_directory_entry_ll_get_inode(it.current);
+		name_size = ext2_directory_entry_ll_get_name_length(fs->superblock,
+		    it.current);
+		
+		/* skip empty entries as well as . and .. */
+		if (inode == 0 || ext2fs_is_dots(&it.current->name, name_size)) {
+			rc = ext2_directory_iterator_next(&it);
+			if (rc != EOK) {
+				ext2_directory_iterator_fini(&it);
+				return rc;
+			}
+			continue;
+		}
+		
+		/* The on-disk entry name is not terminated by \0 */
+		memcpy(name, &it.current->name, name_size);
+		name[name_size] = 0;
+		
+		rc = ext2fs_node_get_core(&cfn, enode->instance, inode);
+		if (rc != EOK) {
+			ext2_directory_iterator_fini(&it);
+			return rc;
+		}
+		
+		rc = ext2_directory_iterator_next(&it);
+		if (rc != EOK) {
+			ext2fs_node_put(cfn);
+			ext2_directory_iterator_fini(&it);
+			return rc;
+		}
+		
+		if (!cb(arg, name, cfn, it.current_offset))
+			break;
+	}
+	
+	return ext2_directory_iterator_fini(&it);
+}
+
 
 fs_index_t ext2fs_index_get(fs_node_t *fn)
 {
@@ -575,6 +653,7 @@ libfs_ops_t ext2fs_libfs_ops = {
 	.link = ext2fs_link,
 	.unlink = ext2fs_unlink,
 	.has_children = ext2fs_has_children,
+	.readdir = ext2fs_readdir,
 	.index_get = ext2fs_index_get,
 	.size_get = ext2fs_size_get,
 	.lnkcnt_get = ext2fs_lnkcnt_get,
@@ -634,6 +713,15 @@ static int ext2fs_mounted(service_id_t service_id, const char *opts,
 		return rc;
 	}
 	
+	/* Clustered reads bypass the block cache and address the device */
+	rc = block_get_bsize(service_id, &inst->dev_block_size);
+	if (rc != EOK) {
+		ext2_filesystem_fini(fs);
+		free(fs);
+		free(inst);
+		return rc;
+	}
+	
 	/* Initialize instance */
 	link_initialize(&inst->link);
 	inst->service_id = service_id;
@@ -864,10 +952,20 @@ int ext2fs_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 		return EOK;
 	}
 	
-	/* For now, we only read data from one block at a time */
 	block_size = ext2_superblock_get_block_size(inst->filesystem->superblock);
 	file_block = pos / block_size;
 	offset_in_block = pos % block_size;
+	
+	/*
+	 * Requests spanning several blocks are served with a single clustered
+	 * read, provided the device can address filesystem blocks directly.
+	 */
+	if (offset_in_block + size > block_size &&
+	    block_size % inst->dev_block_size == 0) {
+		return ext2fs_read_file_clustered(callid, pos, size, inst,
+		    inode_ref, rbytes);
+	}
+	
 	bytes = min(block_size - offset_in_block, size);
 	
 	/* Handle end of file */
@@ -876,15 +974,15 @@ int ext2fs_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 	}
 	
 	/* Get the real block number */
-	rc = ext2_filesystem_get_inode_data_block_index(inst->filesystem,
-		inode_ref->inode, file_block, &fs_block);
+	rc = ext2_filesystem_map_inode_blocks(inst->filesystem, inode_ref,
+	    file_block, 1, &fs_block);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return rc;
 	}
 	
 	/* Check for sparse file
-	 * If ext2_filesystem_get_inode_data_block_index returned
+	 * If ext2_filesystem_map_inode_blocks returned
 	 * fs_block == 0, it means that the given block is not allocated for the 
 	 * file and we need to return a buffer of zeros
 	 */
@@ -923,6 +1021,95 @@ int ext2fs_read_file(ipc_callid_t callid, aoff64_t pos, size_t size,
 	return EOK;
 }
 
+/**
+ * Read a run of consecutive file blocks in as few device requests
+ * as possible.
+ * 
+ * The run is mapped in one go and every physically contiguous part of it
+ * is read directly from the device, bypassing the block cache. This is
+ * safe because the filesystem is mounted read-only and the cache is
+ * write-through. Holes are filled with zeros.
+ */
+static int ext2fs_read_file_clustered(ipc_callid_t callid, aoff64_t pos,
+    size_t size, ext2fs_instance_t *inst, ext2_inode_ref_t *inode_ref,
+    size_t *rbytes)
+{
+	int rc;
+	uint32_t block_size;
+	uint64_t file_size;
+	size_t offset_in_block;
+	size_t bytes;
+	size_t blocks;
+	size_t i, j;
+	size_t dev_blocks_per_block;
+	uint32_t *fs_blocks;
+	uint8_t *buffer;
+	
+	file_size = ext2_inode_get_size(inst->filesystem->superblock,
+		inode_ref->inode);
+	block_size = ext2_superblock_get_block_size(inst->filesystem->superblock);
+	offset_in_block = pos % block_size;
+	dev_blocks_per_block = block_size / inst->dev_block_size;
+	
+	/* The whole run must fit into the device communication area */
+	bytes = min(size, EXT2_COMM_SIZE - offset_in_block);
+	if (pos + bytes > file_size) {
+		bytes = file_size - pos;
+	}
+	
+	blocks = (offset_in_block + bytes + block_size - 1) / block_size;
+	
+	fs_blocks = malloc(blocks * sizeof(uint32_t));
+	buffer = malloc(blocks * block_size);
+	if (fs_blocks == NULL || buffer == NULL) {
+		free(fs_blocks);
+		free(buffer);
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+	
+	rc = ext2_filesystem_map_inode_blocks(inst->filesystem, inode_ref,
+	    pos / block_size, blocks, fs_blocks);
+	if (rc != EOK) {
+		goto error;
+	}
+	
+	for (i = 0; i < blocks; i = j) {
+		if (fs_blocks[i] == 0) {
+			/* Sparse file */
+			memset(buffer + i * block_size, 0, block_size);
+			j = i + 1;
+			continue;
+		}
+		
+		for (j = i + 1; j < blocks; j++) {
+			if (fs_blocks[j] != fs_blocks[j - 1] + 1) {
+				break;
+			}
+		}
+		
+		rc = block_read_direct(inst->service_id,
+		    (aoff64_t) fs_blocks[i] * dev_blocks_per_block,
+		    (j - i) * dev_blocks_per_block, buffer + i * block_size);
+		if (rc != EOK) {
+			goto error;
+		}
+	}
+	
+	async_data_read_finalize(callid, buffer + offset_in_block, bytes);
+	*rbytes = bytes;
+	
+	free(fs_blocks);
+	free(buffer);
+	return EOK;
+	
+error:
+	free(fs_blocks);
+	free(buffer);
+	async_answer_0(callid, rc);
+	return rc;
+}
+
 static int
 ext2fs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -69,6 +69,9 @@
 #define BS_BLOCK	0
 #define BS_SIZE		512
 
+/** Size of the communication area shared with the block device. */
+#define FAT_COMM_SIZE	(32 * 1024)
+
 typedef struct fat_bs {
 	uint8_t		ji[3];		/**< Jump instruction. */
 	uint8_t		oem_name[8];
@@ -209,6 +212,16 @@ typedef struct {
 	struct fat_node	*nodep;
 } fat_idx_t;
 
+/** Run of physically contiguous clusters of a node. */
+typedef struct {
+	/** Logical number of the first cluster of the run within the node. */
+	uint32_t	lcl;
+	/** Physical number of the first cluster of the run. */
+	fat_cluster_t	pcl;
+	/** Number of clusters in the run. */
+	uint32_t	len;
+} fat_extent_t;
+
 /** FAT in-core node. */
 typedef struct fat_node {
 	/** Back pointer to the FS node. */
@@ -231,20 +244,42 @@ typedef struct fat_node {
 	bool			dirty;
 
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
 	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	fat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Map of the node's cluster chain, sorted by the logical cluster
+	 * number. It covers a contiguous prefix of the chain and is extended
+	 * lazily as the chain is walked. Reads of the node may run in
+	 * parallel, so the map is protected by extents_lock.
+	 */
+	fibril_mutex_t	extents_lock;
+	fat_extent_t	*extents;
+	/** Number of valid entries in extents. */
+	size_t		extents_cnt;
+	/** Number of entries allocated for extents. */
+	size_t		extents_size;
+
+	/** Name lookup cache of a directory node. */
+	fs_dcache_node_t dcache;
 } fat_node_t;
 
-typedef struct {
+typedef struct fat_instance {
 	bool lfn_enabled;
+
+	/*
+	 * Free cluster bitmap, protected by fat_alloc_lock. Bit set for a free
+	 * cluster, the first bit describes cluster FAT_CLST_FIRST.
+	 */
+	uint32_t	*free_bitmap;
+	/** Number of free clusters. */
+	uint32_t	free_clusters;
+	/** Cluster where the search for free clusters continues. */
+	fat_cluster_t	next_free;
 } fat_instance_t;
 
 extern vfs_out_ops_t fat_ops;
@@ -44,6 +44,94 @@
 #include <str.h>
 #include <align.h>
 #include <stdio.h>
+#include <ctype.h>
+
+/** Compute lookup cache key of a name.
+ *
+ * The key is the name converted to lower case.
+ *
+ * @return		False if the name is too long to be present in any
+ *			directory.
+ */
+static bool fat_dcache_key(char *key, const char *name)
+{
+	size_t i;
+
+	for (i = 0; name[i] != '\0'; i++) {
+		if (i + 1 >= FAT_LFN_NAME_SIZE)
+			return false;
+		key[i] = tolower(name[i]);
+	}
+	key[i] = '\0';
+
+	return true;
+}
+
+/** Compute the alternative lookup cache key of a path component.
+ *
+ * fat_dentry_namecmp() lets a component with a trailing dot match a name
+ * which does not contain any dot. The alternative key is the key without
+ * the trailing dot.
+ *
+ * @return		False if there is no alternative key.
+ */
+static bool fat_dcache_key_alt(char *alt, const char *key)
+{
+	size_t size = str_size(key);
+
+	if (size < 2 || key[size - 1] != '.' || str_chr(key, '.') != &key[size - 1])
+		return false;
+
+	str_cpy(alt, size, key);
+	return true;
+}
+
+/** Update the directory lookup cache after writing a new entry.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name of the new entry.
+ * @param pos		Position of the short name dentry of the new entry.
+ * @param rc		Result of the write. The cache is dropped on failure as
+ *			the directory may have been modified partially.
+ */
+static void fat_directory_cache_add(fat_node_t *nodep, const char *name,
+    aoff64_t pos, int rc)
+{
+	char key[FAT_LFN_NAME_SIZE];
+
+	if (rc != EOK || !fat_dcache_key(key, name))
+		fs_dcache_add(&nodep->dcache, NULL, pos);
+	else
+		fs_dcache_add(&nodep->dcache, key, pos);
+}
+
+/** Remove a name from the directory lookup cache.
+ *
+ * @param nodep		Directory node.
+ * @param name		Name of the removed entry.
+ * @param pos		Position of the short name dentry of the removed entry.
+ */
+void fat_directory_cache_remove(fat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	char key[FAT_LFN_NAME_SIZE];
+	char alt[FAT_LFN_NAME_SIZE];
+
+	if (!fat_dcache_key(key, name))
+		fs_dcache_remove(&nodep->dcache, NULL, NULL, pos);
+	else
+		fs_dcache_remove(&nodep->dcache, key,
+		    fat_dcache_key_alt(alt, key) ? alt : NULL, pos);
+}
+
+/** Free the lookup cache of a directory node.
+ *
+ * Must be called before the node structure is freed or reused.
+ */
+void fat_directory_cache_destroy(fat_node_t *nodep)
+{
+	fs_dcache_invalidate(&nodep->dcache);
+}
 
 int fat_directory_open(fat_node_t *nodep, fat_directory_t *di)
 {
@@ -265,7 +353,8 @@ int fat_directory_erase(fat_directory_t *di)
 	return EOK;
 }
 
-int fat_directory_write(fat_directory_t *di, const char *name, fat_dentry_t *de)
+static int fat_directory_write_entries(fat_directory_t *di, const char *name,
+    fat_dentry_t *de)
 {
 	int rc;
 	void *data;
@@ -346,6 +435,17 @@ int fat_directory_write(fat_directory_t *di, const char *name, fat_dentry_t *de)
 	return ENOTSUP;
 }
 
+int fat_directory_write(fat_directory_t *di, const char *name, fat_dentry_t *de)
+{
+	int rc;
+
+	rc = fat_directory_write_entries(di, name, de);
+	if (rc != EEXIST && rc != ENOTSUP)
+		fat_directory_cache_add(di->nodep, name, di->pos, rc);
+
+	return rc;
+}
+
 int fat_directory_create_sfn(fat_directory_t *di, fat_dentry_t *de,
     const char *lname)
 {
@@ -419,8 +519,8 @@ int fat_directory_expand(fat_directory_t *di)
 		/* Can't grow the root directory on FAT12/16. */
 		return ENOSPC;
 	}
-	rc = fat_alloc_clusters(di->bs, di->nodep->idx->service_id, 1, &mcl,
-	    &lcl);
+	rc = fat_alloc_clusters(di->bs, di->nodep->idx->service_id, 1,
+	    fat_alloc_hint(di->bs, di->nodep), &mcl, &lcl);
 	if (rc != EOK)
 		return rc;
 	rc = fat_zero_cluster(di->bs, di->nodep->idx->service_id, mcl);
@@ -482,22 +582,126 @@ int fat_directory_lookup_free(fat_directory_t *di, size_t count)
 	return ENOSPC;
 }
 
-int fat_directory_lookup_name(fat_directory_t *di, const char *name,
-    fat_dentry_t **de)
+/** Scan the whole directory and build its lookup cache.
+ *
+ * The scan also looks for the requested name, so that the directory is not
+ * read twice when the cache cannot be built.
+ *
+ * @param di		Directory.
+ * @param key		Lookup cache key of the requested name.
+ * @param alt		Alternative key of the requested name or NULL.
+ * @param pos		Output argument holding the position of the short name
+ *			dentry of the requested entry.
+ *
+ * @return		EOK if the name was found, ENOENT if it is not
+ *			present or a negative error code.
+ */
+static int fat_directory_cache_build(fat_directory_t *di, const char *key,
+    const char *alt, aoff64_t *pos)
 {
-	char entry[FAT_LFN_NAME_SIZE];
+	char name[FAT_LFN_NAME_SIZE];
+	char ekey[FAT_LFN_NAME_SIZE];
+	fat_node_t *nodep = di->nodep;
+	fs_dcache_t *dc;
+	fat_dentry_t *d;
+	unsigned gen;
+	bool alt_found = false;
+	aoff64_t alt_pos = 0;
+	int rc = ENOENT;
+	int erc;
+
+	gen = fs_dcache_gen(&nodep->dcache);
+	dc = fs_dcache_create();
 
 	fat_directory_seek(di, 0);
-	while (fat_directory_read(di, entry, de) == EOK) {
-		if (fat_dentry_namecmp(entry, name) == 0) {
-			return EOK;
-		} else {
-			if (fat_directory_next(di) != EOK)
-				break;
+	while ((erc = fat_directory_read(di, name, &d)) == EOK) {
+		/*
+		 * A name without a key cannot be looked up, so the cache stays
+		 * complete without it.
+		 */
+		if (fat_dcache_key(ekey, name)) {
+			if (rc == ENOENT && str_cmp(ekey, key) == 0) {
+				*pos = di->pos;
+				rc = EOK;
+			} else if (!alt_found && alt &&
+			    str_cmp(ekey, alt) == 0) {
+				alt_pos = di->pos;
+				alt_found = true;
+			}
+
+			if (dc && fs_dcache_insert(dc, ekey, di->pos) != EOK) {
+				/* Too large to be cached. */
+				fs_dcache_free(dc);
+				dc = NULL;
+			}
 		}
+
+		erc = fat_directory_next(di);
+		if (erc != EOK)
+			break;
 	}
 
-	return ENOENT;
+	if (dc) {
+		if (erc == ENOENT)
+			fs_dcache_attach(&nodep->dcache, dc, gen);
+		else {
+			/* The scan did not reach the end of the directory. */
+			fs_dcache_free(dc);
+		}
+	}
+
+	if (rc == ENOENT && alt_found) {
+		*pos = alt_pos;
+		rc = EOK;
+	}
+
+	return rc;
+}
+
+/** Find a directory entry by name.
+ *
+ * The lookup uses the lookup cache of the directory, which is built on the
+ * first lookup.
+ *
+ * @param di		Directory.
+ * @param name		Name of the entry to look for.
+ * @param de		Output argument holding the short name dentry.
+ *
+ * @return		EOK on success with di positioned at the short name
+ *			dentry, ENOENT if the name is not present or a
+ *			negative error code.
+ */
+int fat_directory_lookup_name(fat_directory_t *di, const char *name,
+    fat_dentry_t **de)
+{
+	char key[FAT_LFN_NAME_SIZE];
+	char alt[FAT_LFN_NAME_SIZE];
+	bool has_alt;
+	aoff64_t pos = 0;
+	int rc;
+
+	if (!fat_dcache_key(key, name))
+		return ENOENT;
+	has_alt = fat_dcache_key_alt(alt, key);
+
+	rc = fs_dcache_lookup(&di->nodep->dcache, key, has_alt ? alt : NULL,
+	    &pos);
+	if (rc == EAGAIN)
+		rc = fat_directory_cache_build(di, key, has_alt ? alt : NULL,
+		    &pos);
+	if (rc != EOK)
+		return rc;
+
+	rc = fat_directory_seek(di, pos);
+	if (rc != EOK)
+		return rc;
+	rc = fat_directory_get(di, de);
+	if (rc != EOK)
+		return rc;
+	if (fat_classify_dentry(*de) != FAT_DENTRY_VALID)
+		return EIO;
+
+	return EOK;
 }
 
 bool fat_directory_is_sfn_exist(fat_directory_t *di, fat_dentry_t *de)
@@ -72,6 +72,9 @@ extern int fat_directory_create_sfn(fat_directory_t *, fat_dentry_t *,
     const char *);
 extern int fat_directory_expand(fat_directory_t *);
 
+extern void fat_directory_cache_remove(fat_node_t *, const char *, aoff64_t);
+extern void fat_directory_cache_destroy(fat_node_t *);
+
 #endif
 
 /**
@@ -52,10 +52,16 @@
 
 #define IS_ODD(number)	(number & 0x1)
 
+/** Initial number of entries in a node's extent map. */
+#define FAT_EXTENTS_INIT	8
+/** Maximum number of entries in a node's extent map. */
+#define FAT_EXTENTS_MAX		4096
+
 /**
  * The fat_alloc_lock mutex protects all copies of the File Allocation Table
- * during allocation of clusters. The lock does not have to be held durring
- * deallocation of clusters.
+ * during allocation of clusters as well as the free cluster bitmaps of all
+ * instances. The lock does not have to be held durring deallocation of
+ * clusters in the FAT.
  */
 static FIBRIL_MUTEX_INITIALIZE(fat_alloc_lock);
 
@@ -112,6 +118,149 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Add a physical cluster to the end of the node's extent map.
+ *
+ * The node's extents_lock must be held by the caller.
+ *
+ * @param nodep		FAT node.
+ * @param pcl		Physical cluster following the last mapped cluster.
+ *
+ * @return		EOK on success or ENOMEM if the map cannot grow.
+ */
+static int fat_extent_append(fat_node_t *nodep, fat_cluster_t pcl)
+{
+	fat_extent_t *last = NULL;
+	uint32_t lcl = 0;
+
+	if (nodep->extents_cnt > 0) {
+		last = &nodep->extents[nodep->extents_cnt - 1];
+		lcl = last->lcl + last->len;
+		if (last->pcl + last->len == pcl) {
+			/* The cluster extends the last run. */
+			last->len++;
+			return EOK;
+		}
+	}
+
+	if (nodep->extents_cnt == nodep->extents_size) {
+		size_t size;
+		fat_extent_t *extents;
+
+		if (nodep->extents_size == FAT_EXTENTS_MAX)
+			return ENOMEM;
+		size = nodep->extents_size ? 2 * nodep->extents_size :
+		    FAT_EXTENTS_INIT;
+		extents = realloc(nodep->extents, size * sizeof(fat_extent_t));
+		if (!extents)
+			return ENOMEM;
+		nodep->extents = extents;
+		nodep->extents_size = size;
+	}
+
+	nodep->extents[nodep->extents_cnt].lcl = lcl;
+	nodep->extents[nodep->extents_cnt].pcl = pcl;
+	nodep->extents[nodep->extents_cnt].len = 1;
+	nodep->extents_cnt++;
+
+	return EOK;
+}
+
+/** Translate logical cluster number of a node to the physical one.
+ *
+ * Clusters covered by the node's extent map are found by a binary search.
+ * Otherwise the cluster chain is walked from the last mapped cluster and
+ * the map is extended with the clusters seen on the way. Once the map
+ * reaches FAT_EXTENTS_MAX runs, the walk continues without recording.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node with at least one cluster allocated.
+ * @param lcl		Logical cluster number within the node.
+ * @param pcl		Output argument holding the physical cluster number.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int fat_extent_lookup(fat_bs_t *bs, fat_node_t *nodep, uint32_t lcl,
+    fat_cluster_t *pcl)
+{
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_extent_t *ext;
+	fat_cluster_t clst;
+	uint32_t mapped;
+	bool record = true;
+	int rc = EOK;
+
+	/*
+	 * The lock is held across the FAT walk so that concurrent lookups do
+	 * not append the same clusters twice.
+	 */
+	fibril_mutex_lock(&nodep->extents_lock);
+
+	if (nodep->extents_cnt == 0) {
+		rc = fat_extent_append(nodep, nodep->firstc);
+		if (rc != EOK)
+			goto out;
+	}
+
+	ext = &nodep->extents[nodep->extents_cnt - 1];
+	mapped = ext->lcl + ext->len;
+
+	if (lcl < mapped) {
+		size_t lo = 0;
+		size_t hi = nodep->extents_cnt - 1;
+
+		while (lo < hi) {
+			size_t mid = (lo + hi + 1) / 2;
+
+			if (nodep->extents[mid].lcl <= lcl)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+
+		ext = &nodep->extents[lo];
+		*pcl = ext->pcl + (lcl - ext->lcl);
+		goto out;
+	}
+
+	clst = ext->pcl + ext->len - 1;
+	while (mapped <= lcl) {
+		rc = fat_get_cluster(bs, nodep->idx->service_id, FAT1, clst,
+		    &clst);
+		if (rc != EOK)
+			goto out;
+		if (clst < FAT_CLST_FIRST || clst >= clst_last1) {
+			rc = ELIMIT;
+			goto out;
+		}
+
+		if (record && fat_extent_append(nodep, clst) != EOK)
+			record = false;
+		mapped++;
+	}
+
+	*pcl = clst;
+out:
+	fibril_mutex_unlock(&nodep->extents_lock);
+	return rc;
+}
+
+/** Drop the extent map of a node.
+ *
+ * Must be called whenever the node's cluster chain is shortened or the node
+ * structure is about to be freed or reused.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_extents_invalidate(fat_node_t *nodep)
+{
+	fibril_mutex_lock(&nodep->extents_lock);
+	free(nodep->extents);
+	nodep->extents = NULL;
+	nodep->extents_cnt = 0;
+	nodep->extents_size = 0;
+	fibril_mutex_unlock(&nodep->extents_lock);
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +275,16 @@ int
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
-	fat_cluster_t currc;
-	aoff64_t relbn = bn;
+	fat_cluster_t c;
 	int rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,29 +296,12 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-	}
-
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
+	rc = fat_extent_lookup(bs, nodep, bn / SPC(bs), &c);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id, CLBN2PBN(bs, c, bn),
+	    flags);
 }
 
 /** Read block from file located on a FAT file system.
@@ -626,17 +758,356 @@ fat_set_cluster(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	return rc;
 }
 
-/** Replay the allocatoin of clusters in all shadow instances of FAT.
+/** Number of clusters described by one word of the free cluster bitmap. */
+#define FAT_BITMAP_WORD_BITS	32
+
+/** Get the index of a cluster in the free cluster bitmap. */
+#define FAT_BITMAP_IDX(clst)	((clst) - FAT_CLST_FIRST)
+
+static inline bool fat_bitmap_is_free(fat_instance_t *instance,
+    fat_cluster_t clst)
+{
+	uint32_t i = FAT_BITMAP_IDX(clst);
+
+	return (instance->free_bitmap[i / FAT_BITMAP_WORD_BITS] &
+	    (1U << (i % FAT_BITMAP_WORD_BITS))) != 0;
+}
+
+static inline void fat_bitmap_set(fat_instance_t *instance,
+    fat_cluster_t clst, bool free)
+{
+	uint32_t i = FAT_BITMAP_IDX(clst);
+	uint32_t mask = 1U << (i % FAT_BITMAP_WORD_BITS);
+
+	if (free) {
+		instance->free_bitmap[i / FAT_BITMAP_WORD_BITS] |= mask;
+		instance->free_clusters++;
+	} else {
+		instance->free_bitmap[i / FAT_BITMAP_WORD_BITS] &= ~mask;
+		instance->free_clusters--;
+	}
+}
+
+/** Find the first free cluster in a range of clusters.
+ *
+ * Words of the bitmap describing only used clusters are skipped at once.
+ *
+ * @param instance	FAT instance.
+ * @param clst		First cluster of the range.
+ * @param end		Cluster following the last cluster of the range.
+ *
+ * @return		Free cluster or FAT_CLST_RES0 if there is none.
+ */
+static fat_cluster_t fat_bitmap_find(fat_instance_t *instance,
+    fat_cluster_t clst, fat_cluster_t end)
+{
+	uint32_t i = FAT_BITMAP_IDX(clst);
+	uint32_t n = FAT_BITMAP_IDX(end);
+
+	while (i < n) {
+		uint32_t word = instance->free_bitmap[i / FAT_BITMAP_WORD_BITS] >>
+		    (i % FAT_BITMAP_WORD_BITS);
+		if (word == 0) {
+			i = ALIGN_DOWN(i, FAT_BITMAP_WORD_BITS) +
+			    FAT_BITMAP_WORD_BITS;
+			continue;
+		}
+
+		while ((word & 1) == 0) {
+			word >>= 1;
+			i++;
+		}
+
+		return (i < n) ? i + FAT_CLST_FIRST : FAT_CLST_RES0;
+	}
+
+	return FAT_CLST_RES0;
+}
+
+/** Count free clusters forming a contiguous run.
+ *
+ * @param instance	FAT instance.
+ * @param clst		First cluster of the run.
+ * @param end		Cluster following the last cluster of the file system.
+ * @param max		Maximum number of clusters to count.
+ *
+ * @return		Number of free clusters in the run.
+ */
+static unsigned fat_bitmap_run(fat_instance_t *instance, fat_cluster_t clst,
+    fat_cluster_t end, unsigned max)
+{
+	unsigned cnt = 0;
+
+	while ((cnt < max) && (clst + cnt < end) &&
+	    (fat_bitmap_is_free(instance, clst + cnt)))
+		cnt++;
+
+	return cnt;
+}
+
+/** Find a run of free clusters using the next-fit strategy.
+ *
+ * @param instance	FAT instance.
+ * @param start		Cluster where to start the search.
+ * @param end		Cluster following the last cluster of the file system.
+ * @param nclsts	Length of the run.
+ *
+ * @return		First cluster of the run or FAT_CLST_RES0 if there is
+ *			no such run.
+ */
+static fat_cluster_t fat_bitmap_find_run(fat_instance_t *instance,
+    fat_cluster_t start, fat_cluster_t end, unsigned nclsts)
+{
+	fat_cluster_t from = start;
+	fat_cluster_t to = end;
+	unsigned pass;
+
+	for (pass = 0; pass < 2; pass++) {
+		fat_cluster_t clst = fat_bitmap_find(instance, from, to);
+
+		while (clst != FAT_CLST_RES0) {
+			unsigned run = fat_bitmap_run(instance, clst, end,
+			    nclsts);
+			if (run == nclsts)
+				return clst;
+			clst = fat_bitmap_find(instance, clst + run, to);
+		}
+
+		/* Wrap around. */
+		from = FAT_CLST_FIRST;
+		to = start;
+	}
+
+	return FAT_CLST_RES0;
+}
+
+/** Choose free clusters for an allocation and mark them as used.
+ *
+ * Clusters following the hint are preferred so that a growing file stays
+ * contiguous. The rest is taken from the first contiguous run which is long
+ * enough, searching from the end of the previous allocation. Only if there is
+ * no such run, the free clusters are gathered one by one.
+ *
+ * @param instance	FAT instance.
+ * @param end		Cluster following the last cluster of the file system.
+ * @param hint		Preferred first cluster or FAT_CLST_RES0.
+ * @param nclsts	Number of clusters to choose.
+ * @param clsts		Array where the chosen clusters will be stored.
+ */
+static void fat_bitmap_alloc(fat_instance_t *instance, fat_cluster_t end,
+    fat_cluster_t hint, unsigned nclsts, fat_cluster_t *clsts)
+{
+	fat_cluster_t start = instance->next_free;
+	fat_cluster_t clst;
+	unsigned found = 0;
+
+	assert(instance->free_clusters >= nclsts);
+
+	if ((start < FAT_CLST_FIRST) || (start >= end))
+		start = FAT_CLST_FIRST;
+
+	if ((hint >= FAT_CLST_FIRST) && (hint < end)) {
+		start = hint;
+		while ((found < nclsts) && (hint + found < end) &&
+		    (fat_bitmap_is_free(instance, hint + found))) {
+			clsts[found] = hint + found;
+			fat_bitmap_set(instance, clsts[found], false);
+			found++;
+		}
+	}
+
+	if (found < nclsts) {
+		clst = fat_bitmap_find_run(instance, start, end,
+		    nclsts - found);
+		if (clst != FAT_CLST_RES0) {
+			while (found < nclsts) {
+				clsts[found++] = clst;
+				fat_bitmap_set(instance, clst++, false);
+			}
+		}
+	}
+
+	clst = start;
+	while (found < nclsts) {
+		clst = fat_bitmap_find(instance, clst, end);
+		if (clst == FAT_CLST_RES0)
+			clst = fat_bitmap_find(instance, FAT_CLST_FIRST, end);
+		assert(clst != FAT_CLST_RES0);
+
+		clsts[found++] = clst;
+		fat_bitmap_set(instance, clst, false);
+	}
+
+	instance->next_free = clsts[nclsts - 1] + 1;
+}
+
+/** Build the free cluster bitmap of a file system instance.
+ *
+ * The first FAT is scanned once and the number of free clusters is counted.
+ * The search for free clusters starts at the hint stored in the FAT32 file
+ * system information sector, if there is a valid one.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param instance	FAT instance.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int fat_alloc_init(fat_bs_t *bs, service_id_t service_id,
+    fat_instance_t *instance)
+{
+	fat_cluster_t end = CC(bs) + FAT_CLST_FIRST;
+	fat_cluster_t clst, value;
+	int rc;
+
+	instance->free_bitmap = calloc(ALIGN_UP(CC(bs), FAT_BITMAP_WORD_BITS) /
+	    FAT_BITMAP_WORD_BITS, sizeof(uint32_t));
+	if (!instance->free_bitmap)
+		return ENOMEM;
+	instance->free_clusters = 0;
+	instance->next_free = FAT_CLST_FIRST;
+
+	if (FAT_IS_FAT12(bs)) {
+		/* FAT12 entries straddle sectors, but there are only few. */
+		for (clst = FAT_CLST_FIRST; clst < end; clst++) {
+			rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
+			if (rc != EOK)
+				goto error;
+			if (value == FAT_CLST_RES0)
+				fat_bitmap_set(instance, clst, true);
+		}
+	} else {
+		size_t csize = FAT_CLST_SIZE(bs);
+		size_t per_sector = BPS(bs) / csize;
+		size_t sectors = ROUND_UP(end * csize, BPS(bs)) / BPS(bs);
+		size_t sector;
+		uint8_t *buf;
+
+		/* Read as many sectors at once as fit the communication area. */
+		size_t chunk = FAT_COMM_SIZE / BPS(bs);
+
+		buf = malloc(chunk * BPS(bs));
+		if (!buf) {
+			rc = ENOMEM;
+			goto error;
+		}
+
+		/*
+		 * The block cache does not hold any modified FAT blocks yet,
+		 * so read the FAT directly without polluting the cache.
+		 */
+		for (sector = 0; sector < sectors; sector += chunk) {
+			size_t cnt = min(chunk, sectors - sector);
+			rc = block_read_direct(service_id, RSCNT(bs) + sector,
+			    cnt, buf);
+			if (rc != EOK) {
+				free(buf);
+				goto error;
+			}
+
+			clst = sector * per_sector;
+			if (clst < FAT_CLST_FIRST)
+				clst = FAT_CLST_FIRST;
+			for (; (clst < (sector + cnt) * per_sector) &&
+			    (clst < end); clst++) {
+				size_t i = clst - sector * per_sector;
+				if (FAT_IS_FAT32(bs)) {
+					value = uint32_t_le2host(
+					    ((uint32_t *) buf)[i]) & FAT32_MASK;
+				} else {
+					value = uint16_t_le2host(
+					    ((uint16_t *) buf)[i]);
+				}
+				if (value == FAT_CLST_RES0)
+					fat_bitmap_set(instance, clst, true);
+			}
+		}
+
+		free(buf);
+	}
+
+	if (FAT_IS_FAT32(bs)) {
+		fat32_fsinfo_t *info;
+		block_t *b;
+
+		rc = block_get(&b, service_id,
+		    uint16_t_le2host(bs->fat32.fsinfo_sec), BLOCK_FLAGS_NONE);
+		if (rc != EOK)
+			goto error;
+
+		info = (fat32_fsinfo_t *) b->data;
+		if (!bcmp(info->sig1, FAT32_FSINFO_SIG1, sizeof(info->sig1)) &&
+		    !bcmp(info->sig2, FAT32_FSINFO_SIG2, sizeof(info->sig2)) &&
+		    !bcmp(info->sig3, FAT32_FSINFO_SIG3, sizeof(info->sig3))) {
+			clst = uint32_t_le2host(info->last_allocated_cluster);
+			if ((clst >= FAT_CLST_FIRST) && (clst < end))
+				instance->next_free = clst;
+		}
+
+		rc = block_put(b);
+		if (rc != EOK)
+			goto error;
+	}
+
+	return EOK;
+
+error:
+	free(instance->free_bitmap);
+	instance->free_bitmap = NULL;
+	return rc;
+}
+
+/** Release the free cluster bitmap of a file system instance.
+ *
+ * @param instance	FAT instance.
+ */
+void fat_alloc_fini(fat_instance_t *instance)
+{
+	free(instance->free_bitmap);
+	instance->free_bitmap = NULL;
+}
+
+/** Suggest where to allocate clusters which are to be appended to a node.
+ *
+ * The last cluster of the node is looked up and cached for the subsequent
+ * fat_append_clusters(), which would have to look it up anyway.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		Node which is to be extended.
+ *
+ * @return		Cluster following the last cluster of the node or
+ *			FAT_CLST_RES0 if there is no preference.
+ */
+fat_cluster_t fat_alloc_hint(fat_bs_t *bs, fat_node_t *nodep)
+{
+	fat_cluster_t lastc;
+
+	/* The node has no clusters or it is the FAT12/16 root directory. */
+	if (nodep->firstc < FAT_CLST_FIRST)
+		return FAT_CLST_RES0;
+
+	if (!nodep->lastc_cached_valid) {
+		if (fat_cluster_walk(bs, nodep->idx->service_id, nodep->firstc,
+		    &lastc, NULL, (uint32_t) -1) != EOK)
+			return FAT_CLST_RES0;
+		nodep->lastc_cached_valid = true;
+		nodep->lastc_cached_value = lastc;
+	}
+
+	return nodep->lastc_cached_value + 1;
+}
+
+/** Replay the allocation of clusters in all shadow instances of FAT.
  *
  * @param bs		Buffer holding the boot sector of the file system.
  * @param service_id	Service ID of the file system.
- * @param lifo		Chain of allocated clusters.
- * @param nclsts	Number of clusters in the lifo chain.
+ * @param clsts		Allocated clusters in the order of the chain.
+ * @param nclsts	Number of clusters in the chain.
  *
  * @return		EOK on success or a negative error code.
  */
 int fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
-    fat_cluster_t *lifo, unsigned nclsts)
+    fat_cluster_t *clsts, unsigned nclsts)
 {
 	uint8_t fatno;
 	unsigned c;
@@ -645,8 +1116,8 @@ int fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
 
 	for (fatno = FAT1 + 1; fatno < FATCNT(bs); fatno++) {
 		for (c = 0; c < nclsts; c++) {
-			rc = fat_set_cluster(bs, service_id, fatno, lifo[c],
-			    c == 0 ? clst_last1 : lifo[c - 1]);
+			rc = fat_set_cluster(bs, service_id, fatno, clsts[c],
+			    c == nclsts - 1 ? clst_last1 : clsts[c + 1]);
 			if (rc != EOK)
 				return rc;
 		}
@@ -660,11 +1131,15 @@ int fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
  * This function will attempt to allocate the requested number of clusters in
  * all instances of the FAT.  The FAT will be altered so that the allocated
  * clusters form an independent chain (i.e. a chain which does not belong to any
- * file yet).
+ * file yet). Free clusters are looked up in the in-memory free cluster bitmap
+ * rather than in the FAT.
  *
  * @param bs		Buffer holding the boot sector of the file system.
  * @param service_id	Device service ID of the file system.
  * @param nclsts	Number of clusters to allocate.
+ * @param hint		Preferred first cluster of the chain, usually the one
+ *			following the last cluster of the file which is to be
+ *			extended, or FAT_CLST_RES0 if there is no preference.
  * @param mcl		Output parameter where the first cluster in the chain
  *			will be returned.
  * @param lcl		Output parameter where the last cluster in the chain
@@ -674,60 +1149,61 @@ int fat_alloc_shadow_clusters(fat_bs_t *bs, service_id_t service_id,
  */
 int
 fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
-    fat_cluster_t *mcl, fat_cluster_t *lcl)
+    fat_cluster_t hint, fat_cluster_t *mcl, fat_cluster_t *lcl)
 {
-	fat_cluster_t *lifo;    /* stack for storing free cluster numbers */
-	unsigned found = 0;     /* top of the free cluster number stack */
-	fat_cluster_t clst, value, clst_last1 = FAT_CLST_LAST1(bs);
-	int rc = EOK;
+	fat_instance_t *instance;
+	fat_cluster_t *clsts;	/* allocated clusters in the chain order */
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	unsigned c, set = 0;
+	int rc;
 
-	lifo = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
-	if (!lifo)
+	rc = fs_instance_get(service_id, (void **) &instance);
+	if (rc != EOK)
+		return rc;
+
+	clsts = (fat_cluster_t *) malloc(nclsts * sizeof(fat_cluster_t));
+	if (!clsts)
 		return ENOMEM;
-	
-	/*
-	 * Search FAT1 for unused clusters.
-	 */
+
 	fibril_mutex_lock(&fat_alloc_lock);
-	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
-	    clst++) {
-		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
-		if (rc != EOK)
-			break;
+	if (instance->free_clusters < nclsts) {
+		fibril_mutex_unlock(&fat_alloc_lock);
+		free(clsts);
+		return ENOSPC;
+	}
 
-		if (value == FAT_CLST_RES0) {
-			/*
-			 * The cluster is free. Put it into our stack
-			 * of found clusters and mark it as non-free.
-			 */
-			lifo[found] = clst;
-			rc = fat_set_cluster(bs, service_id, FAT1, clst,
-			    (found == 0) ?  clst_last1 : lifo[found - 1]);
-			if (rc != EOK)
-				break;
+	fat_bitmap_alloc(instance, CC(bs) + FAT_CLST_FIRST, hint, nclsts,
+	    clsts);
 
-			found++;
-		}
+	/* Link the clusters into a chain in FAT1. */
+	for (c = 0; c < nclsts; c++) {
+		rc = fat_set_cluster(bs, service_id, FAT1, clsts[c],
+		    c == nclsts - 1 ? clst_last1 : clsts[c + 1]);
+		if (rc != EOK)
+			break;
+		set++;
 	}
 
-	if (rc == EOK && found == nclsts) {
-		rc = fat_alloc_shadow_clusters(bs, service_id, lifo, nclsts);
+	if (rc == EOK) {
+		rc = fat_alloc_shadow_clusters(bs, service_id, clsts, nclsts);
 		if (rc == EOK) {
-			*mcl = lifo[found - 1];
-			*lcl = lifo[0];
-			free(lifo);
+			*mcl = clsts[0];
+			*lcl = clsts[nclsts - 1];
+			free(clsts);
 			fibril_mutex_unlock(&fat_alloc_lock);
 			return EOK;
 		}
 	}
 
 	/* If something wrong - free the clusters */
-	while (found--) {
-		(void) fat_set_cluster(bs, service_id, FAT1, lifo[found],
+	for (c = 0; c < set; c++) {
+		(void) fat_set_cluster(bs, service_id, FAT1, clsts[c],
 		    FAT_CLST_RES0);
 	}
+	for (c = 0; c < nclsts; c++)
+		fat_bitmap_set(instance, clsts[c], true);
 
-	free(lifo);
+	free(clsts);
 	fibril_mutex_unlock(&fat_alloc_lock);
 
 	return ENOSPC;
@@ -744,10 +1220,15 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 int
 fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 {
+	fat_instance_t *instance;
 	unsigned fatno;
 	fat_cluster_t nextc, clst_bad = FAT_CLST_BAD(bs);
 	int rc;
 
+	rc = fs_instance_get(service_id, (void **) &instance);
+	if (rc != EOK)
+		return rc;
+
 	/* Mark all clusters in the chain as free in all copies of FAT. */
 	while (firstc < FAT_CLST_LAST1(bs)) {
 		assert(firstc >= FAT_CLST_FIRST && firstc < clst_bad);
@@ -763,6 +1244,14 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 				return rc;
 		}
 
+		/*
+		 * The cluster can be reused only after it has been freed in
+		 * all copies of FAT.
+		 */
+		fibril_mutex_lock(&fat_alloc_lock);
+		fat_bitmap_set(instance, firstc, true);
+		fibril_mutex_unlock(&fat_alloc_lock);
+
 		firstc = nextc;
 	}
 
@@ -835,8 +1324,7 @@ int fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
+	fat_extents_invalidate(nodep);
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
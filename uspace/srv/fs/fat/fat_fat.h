@@ -102,6 +102,7 @@
 struct block;
 struct fat_node;
 struct fat_bs;
+struct fat_instance;
 
 typedef uint32_t fat_cluster_t;
 
@@ -112,6 +113,7 @@ extern int fat_cluster_walk(struct fat_bs *, service_id_t, fat_cluster_t,
 
 extern int fat_block_get(block_t **, struct fat_bs *, struct fat_node *,
     aoff64_t, int);
+extern void fat_extents_invalidate(struct fat_node *);
 extern int _fat_block_get(block_t **, struct fat_bs *, service_id_t,
     fat_cluster_t, fat_cluster_t *, aoff64_t, int);
 
@@ -119,8 +121,12 @@ extern int fat_append_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t, fat_cluster_t);
 extern int fat_chop_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t);
+extern int fat_alloc_init(struct fat_bs *, service_id_t,
+    struct fat_instance *);
+extern void fat_alloc_fini(struct fat_instance *);
+extern fat_cluster_t fat_alloc_hint(struct fat_bs *, struct fat_node *);
 extern int fat_alloc_clusters(struct fat_bs *, service_id_t, unsigned,
-    fat_cluster_t *, fat_cluster_t *);
+    fat_cluster_t, fat_cluster_t *, fat_cluster_t *);
 extern int fat_free_clusters(struct fat_bs *, service_id_t, fat_cluster_t);
 extern int fat_alloc_shadow_clusters(struct fat_bs *, service_id_t,
     fat_cluster_t *, unsigned);
@@ -84,6 +84,7 @@ static int fat_destroy_node(fs_node_t *);
 static int fat_link(fs_node_t *, fs_node_t *, const char *);
 static int fat_unlink(fs_node_t *, fs_node_t *, const char *);
 static int fat_has_children(bool *, fs_node_t *);
+static int fat_readdir(fs_node_t *, aoff64_t, libfs_readdir_cb_t, void *);
 static fs_index_t fat_index_get(fs_node_t *);
 static aoff64_t fat_size_get(fs_node_t *);
 static unsigned fat_lnkcnt_get(fs_node_t *);
@@ -107,9 +108,11 @@ static void fat_node_initialize(fat_node_t *node)
 	node->dirty = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	fibril_mutex_initialize(&node->extents_lock);
+	node->extents = NULL;
+	node->extents_cnt = 0;
+	node->extents_size = 0;
+	fs_dcache_node_initialize(&node->dcache);
 }
 
 static int fat_node_sync(fat_node_t *node)
@@ -193,6 +196,8 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_extents_invalidate(nodep);
+		fat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -231,12 +236,16 @@ static int fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_extents_invalidate(nodep);
+				fat_directory_cache_destroy(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		fat_extents_invalidate(nodep);
+		fat_directory_cache_destroy(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -370,10 +379,41 @@ int fat_root_get(fs_node_t **rfn, service_id_t service_id)
 	return fat_node_get(rfn, service_id, 0);
 }
 
+/** Get the node described by the current entry of a directory.
+ *
+ * @param rfn        Place to store the node.
+ * @param parentp    Directory being read.
+ * @param service_id Service ID of the file system instance.
+ * @param di         Directory positioned at the entry.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int fat_node_get_by_dentry(fs_node_t **rfn, fat_node_t *parentp,
+    service_id_t service_id, fat_directory_t *di)
+{
+	fat_node_t *nodep;
+	aoff64_t o = di->pos % (BPS(di->bs) / sizeof(fat_dentry_t));
+	fat_idx_t *idx = fat_idx_get_by_pos(service_id, parentp->firstc,
+	    di->bnum * DPS(di->bs) + o);
+	if (!idx) {
+		/*
+		 * Can happen if memory is low or if we
+		 * run out of 32-bit indices.
+		 */
+		return ENOMEM;
+	}
+	int rc = fat_node_get_core(&nodep, idx);
+	fibril_mutex_unlock(&idx->lock);
+	if (rc != EOK)
+		return rc;
+	*rfn = FS_NODE(nodep);
+	return EOK;
+}
+
 int fat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
 	fat_node_t *parentp = FAT_NODE(pfn);
-	char name[FAT_LFN_NAME_SIZE];
 	fat_dentry_t *d;
 	service_id_t service_id;
 	int rc;
@@ -387,40 +427,22 @@ int fat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	if (rc != EOK)
 		return rc;
 
-	while (fat_directory_read(&di, name, &d) == EOK) {
-		if (fat_dentry_namecmp(name, component) == 0) {
-			/* hit */
-			fat_node_t *nodep;
-			aoff64_t o = di.pos %
-			    (BPS(di.bs) / sizeof(fat_dentry_t));
-			fat_idx_t *idx = fat_idx_get_by_pos(service_id,
-			    parentp->firstc, di.bnum * DPS(di.bs) + o);
-			if (!idx) {
-				/*
-				 * Can happen if memory is low or if we
-				 * run out of 32-bit indices.
-				 */
-				rc = fat_directory_close(&di);
-				return (rc == EOK) ? ENOMEM : rc;
-			}
-			rc = fat_node_get_core(&nodep, idx);
-			fibril_mutex_unlock(&idx->lock);
-			if (rc != EOK) {
-				(void) fat_directory_close(&di);
-				return rc;
-			}
-			*rfn = FS_NODE(nodep);
-			rc = fat_directory_close(&di);
-			if (rc != EOK)
-				(void) fat_node_put(*rfn);
+	rc = fat_directory_lookup_name(&di, component, &d);
+	if (rc == EOK) {
+		/* hit */
+		rc = fat_node_get_by_dentry(rfn, parentp, service_id, &di);
+		if (rc != EOK) {
+			(void) fat_directory_close(&di);
 			return rc;
-		} else {
-			rc = fat_directory_next(&di);
-			if (rc != EOK)
-				break;
 		}
+		rc = fat_directory_close(&di);
+		if (rc != EOK)
+			(void) fat_node_put(*rfn);
+		return rc;
 	}
 	(void) fat_directory_close(&di);
+	if (rc != ENOENT)
+		return rc;
 	*rfn = NULL;
 	return EOK;
 }
@@ -477,6 +499,8 @@ int fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_extents_invalidate(nodep);
+		fat_directory_cache_destroy(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -494,7 +518,8 @@ int fat_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 	bs = block_bb_get(service_id);
 	if (flags & L_DIRECTORY) {
 		/* allocate a cluster */
-		rc = fat_alloc_clusters(bs, service_id, 1, &mcl, &lcl);
+		rc = fat_alloc_clusters(bs, service_id, 1, FAT_CLST_RES0, &mcl,
+		    &lcl);
 		if (rc != EOK)
 			return rc;
 		/* populate the new cluster with unused dentries */
@@ -570,6 +595,8 @@ int fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_extents_invalidate(nodep);
+	fat_directory_cache_destroy(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -725,8 +752,11 @@ int fat_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (rc != EOK)
 		goto error;
 	rc = fat_directory_erase(&di);
-	if (rc != EOK)
+	if (rc != EOK) {
+		fat_directory_cache_destroy(parentp);
 		goto error;
+	}
+	fat_directory_cache_remove(parentp, nm, childp->idx->pdi);
 	rc = fat_directory_close(&di);
 	if (rc != EOK)
 		goto error;
@@ -811,6 +841,47 @@ int fat_has_children(bool *has_children, fs_node_t *fn)
 	return EOK;
 }
 
+int fat_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg)
+{
+	fat_node_t *nodep = FAT_NODE(fn);
+	char name[FAT_LFN_NAME_SIZE];
+	fat_dentry_t *d;
+	service_id_t service_id;
+	int rc;
+
+	fibril_mutex_lock(&nodep->idx->lock);
+	service_id = nodep->idx->service_id;
+	fibril_mutex_unlock(&nodep->idx->lock);
+
+	fat_directory_t di;
+	rc = fat_directory_open(nodep, &di);
+	if (rc != EOK)
+		return rc;
+	rc = fat_directory_seek(&di, pos);
+
+	while ((rc == EOK) &&
+	    ((rc = fat_directory_read(&di, name, &d)) == EOK)) {
+		fs_node_t *cfn;
+		rc = fat_node_get_by_dentry(&cfn, nodep, service_id, &di);
+		if (rc != EOK)
+			break;
+		if (!cb(arg, name, cfn, di.pos + 1))
+			break;
+		rc = fat_directory_next(&di);
+		if (rc != EOK)
+			break;
+	}
+
+	if (rc == ENOENT)
+		rc = EOK;
+	if (rc != EOK) {
+		(void) fat_directory_close(&di);
+		return rc;
+	}
+	return fat_directory_close(&di);
+}
+
 
 fs_index_t fat_index_get(fs_node_t *fn)
 {
@@ -854,6 +925,7 @@ libfs_ops_t fat_libfs_ops = {
 	.link = fat_link,
 	.unlink = fat_unlink,
 	.has_children = fat_has_children,
+	.readdir = fat_readdir,
 	.index_get = fat_index_get,
 	.size_get = fat_size_get,
 	.lnkcnt_get = fat_lnkcnt_get,
@@ -893,7 +965,7 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	}
 
 	/* initialize libblock */
-	rc = block_init(EXCHANGE_SERIALIZE, service_id, BS_SIZE);
+	rc = block_init(EXCHANGE_SERIALIZE, service_id, FAT_COMM_SIZE);
 	if (rc != EOK) {
 		free(instance);
 		return rc;
@@ -998,9 +1070,23 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	} else
 		rootp->size = RDE(bs) * sizeof(fat_dentry_t);
 
+	/* Build the free cluster bitmap. */
+	rc = fat_alloc_init(bs, service_id, instance);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&ridxp->lock);
+		free(instance);
+		free(rfn);
+		free(rootp);
+		(void) block_cache_fini(service_id);
+		block_fini(service_id);
+		fat_idx_fini_by_service_id(service_id);
+		return rc;
+	}
+
 	rc = fs_instance_create(service_id, instance);
 	if (rc != EOK) {
 		fibril_mutex_unlock(&ridxp->lock);
+		fat_alloc_fini(instance);
 		free(instance);
 		free(rfn);
 		free(rootp);
@@ -1027,6 +1113,7 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 static int fat_update_fat32_fsinfo(service_id_t service_id)
 {
 	fat_bs_t *bs;
+	fat_instance_t *instance;
 	fat32_fsinfo_t *info;
 	block_t *b;
 	int rc;
@@ -1034,6 +1121,10 @@ static int fat_update_fat32_fsinfo(service_id_t service_id)
 	bs = block_bb_get(service_id);
 	assert(FAT_IS_FAT32(bs));
 
+	rc = fs_instance_get(service_id, (void **) &instance);
+	if (rc != EOK)
+		return rc;
+
 	rc = block_get(&b, service_id, uint16_t_le2host(bs->fat32.fsinfo_sec),
 	    BLOCK_FLAGS_NONE);
 	if (rc != EOK)
@@ -1048,8 +1139,9 @@ static int fat_update_fat32_fsinfo(service_id_t service_id)
 		return EINVAL;
 	}
 
-	/* For now, invalidate the counter. */
-	info->free_clusters = host2uint16_t_le(-1);
+	/* Store the state of the allocator for the next mount. */
+	info->free_clusters = host2uint32_t_le(instance->free_clusters);
+	info->last_allocated_cluster = host2uint32_t_le(instance->next_free);
 
 	b->dirty = true;
 	return block_put(b);
@@ -1104,12 +1196,80 @@ static int fat_unmounted(service_id_t service_id)
 	void *data;
 	if (fs_instance_get(service_id, &data) == EOK) {
 		fs_instance_destroy(service_id);
+		fat_alloc_fini((fat_instance_t *) data);
 		free(data);
 	}
 
 	return EOK;
 }
 
+/** Read a range of a regular file.
+ *
+ * A range within one block is passed to the client directly from the block
+ * cache. A longer range is assembled from all the blocks it spans so that the
+ * whole request is satisfied at once.
+ *
+ * @param callid IPC_M_DATA_READ request to answer.
+ * @param bs     Buffer holding the boot sector of the file system.
+ * @param nodep  Node of the regular file.
+ * @param pos    Position in the file.
+ * @param size   Number of bytes to read, all of them within the file.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int fat_read_file(ipc_callid_t callid, fat_bs_t *bs, fat_node_t *nodep,
+    aoff64_t pos, size_t size)
+{
+	block_t *b;
+	int rc;
+
+	if (pos % BPS(bs) + size <= BPS(bs)) {
+		rc = fat_block_get(&b, bs, nodep, pos / BPS(bs),
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			async_answer_0(callid, rc);
+			return rc;
+		}
+		(void) async_data_read_finalize(callid,
+		    b->data + pos % BPS(bs), size);
+		return block_put(b);
+	}
+
+	uint8_t *buf = malloc(size);
+	if (!buf) {
+		async_answer_0(callid, ENOMEM);
+		return ENOMEM;
+	}
+
+	size_t done = 0;
+	while (done < size) {
+		aoff64_t cur = pos + done;
+		size_t chunk = min(size - done, BPS(bs) - cur % BPS(bs));
+
+		rc = fat_block_get(&b, bs, nodep, cur / BPS(bs),
+		    BLOCK_FLAGS_NONE);
+		if (rc != EOK) {
+			free(buf);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+		memcpy(buf + done, b->data + cur % BPS(bs), chunk);
+		rc = block_put(b);
+		if (rc != EOK) {
+			free(buf);
+			async_answer_0(callid, rc);
+			return rc;
+		}
+
+		done += chunk;
+	}
+
+	(void) async_data_read_finalize(callid, buf, size);
+	free(buf);
+	return EOK;
+}
+
 static int
 fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *rbytes)
@@ -1118,7 +1278,6 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	fat_node_t *nodep;
 	fat_bs_t *bs;
 	size_t bytes;
-	block_t *b;
 	int rc;
 
 	rc = fat_node_get(&fn, service_id, index);
@@ -1139,28 +1298,15 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	bs = block_bb_get(service_id);
 
 	if (nodep->type == FAT_FILE) {
-		/*
-		 * Our strategy for regular file reads is to read one block at
-		 * most and make use of the possibility to return less data than
-		 * requested. This keeps the code very simple.
-		 */
 		if (pos >= nodep->size) {
 			/* reading beyond the EOF */
 			bytes = 0;
 			(void) async_data_read_finalize(callid, NULL, 0);
 		} else {
-			bytes = min(len, BPS(bs) - pos % BPS(bs));
-			bytes = min(bytes, nodep->size - pos);
-			rc = fat_block_get(&b, bs, nodep, pos / BPS(bs),
-			    BLOCK_FLAGS_NONE);
-			if (rc != EOK) {
-				fat_node_put(fn);
-				async_answer_0(callid, rc);
-				return rc;
-			}
-			(void) async_data_read_finalize(callid,
-			    b->data + pos % BPS(bs), bytes);
-			rc = block_put(b);
+			/* Larger reads are short to bound the buffer size */
+			bytes = min(len, nodep->size - pos);
+			bytes = min(bytes, FAT_COMM_SIZE);
+			rc = fat_read_file(callid, bs, nodep, pos, bytes);
 			if (rc != EOK) {
 				fat_node_put(fn);
 				return rc;
@@ -1307,7 +1453,8 @@ fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 		nclsts = (ROUND_UP(pos + bytes, BPC(bs)) - boundary) / BPC(bs);
 		/* create an independent chain of nclsts clusters in all FATs */
-		rc = fat_alloc_clusters(bs, service_id, nclsts, &mcl, &lcl);
+		rc = fat_alloc_clusters(bs, service_id, nclsts,
+		    fat_alloc_hint(bs, nodep), &mcl, &lcl);
 		if (rc != EOK) {
 			/* could not allocate a chain of nclsts clusters */
 			(void) fat_node_put(fn);
@@ -382,6 +382,90 @@ static int locfs_has_children(bool *has_children, fs_node_t *fn)
 	return EOK;
 }
 
+/** Report entries of a namespace to libfs_ops_t.readdir's caller.
+ *
+ * @param desc  Descriptors of the entries.
+ * @param count Number of the descriptors.
+ * @param type  Type of the entries.
+ * @param pos   Position of the first entry to report.
+ * @param cur   Position of the first descriptor, updated to the position
+ *              following the last one.
+ * @param cb    Callback to report the entries to.
+ * @param arg   Argument of the callback.
+ * @param stop  Set to true if the callback requested to stop.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int locfs_readdir_report(loc_sdesc_t *desc, size_t count,
+    loc_object_type_t type, aoff64_t pos, aoff64_t *cur,
+    libfs_readdir_cb_t cb, void *arg, bool *stop)
+{
+	size_t i;
+	for (i = 0; i < count; i++) {
+		/* Ignore root namespace */
+		if ((type == LOC_OBJECT_NAMESPACE) &&
+		    (str_cmp(desc[i].name, "") == 0))
+			continue;
+		
+		if ((*cur)++ < pos)
+			continue;
+		
+		fs_node_t *cfn;
+		int rc = locfs_node_get_internal(&cfn, type, desc[i].id);
+		if (rc != EOK)
+			return rc;
+		
+		if (!cb(arg, desc[i].name, cfn, *cur)) {
+			*stop = true;
+			break;
+		}
+	}
+	
+	return EOK;
+}
+
+static int locfs_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg)
+{
+	locfs_node_t *node = (locfs_node_t *) fn->data;
+	service_id_t namespace;
+	loc_sdesc_t *desc;
+	size_t count;
+	aoff64_t cur = 0;
+	bool stop = false;
+	int rc = EOK;
+	
+	if (node->service_id == 0) {
+		/* Root directory */
+		count = loc_get_namespaces(&desc);
+		if (count > 0) {
+			rc = locfs_readdir_report(desc, count,
+			    LOC_OBJECT_NAMESPACE, pos, &cur, cb, arg, &stop);
+			free(desc);
+			if ((rc != EOK) || (stop))
+				return rc;
+		}
+		
+		/* Root namespace */
+		if (loc_namespace_get_id("", &namespace, 0) != EOK)
+			return EOK;
+	} else if (node->type == LOC_OBJECT_NAMESPACE) {
+		/* Namespace directory */
+		namespace = node->service_id;
+	} else
+		return ENOTDIR;
+	
+	count = loc_get_services(namespace, &desc);
+	if (count > 0) {
+		rc = locfs_readdir_report(desc, count, LOC_OBJECT_SERVICE, pos,
+		    &cur, cb, arg, &stop);
+		free(desc);
+	}
+	
+	return rc;
+}
+
 static fs_index_t locfs_index_get(fs_node_t *fn)
 {
 	locfs_node_t *node = (locfs_node_t *) fn->data;
@@ -439,6 +523,7 @@ libfs_ops_t locfs_libfs_ops = {
 	.link = locfs_link_node,
 	.unlink = locfs_unlink_node,
 	.has_children = locfs_has_children,
+	.readdir = locfs_readdir,
 	.index_get = locfs_index_get,
 	.size_get = locfs_size_get,
 	.lnkcnt_get = locfs_lnkcnt_get,
@@ -94,6 +94,9 @@ struct mfs_sb_info {
 	bool native;
 	unsigned isearch;
 	unsigned zsearch;
+	/* Number of free bits in each block of the inode and zone bitmaps */
+	uint32_t *ibmap_free;
+	uint32_t *zbmap_free;
 };
 
 /* Generic MinixFS inode */
@@ -133,6 +136,7 @@ struct mfs_instance {
 	service_id_t service_id;
 	struct mfs_sb_info *sbi;
 	unsigned open_nodes_cnt;
+	enum cache_mode cmode;
 };
 
 /* MinixFS node in core */
@@ -142,6 +146,8 @@ struct mfs_node {
 	unsigned refcnt;
 	fs_node_t *fsnode;
 	link_t link;
+	/* Link in the list of unreferenced cached nodes */
+	link_t unused_link;
 };
 
 /* mfs_ops.c */
@@ -173,6 +179,15 @@ mfs_write_map(struct mfs_node *mnode, uint32_t pos, uint32_t new_zone,
 extern int
 mfs_prune_ind_zones(struct mfs_node *mnode, size_t new_size);
 
+extern int
+mfs_ind_zones_init(void);
+
+extern int
+mfs_ind_zones_sync(struct mfs_instance *inst);
+
+extern int
+mfs_ind_zones_fini(struct mfs_instance *inst);
+
 /* mfs_dentry.c */
 extern int
 mfs_read_dentry(struct mfs_node *mnode,
@@ -188,6 +203,12 @@ extern int
 mfs_insert_dentry(struct mfs_node *mnode, const char *d_name, fs_index_t d_inum);
 
 /* mfs_balloc.c */
+extern int
+mfs_balloc_init(struct mfs_instance *inst);
+
+extern void
+mfs_balloc_fini(struct mfs_instance *inst);
+
 extern int
 mfs_alloc_inode(struct mfs_instance *inst, uint32_t *inum);
 
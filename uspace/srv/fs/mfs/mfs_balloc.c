@@ -31,18 +31,66 @@
  */
 
 #include <stdlib.h>
+#include <bitops.h>
+#include <macros.h>
 #include "mfs.h"
 
 static int
 find_free_bit_and_set(bitchunk_t *b, const int bsize,
     const bool native, unsigned start_bit);
 
+static unsigned
+count_free_bits(bitchunk_t *b, const bool native, unsigned nbits);
+
+static int
+mfs_bmap_summary(struct mfs_instance *inst, bmap_id_t bid);
+
 static int
 mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid);
 
 static int
 mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid);
 
+/**Count the free bits in each block of the inode and zone bitmaps.
+ *
+ * The allocator uses the counts to skip full bitmap blocks without
+ * reading them.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int
+mfs_balloc_init(struct mfs_instance *inst)
+{
+	int r;
+
+	inst->sbi->ibmap_free = NULL;
+	inst->sbi->zbmap_free = NULL;
+
+	r = mfs_bmap_summary(inst, BMAP_INODE);
+	if (r == EOK)
+		r = mfs_bmap_summary(inst, BMAP_ZONE);
+
+	if (r != EOK)
+		mfs_balloc_fini(inst);
+
+	return r;
+}
+
+/**Release the free bit counts of the bitmaps.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ */
+void
+mfs_balloc_fini(struct mfs_instance *inst)
+{
+	free(inst->sbi->ibmap_free);
+	free(inst->sbi->zbmap_free);
+	inst->sbi->ibmap_free = NULL;
+	inst->sbi->zbmap_free = NULL;
+}
+
 /**Allocate a new inode.
  *
  * @param inst		Pointer to the filesystem instance.
@@ -119,12 +167,15 @@ mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 	int r;
 	unsigned start_block;
 	unsigned *search;
+	uint32_t *summary;
+	uint32_t bit;
 	block_t *b;
 
 	sbi = inst->sbi;
 
 	if (bid == BMAP_ZONE) {
 		search = &sbi->zsearch;
+		summary = sbi->zbmap_free;
 		start_block = 2 + sbi->ibmap_blocks;
 		if (idx > sbi->nzones) {
 			printf(NAME ": Error! Trying to free beyond the" \
@@ -134,6 +185,7 @@ mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 	} else {
 		/* bid == BMAP_INODE */
 		search = &sbi->isearch;
+		summary = sbi->ibmap_free;
 		start_block = 2;
 		if (idx > sbi->ninodes) {
 			printf(NAME ": Error! Trying to free beyond the" \
@@ -143,21 +195,24 @@ mfs_free_bit(struct mfs_instance *inst, uint32_t idx, bmap_id_t bid)
 	}
 
 	/* Compute the bitmap block */
-	uint32_t block = idx / (sbi->block_size * 8) + start_block;
+	uint32_t block = idx / (sbi->block_size * 8);
 
-	r = block_get(&b, inst->service_id, block, BLOCK_FLAGS_NONE);
+	r = block_get(&b, inst->service_id, block + start_block,
+	    BLOCK_FLAGS_NONE);
 	if (r != EOK)
 		goto out_err;
 
 	/* Compute the bit index in the block */
-	idx %= (sbi->block_size * 8);
+	bit = idx % (sbi->block_size * 8);
 	bitchunk_t *ptr = b->data;
 	bitchunk_t chunk;
 	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
 
-	chunk = conv32(sbi->native, ptr[idx / chunk_bits]);
-	chunk &= ~(1 << (idx % chunk_bits));
-	ptr[idx / chunk_bits] = conv32(sbi->native, chunk);
+	chunk = conv32(sbi->native, ptr[bit / chunk_bits]);
+	if (chunk & (1 << (bit % chunk_bits)))
+		summary[block]++;
+	chunk &= ~(1 << (bit % chunk_bits));
+	ptr[bit / chunk_bits] = conv32(sbi->native, chunk);
 
 	b->dirty = true;
 	r = block_put(b);
@@ -187,18 +242,21 @@ mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid)
 	unsigned long nblocks;
 	unsigned *search, i, start_block;
 	unsigned bits_per_block;
+	uint32_t *summary;
 	int r, freebit;
 
 	sbi = inst->sbi;
 
 	if (bid == BMAP_ZONE) {
 		search = &sbi->zsearch;
+		summary = sbi->zbmap_free;
 		start_block = 2 + sbi->ibmap_blocks;
 		nblocks = sbi->zbmap_blocks;
 		limit = sbi->nzones - sbi->firstdatazone - 1;
 	} else {
 		/* bid == BMAP_INODE */
 		search = &sbi->isearch;
+		summary = sbi->ibmap_free;
 		start_block = 2;
 		nblocks = sbi->ibmap_blocks;
 		limit = sbi->ninodes;
@@ -210,13 +268,21 @@ mfs_alloc_bit(struct mfs_instance *inst, uint32_t *idx, bmap_id_t bid)
 retry:
 
 	for (i = *search / bits_per_block; i < nblocks; ++i) {
+		if (summary[i] == 0) {
+			/* No free bit in this block, skip it without reading */
+			continue;
+		}
+
 		r = block_get(&b, inst->service_id, i + start_block,
 		    BLOCK_FLAGS_NONE);
 
 		if (r != EOK)
 			goto out;
 
-		unsigned tmp = *search % bits_per_block;
+		/* Only the first block is searched from the hint */
+		unsigned tmp = 0;
+		if (i == *search / bits_per_block)
+			tmp = *search % bits_per_block;
 
 		freebit = find_free_bit_and_set(b->data, sbi->block_size,
 		    sbi->native, tmp);
@@ -239,6 +305,7 @@ retry:
 		}
 
 		*search = *idx;
+		summary[i]--;
 		b->dirty = true;
 		r = block_put(b);
 		goto out;
@@ -262,8 +329,8 @@ find_free_bit_and_set(bitchunk_t *b, const int bsize,
     const bool native, unsigned start_bit)
 {
 	int r = -1;
-	unsigned i, j;
-	bitchunk_t chunk;
+	unsigned i;
+	bitchunk_t chunk, free_bit;
 	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
 
 	for (i = start_bit / chunk_bits;
@@ -276,19 +343,102 @@ find_free_bit_and_set(bitchunk_t *b, const int bsize,
 
 		chunk = conv32(native, b[i]);
 
-		for (j = 0; j < chunk_bits; ++j) {
-			if (!(chunk & (1 << j))) {
-				r = i * chunk_bits + j;
-				chunk |= 1 << j;
-				b[i] = conv32(native, chunk);
-				goto found;
-			}
-		}
+		/* Isolate the lowest clear bit of the chunk */
+		free_bit = ~chunk & (chunk + 1);
+		r = i * chunk_bits + fnzb32(free_bit);
+		b[i] = conv32(native, chunk | free_bit);
+		break;
 	}
-found:
+
 	return r;
 }
 
+static unsigned
+count_free_bits(bitchunk_t *b, const bool native, unsigned nbits)
+{
+	unsigned i, cnt = 0;
+	bitchunk_t chunk;
+	const size_t chunk_bits = sizeof(bitchunk_t) * 8;
+
+	for (i = 0; i < nbits; i += chunk_bits) {
+		chunk = ~conv32(native, b[i / chunk_bits]);
+		if (nbits - i < chunk_bits)
+			chunk &= (1U << (nbits - i)) - 1;
+
+		while (chunk) {
+			chunk &= chunk - 1;
+			cnt++;
+		}
+	}
+
+	return cnt;
+}
+
+/**Count the free bits in each block of a bitmap.
+ *
+ * Only the bits which can be allocated are counted.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ * @param bid		BMAP_ZONE if operating on the zone's bitmap,
+ * 			BMAP_INODE if operating on the inode's bitmap.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int
+mfs_bmap_summary(struct mfs_instance *inst, bmap_id_t bid)
+{
+	struct mfs_sb_info *sbi = inst->sbi;
+	unsigned long nblocks, i;
+	unsigned start_block, bits_per_block;
+	uint32_t limit, first;
+	uint32_t *summary;
+	block_t *b;
+	int r;
+
+	if (bid == BMAP_ZONE) {
+		start_block = 2 + sbi->ibmap_blocks;
+		nblocks = sbi->zbmap_blocks;
+		limit = sbi->nzones - sbi->firstdatazone - 1;
+	} else {
+		/* bid == BMAP_INODE */
+		start_block = 2;
+		nblocks = sbi->ibmap_blocks;
+		limit = sbi->ninodes;
+	}
+	bits_per_block = sbi->block_size * 8;
+
+	summary = malloc(nblocks * sizeof(uint32_t));
+	if (!summary)
+		return ENOMEM;
+
+	if (bid == BMAP_ZONE)
+		sbi->zbmap_free = summary;
+	else
+		sbi->ibmap_free = summary;
+
+	for (i = 0; i < nblocks; ++i) {
+		first = i * bits_per_block;
+		if (first > limit) {
+			summary[i] = 0;
+			continue;
+		}
+
+		r = block_get(&b, inst->service_id, i + start_block,
+		    BLOCK_FLAGS_NONE);
+		if (r != EOK)
+			return r;
+
+		summary[i] = count_free_bits(b->data, sbi->native,
+		    min(bits_per_block, limit - first + 1));
+
+		r = block_put(b);
+		if (r != EOK)
+			return r;
+	}
+
+	return EOK;
+}
+
 /**
  * @}
  */
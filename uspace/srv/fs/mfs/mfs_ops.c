@@ -40,6 +40,8 @@
 #define OPEN_NODES_SERVICE_KEY 0
 #define OPEN_NODES_INODE_KEY 1
 #define OPEN_NODES_BUCKETS 256
+/* Maximum number of unreferenced nodes kept in the open nodes hash table */
+#define OPEN_NODES_CACHE_SIZE 128
 
 static bool check_magic_number(uint16_t magic, bool *native,
     mfs_version_t *version, bool *longfilenames);
@@ -56,6 +58,8 @@ static int mfs_root_get(fs_node_t **rfn, service_id_t service_id);
 static service_id_t mfs_service_get(fs_node_t *fsnode);
 static aoff64_t mfs_size_get(fs_node_t *node);
 static int mfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component);
+static int mfs_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg);
 static int mfs_create_node(fs_node_t **rfn, service_id_t service_id, int flags);
 static int mfs_link(fs_node_t *pfn, fs_node_t *cfn, const char *name);
 static int mfs_unlink(fs_node_t *, fs_node_t *, const char *name);
@@ -74,6 +78,13 @@ static bool is_power_of_two(uint32_t n);
 static hash_table_t open_nodes;
 static FIBRIL_MUTEX_INITIALIZE(open_nodes_lock);
 
+/*
+ * Nodes without references stay in the open nodes hash table so that their
+ * inodes need not be read again. They are kept in the LRU order here.
+ */
+static LIST_INITIALIZE(unused_nodes);
+static unsigned unused_nodes_cnt = 0;
+
 libfs_ops_t mfs_libfs_ops = {
 	.size_get = mfs_size_get,
 	.root_get = mfs_root_get,
@@ -90,6 +101,7 @@ libfs_ops_t mfs_libfs_ops = {
 	.unlink = mfs_unlink,
 	.destroy = mfs_destroy_node,
 	.has_children = mfs_has_children,
+	.readdir = mfs_readdir,
 	.lnkcnt_get = mfs_lnkcnt_get
 };
 
@@ -130,6 +142,50 @@ static hash_table_operations_t open_nodes_ops = {
 	.remove_callback = open_nodes_remove_cb,
 };
 
+/** Remove an unreferenced node from the node cache and free it.
+ *
+ * The open nodes lock must be held by the caller.
+ */
+static void
+mfs_node_evict(struct mfs_node *mnode)
+{
+	unsigned long key[] = {
+		[OPEN_NODES_SERVICE_KEY] = mnode->instance->service_id,
+		[OPEN_NODES_INODE_KEY] = mnode->ino_i->index
+	};
+
+	assert(mnode->refcnt == 0);
+
+	hash_table_remove(&open_nodes, key, OPEN_NODES_KEYS);
+	list_remove(&mnode->unused_link);
+	unused_nodes_cnt--;
+
+	free(mnode->ino_i);
+	free(mnode->fsnode);
+	free(mnode);
+}
+
+/** Drop all the cached nodes of a file system instance.
+ *
+ * @param service_id	Service ID of the file system instance.
+ */
+static void
+mfs_node_cache_purge(service_id_t service_id)
+{
+	fibril_mutex_lock(&open_nodes_lock);
+
+	link_t *cur = unused_nodes.head.next;
+	while (cur != &unused_nodes.head) {
+		struct mfs_node *mnode = list_get_instance(cur, struct mfs_node,
+		    unused_link);
+		cur = cur->next;
+		if (mnode->instance->service_id == service_id)
+			mfs_node_evict(mnode);
+	}
+
+	fibril_mutex_unlock(&open_nodes_lock);
+}
+
 int
 mfs_global_init(void)
 {
@@ -137,7 +193,7 @@ mfs_global_init(void)
 	    OPEN_NODES_KEYS, &open_nodes_ops)) {
 		return ENOMEM;
 	}
-	return EOK;
+	return mfs_ind_zones_init();
 }
 
 static int
@@ -277,8 +333,19 @@ mfs_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 	instance->service_id = service_id;
 	instance->sbi = sbi;
 	instance->open_nodes_cnt = 0;
+	instance->cmode = cmode;
+
+	/* Count the free bits in each bitmap block */
+	rc = mfs_balloc_init(instance);
+	if (rc != EOK) {
+		block_cache_fini(service_id);
+		mfsdebug("bitmap summary initialization failed\n");
+		goto out_error;
+	}
+
 	rc = fs_instance_create(service_id, instance);
 	if (rc != EOK) {
+		mfs_balloc_fini(instance);
 		block_cache_fini(service_id);
 		mfsdebug("fs instance creation failed\n");
 		goto out_error;
@@ -324,11 +391,14 @@ mfs_unmounted(service_id_t service_id)
 	if (inst->open_nodes_cnt != 0)
 		return EBUSY;
 
+	mfs_node_cache_purge(service_id);
+	(void) mfs_ind_zones_fini(inst);
 	(void) block_cache_fini(service_id);
 	block_fini(service_id);
 
 	/* Remove and destroy the instance */
 	(void) fs_instance_destroy(service_id);
+	mfs_balloc_fini(inst);
 	free(inst->sbi);
 	free(inst);
 	return EOK;
@@ -412,7 +482,15 @@ mfs_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 		[OPEN_NODES_INODE_KEY] = inum,
 	};
 
+	link_initialize(&mnode->unused_link);
+
 	fibril_mutex_lock(&open_nodes_lock);
+	/* A cached node of a previous incarnation of the inode is stale */
+	link_t *stale = hash_table_find(&open_nodes, key);
+	if (stale) {
+		mfs_node_evict(hash_table_get_instance(stale, struct mfs_node,
+		    link));
+	}
 	hash_table_insert(&open_nodes, key, &mnode->link);
 	fibril_mutex_unlock(&open_nodes_lock);
 	inst->open_nodes_cnt++;
@@ -476,6 +554,47 @@ found:
 	return EOK;
 }
 
+static int
+mfs_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb, void *arg)
+{
+	struct mfs_node *mnode = fn->data;
+	struct mfs_ino_info *ino_i = mnode->ino_i;
+	struct mfs_sb_info *sbi = mnode->instance->sbi;
+	struct mfs_dentry_info d_info;
+	fs_node_t *cfn;
+	int r;
+
+	mfsdebug("%s()\n", __FUNCTION__);
+
+	if (!S_ISDIR(ino_i->i_mode))
+		return ENOTDIR;
+
+	if (pos < 2) {
+		/* Skip the first two dentries ('.' and '..') */
+		pos = 2;
+	}
+
+	for (; pos < ino_i->i_size / sbi->dirsize; ++pos) {
+		r = mfs_read_dentry(mnode, &d_info, pos);
+		if (r != EOK)
+			return r;
+
+		if (!d_info.d_inum) {
+			/* This entry is not used */
+			continue;
+		}
+
+		r = mfs_node_core_get(&cfn, mnode->instance, d_info.d_inum);
+		if (r != EOK)
+			return r;
+
+		if (!cb(arg, d_info.d_name, cfn, pos + 1))
+			break;
+	}
+
+	return EOK;
+}
+
 static aoff64_t
 mfs_size_get(fs_node_t *node)
 {
@@ -512,17 +631,23 @@ mfs_node_put(fs_node_t *fsnode)
 	assert(mnode->refcnt > 0);
 	mnode->refcnt--;
 	if (mnode->refcnt == 0) {
-		unsigned long key[] = {
-			[OPEN_NODES_SERVICE_KEY] = mnode->instance->service_id,
-			[OPEN_NODES_INODE_KEY] = mnode->ino_i->index
-		};
-		hash_table_remove(&open_nodes, key, OPEN_NODES_KEYS);
 		assert(mnode->instance->open_nodes_cnt > 0);
 		mnode->instance->open_nodes_cnt--;
 		rc = mfs_put_inode(mnode);
-		free(mnode->ino_i);
-		free(mnode);
-		free(fsnode);
+
+		/*
+		 * Keep the node around unless it is unlinked or could not be
+		 * written back.
+		 */
+		list_append(&mnode->unused_link, &unused_nodes);
+		unused_nodes_cnt++;
+		if (rc != EOK || mfs_lnkcnt_get(fsnode) == 0)
+			mfs_node_evict(mnode);
+
+		while (unused_nodes_cnt > OPEN_NODES_CACHE_SIZE) {
+			mfs_node_evict(list_get_instance(list_first(&unused_nodes),
+			    struct mfs_node, unused_link));
+		}
 	}
 
 	fibril_mutex_unlock(&open_nodes_lock);
@@ -584,7 +709,12 @@ mfs_node_core_get(fs_node_t **rfn, struct mfs_instance *inst,
 	if (already_open) {
 		mnode = hash_table_get_instance(already_open, struct mfs_node, link);
 		*rfn = mnode->fsnode;
-		mnode->refcnt++;
+		if (mnode->refcnt++ == 0) {
+			/* Revive a cached node */
+			list_remove(&mnode->unused_link);
+			unused_nodes_cnt--;
+			inst->open_nodes_cnt++;
+		}
 
 		fibril_mutex_unlock(&open_nodes_lock);
 		return EOK;
@@ -614,6 +744,7 @@ mfs_node_core_get(fs_node_t **rfn, struct mfs_instance *inst,
 	mnode->ino_i = ino_i;
 	mnode->refcnt = 1;
 	link_initialize(&mnode->link);
+	link_initialize(&mnode->unused_link);
 
 	mnode->instance = inst;
 	node->data = mnode;
@@ -1134,6 +1265,12 @@ mfs_sync(service_id_t service_id, fs_index_t index)
 	struct mfs_node *mnode = fn->data;
 	mnode->ino_i->dirty = true;
 
+	rc = mfs_ind_zones_sync(mnode->instance);
+	if (rc != EOK) {
+		mfs_node_put(fn);
+		return rc;
+	}
+
 	return mfs_node_put(fn);
 }
 
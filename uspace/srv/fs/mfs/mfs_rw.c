@@ -31,8 +31,30 @@
  */
 
 #include <align.h>
+#include <adt/hash_table.h>
+#include <fibril_synch.h>
 #include "mfs.h"
 
+#define IND_ZONES_KEYS		2
+#define IND_ZONES_SERVICE_KEY	0
+#define IND_ZONES_ZONE_KEY	1
+#define IND_ZONES_BUCKETS	64
+/* Maximum number of unreferenced indirect zones kept in memory */
+#define IND_ZONES_CACHE_SIZE	64
+
+/* Indirect zone in core */
+struct mfs_ind_zone {
+	struct mfs_instance *instance;
+	uint32_t zone;
+	unsigned refcnt;
+	bool dirty;
+	link_t link;
+	/* Link in the list of unreferenced indirect zones */
+	link_t unused_link;
+	/* Zone pointers in the native byte order */
+	uint32_t ptrs[];
+};
+
 static int
 rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
     bool write_mode, uint32_t w_block);
@@ -44,11 +66,76 @@ static int
 alloc_zone_and_clear(struct mfs_instance *inst, uint32_t *zone);
 
 static int
-read_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t **ind_zone);
+read_ind_zone(struct mfs_instance *inst, uint32_t zone,
+    struct mfs_ind_zone **ind_zone);
+
+static int
+write_ind_zone(struct mfs_ind_zone *ind_zone);
 
 static int
-write_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t *ind_zone);
+put_ind_zone(struct mfs_ind_zone *ind_zone);
+
+static void
+drop_ind_zone(struct mfs_instance *inst, uint32_t zone);
+
+/*
+ * Indirect zones shared by all the nodes. Modified zones are written back to
+ * the block cache when evicted or synced.
+ */
+static hash_table_t ind_zones;
+static FIBRIL_MUTEX_INITIALIZE(ind_zones_lock);
+static LIST_INITIALIZE(unused_ind_zones);
+static unsigned unused_ind_zones_cnt = 0;
 
+static hash_index_t
+ind_zones_hash(unsigned long key[])
+{
+	return (key[IND_ZONES_SERVICE_KEY] * 31 + key[IND_ZONES_ZONE_KEY]) %
+	    IND_ZONES_BUCKETS;
+}
+
+static int
+ind_zones_compare(unsigned long key[], hash_count_t keys, link_t *item)
+{
+	struct mfs_ind_zone *iz = hash_table_get_instance(item,
+	    struct mfs_ind_zone, link);
+	assert(keys > 0);
+	if (iz->instance->service_id !=
+	    ((service_id_t) key[IND_ZONES_SERVICE_KEY])) {
+		return false;
+	}
+	if (keys == 1) {
+		return true;
+	}
+	assert(keys == 2);
+	return (iz->zone == key[IND_ZONES_ZONE_KEY]);
+}
+
+static void
+ind_zones_remove_cb(link_t *link)
+{
+	/* We don't use remove callback for this hash table */
+}
+
+static hash_table_operations_t ind_zones_ops = {
+	.hash = ind_zones_hash,
+	.compare = ind_zones_compare,
+	.remove_callback = ind_zones_remove_cb,
+};
+
+/**Initialize the indirect zones cache.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int
+mfs_ind_zones_init(void)
+{
+	if (!hash_table_create(&ind_zones, IND_ZONES_BUCKETS,
+	    IND_ZONES_KEYS, &ind_zones_ops)) {
+		return ENOMEM;
+	}
+	return EOK;
+}
 
 /**Given the position in the file expressed in
  *bytes, this function returns the on-disk block
@@ -105,7 +192,7 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 {
 	int r, nr_direct;
 	int ptrs_per_block;
-	uint32_t *ind_zone, *ind2_zone;
+	struct mfs_ind_zone *ind_zone, *ind2_zone;
 
 	struct mfs_ino_info *ino_i = mnode->ino_i;
 	struct mfs_instance *inst = mnode->instance;
@@ -156,13 +243,13 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 		if (r != EOK)
 			return r;
 
-		*b = ind_zone[rblock];
+		*b = ind_zone->ptrs[rblock];
 		if (write_mode) {
-			ind_zone[rblock] = w_block;
-			write_ind_zone(inst, ino_i->i_izone[0], ind_zone);
+			ind_zone->ptrs[rblock] = w_block;
+			r = write_ind_zone(ind_zone);
 		}
 
-		goto out_free_ind1;
+		goto out_put_ind1;
 	}
 
 	rblock -= ptrs_per_block;
@@ -197,38 +284,43 @@ rw_map_ondisk(uint32_t *b, const struct mfs_node *mnode, int rblock,
 	uint32_t ind2_off = rblock / ptrs_per_block;
 
 	/* read the second indirect zone of the chain */
-	if (ind_zone[ind2_off] == 0) {
+	if (ind_zone->ptrs[ind2_off] == 0) {
 		if (write_mode && !deleting) {
 			uint32_t zone;
 			r = alloc_zone_and_clear(inst, &zone);
 			if (r != EOK)
-				goto out_free_ind1;
+				goto out_put_ind1;
 
-			ind_zone[ind2_off] = zone;
-			write_ind_zone(inst, ino_i->i_izone[1], ind_zone);
+			ind_zone->ptrs[ind2_off] = zone;
+			r = write_ind_zone(ind_zone);
+			if (r != EOK)
+				goto out_put_ind1;
 		} else {
 			/* Sparse block */
 			r = EOK;
 			*b = 0;
-			goto out_free_ind1;
+			goto out_put_ind1;
 		}
 	}
 
-	r = read_ind_zone(inst, ind_zone[ind2_off], &ind2_zone);
+	r = read_ind_zone(inst, ind_zone->ptrs[ind2_off], &ind2_zone);
 	if (r != EOK)
-		goto out_free_ind1;
+		goto out_put_ind1;
 
-	*b = ind2_zone[rblock - (ind2_off * ptrs_per_block)];
+	*b = ind2_zone->ptrs[rblock - (ind2_off * ptrs_per_block)];
 	if (write_mode) {
-		ind2_zone[rblock - (ind2_off * ptrs_per_block)] = w_block;
-		write_ind_zone(inst, ind_zone[ind2_off], ind2_zone);
+		ind2_zone->ptrs[rblock - (ind2_off * ptrs_per_block)] = w_block;
+		r = write_ind_zone(ind2_zone);
 	}
 
-	r = EOK;
-
-	free(ind2_zone);
-out_free_ind1:
-	free(ind_zone);
+	if (r == EOK)
+		r = put_ind_zone(ind2_zone);
+	else
+		(void) put_ind_zone(ind2_zone);
+out_put_ind1:
+	if (r == EOK)
+		return put_ind_zone(ind_zone);
+	(void) put_ind_zone(ind_zone);
 	return r;
 }
 
@@ -265,6 +357,7 @@ mfs_prune_ind_zones(struct mfs_node *mnode, size_t new_size)
 	if (rblock < nr_direct) {
 		/* Free the single indirect zone */
 		if (ino_i->i_izone[0]) {
+			drop_ind_zone(inst, ino_i->i_izone[0]);
 			r = mfs_free_zone(inst, ino_i->i_izone[0]);
 			if (r != EOK)
 				return r;
@@ -282,7 +375,7 @@ mfs_prune_ind_zones(struct mfs_node *mnode, size_t new_size)
 		++fzone_to_free;
 
 	/* Free the entire double indirect zone */
-	uint32_t *dbl_zone;
+	struct mfs_ind_zone *dbl_zone;
 
 	if (ino_i->i_izone[1] == 0) {
 		/* Nothing to be done */
@@ -293,22 +386,44 @@ mfs_prune_ind_zones(struct mfs_node *mnode, size_t new_size)
 	if (r != EOK)
 		return r;
 
+	bool modified = false;
+
 	for (i = fzone_to_free; i < ptrs_per_block; ++i) {
-		if (dbl_zone[i] == 0)
+		if (dbl_zone->ptrs[i] == 0)
 			continue;
 
-		r = mfs_free_zone(inst, dbl_zone[i]);
+		drop_ind_zone(inst, dbl_zone->ptrs[i]);
+		r = mfs_free_zone(inst, dbl_zone->ptrs[i]);
 		if (r != EOK)
-			goto out;
+			break;
+
+		dbl_zone->ptrs[i] = 0;
+		modified = true;
+	}
+
+	if (modified) {
+		int r2 = write_ind_zone(dbl_zone);
+		if (r == EOK)
+			r = r2;
 	}
 
+	if (r != EOK)
+		goto out;
+
+	r = put_ind_zone(dbl_zone);
+	if (r != EOK)
+		return r;
+
 	if (fzone_to_free == 0) {
+		drop_ind_zone(inst, ino_i->i_izone[1]);
 		r = mfs_free_zone(inst, ino_i->i_izone[1]);
 		ino_i->i_izone[1] = 0;
 		ino_i->dirty = true;
 	}
+	return r;
+
 out:
-	free(dbl_zone);
+	(void) put_ind_zone(dbl_zone);
 	return r;
 }
 
@@ -341,70 +456,317 @@ alloc_zone_and_clear(struct mfs_instance *inst, uint32_t *zone)
 	return r;
 }
 
+/**Write an indirect zone back to the block cache.
+ *
+ * The indirect zones lock must be held by the caller.
+ */
 static int
-read_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t **ind_zone)
+flush_ind_zone(struct mfs_ind_zone *ind_zone)
 {
+	struct mfs_instance *inst = ind_zone->instance;
 	struct mfs_sb_info *sbi = inst->sbi;
 	int r;
 	unsigned i;
 	block_t *b;
-	const int max_ind_zone_ptrs = (MFS_MAX_BLOCKSIZE / sizeof(uint16_t)) *
-	    sizeof(uint32_t);
-
-	*ind_zone = malloc(max_ind_zone_ptrs);
-	if (*ind_zone == NULL)
-		return ENOMEM;
 
-	r = block_get(&b, inst->service_id, zone, BLOCK_FLAGS_NONE);
-	if (r != EOK) {
-		free(*ind_zone);
+	r = block_get(&b, inst->service_id, ind_zone->zone, BLOCK_FLAGS_NOREAD);
+	if (r != EOK)
 		return r;
-	}
 
 	if (sbi->fs_version == MFS_VERSION_V1) {
-		uint16_t *src_ptr = b->data;
+		uint16_t *dest_ptr = b->data;
 
 		for (i = 0; i < sbi->block_size / sizeof(uint16_t); ++i)
-			(*ind_zone)[i] = conv16(sbi->native, src_ptr[i]);
+			dest_ptr[i] = conv16(sbi->native, ind_zone->ptrs[i]);
 	} else {
-		uint32_t *src_ptr = b->data;
+		uint32_t *dest_ptr = b->data;
 
 		for (i = 0; i < sbi->block_size / sizeof(uint32_t); ++i)
-			(*ind_zone)[i] = conv32(sbi->native, src_ptr[i]);
+			dest_ptr[i] = conv32(sbi->native, ind_zone->ptrs[i]);
+
 	}
+	b->dirty = true;
 
-	return block_put(b);
+	r = block_put(b);
+	if (r == EOK)
+		ind_zone->dirty = false;
+	return r;
+}
+
+/**Remove an unreferenced indirect zone from the cache and free it.
+ *
+ * The zone is written back first if it is dirty. The indirect zones lock
+ * must be held by the caller.
+ */
+static int
+evict_ind_zone(struct mfs_ind_zone *ind_zone)
+{
+	int r;
+
+	assert(ind_zone->refcnt == 0);
+
+	if (ind_zone->dirty) {
+		r = flush_ind_zone(ind_zone);
+		if (r != EOK)
+			return r;
+	}
+
+	unsigned long key[] = {
+		[IND_ZONES_SERVICE_KEY] = ind_zone->instance->service_id,
+		[IND_ZONES_ZONE_KEY] = ind_zone->zone
+	};
+	hash_table_remove(&ind_zones, key, IND_ZONES_KEYS);
+	list_remove(&ind_zone->unused_link);
+	unused_ind_zones_cnt--;
+	free(ind_zone);
+	return EOK;
 }
 
+/**Get a reference to an indirect zone, reading it from disk if needed.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ * @param zone		Number of the indirect zone.
+ * @param ind_zone	Pointer where the indirect zone will be stored.
+ *
+ * @return		EOK on success or a negative error code.
+ */
 static int
-write_ind_zone(struct mfs_instance *inst, uint32_t zone, uint32_t *ind_zone)
+read_ind_zone(struct mfs_instance *inst, uint32_t zone,
+    struct mfs_ind_zone **ind_zone)
 {
 	struct mfs_sb_info *sbi = inst->sbi;
+	struct mfs_ind_zone *iz;
 	int r;
 	unsigned i;
 	block_t *b;
+	const int max_ind_zone_ptrs = (MFS_MAX_BLOCKSIZE / sizeof(uint16_t)) *
+	    sizeof(uint32_t);
 
-	r = block_get(&b, inst->service_id, zone, BLOCK_FLAGS_NOREAD);
-	if (r != EOK)
+	unsigned long key[] = {
+		[IND_ZONES_SERVICE_KEY] = inst->service_id,
+		[IND_ZONES_ZONE_KEY] = zone
+	};
+
+	fibril_mutex_lock(&ind_zones_lock);
+
+	link_t *l = hash_table_find(&ind_zones, key);
+	if (l) {
+		iz = hash_table_get_instance(l, struct mfs_ind_zone, link);
+		if (iz->refcnt++ == 0) {
+			list_remove(&iz->unused_link);
+			unused_ind_zones_cnt--;
+		}
+		fibril_mutex_unlock(&ind_zones_lock);
+		*ind_zone = iz;
+		return EOK;
+	}
+
+	iz = malloc(sizeof(*iz) + max_ind_zone_ptrs);
+	if (iz == NULL) {
+		fibril_mutex_unlock(&ind_zones_lock);
+		return ENOMEM;
+	}
+
+	r = block_get(&b, inst->service_id, zone, BLOCK_FLAGS_NONE);
+	if (r != EOK) {
+		fibril_mutex_unlock(&ind_zones_lock);
+		free(iz);
 		return r;
+	}
 
 	if (sbi->fs_version == MFS_VERSION_V1) {
-		uint16_t *dest_ptr = b->data;
+		uint16_t *src_ptr = b->data;
 
 		for (i = 0; i < sbi->block_size / sizeof(uint16_t); ++i)
-			dest_ptr[i] = conv16(sbi->native, ind_zone[i]);
+			iz->ptrs[i] = conv16(sbi->native, src_ptr[i]);
 	} else {
-		uint32_t *dest_ptr = b->data;
+		uint32_t *src_ptr = b->data;
 
 		for (i = 0; i < sbi->block_size / sizeof(uint32_t); ++i)
-			dest_ptr[i] = conv32(sbi->native, ind_zone[i]);
+			iz->ptrs[i] = conv32(sbi->native, src_ptr[i]);
+	}
 
+	r = block_put(b);
+	if (r != EOK) {
+		fibril_mutex_unlock(&ind_zones_lock);
+		free(iz);
+		return r;
 	}
-	b->dirty = true;
 
-	return block_put(b);
+	iz->instance = inst;
+	iz->zone = zone;
+	iz->refcnt = 1;
+	iz->dirty = false;
+	link_initialize(&iz->link);
+	link_initialize(&iz->unused_link);
+	hash_table_insert(&ind_zones, key, &iz->link);
+
+	fibril_mutex_unlock(&ind_zones_lock);
+
+	*ind_zone = iz;
+	return EOK;
 }
 
+/**Mark a referenced indirect zone as modified.
+ *
+ * In the write-through cache mode, the zone is written back immediately.
+ * Otherwise it is written back when it is evicted or synced.
+ *
+ * @param ind_zone	Pointer to the indirect zone.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int
+write_ind_zone(struct mfs_ind_zone *ind_zone)
+{
+	int r = EOK;
+
+	assert(ind_zone->refcnt > 0);
+	ind_zone->dirty = true;
+
+	if (ind_zone->instance->cmode == CACHE_MODE_WT) {
+		fibril_mutex_lock(&ind_zones_lock);
+		r = flush_ind_zone(ind_zone);
+		fibril_mutex_unlock(&ind_zones_lock);
+	}
+
+	return r;
+}
+
+/**Release a reference to an indirect zone.
+ *
+ * @param ind_zone	Pointer to the indirect zone.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+static int
+put_ind_zone(struct mfs_ind_zone *ind_zone)
+{
+	int r = EOK;
+
+	fibril_mutex_lock(&ind_zones_lock);
+
+	assert(ind_zone->refcnt > 0);
+	if (--ind_zone->refcnt == 0) {
+		list_append(&ind_zone->unused_link, &unused_ind_zones);
+		unused_ind_zones_cnt++;
+
+		while (unused_ind_zones_cnt > IND_ZONES_CACHE_SIZE) {
+			r = evict_ind_zone(list_get_instance(
+			    list_first(&unused_ind_zones), struct mfs_ind_zone,
+			    unused_link));
+			if (r != EOK)
+				break;
+		}
+	}
+
+	fibril_mutex_unlock(&ind_zones_lock);
+	return r;
+}
+
+/**Forget an indirect zone which is about to be freed.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ * @param zone		Number of the indirect zone.
+ */
+static void
+drop_ind_zone(struct mfs_instance *inst, uint32_t zone)
+{
+	unsigned long key[] = {
+		[IND_ZONES_SERVICE_KEY] = inst->service_id,
+		[IND_ZONES_ZONE_KEY] = zone
+	};
+
+	fibril_mutex_lock(&ind_zones_lock);
+
+	link_t *l = hash_table_find(&ind_zones, key);
+	if (l) {
+		struct mfs_ind_zone *iz = hash_table_get_instance(l,
+		    struct mfs_ind_zone, link);
+
+		/* The contents of a freed zone must not be written back */
+		iz->dirty = false;
+		(void) evict_ind_zone(iz);
+	}
+
+	fibril_mutex_unlock(&ind_zones_lock);
+}
+
+struct ind_zones_sync_arg {
+	struct mfs_instance *inst;
+	int rc;
+};
+
+static void
+ind_zones_sync_cb(link_t *link, void *arg)
+{
+	struct mfs_ind_zone *iz = hash_table_get_instance(link,
+	    struct mfs_ind_zone, link);
+	struct ind_zones_sync_arg *sarg = arg;
+
+	if (iz->instance == sarg->inst && iz->dirty) {
+		int r = flush_ind_zone(iz);
+		if (r != EOK)
+			sarg->rc = r;
+	}
+}
+
+/**Write back all the modified indirect zones of a filesystem instance.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int
+mfs_ind_zones_sync(struct mfs_instance *inst)
+{
+	struct ind_zones_sync_arg arg = {
+		.inst = inst,
+		.rc = EOK
+	};
+
+	fibril_mutex_lock(&ind_zones_lock);
+	hash_table_apply(&ind_zones, ind_zones_sync_cb, &arg);
+	fibril_mutex_unlock(&ind_zones_lock);
+
+	return arg.rc;
+}
+
+/**Write back and forget all the indirect zones of a filesystem instance.
+ *
+ * There must be no references to the zones left.
+ *
+ * @param inst		Pointer to the filesystem instance.
+ *
+ * @return		EOK on success or a negative error code.
+ */
+int
+mfs_ind_zones_fini(struct mfs_instance *inst)
+{
+	int rc = EOK;
+
+	fibril_mutex_lock(&ind_zones_lock);
+
+	link_t *cur = unused_ind_zones.head.next;
+	while (cur != &unused_ind_zones.head) {
+		struct mfs_ind_zone *iz = list_get_instance(cur,
+		    struct mfs_ind_zone, unused_link);
+		cur = cur->next;
+		if (iz->instance != inst)
+			continue;
+
+		int r = evict_ind_zone(iz);
+		if (r != EOK) {
+			/* Do not leave a dangling pointer to the instance */
+			iz->dirty = false;
+			(void) evict_ind_zone(iz);
+			rc = r;
+		}
+	}
+
+	fibril_mutex_unlock(&ind_zones_lock);
+	return rc;
+}
 
 /**
  * @}
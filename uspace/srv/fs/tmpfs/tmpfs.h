@@ -39,6 +39,9 @@
 #include <bool.h>
 #include <adt/hash_table.h>
 
+/** Granularity of the storage of file contents. */
+#define TMPFS_PAGE_SIZE		4096
+
 #define TMPFS_NODE(node)	((node) ? (tmpfs_node_t *)(node)->data : NULL)
 #define FS_NODE(node)		((node) ? (node)->bp : NULL)
 
@@ -53,6 +56,8 @@ struct tmpfs_node;
 
 typedef struct tmpfs_dentry {
 	link_t link;		/**< Linkage for the list of siblings. */
+	link_t dh_link;		/**< Dentries hash table link. */
+	struct tmpfs_node *parent;/**< Directory containing the dentry. */
 	struct tmpfs_node *node;/**< Back pointer to TMPFS node. */
 	char *name;		/**< Name of dentry. */
 } tmpfs_dentry_t;
@@ -65,7 +70,8 @@ typedef struct tmpfs_node {
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
 	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
+	void *data;		/**< Radix tree of file pages, see tmpfs_data.c. */
+	unsigned data_height;	/**< Height of the radix tree. */
 	list_t cs_list;		/**< Child's siblings list. */
 } tmpfs_node_t;
 
@@ -75,6 +81,10 @@ extern libfs_ops_t tmpfs_libfs_ops;
 extern bool tmpfs_init(void);
 extern bool tmpfs_restore(service_id_t);
 
+extern void *tmpfs_data_page(tmpfs_node_t *, aoff64_t, bool);
+extern void tmpfs_data_truncate(tmpfs_node_t *, size_t);
+extern void tmpfs_data_destroy(tmpfs_node_t *);
+
 #endif
 
 /**
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file	tmpfs_data.c
+ * @brief	Page-granular storage of TMPFS file contents.
+ *
+ * File contents are kept in a radix tree of TMPFS_PAGE_SIZE pages indexed
+ * by the page number. Pages which were never written are not allocated and
+ * read as zeros.
+ */
+
+#include "tmpfs.h"
+#include <malloc.h>
+#include <mem.h>
+#include <stdint.h>
+#include <bool.h>
+
+#define RADIX_BITS	9
+#define RADIX_SLOTS	(1 << RADIX_BITS)
+
+/** Number of pages covered by a subtree of the given height. */
+#define RADIX_PAGES(height) \
+	((uint64_t) 1 << (RADIX_BITS * (height)))
+
+static void *tmpfs_data_node_alloc(void)
+{
+	return calloc(RADIX_SLOTS, sizeof(void *));
+}
+
+/** Free a subtree.
+ *
+ * @param node		Root of the subtree, a page if height is zero.
+ * @param height	Height of the subtree.
+ */
+static void tmpfs_data_free(void *node, unsigned height)
+{
+	if (height > 0) {
+		void **slots = (void **) node;
+		unsigned i;
+
+		for (i = 0; i < RADIX_SLOTS; i++) {
+			if (slots[i])
+				tmpfs_data_free(slots[i], height - 1);
+		}
+	}
+
+	free(node);
+}
+
+/** Get a page of a TMPFS file.
+ *
+ * @param nodep		TMPFS file node.
+ * @param pgno		Page number within the file.
+ * @param alloc		Allocate a zero-filled page if it is not present.
+ *
+ * @return		The page or NULL if it is not present or cannot be
+ *			allocated.
+ */
+void *tmpfs_data_page(tmpfs_node_t *nodep, aoff64_t pgno, bool alloc)
+{
+	void **slot;
+	unsigned level;
+
+	while (pgno >= RADIX_PAGES(nodep->data_height)) {
+		void **root;
+
+		if (!alloc)
+			return NULL;
+
+		/* Grow the tree by adding a new root above the old one. */
+		root = tmpfs_data_node_alloc();
+		if (!root)
+			return NULL;
+		root[0] = nodep->data;
+		nodep->data = root;
+		nodep->data_height++;
+	}
+
+	slot = &nodep->data;
+	for (level = nodep->data_height; level > 0; level--) {
+		if (!*slot) {
+			if (!alloc)
+				return NULL;
+			*slot = tmpfs_data_node_alloc();
+			if (!*slot)
+				return NULL;
+		}
+		slot = &((void **) *slot)[(pgno >> (RADIX_BITS * (level - 1))) &
+		    (RADIX_SLOTS - 1)];
+	}
+
+	if (!*slot && alloc) {
+		*slot = malloc(TMPFS_PAGE_SIZE);
+		if (*slot)
+			memset(*slot, 0, TMPFS_PAGE_SIZE);
+	}
+
+	return *slot;
+}
+
+/** Free all pages of a subtree starting with a given page.
+ *
+ * @param slot		Slot holding the subtree.
+ * @param height	Height of the subtree.
+ * @param base		Number of the first page covered by the subtree.
+ * @param first		Number of the first page to free.
+ */
+static void tmpfs_data_chop(void **slot, unsigned height, aoff64_t base,
+    aoff64_t first)
+{
+	void **slots;
+	bool empty = true;
+	unsigned i;
+
+	if (!*slot || base + RADIX_PAGES(height) <= first)
+		return;
+
+	if (base >= first) {
+		tmpfs_data_free(*slot, height);
+		*slot = NULL;
+		return;
+	}
+
+	slots = (void **) *slot;
+	for (i = 0; i < RADIX_SLOTS; i++) {
+		tmpfs_data_chop(&slots[i], height - 1,
+		    base + i * RADIX_PAGES(height - 1), first);
+		if (slots[i])
+			empty = false;
+	}
+
+	if (empty) {
+		free(*slot);
+		*slot = NULL;
+	}
+}
+
+/** Change the size of a TMPFS file.
+ *
+ * Pages beyond the new end of file are freed and the rest of the last page
+ * is cleared, so that the file reads as zeros if it grows again.
+ *
+ * @param nodep		TMPFS file node.
+ * @param size		New size of the file.
+ */
+void tmpfs_data_truncate(tmpfs_node_t *nodep, size_t size)
+{
+	if (size < nodep->size) {
+		aoff64_t first = ((aoff64_t) size + TMPFS_PAGE_SIZE - 1) /
+		    TMPFS_PAGE_SIZE;
+		void *page;
+
+		tmpfs_data_chop(&nodep->data, nodep->data_height, 0, first);
+		if (!nodep->data)
+			nodep->data_height = 0;
+
+		page = tmpfs_data_page(nodep, size / TMPFS_PAGE_SIZE, false);
+		if (page && size % TMPFS_PAGE_SIZE) {
+			memset(page + size % TMPFS_PAGE_SIZE, 0,
+			    TMPFS_PAGE_SIZE - size % TMPFS_PAGE_SIZE);
+		}
+	}
+
+	nodep->size = size;
+}
+
+/** Free all pages of a TMPFS file. */
+void tmpfs_data_destroy(tmpfs_node_t *nodep)
+{
+	if (nodep->data)
+		tmpfs_data_free(nodep->data, nodep->data_height);
+	nodep->data = NULL;
+	nodep->data_height = 0;
+	nodep->size = 0;
+}
+
+/**
+ * @}
+ */
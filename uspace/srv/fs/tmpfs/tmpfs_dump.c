@@ -43,6 +43,7 @@
 #include <str.h>
 #include <sys/types.h>
 #include <as.h>
+#include <macros.h>
 #include <libblock.h>
 #include <byteorder.h>
 
@@ -66,6 +67,7 @@ tmpfs_restore_recursion(service_id_t dsid, size_t *bufpos, size_t *buflen,
 		fs_node_t *fn;
 		tmpfs_node_t *nodep;
 		uint32_t size;
+		uint32_t off;
 		
 		if (block_seqread(dsid, bufpos, buflen, pos, &entry,
 		    sizeof(entry)) != EOK)
@@ -110,14 +112,17 @@ tmpfs_restore_recursion(service_id_t dsid, size_t *bufpos, size_t *buflen,
 			size = uint32_t_le2host(size);
 			
 			nodep = TMPFS_NODE(fn);
-			nodep->data = malloc(size);
-			if (nodep->data == NULL)
-				return false;
-			
 			nodep->size = size;
-			if (block_seqread(dsid, bufpos, buflen, pos, nodep->data,
-			    size) != EOK)
-				return false;
+			for (off = 0; off < size; off += TMPFS_PAGE_SIZE) {
+				void *page = tmpfs_data_page(nodep,
+				    off / TMPFS_PAGE_SIZE, true);
+				if (page == NULL)
+					return false;
+				
+				if (block_seqread(dsid, bufpos, buflen, pos, page,
+				    min(size - off, TMPFS_PAGE_SIZE)) != EOK)
+					return false;
+			}
 			
 			break;
 		case TMPFS_DIRECTORY:
@@ -55,7 +55,15 @@
 #define min(a, b)		((a) < (b) ? (a) : (b))
 #define max(a, b)		((a) > (b) ? (a) : (b))
 
+/** Initial number of buckets of the nodes and dentries hash tables. */
 #define NODES_BUCKETS	256
+#define DENTRIES_BUCKETS	256
+
+/** Maximum average length of a hash chain before the table grows. */
+#define HASH_MAX_LOAD	2
+
+/** Contents of pages within file holes. */
+static const uint8_t tmpfs_zero_page[TMPFS_PAGE_SIZE];
 
 /** All root nodes have index 0. */
 #define TMPFS_SOME_ROOT		0
@@ -88,6 +96,26 @@ static int tmpfs_has_children(bool *has_children, fs_node_t *fn)
 	return EOK;
 }
 
+static int tmpfs_readdir(fs_node_t *fn, aoff64_t pos, libfs_readdir_cb_t cb,
+    void *arg)
+{
+	tmpfs_node_t *nodep = TMPFS_NODE(fn);
+	link_t *lnk;
+
+	if (nodep->type != TMPFS_DIRECTORY)
+		return ENOTDIR;
+
+	for (lnk = list_nth(&nodep->cs_list, pos);
+	    (lnk != NULL) && (lnk != &nodep->cs_list.head); lnk = lnk->next) {
+		tmpfs_dentry_t *dentryp;
+		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);
+		if (!cb(arg, dentryp->name, FS_NODE(dentryp->node), ++pos))
+			break;
+	}
+
+	return EOK;
+}
+
 static fs_index_t tmpfs_index_get(fs_node_t *fn)
 {
 	return TMPFS_NODE(fn)->index;
@@ -130,6 +158,7 @@ libfs_ops_t tmpfs_libfs_ops = {
 	.link = tmpfs_link_node,
 	.unlink = tmpfs_unlink_node,
 	.has_children = tmpfs_has_children,
+	.readdir = tmpfs_readdir,
 	.index_get = tmpfs_index_get,
 	.size_get = tmpfs_size_get,
 	.lnkcnt_get = tmpfs_lnkcnt_get,
@@ -138,8 +167,47 @@ libfs_ops_t tmpfs_libfs_ops = {
 	.service_get = tmpfs_service_get
 };
 
+/** Double the number of buckets of a TMPFS hash table.
+ *
+ * The hash functions of the TMPFS hash tables compute the bucket index using
+ * the number of buckets stored in a variable, so the items can be moved to
+ * a larger table. If the larger table cannot be allocated, the original one
+ * is kept.
+ *
+ * @param h		Hash table to grow.
+ * @param buckets	Variable holding the number of buckets of h.
+ * @param key_get	Function filling in the keys of an item.
+ */
+static void tmpfs_hash_grow(hash_table_t *h, hash_count_t *buckets,
+    void (*key_get)(link_t *, unsigned long []))
+{
+	hash_count_t old = *buckets;
+	hash_table_t nh;
+	hash_count_t i;
+
+	if (!hash_table_create(&nh, 2 * old, h->max_keys, h->op))
+		return;
+
+	*buckets = 2 * old;
+	for (i = 0; i < old; i++) {
+		while (!list_empty(&h->entry[i])) {
+			link_t *lnk = list_first(&h->entry[i]);
+			unsigned long key[2];
+
+			list_remove(lnk);
+			key_get(lnk, key);
+			hash_table_insert(&nh, key, lnk);
+		}
+	}
+
+	hash_table_destroy(h);
+	*h = nh;
+}
+
 /** Hash table of all TMPFS nodes. */
 hash_table_t nodes;
+static hash_count_t nodes_buckets = NODES_BUCKETS;
+static size_t nodes_count = 0;
 
 #define NODES_KEY_DEV	0	
 #define NODES_KEY_INDEX	1
@@ -147,7 +215,7 @@ hash_table_t nodes;
 /* Implementation of hash table interface for the nodes hash table. */
 static hash_index_t nodes_hash(unsigned long key[])
 {
-	return key[NODES_KEY_INDEX] % NODES_BUCKETS;
+	return key[NODES_KEY_INDEX] % nodes_buckets;
 }
 
 static int nodes_compare(unsigned long key[], hash_count_t keys, link_t *item)
@@ -168,23 +236,113 @@ static int nodes_compare(unsigned long key[], hash_count_t keys, link_t *item)
 	return 0;
 }
 
+static void nodes_key_get(link_t *item, unsigned long key[])
+{
+	tmpfs_node_t *nodep = hash_table_get_instance(item, tmpfs_node_t,
+	    nh_link);
+
+	key[NODES_KEY_DEV] = nodep->service_id;
+	key[NODES_KEY_INDEX] = nodep->index;
+}
+
+/** Hash table of the dentries of all TMPFS directories. */
+hash_table_t dentries;
+static hash_count_t dentries_buckets = DENTRIES_BUCKETS;
+static size_t dentries_count = 0;
+
+#define DENTRIES_KEY_PARENT	0
+#define DENTRIES_KEY_NAME	1
+
+/* Implementation of hash table interface for the dentries hash table. */
+static hash_index_t dentries_hash(unsigned long key[])
+{
+	const char *name = (const char *) key[DENTRIES_KEY_NAME];
+	unsigned long h = key[DENTRIES_KEY_PARENT] / sizeof(tmpfs_node_t);
+
+	while (*name)
+		h = h * 31 + (uint8_t) *name++;
+
+	return h % dentries_buckets;
+}
+
+static int dentries_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_instance(item, tmpfs_dentry_t,
+	    dh_link);
+	const char *name = (const char *) key[DENTRIES_KEY_NAME];
+	tmpfs_node_t *parentp = (tmpfs_node_t *) key[DENTRIES_KEY_PARENT];
+
+	assert(keys == 2);
+	return ((dentryp->parent == parentp) &&
+	    (str_cmp(dentryp->name, name) == 0));
+}
+
+static void dentries_key_get(link_t *item, unsigned long key[])
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_instance(item, tmpfs_dentry_t,
+	    dh_link);
+
+	key[DENTRIES_KEY_PARENT] = (unsigned long) dentryp->parent;
+	key[DENTRIES_KEY_NAME] = (unsigned long) dentryp->name;
+}
+
+static void tmpfs_dentry_destroy(tmpfs_dentry_t *dentryp)
+{
+	list_remove(&dentryp->link);
+	list_remove(&dentryp->dh_link);
+	dentries_count--;
+	free(dentryp->name);
+	free(dentryp);
+}
+
+static void dentries_remove_callback(link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_instance(item, tmpfs_dentry_t,
+	    dh_link);
+
+	/* The dentry was already removed from the hash table. */
+	link_initialize(&dentryp->dh_link);
+	tmpfs_dentry_destroy(dentryp);
+}
+
+/** TMPFS dentries hash table operations. */
+hash_table_operations_t dentries_ops = {
+	.hash = dentries_hash,
+	.compare = dentries_compare,
+	.remove_callback = dentries_remove_callback
+};
+
+static tmpfs_dentry_t *tmpfs_dentry_find(tmpfs_node_t *parentp, const char *nm)
+{
+	unsigned long key[] = {
+		[DENTRIES_KEY_PARENT] = (unsigned long) parentp,
+		[DENTRIES_KEY_NAME] = (unsigned long) nm
+	};
+	link_t *lnk = hash_table_find(&dentries, key);
+
+	if (!lnk)
+		return NULL;
+	return hash_table_get_instance(lnk, tmpfs_dentry_t, dh_link);
+}
+
 static void nodes_remove_callback(link_t *item)
 {
 	tmpfs_node_t *nodep = hash_table_get_instance(item, tmpfs_node_t,
 	    nh_link);
 
+	nodes_count--;
 	while (!list_empty(&nodep->cs_list)) {
 		tmpfs_dentry_t *dentryp = list_get_instance(
 		    list_first(&nodep->cs_list), tmpfs_dentry_t, link);
 
 		assert(nodep->type == TMPFS_DIRECTORY);
-		list_remove(&dentryp->link);
-		free(dentryp);
+		tmpfs_dentry_destroy(dentryp);
 	}
 
 	if (nodep->data) {
 		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
+		tmpfs_data_destroy(nodep);
 	}
 	free(nodep->bp);
 	free(nodep);
@@ -206,6 +364,7 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
 	nodep->data = NULL;
+	nodep->data_height = 0;
 	link_initialize(&nodep->nh_link);
 	list_initialize(&nodep->cs_list);
 }
@@ -213,7 +372,9 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
 {
 	link_initialize(&dentryp->link);
+	link_initialize(&dentryp->dh_link);
 	dentryp->name = NULL;
+	dentryp->parent = NULL;
 	dentryp->node = NULL;
 }
 
@@ -221,6 +382,10 @@ bool tmpfs_init(void)
 {
 	if (!hash_table_create(&nodes, NODES_BUCKETS, 2, &nodes_ops))
 		return false;
+	if (!hash_table_create(&dentries, DENTRIES_BUCKETS, 2, &dentries_ops)) {
+		hash_table_destroy(&nodes);
+		return false;
+	}
 	
 	return true;
 }
@@ -254,18 +419,9 @@ static void tmpfs_instance_done(service_id_t service_id)
 
 int tmpfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
-	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
+	tmpfs_dentry_t *dentryp = tmpfs_dentry_find(TMPFS_NODE(pfn), component);
 
-	list_foreach(parentp->cs_list, lnk) {
-		tmpfs_dentry_t *dentryp;
-		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);
-		if (!str_cmp(dentryp->name, component)) {
-			*rfn = FS_NODE(dentryp->node);
-			return EOK;
-		}
-	}
-
-	*rfn = NULL;
+	*rfn = dentryp ? FS_NODE(dentryp->node) : NULL;
 	return EOK;
 }
 
@@ -335,6 +491,8 @@ int tmpfs_create_node(fs_node_t **rfn, service_id_t service_id, int lflag)
 		[NODES_KEY_INDEX] = nodep->index
 	};
 	hash_table_insert(&nodes, key, &nodep->nh_link);
+	if (++nodes_count > HASH_MAX_LOAD * nodes_buckets)
+		tmpfs_hash_grow(&nodes, &nodes_buckets, nodes_key_get);
 	*rfn = FS_NODE(nodep);
 	return EOK;
 }
@@ -368,11 +526,8 @@ int tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	assert(parentp->type == TMPFS_DIRECTORY);
 
 	/* Check for duplicit entries. */
-	list_foreach(parentp->cs_list, lnk) {
-		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);	
-		if (!str_cmp(dentryp->name, nm))
-			return EEXIST;
-	}
+	if (tmpfs_dentry_find(parentp, nm))
+		return EEXIST;
 
 	/* Allocate and initialize the dentry. */
 	dentryp = malloc(sizeof(tmpfs_dentry_t));
@@ -388,10 +543,19 @@ int tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 		return ENOMEM;
 	}
 	str_cpy(dentryp->name, size + 1, nm);
+	dentryp->parent = parentp;
 	dentryp->node = childp;
 	childp->lnkcnt++;
 	list_append(&dentryp->link, &parentp->cs_list);
 
+	unsigned long key[] = {
+		[DENTRIES_KEY_PARENT] = (unsigned long) parentp,
+		[DENTRIES_KEY_NAME] = (unsigned long) dentryp->name
+	};
+	hash_table_insert(&dentries, key, &dentryp->dh_link);
+	if (++dentries_count > HASH_MAX_LOAD * dentries_buckets)
+		tmpfs_hash_grow(&dentries, &dentries_buckets, dentries_key_get);
+
 	return EOK;
 }
 
@@ -404,13 +568,10 @@ int tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (!parentp)
 		return EBUSY;
 	
-	list_foreach(parentp->cs_list, lnk) {
-		dentryp = list_get_instance(lnk, tmpfs_dentry_t, link);
-		if (!str_cmp(dentryp->name, nm)) {
-			childp = dentryp->node;
-			assert(FS_NODE(childp) == cfn);
-			break;
-		}
+	dentryp = tmpfs_dentry_find(parentp, nm);
+	if (dentryp) {
+		childp = dentryp->node;
+		assert(FS_NODE(childp) == cfn);
 	}
 
 	if (!childp)
@@ -419,8 +580,7 @@ int tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
 		return ENOTEMPTY;
 
-	list_remove(&dentryp->link);
-	free(dentryp);
+	tmpfs_dentry_destroy(dentryp);
 	childp->lnkcnt--;
 
 	return EOK;
@@ -498,9 +658,47 @@ static int tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
-		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(callid, nodep->data + pos,
-		    bytes);
+		/* Pages which have never been written read as zeros. */
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		void *page = NULL;
+
+		bytes = 0;
+		if (pos < nodep->size)
+			bytes = min(nodep->size - pos, size);
+
+		if (off + bytes <= TMPFS_PAGE_SIZE) {
+			/* The data can be served directly from the page. */
+			if (bytes > 0)
+				page = tmpfs_data_page(nodep,
+				    pos / TMPFS_PAGE_SIZE, false);
+			(void) async_data_read_finalize(callid,
+			    page ? page + off : tmpfs_zero_page, bytes);
+		} else {
+			/* Gather the pages into one buffer. */
+			bytes = min(bytes, VFS_XFER_MAX);
+			uint8_t *buf = malloc(bytes);
+			if (!buf) {
+				async_answer_0(callid, ENOMEM);
+				return ENOMEM;
+			}
+
+			size_t done = 0;
+			while (done < bytes) {
+				aoff64_t cur = pos + done;
+				size_t chunk = min(bytes - done,
+				    TMPFS_PAGE_SIZE - cur % TMPFS_PAGE_SIZE);
+
+				page = tmpfs_data_page(nodep,
+				    cur / TMPFS_PAGE_SIZE, false);
+				memcpy(buf + done, page ?
+				    page + cur % TMPFS_PAGE_SIZE :
+				    tmpfs_zero_page, chunk);
+				done += chunk;
+			}
+
+			(void) async_data_read_finalize(callid, buf, bytes);
+			free(buf);
+		}
 	} else {
 		tmpfs_dentry_t *dentryp;
 		link_t *lnk;
@@ -559,33 +757,74 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	}
 
 	/*
-	 * Check whether the file needs to grow.
-	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(callid, nodep->data + pos,
-		    size);
-		goto out;
-	}
-	size_t delta = (pos + size) - nodep->size;
-	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
+	 * Pages are allocated if the write lands in a hole or extends the
+	 * file.
 	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
+	size_t off = pos % TMPFS_PAGE_SIZE;
+	if (off + size > TMPFS_PAGE_SIZE)
+		size = min(size, VFS_XFER_MAX);
+	if (pos + size > SIZE_MAX) {
 		async_answer_0(callid, ENOMEM);
 		size = 0;
 		goto out;
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(callid, nodep->data + pos, size);
+
+	if (off + size <= TMPFS_PAGE_SIZE) {
+		/* The data can be received directly into the page. */
+		void *page = tmpfs_data_page(nodep, pos / TMPFS_PAGE_SIZE,
+		    true);
+		if (!page) {
+			async_answer_0(callid, ENOMEM);
+			size = 0;
+			goto out;
+		}
+		(void) async_data_write_finalize(callid, page + off, size);
+	} else {
+		/*
+		 * Allocate the pages first so that a short write can be
+		 * reported before any data is accepted.
+		 */
+		size_t done = 0;
+		while (done < size) {
+			aoff64_t cur = pos + done;
+			if (!tmpfs_data_page(nodep, cur / TMPFS_PAGE_SIZE,
+			    true))
+				break;
+			done += TMPFS_PAGE_SIZE - cur % TMPFS_PAGE_SIZE;
+		}
+		size = min(size, done);
+
+		uint8_t *buf = (size > 0) ? malloc(size) : NULL;
+		if (!buf) {
+			async_answer_0(callid, ENOMEM);
+			size = 0;
+			goto out;
+		}
+
+		int rc = async_data_write_finalize(callid, buf, size);
+		if (rc != EOK) {
+			free(buf);
+			size = 0;
+			goto out;
+		}
+
+		done = 0;
+		while (done < size) {
+			aoff64_t cur = pos + done;
+			size_t chunk = min(size - done,
+			    TMPFS_PAGE_SIZE - cur % TMPFS_PAGE_SIZE);
+			void *page = tmpfs_data_page(nodep,
+			    cur / TMPFS_PAGE_SIZE, false);
+
+			memcpy(page + cur % TMPFS_PAGE_SIZE, buf + done, chunk);
+			done += chunk;
+		}
+
+		free(buf);
+	}
+
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -614,17 +853,8 @@ static int tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size > SIZE_MAX)
 		return ENOMEM;
 	
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata)
-		return ENOMEM;
-	
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
-	}
-	
-	nodep->size = size;
-	nodep->data = newdata;
+	/* Growing the file only creates a hole which reads as zeros. */
+	tmpfs_data_truncate(nodep, size);
 	return EOK;
 }
 
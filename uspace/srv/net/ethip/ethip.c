@@ -100,6 +100,8 @@ int ethip_iplink_init(ethip_nic_t *nic)
 	iplink_srv_init(&nic->iplink);
 	nic->iplink.ops = &ethip_iplink_ops;
 	nic->iplink.arg = nic;
+	nic->iplink.headroom = sizeof(eth_header_t);
+	nic->iplink.tailroom = ETH_FRAME_MIN_SIZE - sizeof(eth_header_t);
 
 	rc = asprintf(&svc_name, "net/eth%u", ++link_num);
 	if (rc < 0) {
@@ -187,6 +189,11 @@ static int ethip_send(iplink_srv_t *srv, iplink_srv_sdu_t *sdu)
 	frame.data = sdu->data;
 	frame.size = sdu->size;
 
+	/* Prepend header in the space reserved by iplink_srv */
+	if (sdu->pbuf != NULL && sdu->pbuf->data == sdu->data &&
+	    eth_pdu_encode_pbuf(&frame, sdu->pbuf) == EOK)
+		return ethip_nic_send_pbuf(nic, sdu->pbuf);
+
 	rc = eth_pdu_encode(&frame, &data, &size);
 	if (rc != EOK)
 		return rc;
@@ -197,7 +204,12 @@ static int ethip_send(iplink_srv_t *srv, iplink_srv_sdu_t *sdu)
 	return rc;
 }
 
-int ethip_received(iplink_srv_t *srv, void *data, size_t size)
+/** Process frame received from the NIC.
+ *
+ * @param srv	IP link service
+ * @param pbuf	Buffer holding the frame, IP payload is passed on in it
+ */
+int ethip_received(iplink_srv_t *srv, pbuf_t *pbuf)
 {
 	log_msg(LVL_DEBUG, "ethip_received(): srv=%p", srv);
 	ethip_nic_t *nic = (ethip_nic_t *)srv->arg;
@@ -208,7 +220,7 @@ int ethip_received(iplink_srv_t *srv, void *data, size_t size)
 	log_msg(LVL_DEBUG, "ethip_received()");
 
 	log_msg(LVL_DEBUG, " - eth_pdu_decode");
-	rc = eth_pdu_decode(data, size, &frame);
+	rc = eth_pdu_decode(pbuf->data, pbuf->size, &frame);
 	if (rc != EOK) {
 		log_msg(LVL_DEBUG, " - eth_pdu_decode failed");
 		return rc;
@@ -222,8 +234,10 @@ int ethip_received(iplink_srv_t *srv, void *data, size_t size)
 		log_msg(LVL_DEBUG, " - construct SDU");
 		sdu.lsrc.ipv4 = (192 << 24) | (168 << 16) | (0 << 8) | 1;
 		sdu.ldest.ipv4 = (192 << 24) | (168 << 16) | (0 << 8) | 4;
+		pbuf_pull(pbuf, sizeof(eth_header_t));
 		sdu.data = frame.data;
 		sdu.size = frame.size;
+		sdu.pbuf = pbuf;
 		log_msg(LVL_DEBUG, " - call iplink_ev_recv");
 		rc = iplink_ev_recv(&nic->iplink, &sdu);
 		break;
@@ -232,7 +246,6 @@ int ethip_received(iplink_srv_t *srv, void *data, size_t size)
 		    frame.etype_len);
 	}
 
-	free(frame.data);
 	return rc;
 }
 
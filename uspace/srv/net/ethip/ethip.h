@@ -41,6 +41,7 @@
 #include <async.h>
 #include <inet/iplink_srv.h>
 #include <loc.h>
+#include <net/pbuf.h>
 #include <sys/types.h>
 
 #define MAC48_BROADCAST 0xffffffffffff
@@ -61,6 +62,10 @@ typedef struct ethip_nic {
 	service_id_t svc_id;
 	char *svc_name;
 	async_sess_t *sess;
+	/** Our areas holding frames to be sent, shared with the NIC */
+	pbuf_share_t send_share;
+	/** NIC's areas holding received frames */
+	pbuf_share_t recv_share;
 
 	iplink_srv_t iplink;
 	service_id_t iplink_sid;
@@ -118,7 +123,7 @@ typedef struct {
 } ethip_atrans_t;
 
 extern int ethip_iplink_init(ethip_nic_t *);
-extern int ethip_received(iplink_srv_t *, void *, size_t);
+extern int ethip_received(iplink_srv_t *, pbuf_t *);
 
 #endif
 
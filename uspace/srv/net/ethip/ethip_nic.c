@@ -43,6 +43,7 @@
 #include <io/log.h>
 #include <loc.h>
 #include <device/nic.h>
+#include <net/pbuf.h>
 #include <stdlib.h>
 
 #include "ethip.h"
@@ -116,6 +117,8 @@ static ethip_nic_t *ethip_nic_new(void)
 
 	link_initialize(&nic->nic_list);
 	list_initialize(&nic->addr_list);
+	pbuf_share_init(&nic->send_share);
+	pbuf_share_init(&nic->recv_share);
 
 	return nic;
 }
@@ -232,24 +235,24 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_callid_t callid,
     ipc_call_t *call)
 {
 	int rc;
-	void *data;
-	size_t size;
+	pbuf_t *pbuf;
 
 	log_msg(LVL_DEBUG, "ethip_nic_received() nic=%p", nic);
 
-	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	rc = pbuf_receive(&nic->recv_share, &pbuf, 0, 0);
 	if (rc != EOK) {
-		log_msg(LVL_DEBUG, "data_write_accept() failed");
+		log_msg(LVL_DEBUG, "pbuf_receive() failed");
+		async_answer_0(callid, rc);
 		return;
 	}
 
 	log_msg(LVL_DEBUG, "Ethernet PDU contents (%zu bytes)",
-	    size);
+	    pbuf->size);
 
+	/* The frame can be borrowed from the NIC until we answer */
 	log_msg(LVL_DEBUG, "call ethip_received");
-	rc = ethip_received(&nic->iplink, data, size);
-	log_msg(LVL_DEBUG, "free data");
-	free(data);
+	rc = ethip_received(&nic->iplink, pbuf);
+	pbuf_delref(pbuf);
 
 	log_msg(LVL_DEBUG, "ethip_nic_received() done, rc=%d", rc);
 	async_answer_0(callid, rc);
@@ -334,6 +337,16 @@ int ethip_nic_send(ethip_nic_t *nic, void *data, size_t size)
 	return rc;
 }
 
+/** Send frame held in a packet buffer, without copying it if possible. */
+int ethip_nic_send_pbuf(ethip_nic_t *nic, pbuf_t *pbuf)
+{
+	int rc;
+	log_msg(LVL_DEBUG, "ethip_nic_send_pbuf(size=%zu)", pbuf->size);
+	rc = nic_send_frame_pbuf(nic->sess, &nic->send_share, pbuf);
+	log_msg(LVL_DEBUG, "nic_send_frame_pbuf -> %d", rc);
+	return rc;
+}
+
 int ethip_nic_addr_add(ethip_nic_t *nic, iplink_srv_addr_t *addr)
 {
 	ethip_link_addr_t *laddr;
@@ -43,6 +43,7 @@
 extern int ethip_nic_discovery_start(void);
 extern ethip_nic_t *ethip_nic_find_by_iplink_sid(service_id_t);
 extern int ethip_nic_send(ethip_nic_t *, void *, size_t);
+extern int ethip_nic_send_pbuf(ethip_nic_t *, pbuf_t *);
 extern int ethip_nic_addr_add(ethip_nic_t *, iplink_srv_addr_t *);
 extern int ethip_nic_addr_remove(ethip_nic_t *, iplink_srv_addr_t *);
 extern ethip_link_addr_t *ethip_nic_addr_find(ethip_nic_t *,
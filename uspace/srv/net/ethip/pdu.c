@@ -47,12 +47,18 @@
 
 #define MAC48_BYTES 6
 
+static void eth_header_encode(eth_frame_t *frame, eth_header_t *hdr)
+{
+	mac48_encode(&frame->src, hdr->src);
+	mac48_encode(&frame->dest, hdr->dest);
+	hdr->etype_len = host2uint16_t_be(frame->etype_len);
+}
+
 /** Encode Ethernet PDU. */
 int eth_pdu_encode(eth_frame_t *frame, void **rdata, size_t *rsize)
 {
 	void *data;
 	size_t size;
-	eth_header_t *hdr;
 
 	size = max(sizeof(eth_header_t) + frame->size, ETH_FRAME_MIN_SIZE);
 
@@ -60,11 +66,7 @@ int eth_pdu_encode(eth_frame_t *frame, void **rdata, size_t *rsize)
 	if (data == NULL)
 		return ENOMEM;
 
-	hdr = (eth_header_t *)data;
-	mac48_encode(&frame->src, hdr->src);
-	mac48_encode(&frame->dest, hdr->dest);
-	hdr->etype_len = host2uint16_t_be(frame->etype_len);
-
+	eth_header_encode(frame, (eth_header_t *)data);
 	memcpy((uint8_t *)data + sizeof(eth_header_t), frame->data,
 	    frame->size);
 
@@ -77,6 +79,42 @@ int eth_pdu_encode(eth_frame_t *frame, void **rdata, size_t *rsize)
 	return EOK;
 }
 
+/** Encode Ethernet PDU in place.
+ *
+ * The header is prepended to the payload in @a pbuf and the frame is padded
+ * to the minimum size, without copying the payload.
+ *
+ * @param frame	Frame addresses and type, payload fields are ignored
+ * @param pbuf	Buffer holding the payload
+ * @return	EOK on success, ENOSPC if the buffer does not have enough
+ *		head or tail room
+ */
+int eth_pdu_encode_pbuf(eth_frame_t *frame, pbuf_t *pbuf)
+{
+	size_t pad;
+	void *tail;
+	eth_header_t *hdr;
+
+	pad = 0;
+	if (sizeof(eth_header_t) + pbuf->size < ETH_FRAME_MIN_SIZE)
+		pad = ETH_FRAME_MIN_SIZE - sizeof(eth_header_t) - pbuf->size;
+
+	if (pbuf_headroom(pbuf) < sizeof(eth_header_t) ||
+	    pbuf_tailroom(pbuf) < pad)
+		return ENOSPC;
+
+	tail = pbuf_put(pbuf, pad);
+	memset(tail, 0, pad);
+
+	hdr = pbuf_push(pbuf, sizeof(eth_header_t));
+	eth_header_encode(frame, hdr);
+
+	log_msg(LVL_DEBUG, "Encoded Ethernet frame in place (%zu bytes)",
+	    pbuf->size);
+
+	return EOK;
+}
+
 /** Decode Ethernet PDU. */
 int eth_pdu_decode(void *data, size_t size, eth_frame_t *frame)
 {
@@ -91,18 +129,14 @@ int eth_pdu_decode(void *data, size_t size, eth_frame_t *frame)
 
 	hdr = (eth_header_t *)data;
 
+	/* Payload is not copied, it points into the PDU */
 	frame->size = size - sizeof(eth_header_t);
-	frame->data = calloc(frame->size, 1);
-	if (frame->data == NULL)
-		return ENOMEM;
+	frame->data = (uint8_t *)data + sizeof(eth_header_t);
 
 	mac48_decode(hdr->src, &frame->src);
 	mac48_decode(hdr->dest, &frame->dest);
 	frame->etype_len = uint16_t_be2host(hdr->etype_len);
 
-	memcpy(frame->data, (uint8_t *)data + sizeof(eth_header_t),
-	    frame->size);
-
 	log_msg(LVL_DEBUG, "Decoding Ethernet frame src=%llx dest=%llx etype=%x",
 	    frame->src, frame->dest, frame->etype_len);
 	log_msg(LVL_DEBUG, "Decoded Ethernet frame payload (%zu bytes)", frame->size);
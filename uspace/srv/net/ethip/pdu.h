@@ -37,9 +37,11 @@
 #ifndef ETH_PDU_H_
 #define ETH_PDU_H_
 
+#include <net/pbuf.h>
 #include "ethip.h"
 
 extern int eth_pdu_encode(eth_frame_t *, void **, size_t *);
+extern int eth_pdu_encode_pbuf(eth_frame_t *, pbuf_t *);
 extern int eth_pdu_decode(void *, size_t, eth_frame_t *);
 extern void mac48_encode(mac48_addr_t *, void *);
 extern void mac48_decode(void *, mac48_addr_t *);
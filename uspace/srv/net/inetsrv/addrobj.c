@@ -34,6 +34,8 @@
  * @brief
  */
 
+#include <adt/hash_table.h>
+#include <adt/ptrie.h>
 #include <bitops.h>
 #include <errno.h>
 #include <fibril_synch.h>
@@ -46,6 +48,9 @@
 #include "inetsrv.h"
 #include "inet_link.h"
 #include "inet_util.h"
+#include "rtcache.h"
+
+#define ADDR_HASH_BUCKETS 64
 
 static inet_addrobj_t *inet_addrobj_find_by_name_locked(const char *, inet_link_t *);
 
@@ -53,6 +58,47 @@ static FIBRIL_MUTEX_INITIALIZE(addr_list_lock);
 static LIST_INITIALIZE(addr_list);
 static sysarg_t addr_id = 0;
 
+/** Address objects by network prefix */
+static ptrie_t addr_trie;
+/** Address objects by local address */
+static hash_table_t addr_hash;
+
+static hash_index_t addr_hash_hash(unsigned long key[])
+{
+	return (key[0] ^ (key[0] >> 16)) % ADDR_HASH_BUCKETS;
+}
+
+static int addr_hash_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	inet_addrobj_t *addr = hash_table_get_instance(item, inet_addrobj_t,
+	    addr_hash);
+
+	return addr->naddr.ipv4 == key[0];
+}
+
+static void addr_hash_remove_callback(link_t *item)
+{
+}
+
+static hash_table_operations_t addr_hash_ops = {
+	.hash = addr_hash_hash,
+	.compare = addr_hash_compare,
+	.remove_callback = addr_hash_remove_callback
+};
+
+/** Initialize address object lookup structures. */
+int inet_addrobj_init(void)
+{
+	ptrie_init(&addr_trie);
+
+	if (!hash_table_create(&addr_hash, ADDR_HASH_BUCKETS, 1,
+	    &addr_hash_ops))
+		return ENOMEM;
+
+	return EOK;
+}
+
 inet_addrobj_t *inet_addrobj_new(void)
 {
 	inet_addrobj_t *addr = calloc(1, sizeof(inet_addrobj_t));
@@ -64,6 +110,8 @@ inet_addrobj_t *inet_addrobj_new(void)
 	}
 
 	link_initialize(&addr->addr_list);
+	link_initialize(&addr->addr_trie);
+	link_initialize(&addr->addr_hash);
 	fibril_mutex_lock(&addr_list_lock);
 	addr->id = ++addr_id;
 	fibril_mutex_unlock(&addr_list_lock);
@@ -81,6 +129,8 @@ void inet_addrobj_delete(inet_addrobj_t *addr)
 int inet_addrobj_add(inet_addrobj_t *addr)
 {
 	inet_addrobj_t *aobj;
+	unsigned long key;
+	int rc;
 
 	fibril_mutex_lock(&addr_list_lock);
 	aobj = inet_addrobj_find_by_name_locked(addr->name, addr->ilink);
@@ -90,17 +140,33 @@ int inet_addrobj_add(inet_addrobj_t *addr)
 		return EEXISTS;
 	}
 
+	rc = ptrie_insert(&addr_trie, addr->naddr.ipv4, addr->naddr.bits,
+	    &addr->addr_trie);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&addr_list_lock);
+		return rc;
+	}
+
+	key = addr->naddr.ipv4;
+	hash_table_insert(&addr_hash, &key, &addr->addr_hash);
 	list_append(&addr->addr_list, &addr_list);
 	fibril_mutex_unlock(&addr_list_lock);
 
+	inet_rtcache_flush();
+
 	return EOK;
 }
 
 void inet_addrobj_remove(inet_addrobj_t *addr)
 {
 	fibril_mutex_lock(&addr_list_lock);
+	ptrie_remove(&addr_trie, addr->naddr.ipv4, addr->naddr.bits,
+	    &addr->addr_trie);
+	list_remove(&addr->addr_hash);
 	list_remove(&addr->addr_list);
 	fibril_mutex_unlock(&addr_list_lock);
+
+	inet_rtcache_flush();
 }
 
 /** Find address object matching address @a addr.
@@ -111,29 +177,34 @@ void inet_addrobj_remove(inet_addrobj_t *addr)
  */
 inet_addrobj_t *inet_addrobj_find(inet_addr_t *addr, inet_addrobj_find_t find)
 {
-	uint32_t mask;
+	inet_addrobj_t *naddr;
+	unsigned long key;
+	link_t *link;
 
 	log_msg(LVL_DEBUG, "inet_addrobj_find(%x)", (unsigned)addr->ipv4);
 
 	fibril_mutex_lock(&addr_list_lock);
 
-	list_foreach(addr_list, link) {
-		inet_addrobj_t *naddr = list_get_instance(link,
-		    inet_addrobj_t, addr_list);
-
-		mask = inet_netmask(naddr->naddr.bits);
-		if ((naddr->naddr.ipv4 & mask) == (addr->ipv4 & mask)) {
-			fibril_mutex_unlock(&addr_list_lock);
-			log_msg(LVL_DEBUG, "inet_addrobj_find: found %p",
-			    naddr);
-			return naddr;
-		}
+	if (find == iaf_addr) {
+		key = addr->ipv4;
+		link = hash_table_find(&addr_hash, &key);
+		naddr = (link != NULL) ? hash_table_get_instance(link,
+		    inet_addrobj_t, addr_hash) : NULL;
+	} else {
+		/* Most specific network wins */
+		link = ptrie_lookup(&addr_trie, addr->ipv4);
+		naddr = (link != NULL) ? list_get_instance(link,
+		    inet_addrobj_t, addr_trie) : NULL;
 	}
 
-	log_msg(LVL_DEBUG, "inet_addrobj_find: Not found");
 	fibril_mutex_unlock(&addr_list_lock);
 
-	return NULL;
+	if (naddr != NULL)
+		log_msg(LVL_DEBUG, "inet_addrobj_find: found %p", naddr);
+	else
+		log_msg(LVL_DEBUG, "inet_addrobj_find: Not found");
+
+	return naddr;
 }
 
 /** Find address object on a link, with a specific name.
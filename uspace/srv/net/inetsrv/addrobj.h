@@ -47,6 +47,7 @@ typedef enum {
 	iaf_addr
 } inet_addrobj_find_t;
 
+extern int inet_addrobj_init(void);
 extern inet_addrobj_t *inet_addrobj_new(void);
 extern void inet_addrobj_delete(inet_addrobj_t *);
 extern int inet_addrobj_add(inet_addrobj_t *);
@@ -91,7 +91,7 @@ static int icmp_recv_echo_request(inet_dgram_t *dgram)
 	request = (icmp_echo_t *)dgram->data;
 	size = dgram->size;
 
-	reply = calloc(size, 1);
+	reply = malloc(size);
 	if (reply == NULL)
 		return ENOMEM;
 
@@ -99,9 +99,11 @@ static int icmp_recv_echo_request(inet_dgram_t *dgram)
 
 	reply->type = ICMP_ECHO_REPLY;
 	reply->code = 0;
-	reply->checksum = 0;
 
-	checksum = inet_checksum_calc(INET_CHECKSUM_INIT, reply, size);
+	/* Only the type and code word changes, update checksum (RFC 1624) */
+	checksum = inet_checksum_update16(uint16_t_be2host(request->checksum),
+	    ((uint16_t) request->type << 8) | request->code,
+	    ((uint16_t) reply->type << 8) | reply->code);
 	reply->checksum = host2uint16_t_be(checksum);
 
 	rdgram.src = dgram->dest;
@@ -109,6 +111,7 @@ static int icmp_recv_echo_request(inet_dgram_t *dgram)
 	rdgram.tos = ICMP_TOS;
 	rdgram.data = reply;
 	rdgram.size = size;
+	rdgram.pbuf = NULL;
 
 	rc = inet_route_packet(&rdgram, IP_PROTO_ICMP, INET_TTL_MAX, 0);
 
@@ -172,6 +175,7 @@ int icmp_ping_send(uint16_t ident, inetping_sdu_t *sdu)
 	dgram.tos = ICMP_TOS;
 	dgram.data = rdata;
 	dgram.size = rsize;
+	dgram.pbuf = NULL;
 
 	rc = inet_route_packet(&dgram, IP_PROTO_ICMP, INET_TTL_MAX, 0);
 
@@ -40,6 +40,7 @@
 #include <inet/iplink.h>
 #include <io/log.h>
 #include <loc.h>
+#include <net/pbuf.h>
 #include <stdlib.h>
 #include <str.h>
 
@@ -70,10 +71,14 @@ static int inet_iplink_recv(iplink_t *iplink, iplink_sdu_t *sdu)
 		return rc;
 	}
 
+	/* Narrow the buffer to the payload so that it can be passed on */
+	packet.pbuf = sdu->pbuf;
+	pbuf_pull(packet.pbuf, (uint8_t *) packet.data - packet.pbuf->data);
+	pbuf_trim(packet.pbuf, packet.size);
+
 	log_msg(LVL_DEBUG, "call inet_recv_packet()");
 	rc = inet_recv_packet(&packet);
 	log_msg(LVL_DEBUG, "call inet_recv_packet -> %d", rc);
-	free(packet.data);
 
 	return rc;
 }
@@ -273,10 +278,30 @@ int inet_link_send_dgram(inet_link_t *ilink, inet_addr_t *lsrc,
 	packet.df = df;
 	packet.data = dgram->data;
 	packet.size = dgram->size;
+	packet.pbuf = dgram->pbuf;
 
 	sdu.lsrc.ipv4 = lsrc->ipv4;
 	sdu.ldest.ipv4 = ldest->ipv4;
 
+	/*
+	 * Unless the datagram needs to be fragmented, prepend the header
+	 * in place and pass the buffer on without copying the payload.
+	 */
+	if (dgram->pbuf != NULL &&
+	    inet_pdu_encode_pbuf(&packet, ilink->def_mtu, dgram->pbuf) == EOK) {
+		sdu.pbuf = dgram->pbuf;
+		sdu.data = sdu.pbuf->data;
+		sdu.size = sdu.pbuf->size;
+
+		rc = iplink_send(ilink->iplink, &sdu);
+
+		/* Restore the datagram */
+		pbuf_pull(sdu.pbuf, sdu.size - packet.size);
+		return rc;
+	}
+
+	sdu.pbuf = NULL;
+
 	offs = 0;
 	do {
 		/* Encode one fragment */
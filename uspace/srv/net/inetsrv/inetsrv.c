@@ -42,8 +42,10 @@
 #include <ipc/inet.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <net/pbuf.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <str.h>
 #include <sys/types.h>
 
 #include "addrobj.h"
@@ -54,7 +56,9 @@
 #include "inetping.h"
 #include "inet_link.h"
 #include "reass.h"
+#include "rtcache.h"
 #include "sroute.h"
+#include "test.h"
 
 #define NAME "inetsrv"
 
@@ -69,7 +73,19 @@ static int inet_init(void)
 	
 	async_set_client_connection(inet_client_conn);
 	
-	int rc = loc_server_register(NAME);
+	int rc = inet_addrobj_init();
+	if (rc != EOK) {
+		log_msg(LVL_ERROR, "Failed initializing address objects.");
+		return ENOMEM;
+	}
+	
+	rc = inet_reass_init();
+	if (rc != EOK) {
+		log_msg(LVL_ERROR, "Failed initializing datagram reassembly.");
+		return ENOMEM;
+	}
+	
+	rc = loc_server_register(NAME);
 	if (rc != EOK) {
 		log_msg(LVL_ERROR, "Failed registering server (%d).", rc);
 		return EEXIST;
@@ -123,10 +139,14 @@ static int inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
     inet_dir_t *dir)
 {
 	inet_sroute_t *sr;
+	unsigned gen;
 
 	/* XXX Handle case where source address is specified */
 	(void) src;
 
+	if (inet_rtcache_lookup(dest, dir, &gen))
+		return EOK;
+
 	dir->aobj = inet_addrobj_find(dest, iaf_net);
 	if (dir->aobj != NULL) {
 		dir->ldest = *dest;
@@ -146,6 +166,7 @@ static int inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
 		return ENOENT;
 	}
 
+	inet_rtcache_insert(dest, dir, gen);
 	return EOK;
 }
 
@@ -219,15 +240,19 @@ static void inet_send_srv(inet_client_t *client, ipc_callid_t callid,
 	ttl = IPC_GET_ARG4(*call);
 	df = IPC_GET_ARG5(*call);
 
-	rc = async_data_write_accept(&dgram.data, false, 0, 0, 0, &dgram.size);
+	rc = pbuf_receive(&client->send_share, &dgram.pbuf, INET_HEADROOM,
+	    INET_TAILROOM);
 	if (rc != EOK) {
 		async_answer_0(callid, rc);
 		return;
 	}
 
+	dgram.data = dgram.pbuf->data;
+	dgram.size = dgram.pbuf->size;
+
 	rc = inet_send(client, &dgram, client->protocol, ttl, df);
 
-	free(dgram.data);
+	pbuf_delref(dgram.pbuf);
 	async_answer_0(callid, rc);
 }
 
@@ -251,6 +276,8 @@ static void inet_set_proto_srv(inet_client_t *client, ipc_callid_t callid,
 static void inet_client_init(inet_client_t *client)
 {
 	client->sess = NULL;
+	pbuf_share_init(&client->send_share);
+	pbuf_share_init(&client->recv_share);
 
 	fibril_mutex_lock(&client_list_lock);
 	list_append(&client->client_list, &client_list);
@@ -259,12 +286,16 @@ static void inet_client_init(inet_client_t *client)
 
 static void inet_client_fini(inet_client_t *client)
 {
-	async_hangup(client->sess);
+	if (client->sess != NULL)
+		async_hangup(client->sess);
 	client->sess = NULL;
 
 	fibril_mutex_lock(&client_list_lock);
 	list_remove(&client->client_list);
 	fibril_mutex_unlock(&client_list_lock);
+
+	pbuf_share_fini(&client->send_share);
+	pbuf_share_fini(&client->recv_share);
 }
 
 static void inet_default_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
@@ -286,7 +317,7 @@ static void inet_default_conn(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		if (!method) {
 			/* The other side has hung up */
 			async_answer_0(callid, EOK);
-			return;
+			break;
 		}
 
 		switch (method) {
@@ -357,7 +388,11 @@ int inet_ev_recv(inet_client_t *client, inet_dgram_t *dgram)
 	ipc_call_t answer;
 	aid_t req = async_send_3(exch, INET_EV_RECV, dgram->src.ipv4,
 	    dgram->dest.ipv4, dgram->tos, &answer);
-	int rc = async_data_write_start(exch, dgram->data, dgram->size);
+	int rc;
+	if (dgram->pbuf != NULL)
+		rc = pbuf_send(&client->recv_share, exch, dgram->pbuf);
+	else
+		rc = async_data_write_start(exch, dgram->data, dgram->size);
 	async_exchange_end(exch);
 
 	if (rc != EOK) {
@@ -410,6 +445,7 @@ int inet_recv_packet(inet_packet_t *packet)
 			dgram.tos = packet->tos;
 			dgram.data = packet->data;
 			dgram.size = packet->size;
+			dgram.pbuf = packet->pbuf;
 
 			return inet_recv_dgram_local(&dgram, packet->proto);
 		} else {
@@ -421,6 +457,36 @@ int inet_recv_packet(inet_packet_t *packet)
 	return ENOENT;
 }
 
+/** Internal test fibril. */
+static int inet_test_fibril(void *arg)
+{
+	exit(inet_reass_test() == EOK ? 0 : 1);
+
+	/* Not reached */
+	return 0;
+}
+
+/** Run the internal test of datagram reassembly.
+ *
+ * Usage: inetsrv --test
+ */
+static int inet_test_main(void)
+{
+	fid_t fid;
+
+	fid = fibril_create(inet_test_fibril, NULL);
+	if (fid == 0) {
+		printf(NAME ": Failed creating test fibril.\n");
+		return 1;
+	}
+
+	fibril_add_ready(fid);
+	async_manager();
+
+	/* Not reached */
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int rc;
@@ -432,6 +498,9 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	if (argc > 1 && str_cmp(argv[1], "--test") == 0)
+		return inet_test_main();
+
 	rc = inet_init();
 	if (rc != EOK)
 		return 1;
@@ -41,6 +41,7 @@
 #include <bool.h>
 #include <inet/iplink.h>
 #include <ipc/loc.h>
+#include <net/pbuf.h>
 #include <sys/types.h>
 #include <async.h>
 
@@ -49,6 +50,10 @@ typedef struct {
 	async_sess_t *sess;
 	uint8_t protocol;
 	link_t client_list;
+	/** Client's areas holding datagrams to be sent */
+	pbuf_share_t send_share;
+	/** Our areas holding received datagrams, shared with the client */
+	pbuf_share_t recv_share;
 } inet_client_t;
 
 /** Inetping Client */
@@ -125,6 +130,8 @@ typedef struct {
 	void *data;
 	/** Packet data size in bytes */
 	size_t size;
+	/** Buffer holding exactly @c data or @c NULL */
+	pbuf_t *pbuf;
 } inet_packet_t;
 
 typedef struct {
@@ -133,6 +140,8 @@ typedef struct {
 	uint8_t tos;
 	void *data;
 	size_t size;
+	/** Buffer holding exactly @c data or @c NULL */
+	pbuf_t *pbuf;
 } inet_dgram_t;
 
 typedef struct {
@@ -146,6 +155,10 @@ typedef struct {
 
 typedef struct {
 	link_t addr_list;
+	/** Link in network prefix trie */
+	link_t addr_trie;
+	/** Link in local address hash */
+	link_t addr_hash;
 	sysarg_t id;
 	inet_naddr_t naddr;
 	inet_link_t *ilink;
@@ -155,6 +168,8 @@ typedef struct {
 /** Static route configuration */
 typedef struct {
 	link_t sroute_list;
+	/** Link in destination prefix trie */
+	link_t sroute_trie;
 	sysarg_t id;
 	/** Destination network */
 	inet_naddr_t dest;
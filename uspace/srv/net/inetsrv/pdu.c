@@ -51,40 +51,41 @@
 static FIBRIL_MUTEX_INITIALIZE(ip_ident_lock);
 static uint16_t ip_ident = 0;
 
-/** One's complement addition.
+/** Encode IP header.
  *
- * Result is a + b + carry.
+ * @param packet	Packet to encode header for
+ * @param hdr		Place to store the header (sizeof(ip_header_t) bytes)
+ * @param size		Total PDU size in bytes
+ * @param flags_foff	Value of the flags and fragment offset field
  */
-static uint16_t inet_ocadd16(uint16_t a, uint16_t b)
+static void inet_header_encode(inet_packet_t *packet, ip_header_t *hdr,
+    size_t size, uint16_t flags_foff)
 {
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
+	uint16_t chksum;
+	uint16_t ident;
 
-uint16_t inet_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2*i] << 8) | bdata[2*i + 1];
-		sum = inet_ocadd16(sum, w);
-	}
+	/* Allocate identifier */
+	fibril_mutex_lock(&ip_ident_lock);
+	ident = ++ip_ident;
+	fibril_mutex_unlock(&ip_ident_lock);
 
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2*words] << 8);
-		sum = inet_ocadd16(sum, w);
-	}
+	/* Encode header fields */
+	hdr->ver_ihl = (4 << VI_VERSION_l) |
+	    (sizeof(ip_header_t) / sizeof(uint32_t));
+	hdr->tos = packet->tos;
+	hdr->tot_len = host2uint16_t_be(size);
+	hdr->id = host2uint16_t_be(ident);
+	hdr->flags_foff = host2uint16_t_be(flags_foff);
+	hdr->ttl = packet->ttl;
+	hdr->proto = packet->proto;
+	hdr->chksum = 0;
+	hdr->src_addr = host2uint32_t_be(packet->src.ipv4);
+	hdr->dest_addr = host2uint32_t_be(packet->dest.ipv4);
 
-	return ~sum;
+	/* Compute checksum */
+	chksum = inet_checksum_calc(INET_CHECKSUM_INIT, (void *)hdr,
+	    sizeof(ip_header_t));
+	hdr->chksum = host2uint16_t_be(chksum);
 }
 
 /** Encode Internet PDU.
@@ -107,11 +108,8 @@ int inet_pdu_encode(inet_packet_t *packet, size_t offs, size_t mtu,
 {
 	void *data;
 	size_t size;
-	ip_header_t *hdr;
 	size_t hdr_size;
 	size_t data_offs;
-	uint16_t chksum;
-	uint16_t ident;
 	uint16_t flags_foff;
 	uint16_t foff;
 	size_t fragoff_limit;
@@ -161,27 +159,7 @@ int inet_pdu_encode(inet_packet_t *packet, size_t offs, size_t mtu,
 	if (data == NULL)
 		return ENOMEM;
 
-	/* Allocate identifier */
-	fibril_mutex_lock(&ip_ident_lock);
-	ident = ++ip_ident;
-	fibril_mutex_unlock(&ip_ident_lock);
-
-	/* Encode header fields */
-	hdr = (ip_header_t *)data;
-	hdr->ver_ihl = (4 << VI_VERSION_l) | (hdr_size / sizeof(uint32_t));
-	hdr->tos = packet->tos;
-	hdr->tot_len = host2uint16_t_be(size);
-	hdr->id = host2uint16_t_be(ident);
-	hdr->flags_foff = host2uint16_t_be(flags_foff);
-	hdr->ttl = packet->ttl;
-	hdr->proto = packet->proto;
-	hdr->chksum = 0;
-	hdr->src_addr = host2uint32_t_be(packet->src.ipv4);
-	hdr->dest_addr = host2uint32_t_be(packet->dest.ipv4);
-
-	/* Compute checksum */
-	chksum = inet_checksum_calc(INET_CHECKSUM_INIT, (void *)hdr, hdr_size);
-	hdr->chksum = host2uint16_t_be(chksum);
+	inet_header_encode(packet, (ip_header_t *)data, size, flags_foff);
 
 	/* Copy payload */
 	memcpy((uint8_t *)data + data_offs, packet->data + offs, xfer_size);
@@ -193,6 +171,40 @@ int inet_pdu_encode(inet_packet_t *packet, size_t offs, size_t mtu,
 	return EOK;
 }
 
+/** Encode Internet PDU in place.
+ *
+ * Prepend the IP header to the payload held in @a pbuf. Only packets
+ * which need not be fragmented can be encoded this way.
+ *
+ * @param packet	Packet to encode, its data is held by @a pbuf
+ * @param mtu		MTU (Maximum Transmission Unit) in bytes
+ * @param pbuf		Buffer holding exactly the packet data, on success
+ *			it holds the PDU
+ * @return		EOK on success, ENOSPC if the packet does not fit
+ *			into @a mtu or @a pbuf lacks headroom
+ */
+int inet_pdu_encode_pbuf(inet_packet_t *packet, size_t mtu, pbuf_t *pbuf)
+{
+	size_t hdr_size;
+	ip_header_t *hdr;
+
+	assert(packet->data == pbuf->data);
+	assert(packet->size == pbuf->size);
+
+	hdr_size = sizeof(ip_header_t);
+	if (hdr_size >= mtu || packet->size > mtu - hdr_size)
+		return ENOSPC;
+
+	hdr = pbuf_push(pbuf, hdr_size);
+	if (hdr == NULL)
+		return ENOSPC;
+
+	inet_header_encode(packet, hdr, pbuf->size,
+	    packet->df ? BIT_V(uint16_t, FF_FLAG_DF) : 0);
+
+	return EOK;
+}
+
 int inet_pdu_decode(void *data, size_t size, inet_packet_t *packet)
 {
 	ip_header_t *hdr;
@@ -252,14 +264,14 @@ int inet_pdu_decode(void *data, size_t size, inet_packet_t *packet)
 	data_offs = sizeof(uint32_t) * BIT_RANGE_EXTRACT(uint8_t, VI_IHL_h,
 	    VI_IHL_l, hdr->ver_ihl);
 
-	packet->size = tot_len - data_offs;
-	packet->data = calloc(packet->size, 1);
-	if (packet->data == NULL) {
-		log_msg(LVL_WARN, "Out of memory.");
-		return ENOMEM;
+	if (data_offs < sizeof(ip_header_t) || data_offs > tot_len) {
+		log_msg(LVL_DEBUG, "Header length (%zu) invalid", data_offs);
+		return EINVAL;
 	}
 
-	memcpy(packet->data, (uint8_t *)data + data_offs, packet->size);
+	/* Payload is not copied, it points into the PDU */
+	packet->size = tot_len - data_offs;
+	packet->data = (uint8_t *)data + data_offs;
 
 	return EOK;
 }
@@ -37,15 +37,14 @@
 #ifndef INET_PDU_H_
 #define INET_PDU_H_
 
+#include <net/checksum.h>
+#include <net/pbuf.h>
 #include <sys/types.h>
 #include "inetsrv.h"
 
-#define INET_CHECKSUM_INIT 0xffff
-
-extern uint16_t inet_checksum_calc(uint16_t, void *, size_t);
-
 extern int inet_pdu_encode(inet_packet_t *, size_t, size_t, void **,
     size_t *, size_t *);
+extern int inet_pdu_encode_pbuf(inet_packet_t *, size_t, pbuf_t *);
 extern int inet_pdu_decode(void *, size_t, inet_packet_t *);
 
 #endif
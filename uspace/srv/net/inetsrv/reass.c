@@ -34,51 +34,209 @@
  * @brief Datagram reassembly.
  */
 
+#include <adt/hash_table.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
 #include "inetsrv.h"
 #include "inet_std.h"
 #include "reass.h"
 
+/** Time after which an incomplete datagram is dropped (RFC 791: 15 s) */
+#define REASS_TIMEOUT (15 * 1000 * 1000)
+/** Upper bound for datagram size given by the fragment offset field */
+#define REASS_DGRAM_MAX \
+	(FRAG_OFFS_UNIT * (1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1)))
+
+#define REASS_DGRAM_BUCKETS 32
+
+enum {
+	REASS_KEY_SRC,
+	REASS_KEY_DEST,
+	REASS_KEY_PROTO,
+	REASS_KEY_IDENT,
+	REASS_KEYS
+};
+
 /** Datagram being reassembled.
  *
  * Uniquely identified by (source address, destination address, protocol,
  * identification) per RFC 791 sec. 2.3 / Fragmentation.
  */
 typedef struct {
+	/** Link in @c reass_dgram_map */
 	link_t map_link;
-	/** List of fragments, @c reass_frag_t */
+	/** Link in @c reass_dgram_age */
+	link_t age_link;
+	inet_addr_t src;
+	inet_addr_t dest;
+	uint8_t proto;
+	uint16_t ident;
+	uint8_t tos;
+	/** Time when reassembly is abandoned */
+	struct timeval expires;
+	/** Fragments ordered by offset and not overlapping, @c reass_frag_t */
 	list_t frags;
+	/** Number of fragments */
+	size_t nfrags;
+	/** Number of data bytes received */
+	size_t recvd;
+	/** Datagram size, known once the last fragment arrives */
+	size_t total;
+	bool have_total;
+	/** Memory accounted to this datagram */
+	size_t mem;
 } reass_dgram_t;
 
 /** One datagram fragment */
 typedef struct {
 	link_t dgram_link;
-	inet_packet_t packet;
+	/** Offset of fragment data into datagram */
+	size_t offs;
+	/** Size of fragment data */
+	size_t size;
+	/** Fragment data, points into @c buf */
+	uint8_t *data;
+	/** Allocated buffer */
+	void *buf;
+	/** Memory accounted to this fragment */
+	size_t mem;
 } reass_frag_t;
 
-/** Datagram map, list of reass_dgram_t */
-static LIST_INITIALIZE(reass_dgram_map);
-/** Protects access to @c reass_dgram_map */
+/** Datagram map, hash of reass_dgram_t */
+static hash_table_t reass_dgram_map;
+/** Datagrams ordered by age (and thus expiration time), oldest first */
+static LIST_INITIALIZE(reass_dgram_age);
+/** Memory held by all datagrams */
+static size_t reass_mem;
+/** Expires the oldest datagram */
+static fibril_timer_t *reass_timer;
+/** Protects access to @c reass_dgram_map and the other state */
 static FIBRIL_MUTEX_INITIALIZE(reass_dgram_map_lock);
+/** Time after which an incomplete datagram is dropped */
+static suseconds_t reass_timeout = REASS_TIMEOUT;
+/** Receives complete datagrams */
+static inet_reass_deliver_t reass_deliver = inet_recv_dgram_local;
 
-static reass_dgram_t *reass_dgram_new(void);
-static reass_dgram_t *reass_dgram_get(inet_packet_t *);
+static reass_dgram_t *reass_dgram_find(inet_packet_t *);
+static reass_dgram_t *reass_dgram_new(inet_packet_t *);
 static int reass_dgram_insert_frag(reass_dgram_t *, inet_packet_t *);
 static bool reass_dgram_complete(reass_dgram_t *);
 static void reass_dgram_remove(reass_dgram_t *);
 static int reass_dgram_deliver(reass_dgram_t *);
 static void reass_dgram_destroy(reass_dgram_t *);
+static void reass_timer_fun(void *);
+
+/** Return link following @a link in @a list or @c NULL. */
+static link_t *reass_link_next(link_t *link, list_t *list)
+{
+	return (link->next == &list->head) ? NULL : link->next;
+}
+
+/** Return link preceding @a link in @a list or @c NULL. */
+static link_t *reass_link_prev(link_t *link, list_t *list)
+{
+	return (link->prev == &list->head) ? NULL : link->prev;
+}
+
+static void reass_packet_key(inet_packet_t *packet, unsigned long key[])
+{
+	key[REASS_KEY_SRC] = packet->src.ipv4;
+	key[REASS_KEY_DEST] = packet->dest.ipv4;
+	key[REASS_KEY_PROTO] = packet->proto;
+	key[REASS_KEY_IDENT] = packet->ident;
+}
+
+static hash_index_t reass_dgram_hash(unsigned long key[])
+{
+	unsigned long h;
+
+	h = key[REASS_KEY_SRC] ^ (key[REASS_KEY_DEST] * 31) ^
+	    (key[REASS_KEY_PROTO] << 16) ^ key[REASS_KEY_IDENT];
+	h ^= h >> 16;
+
+	return h % REASS_DGRAM_BUCKETS;
+}
+
+static int reass_dgram_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_instance(item, reass_dgram_t,
+	    map_link);
+
+	assert(keys == REASS_KEYS);
+
+	return key[REASS_KEY_SRC] == rdg->src.ipv4 &&
+	    key[REASS_KEY_DEST] == rdg->dest.ipv4 &&
+	    key[REASS_KEY_PROTO] == rdg->proto &&
+	    key[REASS_KEY_IDENT] == rdg->ident;
+}
+
+static void reass_dgram_remove_callback(link_t *item)
+{
+}
+
+static hash_table_operations_t reass_dgram_ops = {
+	.hash = reass_dgram_hash,
+	.compare = reass_dgram_compare,
+	.remove_callback = reass_dgram_remove_callback
+};
+
+/** Initialize datagram reassembly.
+ *
+ * @return		EOK on success or ENOMEM.
+ */
+int inet_reass_init(void)
+{
+	if (!hash_table_create(&reass_dgram_map, REASS_DGRAM_BUCKETS,
+	    REASS_KEYS, &reass_dgram_ops))
+		return ENOMEM;
+
+	reass_timer = fibril_timer_create();
+	if (reass_timer == NULL) {
+		hash_table_destroy(&reass_dgram_map);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
+
+/** Set up datagram reassembly for the internal test.
+ *
+ * @param deliver	Function receiving complete datagrams
+ * @param timeout	Time after which an incomplete datagram is dropped,
+ *			in microseconds
+ */
+void inet_reass_test_setup(inet_reass_deliver_t deliver, suseconds_t timeout)
+{
+	fibril_mutex_lock(&reass_dgram_map_lock);
+	reass_deliver = deliver;
+	reass_timeout = timeout;
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+}
+
+/** Get the state of datagram reassembly.
+ *
+ * @param dgrams	Place to store the number of datagrams being reassembled
+ * @param mem		Place to store the memory held by them
+ */
+void inet_reass_stats(size_t *dgrams, size_t *mem)
+{
+	fibril_mutex_lock(&reass_dgram_map_lock);
+	*dgrams = list_count(&reass_dgram_age);
+	*mem = reass_mem;
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+}
 
 /** Queue packet for datagram reassembly.
  *
  * @param packet	Packet
- * @return		EOK on success or ENOMEM.
+ * @return		EOK on success or negative error code.
  */
 int inet_reass_queue_packet(inet_packet_t *packet)
 {
@@ -90,18 +248,30 @@ int inet_reass_queue_packet(inet_packet_t *packet)
 	fibril_mutex_lock(&reass_dgram_map_lock);
 
 	/* Get existing or new datagram */
-	rdg = reass_dgram_get(packet);
+	rdg = reass_dgram_find(packet);
 	if (rdg == NULL) {
-		/* Only happens when we are out of memory */
-		fibril_mutex_unlock(&reass_dgram_map_lock);
-		log_msg(LVL_DEBUG, "Allocation failed, packet dropped.");
-		return ENOMEM;
+		rdg = reass_dgram_new(packet);
+		if (rdg == NULL) {
+			/* Only happens when we are out of memory */
+			fibril_mutex_unlock(&reass_dgram_map_lock);
+			log_msg(LVL_DEBUG, "Allocation failed, packet "
+			    "dropped.");
+			return ENOMEM;
+		}
 	}
 
 	/* Insert fragment into the datagram */
 	rc = reass_dgram_insert_frag(rdg, packet);
-	if (rc != EOK)
-		return ENOMEM;
+	if (rc != EOK) {
+		log_msg(LVL_DEBUG, "Fragment dropped (%d).", rc);
+		if (rdg->nfrags == 0) {
+			reass_dgram_remove(rdg);
+			reass_dgram_destroy(rdg);
+		}
+
+		fibril_mutex_unlock(&reass_dgram_map_lock);
+		return rc;
+	}
 
 	/* Check if datagram is complete */
 	if (reass_dgram_complete(rdg)) {
@@ -119,112 +289,260 @@ int inet_reass_queue_packet(inet_packet_t *packet)
 	return EOK;
 }
 
-/** Get datagram reassembly structure for packet.
+/** Find datagram reassembly structure for packet.
  *
  * @param packet	Packet
- * @return		Datagram reassembly structure matching @a packet
+ * @return		Datagram reassembly structure matching @a packet or
+ *			@c NULL if there is none
  */
-static reass_dgram_t *reass_dgram_get(inet_packet_t *packet)
+static reass_dgram_t *reass_dgram_find(inet_packet_t *packet)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-
-	list_foreach(reass_dgram_map, link) {
-		reass_dgram_t *rdg = list_get_instance(link, reass_dgram_t,
-		    map_link);
-
-		link_t *f1_link = list_first(&rdg->frags);
-		assert(f1_link != NULL);
+	unsigned long key[REASS_KEYS];
+	link_t *link;
 
-		reass_frag_t *f1 = list_get_instance(f1_link, reass_frag_t,
-		    dgram_link);
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-		if (f1->packet.src.ipv4 == packet->src.ipv4 &&
-		    f1->packet.dest.ipv4 == packet->dest.ipv4 &&
-		    f1->packet.proto == packet->proto &&
-		    f1->packet.ident == packet->ident) {
-			/* Match */
-			return rdg;
-		}
-	}
+	reass_packet_key(packet, key);
+	link = hash_table_find(&reass_dgram_map, key);
+	if (link == NULL)
+		return NULL;
 
-	/* No existing reassembly structure. Create a new one. */
-	return reass_dgram_new();
+	return hash_table_get_instance(link, reass_dgram_t, map_link);
 }
 
-/** Create new datagram reassembly structure.
+/** Create new datagram reassembly structure and insert it into the map.
  *
- * @return New datagram reassembly structure.
+ * @param packet	First packet of the datagram
+ * @return		New datagram reassembly structure.
  */
-static reass_dgram_t *reass_dgram_new(void)
+static reass_dgram_t *reass_dgram_new(inet_packet_t *packet)
 {
+	unsigned long key[REASS_KEYS];
 	reass_dgram_t *rdg;
+	bool was_empty;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
 	rdg = calloc(1, sizeof(reass_dgram_t));
 	if (rdg == NULL)
 		return NULL;
 
 	link_initialize(&rdg->map_link);
+	link_initialize(&rdg->age_link);
 	list_initialize(&rdg->frags);
 
+	rdg->src = packet->src;
+	rdg->dest = packet->dest;
+	rdg->proto = packet->proto;
+	rdg->ident = packet->ident;
+	rdg->tos = packet->tos;
+	rdg->mem = sizeof(reass_dgram_t);
+
+	gettimeofday(&rdg->expires, NULL);
+	tv_add(&rdg->expires, reass_timeout);
+
+	reass_packet_key(packet, key);
+	hash_table_insert(&reass_dgram_map, key, &rdg->map_link);
+
+	/* All datagrams have the same timeout, newest expires last */
+	was_empty = list_empty(&reass_dgram_age);
+	list_append(&rdg->age_link, &reass_dgram_age);
+	reass_mem += rdg->mem;
+
+	if (was_empty)
+		fibril_timer_set(reass_timer, reass_timeout, reass_timer_fun,
+		    NULL);
+
 	return rdg;
 }
 
-static reass_frag_t *reass_frag_new(void)
+/** Make room for new fragment by evicting the oldest datagrams.
+ *
+ * @param rdg		Datagram the fragment belongs to, not evicted
+ * @param mem		Memory needed
+ * @return		EOK on success, ELIMIT if there is not enough room
+ */
+static int reass_mem_reserve(reass_dgram_t *rdg, size_t mem)
 {
-	reass_frag_t *frag;
+	link_t *link;
 
-	frag = calloc(1, sizeof(reass_frag_t));
-	if (frag == NULL)
-		return NULL;
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	link_initialize(&frag->dgram_link);
+	link = list_first(&reass_dgram_age);
+	while (reass_mem + mem > REASS_MEM_LIMIT && link != NULL) {
+		reass_dgram_t *old = list_get_instance(link, reass_dgram_t,
+		    age_link);
+
+		link = reass_link_next(link, &reass_dgram_age);
+		if (old == rdg)
+			continue;
+
+		log_msg(LVL_DEBUG, "Reassembly memory exhausted, dropping "
+		    "datagram %p.", old);
+		reass_dgram_remove(old);
+		reass_dgram_destroy(old);
+	}
+
+	if (reass_mem + mem > REASS_MEM_LIMIT)
+		return ELIMIT;
+
+	return EOK;
+}
 
-	return frag;
+static void reass_frag_destroy(reass_dgram_t *rdg, reass_frag_t *frag)
+{
+	list_remove(&frag->dgram_link);
+	rdg->nfrags--;
+	rdg->recvd -= frag->size;
+	rdg->mem -= frag->mem;
+	reass_mem -= frag->mem;
+	free(frag->buf);
+	free(frag);
 }
 
+/** Insert fragment into datagram.
+ *
+ * Fragments are kept disjoint, so the number of bytes received tells when
+ * the datagram is complete. Where the new fragment overlaps a preceding
+ * one, the earlier data is kept. Fragments following it are trimmed or
+ * replaced by the new data (like BSD does), so no data is lost when
+ * overlapping fragments leave gaps.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param packet	Packet
+ * @return		EOK on success (including duplicates), EINVAL if the
+ *			fragment is inconsistent with the datagram, ELIMIT
+ *			or ENOMEM if resources are exhausted
+ */
 static int reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
 {
 	reass_frag_t *frag;
-	void *data_copy;
+	reass_frag_t *prev;
+	reass_frag_t *next;
 	link_t *link;
+	size_t begin, end;
+	size_t trim;
+	size_t mem;
+	int rc;
 
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	frag = reass_frag_new();
+	begin = packet->offs;
+	end = packet->offs + packet->size;
 
-	/* Clone the packet */
+	if (end > REASS_DGRAM_MAX || (packet->mf && packet->size == 0))
+		return EINVAL;
 
-	data_copy = malloc(packet->size);
-	if (data_copy == NULL)
-		return ENOMEM;
+	/* Check fragment against the known datagram size */
+	link = list_last(&rdg->frags);
+	if (!packet->mf) {
+		if (rdg->have_total && rdg->total != end)
+			return EINVAL;
 
-	frag->packet = *packet;
-	frag->packet.data = data_copy;
+		if (link != NULL) {
+			frag = list_get_instance(link, reass_frag_t,
+			    dgram_link);
+			if (frag->offs + frag->size > end)
+				return EINVAL;
+		}
+	} else if (rdg->have_total && end > rdg->total) {
+		return EINVAL;
+	}
 
 	/*
-	 * XXX Make resource-consuming attacks harder, eliminate any duplicate
-	 * data immediately. Possibly eliminate redundant packet headers.
+	 * Find the last fragment starting at or before ours. Fragments
+	 * usually arrive in order, so search from the end.
 	 */
+	prev = NULL;
+	while (link != NULL) {
+		frag = list_get_instance(link, reass_frag_t, dgram_link);
+		if (frag->offs <= begin) {
+			prev = frag;
+			break;
+		}
 
-	/*
-	 * Insert into the list, which is sorted by offs member ascending.
-	 */
+		link = reass_link_prev(link, &rdg->frags);
+	}
 
-	link = list_first(&rdg->frags);
-	while (link != NULL) {
-		reass_frag_t *qf = list_get_instance(link, reass_frag_t,
-		    dgram_link);
+	/* Trim data already received in the preceding fragment */
+	if (prev != NULL && prev->offs + prev->size > begin)
+		begin = min(prev->offs + prev->size, end);
+
+	if (begin == end) {
+		/* Nothing new */
+		if (!packet->mf) {
+			rdg->total = end;
+			rdg->have_total = true;
+		}
 
-		if (qf->packet.offs >= packet->offs)
+		return EOK;
+	}
+
+	if (rdg->nfrags >= REASS_FRAGS_MAX)
+		return ELIMIT;
+
+	mem = sizeof(reass_frag_t) + (end - begin);
+	rc = reass_mem_reserve(rdg, mem);
+	if (rc != EOK)
+		return rc;
+
+	frag = calloc(1, sizeof(reass_frag_t));
+	if (frag == NULL)
+		return ENOMEM;
+
+	frag->buf = malloc(end - begin);
+	if (frag->buf == NULL) {
+		free(frag);
+		return ENOMEM;
+	}
+
+	link_initialize(&frag->dgram_link);
+	frag->offs = begin;
+	frag->size = end - begin;
+	frag->data = frag->buf;
+	frag->mem = mem;
+	memcpy(frag->data, (uint8_t *) packet->data + (begin - packet->offs),
+	    frag->size);
+
+	/* Replace or trim following fragments overlapped by ours */
+	if (prev != NULL)
+		link = reass_link_next(&prev->dgram_link, &rdg->frags);
+	else
+		link = list_first(&rdg->frags);
+
+	while (link != NULL) {
+		next = list_get_instance(link, reass_frag_t, dgram_link);
+		if (next->offs >= end)
 			break;
 
-		link = link->next;
+		link = reass_link_next(link, &rdg->frags);
+
+		if (next->offs + next->size <= end) {
+			reass_frag_destroy(rdg, next);
+		} else {
+			trim = end - next->offs;
+			next->offs += trim;
+			next->data += trim;
+			next->size -= trim;
+			rdg->recvd -= trim;
+			break;
+		}
 	}
 
-	if (link != NULL)
-		list_insert_after(&frag->dgram_link, link);
+	if (prev != NULL)
+		list_insert_after(&frag->dgram_link, &prev->dgram_link);
 	else
-		list_append(&frag->dgram_link, &rdg->frags);
+		list_prepend(&frag->dgram_link, &rdg->frags);
+
+	rdg->nfrags++;
+	rdg->recvd += frag->size;
+	rdg->mem += mem;
+	reass_mem += mem;
+
+	if (!packet->mf) {
+		rdg->total = end;
+		rdg->have_total = true;
+	}
 
 	return EOK;
 }
@@ -236,37 +554,10 @@ static int reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
  */
 static bool reass_dgram_complete(reass_dgram_t *rdg)
 {
-	reass_frag_t *frag, *prev;
-	link_t *link;
-
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	assert(!list_empty(&rdg->frags));
-
-	/* First fragment must be at offset zero */
-	frag = list_get_instance(list_first(&rdg->frags), reass_frag_t,
-	    dgram_link);
-	if (frag->packet.offs != 0)
-		return false;
-
-	prev = frag;
-	while (true) {
-		link = frag->dgram_link.next;
-		if (link == NULL)
-			return false;
-
-		/* Each next fragment must follow immediately or overlap */
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-		if (frag->packet.offs > prev->packet.offs + prev->packet.size)
-			return false;
-
-		/* No more fragments - datagram is complete */
-		if (!frag->packet.mf)
-			return true;
-
-		prev = frag;
-	}
 
-	return false;
+	/* Fragments are disjoint and lie within the datagram */
+	return rdg->have_total && rdg->recvd == rdg->total;
 }
 
 /** Remove datagram from reassembly map.
@@ -276,7 +567,10 @@ static bool reass_dgram_complete(reass_dgram_t *rdg)
 static void reass_dgram_remove(reass_dgram_t *rdg)
 {
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
 	list_remove(&rdg->map_link);
+	list_remove(&rdg->age_link);
+	reass_mem -= rdg->mem;
 }
 
 /** Deliver complete datagram.
@@ -285,70 +579,32 @@ static void reass_dgram_remove(reass_dgram_t *rdg)
  */
 static int reass_dgram_deliver(reass_dgram_t *rdg)
 {
-	size_t dgram_size;
-	size_t fragoff_limit;
 	inet_dgram_t dgram;
-	reass_frag_t *frag;
-	uint8_t proto;
-
-	/*
-	 * Potentially there could be something beyond the first packet
-	 * that has !MF. Make sure we ignore that.
-	 */
-	frag = NULL;
-	list_foreach(rdg->frags, link) {
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-
-		if (!frag->packet.mf)
-			break;
-	}
-
-	assert(frag != NULL);
-	assert(!frag->packet.mf);
-
-	dgram_size = frag->packet.offs + frag->packet.size;
-
-	/* Upper bound for fragment offset field */
-	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l);
-
-	/* Verify that total size of datagram is within reasonable bounds */
-	if (dgram_size > FRAG_OFFS_UNIT * fragoff_limit)
-		return ELIMIT;
+	int rc;
 
-	dgram.data = calloc(dgram_size, 1);
+	dgram.data = malloc(max(rdg->total, 1));
 	if (dgram.data == NULL)
 		return ENOMEM;
 
-	dgram.size = dgram_size;
-	dgram.src = frag->packet.src;
-	dgram.dest = frag->packet.dest;
-	dgram.tos = frag->packet.tos;
-	proto = frag->packet.proto;
+	dgram.size = rdg->total;
+	dgram.pbuf = NULL;
+	dgram.src = rdg->src;
+	dgram.dest = rdg->dest;
+	dgram.tos = rdg->tos;
 
 	/* Pull together data from individual fragments */
-
-	size_t doffs = 0;
-
-	frag = NULL;
 	list_foreach(rdg->frags, link) {
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-
-		size_t cb, ce;
-
-		cb = max(doffs, frag->packet.offs);
-		ce = min(dgram_size, frag->packet.offs + frag->packet.size);
-
-		if (ce > cb) {
-			memcpy(dgram.data + cb,
-			    frag->packet.data + cb - frag->packet.offs,
-			    ce - cb);
-		}
+		reass_frag_t *frag = list_get_instance(link, reass_frag_t,
+		    dgram_link);
 
-		if (!frag->packet.mf)
-			break;
+		memcpy((uint8_t *) dgram.data + frag->offs, frag->data,
+		    frag->size);
 	}
 
-	return inet_recv_dgram_local(&dgram, proto);
+	rc = reass_deliver(&dgram, rdg->proto);
+	free(dgram.data);
+
+	return rc;
 }
 
 /** Destroy datagram reassembly structure.
@@ -363,12 +619,47 @@ static void reass_dgram_destroy(reass_dgram_t *rdg)
 		    dgram_link);
 
 		list_remove(&frag->dgram_link);
-		free(frag->packet.data);
+		free(frag->buf);
 		free(frag);
 	}
 
 	free(rdg);
 }
 
+/** Drop datagrams whose reassembly timed out.
+ *
+ * The age list is ordered by expiration time, so the timer only needs to
+ * track its first entry.
+ */
+static void reass_timer_fun(void *arg)
+{
+	struct timeval now;
+	suseconds_t delay;
+
+	fibril_mutex_lock(&reass_dgram_map_lock);
+
+	gettimeofday(&now, NULL);
+
+	while (!list_empty(&reass_dgram_age)) {
+		reass_dgram_t *rdg = list_get_instance(
+		    list_first(&reass_dgram_age), reass_dgram_t, age_link);
+
+		if (tv_gt(&rdg->expires, &now)) {
+			/* Zero delay would mean waiting forever */
+			delay = max(tv_sub(&rdg->expires, &now), 1);
+			fibril_timer_set(reass_timer, delay, reass_timer_fun,
+			    NULL);
+			break;
+		}
+
+		log_msg(LVL_DEBUG, "Reassembly timed out, dropping datagram "
+		    "%p.", rdg);
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+}
+
 /** @}
  */
@@ -40,7 +40,18 @@
 #include <sys/types.h>
 #include "inetsrv.h"
 
+/** Limit for memory held by all datagrams being reassembled */
+#define REASS_MEM_LIMIT (256 * 1024)
+/** Maximum number of fragments of one datagram */
+#define REASS_FRAGS_MAX 128
+
+/** Function receiving complete datagrams */
+typedef int (*inet_reass_deliver_t)(inet_dgram_t *, uint8_t);
+
+extern int inet_reass_init(void);
 extern int inet_reass_queue_packet(inet_packet_t *);
+extern void inet_reass_test_setup(inet_reass_deliver_t, suseconds_t);
+extern void inet_reass_stats(size_t *, size_t *);
 
 #endif
 
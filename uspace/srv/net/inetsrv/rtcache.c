@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file Route cache
+ *
+ * Remembers the direction found for recently used destinations so that
+ * consecutive datagrams to the same destination need not consult the
+ * address and routing tables. The cache is direct-mapped. It is flushed
+ * as a whole by advancing the generation number whenever an address
+ * object or a static route is added or removed.
+ */
+
+#include <fibril_synch.h>
+
+#include "rtcache.h"
+
+/** Number of cache entries is 2^RTCACHE_ORDER */
+#define RTCACHE_ORDER 6
+#define RTCACHE_SIZE (1 << RTCACHE_ORDER)
+
+typedef struct {
+	/** Generation this entry belongs to, zero for never used */
+	unsigned gen;
+	/** Destination address */
+	uint32_t dest;
+	/** Direction to @c dest */
+	inet_dir_t dir;
+} inet_rtcache_entry_t;
+
+static FIBRIL_MUTEX_INITIALIZE(rtcache_lock);
+static inet_rtcache_entry_t rtcache[RTCACHE_SIZE];
+static unsigned rtcache_gen = 1;
+
+static inet_rtcache_entry_t *inet_rtcache_entry(uint32_t dest)
+{
+	/* Fibonacci hashing, use the most significant bits of the product */
+	return &rtcache[(uint32_t) (dest * 2654435761U) >>
+	    (32 - RTCACHE_ORDER)];
+}
+
+/** Look up direction to destination in route cache.
+ *
+ * On a miss, the caller is given the current cache generation, which it
+ * passes to inet_rtcache_insert() once it has resolved the direction.
+ *
+ * @param dest	Destination address
+ * @param dir	Place to store the direction
+ * @param gen	Place to store the cache generation
+ * @return	@c true if found
+ */
+bool inet_rtcache_lookup(inet_addr_t *dest, inet_dir_t *dir, unsigned *gen)
+{
+	inet_rtcache_entry_t *entry;
+	bool found;
+
+	fibril_mutex_lock(&rtcache_lock);
+
+	entry = inet_rtcache_entry(dest->ipv4);
+	found = entry->gen == rtcache_gen && entry->dest == dest->ipv4;
+	if (found)
+		*dir = entry->dir;
+	*gen = rtcache_gen;
+
+	fibril_mutex_unlock(&rtcache_lock);
+
+	return found;
+}
+
+/** Store direction to destination in route cache.
+ *
+ * The direction is not stored if the cache has been flushed since @a gen
+ * was obtained, as it may refer to a removed address object.
+ *
+ * @param dest	Destination address
+ * @param dir	Direction to @a dest
+ * @param gen	Cache generation obtained by inet_rtcache_lookup()
+ */
+void inet_rtcache_insert(inet_addr_t *dest, inet_dir_t *dir, unsigned gen)
+{
+	inet_rtcache_entry_t *entry;
+
+	fibril_mutex_lock(&rtcache_lock);
+
+	if (gen != rtcache_gen) {
+		fibril_mutex_unlock(&rtcache_lock);
+		return;
+	}
+
+	entry = inet_rtcache_entry(dest->ipv4);
+	entry->gen = rtcache_gen;
+	entry->dest = dest->ipv4;
+	entry->dir = *dir;
+
+	fibril_mutex_unlock(&rtcache_lock);
+}
+
+/** Invalidate all route cache entries. */
+void inet_rtcache_flush(void)
+{
+	fibril_mutex_lock(&rtcache_lock);
+
+	if (++rtcache_gen == 0)
+		rtcache_gen = 1;
+
+	fibril_mutex_unlock(&rtcache_lock);
+}
+
+/** @}
+ */
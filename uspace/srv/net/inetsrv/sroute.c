@@ -34,6 +34,7 @@
  * @brief
  */
 
+#include <adt/ptrie.h>
 #include <bitops.h>
 #include <errno.h>
 #include <fibril_synch.h>
@@ -46,11 +47,15 @@
 #include "inetsrv.h"
 #include "inet_link.h"
 #include "inet_util.h"
+#include "rtcache.h"
 
 static FIBRIL_MUTEX_INITIALIZE(sroute_list_lock);
 static LIST_INITIALIZE(sroute_list);
 static sysarg_t sroute_id = 0;
 
+/** Static routes by destination network */
+static ptrie_t sroute_trie;
+
 inet_sroute_t *inet_sroute_new(void)
 {
 	inet_sroute_t *sroute = calloc(1, sizeof(inet_sroute_t));
@@ -62,6 +67,7 @@ inet_sroute_t *inet_sroute_new(void)
 	}
 
 	link_initialize(&sroute->sroute_list);
+	link_initialize(&sroute->sroute_trie);
 	fibril_mutex_lock(&sroute_list_lock);
 	sroute->id = ++sroute_id;
 	fibril_mutex_unlock(&sroute_list_lock);
@@ -76,56 +82,60 @@ void inet_sroute_delete(inet_sroute_t *sroute)
 	free(sroute);
 }
 
-void inet_sroute_add(inet_sroute_t *sroute)
+int inet_sroute_add(inet_sroute_t *sroute)
 {
+	int rc;
+
 	fibril_mutex_lock(&sroute_list_lock);
+
+	rc = ptrie_insert(&sroute_trie, sroute->dest.ipv4, sroute->dest.bits,
+	    &sroute->sroute_trie);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&sroute_list_lock);
+		return rc;
+	}
+
 	list_append(&sroute->sroute_list, &sroute_list);
 	fibril_mutex_unlock(&sroute_list_lock);
+
+	inet_rtcache_flush();
+	return EOK;
 }
 
 void inet_sroute_remove(inet_sroute_t *sroute)
 {
 	fibril_mutex_lock(&sroute_list_lock);
+	ptrie_remove(&sroute_trie, sroute->dest.ipv4, sroute->dest.bits,
+	    &sroute->sroute_trie);
 	list_remove(&sroute->sroute_list);
 	fibril_mutex_unlock(&sroute_list_lock);
+
+	inet_rtcache_flush();
 }
 
-/** Find address object matching address @a addr.
+/** Find static route with the longest destination prefix matching @a addr.
  *
  * @param addr	Address
  */
 inet_sroute_t *inet_sroute_find(inet_addr_t *addr)
 {
-	uint32_t mask;
-	inet_sroute_t *best;
+	inet_sroute_t *sroute;
+	link_t *link;
 
 	log_msg(LVL_DEBUG, "inet_sroute_find(%x)", (unsigned)addr->ipv4);
 
 	fibril_mutex_lock(&sroute_list_lock);
-
-	best = NULL;
-
-	list_foreach(sroute_list, link) {
-		inet_sroute_t *sroute = list_get_instance(link,
-		    inet_sroute_t, sroute_list);
-
-		/* Look for the most specific route */
-		if (best != NULL && best->dest.bits >= sroute->dest.bits)
-			continue;
-
-		mask = inet_netmask(sroute->dest.bits);
-		if ((sroute->dest.ipv4 & mask) == (addr->ipv4 & mask)) {
-			fibril_mutex_unlock(&sroute_list_lock);
-			log_msg(LVL_DEBUG, "inet_sroute_find: found %p",
-			    sroute);
-			return sroute;
-		}
-	}
-
-	log_msg(LVL_DEBUG, "inet_sroute_find: Not found");
+	link = ptrie_lookup(&sroute_trie, addr->ipv4);
+	sroute = (link != NULL) ? list_get_instance(link, inet_sroute_t,
+	    sroute_trie) : NULL;
 	fibril_mutex_unlock(&sroute_list_lock);
 
-	return NULL;
+	if (sroute != NULL)
+		log_msg(LVL_DEBUG, "inet_sroute_find: found %p", sroute);
+	else
+		log_msg(LVL_DEBUG, "inet_sroute_find: Not found");
+
+	return sroute;
 }
 
 /** Find static route with a specific name.
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup inet
+ * @{
+ */
+
+/**
+ * @file Internal test of datagram reassembly
+ */
+
+#include <async.h>
+#include <bool.h>
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "inetsrv.h"
+#include "reass.h"
+#include "test.h"
+
+/** Maximum size of a test datagram */
+#define TEST_DGRAM_MAX 6000
+/** Maximum size of a test fragment */
+#define TEST_FRAG_MAX 1500
+/** Number of datagrams reassembled from random overlapping fragments */
+#define TEST_OVERLAP_ROUNDS 500
+/** Reassembly timeout used by the test, in microseconds */
+#define TEST_TIMEOUT (100 * 1000)
+
+/** Data the test datagrams are cut from */
+static uint8_t test_src[TEST_DGRAM_MAX];
+/** Data of the last delivered datagram */
+static uint8_t test_dst[TEST_DGRAM_MAX];
+static size_t test_dst_size;
+/** Number of delivered datagrams */
+static unsigned test_delivered;
+
+static int test_deliver(inet_dgram_t *dgram, uint8_t proto)
+{
+	test_delivered++;
+	test_dst_size = min(dgram->size, TEST_DGRAM_MAX);
+	memcpy(test_dst, dgram->data, test_dst_size);
+	return EOK;
+}
+
+/** Queue one fragment of test datagram @a ident. */
+static int test_frag(uint16_t ident, size_t offs, size_t size, bool mf)
+{
+	inet_packet_t packet;
+
+	memset(&packet, 0, sizeof(packet));
+	packet.src.ipv4 = 0x0a000001;
+	packet.dest.ipv4 = 0x0a000002;
+	packet.proto = 17;
+	packet.ident = ident;
+	packet.mf = mf;
+	packet.offs = offs;
+	packet.size = size;
+	packet.data = test_src + offs;
+
+	return inet_reass_queue_packet(&packet);
+}
+
+/** Reassemble datagrams from random, overlapping and duplicate fragments. */
+static unsigned test_overlap(void)
+{
+	unsigned errors = 0;
+	unsigned i;
+
+	for (i = 0; i < TEST_OVERLAP_ROUNDS; i++) {
+		size_t total = 1 + (size_t) rand() % TEST_DGRAM_MAX;
+		unsigned nfrags = 0;
+
+		test_delivered = 0;
+
+		while (test_delivered == 0 && nfrags < REASS_FRAGS_MAX) {
+			size_t offs = (size_t) rand() % total;
+			size_t size = 1 + (size_t) rand() % TEST_FRAG_MAX;
+
+			size = min(size, total - offs);
+
+			if (rand() % 4 == 0)
+				offs = total - size;
+
+			(void) test_frag(i, offs, size, offs + size < total);
+			nfrags++;
+		}
+
+		if (test_delivered == 0)
+			(void) test_frag(i, 0, total, false);
+
+		if (test_delivered != 1 || test_dst_size != total ||
+		    bcmp(test_dst, test_src, total) != 0) {
+			printf("Datagram %u (%zu bytes) reassembled wrong.\n",
+			    i, total);
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+/** Flood reassembly with incomplete datagrams and check eviction. */
+static unsigned test_eviction(void)
+{
+	unsigned errors = 0;
+	size_t dgrams;
+	size_t mem;
+	unsigned count;
+	unsigned i;
+
+	/* Enough datagrams to exceed the limit several times */
+	count = 4 * REASS_MEM_LIMIT / TEST_FRAG_MAX;
+
+	for (i = 0; i < count; i++)
+		(void) test_frag(10000 + i, 0, TEST_FRAG_MAX, true);
+
+	inet_reass_stats(&dgrams, &mem);
+	if (mem > REASS_MEM_LIMIT) {
+		printf("Reassembly holds %zu bytes, limit is %u.\n", mem,
+		    REASS_MEM_LIMIT);
+		errors++;
+	}
+
+	/* The newest datagram survives and can be completed */
+	test_delivered = 0;
+	(void) test_frag(10000 + count - 1, TEST_FRAG_MAX, 8, false);
+	if (test_delivered != 1) {
+		printf("Newest datagram was evicted.\n");
+		errors++;
+	}
+
+	/* The oldest one was evicted and cannot be */
+	test_delivered = 0;
+	(void) test_frag(10000, TEST_FRAG_MAX, 8, false);
+	if (test_delivered != 0) {
+		printf("Oldest datagram was not evicted.\n");
+		errors++;
+	}
+
+	return errors;
+}
+
+/** Check that incomplete datagrams are dropped after the timeout. */
+static unsigned test_expiry(void)
+{
+	size_t dgrams;
+	size_t mem;
+
+	(void) test_frag(20000, 0, 8, true);
+	async_usleep(3 * TEST_TIMEOUT);
+
+	inet_reass_stats(&dgrams, &mem);
+	if (dgrams != 0 || mem != 0) {
+		printf("%zu datagrams (%zu bytes) not expired.\n", dgrams,
+		    mem);
+		return 1;
+	}
+
+	return 0;
+}
+
+/** Check the limit of fragments of one datagram. */
+static unsigned test_frag_limit(void)
+{
+	unsigned errors = 0;
+	int rc;
+	unsigned i;
+
+	/* Disjoint fragments with gaps between them */
+	for (i = 0; i < REASS_FRAGS_MAX; i++) {
+		rc = test_frag(30000, 16 * i, 8, true);
+		if (rc != EOK) {
+			printf("Fragment %u refused (%d).\n", i, rc);
+			errors++;
+		}
+	}
+
+	rc = test_frag(30000, 16 * REASS_FRAGS_MAX, 8, true);
+	if (rc != ELIMIT) {
+		printf("Fragment over the limit not refused (%d).\n", rc);
+		errors++;
+	}
+
+	return errors;
+}
+
+/** Run the internal test of datagram reassembly.
+ *
+ * Covers overlapping and duplicate fragments, eviction of the oldest
+ * datagrams under the memory limit, expiry of incomplete datagrams and the
+ * limit of fragments per datagram.
+ *
+ * @return		EOK if the test passed, EIO if it failed or ENOMEM
+ */
+int inet_reass_test(void)
+{
+	unsigned errors;
+	size_t i;
+
+	printf("inet_reass_test()\n");
+
+	if (inet_reass_init() != EOK)
+		return ENOMEM;
+
+	inet_reass_test_setup(test_deliver, TEST_TIMEOUT);
+
+	srand(1);
+	for (i = 0; i < TEST_DGRAM_MAX; i++)
+		test_src[i] = rand();
+
+	errors = test_overlap();
+	errors += test_eviction();
+	errors += test_expiry();
+	errors += test_frag_limit();
+
+	printf("inet_reass_test(): %u errors\n", errors);
+	return errors == 0 ? EOK : EIO;
+}
+
+/** @}
+ */
@@ -79,6 +79,8 @@ static int loopip_recv_fibril(void *arg)
 		rqueue_entry_t *rqe = list_get_instance(link, rqueue_entry_t, link);
 
 		(void) iplink_ev_recv(&loopip_iplink, &rqe->sdu);
+		pbuf_delref(rqe->sdu.pbuf);
+		free(rqe);
 	}
 
 	return 0;
@@ -160,18 +162,19 @@ static int loopip_send(iplink_srv_t *srv, iplink_srv_sdu_t *sdu)
 	if (rqe == NULL)
 		return ENOMEM;
 	/*
-	 * Clone SDU
+	 * Clone SDU, sharing its data unless it is borrowed from the client.
+	 * It is delivered after the send request is answered.
 	 */
-	rqe->sdu.lsrc = sdu->ldest;
-	rqe->sdu.ldest = sdu->lsrc;
-	rqe->sdu.data = malloc(sdu->size);
-	if (rqe->sdu.data == NULL) {
+	rqe->sdu.pbuf = pbuf_keep(sdu->pbuf);
+	if (rqe->sdu.pbuf == NULL) {
 		free(rqe);
 		return ENOMEM;
 	}
 
-	memcpy(rqe->sdu.data, sdu->data, sdu->size);
-	rqe->sdu.size = sdu->size;
+	rqe->sdu.lsrc = sdu->ldest;
+	rqe->sdu.ldest = sdu->lsrc;
+	rqe->sdu.data = rqe->sdu.pbuf->data;
+	rqe->sdu.size = rqe->sdu.pbuf->size;
 
 	/*
 	 * Insert to receive queue
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file Congestion control
+ *
+ * Congestion window bookkeeping common to all algorithms (RFC 5681) and
+ * the NewReno algorithm. Loss detection and recovery is done by the
+ * retransmission queue, which calls in here when the congestion window
+ * needs to change.
+ */
+
+#include <errno.h>
+#include <io/log.h>
+#include <macros.h>
+#include <stdint.h>
+#include <str.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Initial congestion window (RFC 5681, SMSS > 2190 bytes) */
+#define CC_INITIAL_WINDOW	(2 * TCP_SMSS)
+
+static void tcp_cc_newreno_acked(tcp_conn_t *, uint32_t);
+static uint32_t tcp_cc_newreno_ssthresh(tcp_conn_t *);
+
+tcp_cc_ops_t tcp_cc_newreno = {
+	.name = "newreno",
+	.init = NULL,
+	.fini = NULL,
+	.acked = tcp_cc_newreno_acked,
+	.ssthresh = tcp_cc_newreno_ssthresh
+};
+
+/** Available algorithms */
+static tcp_cc_ops_t *tcp_cc_algs[] = {
+	&tcp_cc_newreno,
+	NULL
+};
+
+/** Algorithm used for new connections */
+tcp_cc_ops_t *tcp_cc_default = &tcp_cc_newreno;
+
+/** Find congestion control algorithm by name.
+ *
+ * @param name		Algorithm name
+ * @return		Algorithm or @c NULL if not found
+ */
+tcp_cc_ops_t *tcp_cc_find(const char *name)
+{
+	unsigned i;
+
+	for (i = 0; tcp_cc_algs[i] != NULL; i++) {
+		if (str_cmp(tcp_cc_algs[i]->name, name) == 0)
+			return tcp_cc_algs[i];
+	}
+
+	return NULL;
+}
+
+/** Set up congestion control of new connection.
+ *
+ * @param conn		Connection
+ * @param cc		Congestion control algorithm
+ * @return		EOK on success or negative error code
+ */
+int tcp_cc_init(tcp_conn_t *conn, tcp_cc_ops_t *cc)
+{
+	conn->cc = cc;
+	conn->cc_data = NULL;
+	conn->cwnd = CC_INITIAL_WINDOW;
+	conn->ssthresh = UINT32_MAX;
+	conn->cwnd_acked = 0;
+
+	if (cc->init != NULL)
+		return cc->init(conn);
+
+	return EOK;
+}
+
+/** Free congestion control state of connection. */
+void tcp_cc_fini(tcp_conn_t *conn)
+{
+	if (conn->cc != NULL && conn->cc->fini != NULL)
+		conn->cc->fini(conn);
+
+	conn->cc = NULL;
+}
+
+/** New data was acknowledged.
+ *
+ * @param conn		Connection
+ * @param acked		Number of newly acknowledged bytes
+ */
+void tcp_cc_acked(tcp_conn_t *conn, uint32_t acked)
+{
+	if (acked > 0)
+		conn->cc->acked(conn, acked);
+}
+
+/** Loss was detected by duplicate ACKs.
+ *
+ * Reduce slow start threshold. The caller is responsible for setting
+ * the congestion window during fast recovery.
+ */
+void tcp_cc_loss(tcp_conn_t *conn)
+{
+	conn->ssthresh = conn->cc->ssthresh(conn);
+	conn->cwnd_acked = 0;
+
+	log_msg(LVL_DEBUG, "%s: loss, ssthresh=%" PRIu32, conn->name,
+	    conn->ssthresh);
+}
+
+/** Retransmission timer expired.
+ *
+ * Reduce slow start threshold and fall back to the loss window
+ * (RFC 5681, section 3.1).
+ */
+void tcp_cc_timeout(tcp_conn_t *conn)
+{
+	conn->ssthresh = conn->cc->ssthresh(conn);
+	conn->cwnd = TCP_SMSS;
+	conn->cwnd_acked = 0;
+
+	log_msg(LVL_DEBUG, "%s: timeout, ssthresh=%" PRIu32, conn->name,
+	    conn->ssthresh);
+}
+
+/** NewReno: grow congestion window.
+ *
+ * Slow start grows the window by at most one SMSS per ACK (RFC 3465
+ * with L = 1), congestion avoidance by one SMSS per window of data.
+ */
+static void tcp_cc_newreno_acked(tcp_conn_t *conn, uint32_t acked)
+{
+	if (conn->cwnd < conn->ssthresh) {
+		conn->cwnd += min(acked, TCP_SMSS);
+		return;
+	}
+
+	conn->cwnd_acked += acked;
+	if (conn->cwnd_acked >= conn->cwnd) {
+		conn->cwnd_acked -= conn->cwnd;
+		conn->cwnd += TCP_SMSS;
+	}
+}
+
+/** NewReno: slow start threshold after loss (RFC 5681, equation 4). */
+static uint32_t tcp_cc_newreno_ssthresh(tcp_conn_t *conn)
+{
+	uint32_t flight;
+
+	flight = conn->snd_nxt - conn->snd_una;
+	return max(flight / 2, 2 * TCP_SMSS);
+}
+
+/**
+ * @}
+ */
@@ -34,33 +34,175 @@
  * @file TCP connection processing and state machine
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <bool.h>
 #include <errno.h>
 #include <io/log.h>
 #include <macros.h>
 #include <stdlib.h>
+#include <sys/time.h>
+#include "cc.h"
 #include "conn.h"
 #include "iqueue.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+/** Initial receive buffer size */
+#define RCV_BUF_SIZE	(16 * 1024)
+/** Limit for receive buffer auto-tuning */
+#define RCV_BUF_MAX	(1024 * 1024)
+/** Default send buffer size */
+#define SND_BUF_SIZE	(64 * 1024)
+/** Limit for user-specified buffer sizes */
+#define BUF_SIZE_MAX	(4 * 1024 * 1024)
+/** Smallest user-specified buffer size */
+#define BUF_SIZE_MIN	1024
+
+/** Initial retransmission timeout (ms) */
+#define RTO_INIT	1000
+/** Lower bound of retransmission timeout (ms) */
+#define RTO_MIN		1000
+/** Upper bound of retransmission timeout (ms) */
+#define RTO_MAX		(60 * 1000)
+/** Timestamp clock granularity (ms) */
+#define RTO_CLOCK_G	1
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
 
-LIST_INITIALIZE(conn_list);
+#define CONN_HASH_BUCKETS	256
+#define CONN_LISTEN_BUCKETS	64
+
+/** Keys of the connection map */
+enum {
+	CONN_KEY_LADDR,
+	CONN_KEY_LPORT,
+	CONN_KEY_FADDR,
+	CONN_KEY_FPORT,
+	CONN_KEYS
+};
+
+/** Connections with a fully specified socket pair, hashed by the pair */
+static hash_table_t conn_hash;
+/** Connections with a wildcard in the socket pair, hashed by local port */
+static hash_table_t conn_listen_hash;
 FIBRIL_MUTEX_INITIALIZE(conn_list_lock);
 
 static void tcp_conn_seg_process(tcp_conn_t *conn, tcp_segment_t *seg);
+static uint8_t tcp_conn_wscale_for(size_t);
 static void tcp_conn_tw_timer_set(tcp_conn_t *conn);
 static void tcp_conn_tw_timer_clear(tcp_conn_t *conn);
 
+static bool tcp_sockpair_match(tcp_sockpair_t *, tcp_sockpair_t *);
+
+/** Convert socket pair to connection map key. */
+static void tcp_sockpair_key(tcp_sockpair_t *sp, unsigned long key[])
+{
+	key[CONN_KEY_LADDR] = sp->local.addr.ipv4;
+	key[CONN_KEY_LPORT] = sp->local.port;
+	key[CONN_KEY_FADDR] = sp->foreign.addr.ipv4;
+	key[CONN_KEY_FPORT] = sp->foreign.port;
+}
+
+/** Convert connection map key to socket pair. */
+static void tcp_key_sockpair(unsigned long key[], tcp_sockpair_t *sp)
+{
+	sp->local.addr.ipv4 = key[CONN_KEY_LADDR];
+	sp->local.port = key[CONN_KEY_LPORT];
+	sp->foreign.addr.ipv4 = key[CONN_KEY_FADDR];
+	sp->foreign.port = key[CONN_KEY_FPORT];
+}
+
+/** Determine whether socket pair contains a wildcard. */
+static bool tcp_sockpair_wildcard(tcp_sockpair_t *sp)
+{
+	return sp->local.addr.ipv4 == TCP_IPV4_ANY ||
+	    sp->local.port == TCP_PORT_ANY ||
+	    sp->foreign.addr.ipv4 == TCP_IPV4_ANY ||
+	    sp->foreign.port == TCP_PORT_ANY;
+}
+
+static hash_index_t conn_hash_hash(unsigned long key[])
+{
+	unsigned long h;
+
+	h = key[CONN_KEY_LADDR] ^ (key[CONN_KEY_FADDR] * 31) ^
+	    (key[CONN_KEY_LPORT] << 16) ^ key[CONN_KEY_FPORT];
+	h ^= h >> 16;
+
+	return h % CONN_HASH_BUCKETS;
+}
+
+static int conn_hash_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	tcp_conn_t *conn = hash_table_get_instance(item, tcp_conn_t, link);
+	unsigned long ckey[CONN_KEYS];
+
+	assert(keys == CONN_KEYS);
+	tcp_sockpair_key(&conn->ident, ckey);
+
+	return key[CONN_KEY_LADDR] == ckey[CONN_KEY_LADDR] &&
+	    key[CONN_KEY_LPORT] == ckey[CONN_KEY_LPORT] &&
+	    key[CONN_KEY_FADDR] == ckey[CONN_KEY_FADDR] &&
+	    key[CONN_KEY_FPORT] == ckey[CONN_KEY_FPORT];
+}
+
+static hash_index_t conn_listen_hash_hash(unsigned long key[])
+{
+	return key[CONN_KEY_LPORT] % CONN_LISTEN_BUCKETS;
+}
+
+/** Match socket pair given by @a key against the connection pattern. */
+static int conn_listen_hash_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	tcp_conn_t *conn = hash_table_get_instance(item, tcp_conn_t, link);
+	tcp_sockpair_t sp;
+
+	assert(keys == CONN_KEYS);
+	tcp_key_sockpair(key, &sp);
+
+	return tcp_sockpair_match(&sp, &conn->ident);
+}
+
+static void conn_hash_remove_callback(link_t *item)
+{
+}
+
+static hash_table_operations_t conn_hash_ops = {
+	.hash = conn_hash_hash,
+	.compare = conn_hash_compare,
+	.remove_callback = conn_hash_remove_callback
+};
+
+static hash_table_operations_t conn_listen_hash_ops = {
+	.hash = conn_listen_hash_hash,
+	.compare = conn_listen_hash_compare,
+	.remove_callback = conn_hash_remove_callback
+};
+
+/** Initialize connection map. */
+int tcp_conn_init(void)
+{
+	if (!hash_table_create(&conn_hash, CONN_HASH_BUCKETS, CONN_KEYS,
+	    &conn_hash_ops))
+		return ENOMEM;
+
+	if (!hash_table_create(&conn_listen_hash, CONN_LISTEN_BUCKETS,
+	    CONN_KEYS, &conn_listen_hash_ops)) {
+		hash_table_destroy(&conn_hash);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
+
 /** Create new connection structure.
  *
  * @param lsock		Local socket (will be deeply copied)
@@ -71,6 +213,7 @@ tcp_conn_t *tcp_conn_new(tcp_sock_t *lsock, tcp_sock_t *fsock)
 {
 	tcp_conn_t *conn = NULL;
 	bool tqueue_inited = false;
+	bool cc_inited = false;
 
 	/* Allocate connection structure */
 	conn = calloc(1, sizeof(tcp_conn_t));
@@ -89,6 +232,8 @@ tcp_conn_t *tcp_conn_new(tcp_sock_t *lsock, tcp_sock_t *fsock)
 	/* Allocate receive buffer */
 	fibril_condvar_initialize(&conn->rcv_buf_cv);
 	conn->rcv_buf_size = RCV_BUF_SIZE;
+	conn->rcv_buf_max = RCV_BUF_MAX;
+	conn->rcv_buf_auto = true;
 	conn->rcv_buf_used = 0;
 	conn->rcv_buf_fin = false;
 
@@ -107,10 +252,20 @@ tcp_conn_t *tcp_conn_new(tcp_sock_t *lsock, tcp_sock_t *fsock)
 
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
+	conn->rcv_wscale = tcp_conn_wscale_for(conn->rcv_buf_max);
+	conn->rcv_space_time = tcp_conn_ts_now();
 
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
 
+	/* Congestion control and loss recovery */
+	conn->rto = RTO_INIT;
+	conn->rstate = rs_open;
+	if (tcp_cc_init(conn, tcp_cc_default) != EOK)
+		goto error;
+
+	cc_inited = true;
+
 	/* Initialize retransmission queue */
 	if (tcp_tqueue_init(&conn->retransmit, conn) != EOK)
 		goto error;
@@ -134,6 +289,8 @@ tcp_conn_t *tcp_conn_new(tcp_sock_t *lsock, tcp_sock_t *fsock)
 	return conn;
 
 error:
+	if (cc_inited)
+		tcp_cc_fini(conn);
 	if (tqueue_inited)
 		tcp_tqueue_fini(&conn->retransmit);
 	if (conn != NULL && conn->rcv_buf != NULL)
@@ -165,6 +322,7 @@ static void tcp_conn_free(tcp_conn_t *conn)
 {
 	log_msg(LVL_DEBUG, "%s: tcp_conn_free(%p)", conn->name, conn);
 	tcp_tqueue_fini(&conn->retransmit);
+	tcp_cc_fini(conn);
 
 	if (conn->rcv_buf != NULL)
 		free(conn->rcv_buf);
@@ -222,9 +380,52 @@ void tcp_conn_delete(tcp_conn_t *conn)
  */
 void tcp_conn_add(tcp_conn_t *conn)
 {
+	unsigned long key[CONN_KEYS];
+
+	tcp_sockpair_key(&conn->ident, key);
+
 	tcp_conn_addref(conn);
 	fibril_mutex_lock(&conn_list_lock);
-	list_append(&conn->link, &conn_list);
+	if (tcp_sockpair_wildcard(&conn->ident))
+		hash_table_insert(&conn_listen_hash, key, &conn->link);
+	else
+		hash_table_insert(&conn_hash, key, &conn->link);
+	fibril_mutex_unlock(&conn_list_lock);
+}
+
+/** Fill in the wildcards in the connection socket pair.
+ *
+ * Complete the socket pair of a listening connection from the socket pair
+ * of an arriving segment. Once the socket pair is fully specified, the
+ * connection is moved from the listening connection map to the map of
+ * fully specified connections.
+ *
+ * @param conn	Connection
+ * @param sp	Socket pair of the arriving segment
+ */
+void tcp_conn_ident_complete(tcp_conn_t *conn, tcp_sockpair_t *sp)
+{
+	unsigned long key[CONN_KEYS];
+	bool wildcard;
+
+	fibril_mutex_lock(&conn_list_lock);
+	wildcard = tcp_sockpair_wildcard(&conn->ident);
+
+	if (conn->ident.foreign.addr.ipv4 == TCP_IPV4_ANY)
+		conn->ident.foreign.addr.ipv4 = sp->foreign.addr.ipv4;
+	if (conn->ident.foreign.port == TCP_PORT_ANY)
+		conn->ident.foreign.port = sp->foreign.port;
+	if (conn->ident.local.addr.ipv4 == TCP_IPV4_ANY)
+		conn->ident.local.addr.ipv4 = sp->local.addr.ipv4;
+
+	/* Only move the connection if it has not been delisted yet */
+	if (wildcard && !tcp_sockpair_wildcard(&conn->ident) &&
+	    conn->link.next != NULL) {
+		list_remove(&conn->link);
+		tcp_sockpair_key(&conn->ident, key);
+		hash_table_insert(&conn_hash, key, &conn->link);
+	}
+
 	fibril_mutex_unlock(&conn_list_lock);
 }
 
@@ -235,6 +436,10 @@ void tcp_conn_add(tcp_conn_t *conn)
 void tcp_conn_remove(tcp_conn_t *conn)
 {
 	fibril_mutex_lock(&conn_list_lock);
+	/*
+	 * Unlink the connection itself rather than the first one matching
+	 * its socket pair.
+	 */
 	list_remove(&conn->link);
 	fibril_mutex_unlock(&conn_list_lock);
 	tcp_conn_delref(conn);
@@ -265,6 +470,245 @@ static void tcp_conn_state_set(tcp_conn_t *conn, tcp_cstate_t nstate)
 	}
 }
 
+/** Return current time for use in timestamps.
+ *
+ * @return	Time in milliseconds (wraps around)
+ */
+uint32_t tcp_conn_ts_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/** Determine window scale needed to advertise a window of @a size bytes. */
+static uint8_t tcp_conn_wscale_for(size_t size)
+{
+	uint8_t shift;
+
+	shift = 0;
+	while (shift < TCP_WSCALE_MAX && (size >> shift) > UINT16_MAX)
+		++shift;
+
+	return shift;
+}
+
+/** Resize receive buffer.
+ *
+ * The receive window changes by the same amount as the buffer. Once we
+ * have advertised a window the buffer is never shrunk, as that would
+ * take back part of the window from the peer.
+ *
+ * @param conn		Connection
+ * @param size		New buffer size
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+static int tcp_conn_rcv_buf_resize(tcp_conn_t *conn, size_t size)
+{
+	uint8_t *nbuf;
+
+	if (conn->cstate != st_listen)
+		size = max(size, conn->rcv_buf_size);
+
+	if (size == conn->rcv_buf_size)
+		return EOK;
+
+	nbuf = realloc(conn->rcv_buf, size);
+	if (nbuf == NULL)
+		return ENOMEM;
+
+	conn->rcv_buf = nbuf;
+	conn->rcv_wnd = conn->rcv_wnd + size - conn->rcv_buf_size;
+	conn->rcv_buf_size = size;
+
+	return EOK;
+}
+
+/** Resize send buffer.
+ *
+ * The send buffer is never shrunk below the amount of data it holds.
+ *
+ * @param conn		Connection
+ * @param size		New buffer size
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+static int tcp_conn_snd_buf_resize(tcp_conn_t *conn, size_t size)
+{
+	uint8_t *nbuf;
+
+	size = max(size, conn->snd_buf_used);
+	if (size == conn->snd_buf_size)
+		return EOK;
+
+	nbuf = realloc(conn->snd_buf, size);
+	if (nbuf == NULL)
+		return ENOMEM;
+
+	conn->snd_buf = nbuf;
+	if (size > conn->snd_buf_size)
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
+	conn->snd_buf_size = size;
+
+	return EOK;
+}
+
+/** Apply user buffer settings to connection.
+ *
+ * Setting the receive buffer size disables its auto-tuning. Settings
+ * should be applied before the connection is synchronized, later
+ * the receive buffer can only grow.
+ *
+ * @param conn		Connection (locked)
+ * @param opts		Buffer settings
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+int tcp_conn_set_buf_opts(tcp_conn_t *conn, tcp_buf_opts_t *opts)
+{
+	size_t size;
+	int rc;
+
+	if (opts->rcv_buf_size != 0) {
+		size = min(max(opts->rcv_buf_size, BUF_SIZE_MIN), BUF_SIZE_MAX);
+		rc = tcp_conn_rcv_buf_resize(conn, size);
+		if (rc != EOK)
+			return rc;
+
+		conn->rcv_buf_auto = false;
+		conn->rcv_buf_max = conn->rcv_buf_size;
+		if (conn->cstate == st_listen)
+			conn->rcv_wscale = tcp_conn_wscale_for(conn->rcv_buf_max);
+	}
+
+	if (opts->snd_buf_size != 0) {
+		size = min(max(opts->snd_buf_size, BUF_SIZE_MIN), BUF_SIZE_MAX);
+		rc = tcp_conn_snd_buf_resize(conn, size);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
+/** Retrieve current buffer sizes of connection.
+ *
+ * @param conn		Connection (locked)
+ * @param opts		Place to store buffer sizes
+ */
+void tcp_conn_get_buf_opts(tcp_conn_t *conn, tcp_buf_opts_t *opts)
+{
+	opts->rcv_buf_size = conn->rcv_buf_size;
+	opts->snd_buf_size = conn->snd_buf_size;
+}
+
+/** Account for data consumed by the user and auto-tune receive buffer.
+ *
+ * Once per round-trip time we look at how much data the user consumed.
+ * If the peer filled more than half of the buffer within one RTT, the
+ * window may be what limits throughput and the buffer is grown to twice
+ * the amount consumed (up to the limit).
+ *
+ * @param conn		Connection (locked)
+ * @param size		Number of bytes removed from the receive buffer
+ */
+void tcp_conn_rcv_buf_consumed(tcp_conn_t *conn, size_t size)
+{
+	uint32_t now;
+	size_t nsize;
+
+	if (!conn->rcv_buf_auto || conn->srtt == 0)
+		return;
+
+	conn->rcv_space_bytes += size;
+
+	now = tcp_conn_ts_now();
+	if (now - conn->rcv_space_time < conn->srtt)
+		return;
+
+	nsize = min(2 * conn->rcv_space_bytes, conn->rcv_buf_max);
+	conn->rcv_space_bytes = 0;
+	conn->rcv_space_time = now;
+
+	if (nsize <= conn->rcv_buf_size)
+		return;
+
+	log_msg(LVL_DEBUG, "%s: growing receive buffer %zu -> %zu "
+	    "(RTT %" PRIu32 " ms)", conn->name, conn->rcv_buf_size, nsize,
+	    conn->srtt);
+
+	(void) tcp_conn_rcv_buf_resize(conn, nsize);
+}
+
+/** Update round-trip time estimate and retransmission timeout.
+ *
+ * Computed as specified in RFC 6298, section 2.
+ *
+ * @param conn		Connection
+ * @param rtt		Measured round-trip time (ms)
+ */
+void tcp_conn_rtt_sample(tcp_conn_t *conn, uint32_t rtt)
+{
+	uint32_t delta;
+
+	/* Zero means no estimate */
+	if (rtt == 0)
+		rtt = 1;
+
+	if (conn->srtt == 0) {
+		conn->srtt = rtt;
+		conn->rttvar = rtt / 2;
+	} else {
+		delta = conn->srtt > rtt ? conn->srtt - rtt : rtt - conn->srtt;
+		conn->rttvar = (3 * conn->rttvar + delta) / 4;
+		conn->srtt = (7 * conn->srtt + rtt) / 8;
+	}
+
+	conn->rto = conn->srtt + max(RTO_CLOCK_G, 4 * conn->rttvar);
+	conn->rto = min(max(conn->rto, RTO_MIN), RTO_MAX);
+}
+
+/** Back off retransmission timer after it expired (RFC 6298, 5.5). */
+void tcp_conn_rto_backoff(tcp_conn_t *conn)
+{
+	conn->rto = min(2 * conn->rto, RTO_MAX);
+}
+
+/** Process window scale and timestamp options of peer's SYN.
+ *
+ * Each option is only used if both sides sent it in their SYN.
+ *
+ * @param conn		Connection
+ * @param seg		SYN segment
+ */
+static void tcp_conn_syn_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	if (conn->cstate == st_listen)
+		conn->rcv_wscale = tcp_conn_wscale_for(conn->rcv_buf_max);
+
+	if ((seg->opts & SOPT_WSCALE) != 0) {
+		conn->wscale_ok = true;
+		conn->snd_wscale = seg->wscale;
+	} else {
+		conn->wscale_ok = false;
+		conn->snd_wscale = 0;
+		conn->rcv_wscale = 0;
+	}
+
+	if ((seg->opts & SOPT_TS) != 0) {
+		conn->ts_ok = true;
+		conn->ts_recent = seg->ts_val;
+	} else {
+		conn->ts_ok = false;
+	}
+
+	conn->sack_ok = (seg->opts & SOPT_SACK_PERM) != 0;
+
+	log_msg(LVL_DEBUG, "%s: wscale %s (snd %u, rcv %u), timestamps %s, "
+	    "SACK %s", conn->name, conn->wscale_ok ? "on" : "off",
+	    (unsigned) conn->snd_wscale, (unsigned) conn->rcv_wscale,
+	    conn->ts_ok ? "on" : "off", conn->sack_ok ? "on" : "off");
+}
+
 /** Synchronize connection.
  *
  * This is the first step of an active connection attempt,
@@ -345,6 +789,9 @@ static bool tcp_sockpair_match(tcp_sockpair_t *sp, tcp_sockpair_t *pattern)
  *
  * A connection is uniquely identified by a socket pair. Look up our
  * connection map and return connection structure based on socket pair.
+ * A connection with a fully specified socket pair takes precedence over
+ * a listening connection bound to the local port, which in turn takes
+ * precedence over one not bound to any local port.
  * The connection reference count is bumped by one.
  *
  * @param sp	Socket pair
@@ -352,25 +799,32 @@ static bool tcp_sockpair_match(tcp_sockpair_t *sp, tcp_sockpair_t *pattern)
  */
 tcp_conn_t *tcp_conn_find_ref(tcp_sockpair_t *sp)
 {
+	unsigned long key[CONN_KEYS];
+	link_t *link;
+
 	log_msg(LVL_DEBUG, "tcp_conn_find_ref(%p)", sp);
 
+	tcp_sockpair_key(sp, key);
+
 	fibril_mutex_lock(&conn_list_lock);
 
-	list_foreach(conn_list, link) {
-		tcp_conn_t *conn = list_get_instance(link, tcp_conn_t, link);
-		tcp_sockpair_t *csp = &conn->ident;
-		log_msg(LVL_DEBUG2, "compare with conn (f:(%x,%u), l:(%x,%u))",
-		    csp->foreign.addr.ipv4, csp->foreign.port,
-		    csp->local.addr.ipv4, csp->local.port);
-		if (tcp_sockpair_match(sp, csp)) {
-			tcp_conn_addref(conn);
-			fibril_mutex_unlock(&conn_list_lock);
-			return conn;
-		}
+	link = hash_table_find(&conn_hash, key);
+	if (link == NULL)
+		link = hash_table_find(&conn_listen_hash, key);
+	if (link == NULL && sp->local.port != TCP_PORT_ANY) {
+		key[CONN_KEY_LPORT] = TCP_PORT_ANY;
+		link = hash_table_find(&conn_listen_hash, key);
+	}
+
+	if (link == NULL) {
+		fibril_mutex_unlock(&conn_list_lock);
+		return NULL;
 	}
 
+	tcp_conn_t *conn = hash_table_get_instance(link, tcp_conn_t, link);
+	tcp_conn_addref(conn);
 	fibril_mutex_unlock(&conn_list_lock);
-	return NULL;
+	return conn;
 }
 
 /** Reset connection.
@@ -457,6 +911,7 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_syn_opts(conn, seg);
 
 
 	log_msg(LVL_DEBUG, "rcv_nxt=%u", conn->rcv_nxt);
@@ -532,15 +987,19 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
+	tcp_conn_syn_opts(conn, seg);
 
 	if ((seg->ctrl & CTL_ACK) != 0) {
 		conn->snd_una = seg->ack;
 
+		if (conn->ts_ok && seg->ts_ecr != 0)
+			tcp_conn_rtt_sample(conn, tcp_conn_ts_now() - seg->ts_ecr);
+
 		/*
 		 * Prune acked segments from retransmission queue and
 		 * possibly transmit more data.
 		 */
-		tcp_tqueue_ack_received(conn);
+		tcp_tqueue_ack_received(conn, 0);
 	}
 
 	log_msg(LVL_DEBUG, "Sent SYN, got SYN.");
@@ -580,6 +1039,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
+	bool ooo;
 
 	log_msg(LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
@@ -591,6 +1051,16 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	/*
+	 * Out-of-order segment is remembered for SACK and acknowledged
+	 * immediately to let the peer detect loss. So is a segment that
+	 * fills in a gap (RFC 5681, section 4.2).
+	 */
+	ooo = !seq_no_segment_ready(conn, seg) ||
+	    !list_empty(&conn->incoming.list);
+	if (!seq_no_segment_ready(conn, seg))
+		conn->sack_last = seg->seq;
+
 	/* Queue for processing */
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
@@ -602,6 +1072,9 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	if (ooo)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 }
 
 /** Process segment RST field.
@@ -717,6 +1190,9 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
 	/* XXX Not mentioned in spec?! */
 	conn->snd_una = seg->ack;
 
+	/* Remove our SYN from the retransmission queue */
+	tcp_tqueue_ack_received(conn, 0);
+
 	return cp_continue;
 }
 
@@ -729,12 +1205,18 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	uint32_t acked;
+	bool dupack;
+
 	log_msg(LVL_DEBUG, "tcp_conn_seg_proc_ack_est(%p, %p)", conn, seg);
 
 	log_msg(LVL_DEBUG, "SEG.ACK=%u, SND.UNA=%u, SND.NXT=%u",
 	    (unsigned)seg->ack, (unsigned)conn->snd_una,
 	    (unsigned)conn->snd_nxt);
 
+	acked = 0;
+	dupack = false;
+
 	if (!seq_no_ack_acceptable(conn, seg->ack)) {
 		log_msg(LVL_DEBUG, "ACK not acceptable.");
 		if (!seq_no_ack_duplicate(conn, seg->ack)) {
@@ -744,16 +1226,34 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 			tcp_segment_delete(seg);
 			return cp_done;
-		} else {
-			log_msg(LVL_DEBUG, "Ignoring duplicate ACK.");
 		}
+
+		/* Duplicate ACK as defined in RFC 5681, section 2 */
+		dupack = seg->ack == conn->snd_una &&
+		    conn->snd_una != conn->snd_nxt &&
+		    tcp_segment_text_size(seg) == 0 &&
+		    (seg->ctrl & (CTL_SYN | CTL_FIN)) == 0 &&
+		    ((uint32_t) seg->wnd << conn->snd_wscale) == conn->snd_wnd;
+		log_msg(LVL_DEBUG, "Duplicate ACK (%s).", dupack ? "counted" :
+		    "ignored");
 	} else {
 		/* Update SND.UNA */
+		acked = seg->ack - conn->snd_una;
 		conn->snd_una = seg->ack;
+
+		/* RTT measurement (RFC 7323, section 4.1) */
+		if (conn->ts_ok && (seg->opts & SOPT_TS) != 0 &&
+		    seg->ts_ecr != 0) {
+			tcp_conn_rtt_sample(conn,
+			    tcp_conn_ts_now() - seg->ts_ecr);
+		}
 	}
 
+	if (conn->sack_ok && (seg->opts & SOPT_SACK) != 0)
+		tcp_tqueue_sack_received(conn, seg);
+
 	if (seq_no_new_wnd_update(conn, seg)) {
-		conn->snd_wnd = seg->wnd;
+		conn->snd_wnd = (uint32_t) seg->wnd << conn->snd_wscale;
 		conn->snd_wl1 = seg->seq;
 		conn->snd_wl2 = seg->ack;
 
@@ -763,10 +1263,13 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 	}
 
 	/*
-	 * Prune acked segments from retransmission queue and
-	 * possibly transmit more data.
+	 * Prune acked segments from retransmission queue, run loss
+	 * recovery and possibly transmit more data.
 	 */
-	tcp_tqueue_ack_received(conn);
+	if (dupack)
+		tcp_tqueue_dupack(conn);
+	else
+		tcp_tqueue_ack_received(conn, acked);
 
 	return cp_continue;
 }
@@ -989,9 +1492,9 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	/* Update receive window. XXX Not an efficient strategy. */
 	conn->rcv_wnd -= xfer_size;
 
-	/* Send ACK */
+	/* Acknowledge, possibly piggybacked or delayed */
 	if (xfer_size > 0)
-		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		tcp_tqueue_ack_delayed(conn);
 
 	if (xfer_size < seg->len) {
 		/* Trim part of segment which we just received */
@@ -1104,6 +1607,11 @@ static void tcp_conn_seg_process(tcp_conn_t *conn, tcp_segment_t *seg)
 	}
 */
 
+	/* Update TS.Recent (RFC 7323, section 4.3) */
+	if (conn->ts_ok && (seg->opts & SOPT_TS) != 0 &&
+	    (int32_t) (seg->ts_val - conn->ts_recent) >= 0)
+		conn->ts_recent = seg->ts_val;
+
 	if (tcp_conn_seg_proc_rst(conn, seg) == cp_done)
 		return;
 
@@ -1148,6 +1656,8 @@ void tcp_conn_segment_arrived(tcp_conn_t *conn, tcp_segment_t *seg)
 	log_msg(LVL_DEBUG, "%c: tcp_conn_segment_arrived(%p)",
 	    conn->name, seg);
 
+	++conn->stats.segs_rcvd;
+
 	switch (conn->cstate) {
 	case st_listen:
 		tcp_conn_sa_listen(conn, seg); break;
@@ -1270,7 +1780,11 @@ void tcp_reply_rst(tcp_sockpair_t *sp, tcp_segment_t *seg)
 	log_msg(LVL_DEBUG, "tcp_reply_rst(%p, %p)", sp, seg);
 
 	rseg = tcp_segment_make_rst(seg);
+	if (rseg == NULL)
+		return;
+
 	tcp_transmit_segment(sp, rseg);
+	tcp_segment_delete(rseg);
 }
 
 /**
@@ -38,10 +38,18 @@
 #include <bool.h>
 #include "tcp_type.h"
 
+extern int tcp_conn_init(void);
 extern tcp_conn_t *tcp_conn_new(tcp_sock_t *, tcp_sock_t *);
 extern void tcp_conn_delete(tcp_conn_t *);
 extern void tcp_conn_add(tcp_conn_t *);
 extern void tcp_conn_remove(tcp_conn_t *);
+extern void tcp_conn_ident_complete(tcp_conn_t *, tcp_sockpair_t *);
+extern uint32_t tcp_conn_ts_now(void);
+extern int tcp_conn_set_buf_opts(tcp_conn_t *, tcp_buf_opts_t *);
+extern void tcp_conn_get_buf_opts(tcp_conn_t *, tcp_buf_opts_t *);
+extern void tcp_conn_rcv_buf_consumed(tcp_conn_t *, size_t);
+extern void tcp_conn_rtt_sample(tcp_conn_t *, uint32_t);
+extern void tcp_conn_rto_backoff(tcp_conn_t *);
 extern void tcp_conn_sync(tcp_conn_t *);
 extern void tcp_conn_fin_sent(tcp_conn_t *);
 extern void tcp_conn_ack_of_fin_rcvd(tcp_conn_t *);
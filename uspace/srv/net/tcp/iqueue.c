@@ -83,8 +83,12 @@ void tcp_iqueue_insert_seg(tcp_iqueue_t *iqueue, tcp_segment_t *seg)
 		qe = list_get_instance(link,
 		    tcp_iqueue_entry_t, link);
 
-		if (seq_no_seg_cmp(iqueue->conn, iqe->seg, qe->seg) >= 0)
+		if (seq_no_seg_cmp(iqueue->conn, iqe->seg, qe->seg) < 0)
 			break;
+
+		link = link->next;
+		if (link == &iqueue->list.head)
+			link = NULL;
 	}
 
 	if (link != NULL)
@@ -126,6 +130,7 @@ int tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 
 		list_remove(&iqe->link);
 		tcp_segment_delete(iqe->seg);
+		free(iqe);
 
          	link = list_first(&iqueue->list);
 		if (link == NULL) {
@@ -147,10 +152,82 @@ int tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	log_msg(LVL_DEBUG, "Returning ready segment %p", iqe->seg);
 	list_remove(&iqe->link);
 	*seg = iqe->seg;
+	free(iqe);
 
 	return EOK;
 }
 
+/** Describe queued out-of-order data as SACK blocks.
+ *
+ * The block containing sequence number @a first (the most recently
+ * received data) is reported first, the rest follow in sequence order
+ * (RFC 2018, section 4).
+ *
+ * @param iqueue	Incoming queue
+ * @param first		Sequence number that should be reported first
+ * @param blk		Array to fill in
+ * @param max_blk	Size of @a blk
+ * @return		Number of blocks filled in
+ */
+unsigned tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, uint32_t first,
+    tcp_sack_blk_t *blk, unsigned max_blk)
+{
+	tcp_iqueue_entry_t *iqe;
+	tcp_sack_blk_t cur;
+	tcp_sack_blk_t tmp;
+	bool have_cur;
+	unsigned cnt;
+	unsigned i;
+	uint32_t rcv_nxt;
+	uint32_t end;
+
+	rcv_nxt = iqueue->conn->rcv_nxt;
+	have_cur = false;
+	cnt = 0;
+
+	list_foreach(iqueue->list, link) {
+		iqe = list_get_instance(link, tcp_iqueue_entry_t, link);
+		end = iqe->seg->seq + iqe->seg->len;
+
+		/* Skip data that has already been processed */
+		if (!seq_no_lt(rcv_nxt, end))
+			continue;
+
+		if (have_cur && !seq_no_lt(cur.end, iqe->seg->seq)) {
+			/* Overlaps or adjoins current block */
+			if (seq_no_lt(cur.end, end))
+				cur.end = end;
+			continue;
+		}
+
+		if (have_cur && cnt < max_blk)
+			blk[cnt++] = cur;
+
+		cur.start = iqe->seg->seq;
+		cur.end = end;
+		have_cur = true;
+	}
+
+	if (have_cur && cnt < max_blk)
+		blk[cnt++] = cur;
+
+	/* Move block containing @a first to the front */
+	for (i = 0; i < cnt; i++) {
+		if (!seq_no_lt(first, blk[i].start) &&
+		    seq_no_lt(first, blk[i].end)) {
+			tmp = blk[i];
+			while (i > 0) {
+				blk[i] = blk[i - 1];
+				--i;
+			}
+			blk[0] = tmp;
+			break;
+		}
+	}
+
+	return cnt;
+}
+
 /**
  * @}
  */
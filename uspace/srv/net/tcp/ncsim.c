@@ -42,8 +42,10 @@
 #include <async.h>
 #include <errno.h>
 #include <io/log.h>
+#include <macros.h>
 #include <stdlib.h>
 #include <fibril.h>
+#include <sys/time.h>
 #include "conn.h"
 #include "ncsim.h"
 #include "rqueue.h"
@@ -54,6 +56,20 @@ static list_t sim_queue;
 static fibril_mutex_t sim_queue_lock;
 static fibril_condvar_t sim_queue_cv;
 
+/** Simulator is active */
+static bool sim_enabled = false;
+/** Probability of dropping a segment (per mille) */
+static unsigned sim_loss;
+/** Fixed one-way delay (us) */
+static suseconds_t sim_delay;
+/** Maximum random delay added to the fixed delay (us) */
+static suseconds_t sim_jitter;
+
+/** Number of segments delivered */
+static size_t sim_delivered;
+/** Number of segments dropped */
+static size_t sim_dropped;
+
 /** Initialize segment receive queue. */
 void tcp_ncsim_init(void)
 {
@@ -62,7 +78,46 @@ void tcp_ncsim_init(void)
 	fibril_condvar_initialize(&sim_queue_cv);
 }
 
+/** Enable simulator and set network conditions.
+ *
+ * @param loss		Probability of dropping a segment (per mille)
+ * @param delay		Fixed one-way delay (us)
+ * @param jitter	Maximum random delay added to @a delay (us)
+ */
+void tcp_ncsim_configure(unsigned loss, suseconds_t delay, suseconds_t jitter)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_enabled = true;
+	sim_loss = min(loss, 1000);
+	sim_delay = delay;
+	sim_jitter = jitter;
+	sim_delivered = 0;
+	sim_dropped = 0;
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Determine whether segments should be routed via the simulator. */
+bool tcp_ncsim_enabled(void)
+{
+	return sim_enabled;
+}
+
+/** Get simulator counters.
+ *
+ * @param delivered	Place to store number of delivered segments
+ * @param dropped	Place to store number of dropped segments
+ */
+void tcp_ncsim_stats(size_t *delivered, size_t *dropped)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+	*delivered = sim_delivered;
+	*dropped = sim_dropped;
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
 /** Bounce segment through simulator into receive queue.
+ *
+ * The simulator takes ownership of the segment.
  *
  * @param sp	Socket pair, oriented for transmission
  * @param seg	Segment
@@ -71,47 +126,62 @@ void tcp_ncsim_bounce_seg(tcp_sockpair_t *sp, tcp_segment_t *seg)
 {
 	tcp_squeue_entry_t *sqe;
 	tcp_squeue_entry_t *old_qe;
-	link_t *link;
+	suseconds_t delay;
+	bool inserted;
 
 	log_msg(LVL_DEBUG, "tcp_ncsim_bounce_seg()");
-	tcp_rqueue_bounce_seg(sp, seg);
-	return;
 
-	if (0 /*random() % 4 == 3*/) {
+	fibril_mutex_lock(&sim_queue_lock);
+
+	if (sim_loss > 0 && (unsigned) (random() % 1000) < sim_loss) {
 		/* Drop segment */
-		log_msg(LVL_ERROR, "NCSim dropping segment");
+		log_msg(LVL_DEBUG, "NCSim dropping segment");
+		++sim_dropped;
+		fibril_mutex_unlock(&sim_queue_lock);
 		tcp_segment_delete(seg);
 		return;
 	}
 
+	delay = sim_delay;
+	if (sim_jitter > 0)
+		delay += random() % sim_jitter;
+
+	fibril_mutex_unlock(&sim_queue_lock);
+
+	if (delay == 0) {
+		fibril_mutex_lock(&sim_queue_lock);
+		++sim_delivered;
+		fibril_mutex_unlock(&sim_queue_lock);
+		tcp_rqueue_bounce_seg(sp, seg);
+		return;
+	}
+
 	sqe = calloc(1, sizeof(tcp_squeue_entry_t));
 	if (sqe == NULL) {
 		log_msg(LVL_ERROR, "Failed allocating SQE.");
+		tcp_segment_delete(seg);
 		return;
 	}
 
-	sqe->delay = random() % (1000 * 1000);
+	gettimeofday(&sqe->due, NULL);
+	tv_add(&sqe->due, delay);
 	sqe->sp = *sp;
 	sqe->seg = seg;
 
 	fibril_mutex_lock(&sim_queue_lock);
 
-	link = list_first(&sim_queue);
-	while (link != NULL && sqe->delay > 0) {
+	/* Keep the queue sorted by delivery time */
+	inserted = false;
+	list_foreach(sim_queue, link) {
 		old_qe = list_get_instance(link, tcp_squeue_entry_t, link);
-		if (sqe->delay < old_qe->delay)
+		if (tv_gt(&old_qe->due, &sqe->due)) {
+			list_insert_before(&sqe->link, link);
+			inserted = true;
 			break;
-
-		sqe->delay -= old_qe->delay;
-
-		link = link->next;
-		if (link == &sim_queue.head)
-			link = NULL;
+		}
 	}
 
-	if (link != NULL)
-		list_insert_after(&sqe->link, link);
-	else
+	if (!inserted)
 		list_append(&sqe->link, &sim_queue);
 
 	fibril_condvar_broadcast(&sim_queue_cv);
@@ -123,27 +193,35 @@ static int tcp_ncsim_fibril(void *arg)
 {
 	link_t *link;
 	tcp_squeue_entry_t *sqe;
-	int rc;
+	struct timeval now;
+	suseconds_t wait;
 
 	log_msg(LVL_DEBUG, "tcp_ncsim_fibril()");
 
-
 	while (true) {
 		fibril_mutex_lock(&sim_queue_lock);
 
-		while (list_empty(&sim_queue))
-			fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+		while (true) {
+			while (list_empty(&sim_queue))
+				fibril_condvar_wait(&sim_queue_cv,
+				    &sim_queue_lock);
 
-		do {
 			link = list_first(&sim_queue);
 			sqe = list_get_instance(link, tcp_squeue_entry_t, link);
 
+			gettimeofday(&now, NULL);
+			if (tv_gteq(&now, &sqe->due))
+				break;
+
+			/* Sleep until due or until an earlier segment arrives */
+			wait = tv_sub(&sqe->due, &now);
 			log_msg(LVL_DEBUG, "NCSim - Sleep");
-			rc = fibril_condvar_wait_timeout(&sim_queue_cv,
-			    &sim_queue_lock, sqe->delay);
-		} while (rc != ETIMEOUT);
+			(void) fibril_condvar_wait_timeout(&sim_queue_cv,
+			    &sim_queue_lock, wait);
+		}
 
 		list_remove(link);
+		++sim_delivered;
 		fibril_mutex_unlock(&sim_queue_lock);
 
 		log_msg(LVL_DEBUG, "NCSim - End Sleep");
@@ -35,9 +35,14 @@
 #ifndef NCSIM_H
 #define NCSIM_H
 
+#include <bool.h>
+#include <sys/time.h>
 #include "tcp_type.h"
 
 extern void tcp_ncsim_init(void);
+extern void tcp_ncsim_configure(unsigned, suseconds_t, suseconds_t);
+extern bool tcp_ncsim_enabled(void);
+extern void tcp_ncsim_stats(size_t *, size_t *);
 extern void tcp_ncsim_bounce_seg(tcp_sockpair_t *, tcp_segment_t *);
 extern void tcp_ncsim_fibril_start(void);
 
@@ -34,10 +34,14 @@
  * @file TCP header encoding and decoding
  */
 
+#include <assert.h>
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/inet.h>
+#include <macros.h>
 #include <mem.h>
+#include <net/checksum.h>
 #include <stdlib.h>
 #include "pdu.h"
 #include "segment.h"
@@ -45,44 +49,6 @@
 #include "std.h"
 #include "tcp_type.h"
 
-#define TCP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t tcp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t tcp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2*i] << 8) | bdata[2*i + 1];
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2*words] << 8);
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void tcp_header_decode_flags(uint16_t doff_flags, tcp_control_t *rctl)
 {
 	tcp_control_t ctl;
@@ -124,7 +90,8 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(tcp_sockpair_t *sp, tcp_segment_t *seg, tcp_header_t *hdr)
+static void tcp_header_setup(tcp_sockpair_t *sp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -134,7 +101,7 @@ static void tcp_header_setup(tcp_sockpair_t *sp, tcp_segment_t *seg, tcp_header_
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -152,6 +119,156 @@ static void tcp_phdr_setup(tcp_pdu_t *pdu, tcp_phdr_t *phdr)
 	phdr->tcp_length = host2uint16_t_be(pdu->header_size + pdu->text_size);
 }
 
+/** Size of encoded options, padded to a multiple of four octets. */
+static size_t tcp_header_opts_size(tcp_segment_t *seg)
+{
+	size_t size;
+
+	size = 0;
+
+	/* NOP, Window Scale */
+	if ((seg->opts & SOPT_WSCALE) != 0)
+		size += 1 + OPT_WINDOW_SCALE_LEN;
+	/* NOP, NOP, Timestamps */
+	if ((seg->opts & SOPT_TS) != 0)
+		size += 2 + OPT_TIMESTAMP_LEN;
+	/* NOP, NOP, SACK permitted */
+	if ((seg->opts & SOPT_SACK_PERM) != 0)
+		size += 2 + OPT_SACK_PERMITTED_LEN;
+	/* NOP, NOP, SACK */
+	if ((seg->opts & SOPT_SACK) != 0)
+		size += 2 + OPT_SACK_LEN + seg->sack_cnt * OPT_SACK_BLOCK_LEN;
+
+	return size;
+}
+
+static void tcp_header_encode_opts(tcp_segment_t *seg, uint8_t *opt)
+{
+	uint32_t ts;
+	uint32_t edge;
+	unsigned i;
+
+	if ((seg->opts & SOPT_WSCALE) != 0) {
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_WINDOW_SCALE;
+		*opt++ = OPT_WINDOW_SCALE_LEN;
+		*opt++ = seg->wscale;
+	}
+
+	if ((seg->opts & SOPT_TS) != 0) {
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_TIMESTAMP;
+		*opt++ = OPT_TIMESTAMP_LEN;
+		ts = host2uint32_t_be(seg->ts_val);
+		memcpy(opt, &ts, sizeof(uint32_t));
+		opt += sizeof(uint32_t);
+		ts = host2uint32_t_be(seg->ts_ecr);
+		memcpy(opt, &ts, sizeof(uint32_t));
+		opt += sizeof(uint32_t);
+	}
+
+	if ((seg->opts & SOPT_SACK_PERM) != 0) {
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_SACK_PERMITTED;
+		*opt++ = OPT_SACK_PERMITTED_LEN;
+	}
+
+	if ((seg->opts & SOPT_SACK) != 0) {
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_NOP;
+		*opt++ = OPT_SACK;
+		*opt++ = OPT_SACK_LEN + seg->sack_cnt * OPT_SACK_BLOCK_LEN;
+		for (i = 0; i < seg->sack_cnt; i++) {
+			edge = host2uint32_t_be(seg->sack[i].start);
+			memcpy(opt, &edge, sizeof(uint32_t));
+			opt += sizeof(uint32_t);
+			edge = host2uint32_t_be(seg->sack[i].end);
+			memcpy(opt, &edge, sizeof(uint32_t));
+			opt += sizeof(uint32_t);
+		}
+	}
+}
+
+/** Decode header options.
+ *
+ * Unknown options are skipped, malformed option lists are truncated.
+ *
+ * @param opt		Start of options
+ * @param size		Size of options in bytes
+ * @param seg		Segment to fill in
+ */
+static void tcp_header_decode_opts(uint8_t *opt, size_t size,
+    tcp_segment_t *seg)
+{
+	size_t i, j;
+	size_t len;
+	uint32_t ts;
+
+	seg->opts = 0;
+	i = 0;
+
+	while (i < size) {
+		if (opt[i] == OPT_END_LIST)
+			break;
+
+		if (opt[i] == OPT_NOP) {
+			++i;
+			continue;
+		}
+
+		if (i + 1 >= size)
+			break;
+
+		len = opt[i + 1];
+		if (len < 2 || i + len > size)
+			break;
+
+		switch (opt[i]) {
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			seg->opts |= SOPT_WSCALE;
+			seg->wscale = min(opt[i + 2], TCP_WSCALE_MAX);
+			break;
+		case OPT_TIMESTAMP:
+			if (len != OPT_TIMESTAMP_LEN)
+				break;
+			seg->opts |= SOPT_TS;
+			memcpy(&ts, &opt[i + 2], sizeof(uint32_t));
+			seg->ts_val = uint32_t_be2host(ts);
+			memcpy(&ts, &opt[i + 6], sizeof(uint32_t));
+			seg->ts_ecr = uint32_t_be2host(ts);
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			seg->opts |= SOPT_SACK_PERM;
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_LEN) % OPT_SACK_BLOCK_LEN != 0)
+				break;
+			seg->opts |= SOPT_SACK;
+			seg->sack_cnt = min((len - OPT_SACK_LEN) /
+			    OPT_SACK_BLOCK_LEN, TCP_SACK_BLOCKS_MAX);
+			for (j = 0; j < seg->sack_cnt; j++) {
+				memcpy(&ts, &opt[i + 2 + j * OPT_SACK_BLOCK_LEN],
+				    sizeof(uint32_t));
+				seg->sack[j].start = uint32_t_be2host(ts);
+				memcpy(&ts, &opt[i + 6 + j * OPT_SACK_BLOCK_LEN],
+				    sizeof(uint32_t));
+				seg->sack[j].end = uint32_t_be2host(ts);
+			}
+			break;
+		default:
+			break;
+		}
+
+		i += len;
+	}
+}
+
 static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 {
 	tcp_header_decode_flags(uint16_t_be2host(hdr->doff_flags), &seg->ctrl);
@@ -161,20 +278,13 @@ static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
 	seg->up = uint16_t_be2host(hdr->urg_ptr);
 }
 
-static int tcp_header_encode(tcp_sockpair_t *sp, tcp_segment_t *seg,
-    void **header, size_t *size)
+static void tcp_header_encode(tcp_sockpair_t *sp, tcp_segment_t *seg,
+    void *header, size_t hdr_size)
 {
-	tcp_header_t *hdr;
+	tcp_header_t *hdr = (tcp_header_t *)header;
 
-	hdr = calloc(1, sizeof(tcp_header_t));
-	if (hdr == NULL)
-		return ENOMEM;
-
-	tcp_header_setup(sp, seg, hdr);
-	*header = hdr;
-	*size = sizeof(tcp_header_t);
-
-	return EOK;
+	tcp_header_setup(sp, seg, hdr, hdr_size);
+	tcp_header_encode_opts(seg, (uint8_t *) (hdr + 1));
 }
 
 static tcp_pdu_t *tcp_pdu_new(void)
@@ -182,68 +292,59 @@ static tcp_pdu_t *tcp_pdu_new(void)
 	return calloc(1, sizeof(tcp_pdu_t));
 }
 
-/** Create PDU with the specified header and text data.
+/** Create PDU referencing encoded data in a packet buffer.
  *
+ * A reference to @a pbuf is added instead of copying the data, unless
+ * the buffer is borrowed from inetsrv and needs to be copied in order to
+ * outlive the receive call (see pbuf_keep()).
  * Note that you still need to set addresses in the returned PDU.
  *
- * @param hdr		Header data
+ * @param pbuf		Buffer holding the header followed by text
  * @param hdr_size      Header size in bytes
- * @param text		Text data
- * @param text_size	Text size in bytes
  * @return		New PDU
  */
-tcp_pdu_t *tcp_pdu_create(void *hdr, size_t hdr_size, void *text,
-    size_t text_size)
+tcp_pdu_t *tcp_pdu_create(pbuf_t *pbuf, size_t hdr_size)
 {
 	tcp_pdu_t *pdu;
 
+	assert(hdr_size <= pbuf->size);
+
 	pdu = tcp_pdu_new();
 	if (pdu == NULL)
 		return NULL;
 
-	pdu->header = malloc(hdr_size);
-	pdu->text = malloc(text_size);
-	if (pdu->header == NULL || pdu->text == NULL)
-		goto error;
-
-	memcpy(pdu->header, hdr, hdr_size);
-	memcpy(pdu->text, text, text_size);
+	pdu->pbuf = pbuf_keep(pbuf);
+	if (pdu->pbuf == NULL) {
+		tcp_pdu_delete(pdu);
+		return NULL;
+	}
 
+	pdu->header = pdu->pbuf->data;
 	pdu->header_size = hdr_size;
-	pdu->text_size = text_size;
+	pdu->text = pdu->pbuf->data + hdr_size;
+	pdu->text_size = pdu->pbuf->size - hdr_size;
 
 	return pdu;
-
-error:
-	if (pdu->header != NULL)
-		free(pdu->header);
-	if (pdu->text != NULL)
-		free(pdu->text);
-
-	return NULL;
 }
 
 void tcp_pdu_delete(tcp_pdu_t *pdu)
 {
-	free(pdu->header);
-	free(pdu->text);
+	if (pdu->pbuf != NULL)
+		pbuf_delref(pdu->pbuf);
 	free(pdu);
 }
 
-static uint16_t tcp_pdu_checksum_calc(tcp_pdu_t *pdu)
+/** Compute checksum of pseudo-header and TCP header. */
+static uint16_t tcp_pdu_hdr_checksum_calc(tcp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
-	uint16_t cs_headers;
-	uint16_t cs_all;
 	tcp_phdr_t phdr;
 
 	tcp_phdr_setup(pdu, &phdr);
-	cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *)&phdr,
+	cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, (void *)&phdr,
 	    sizeof(tcp_phdr_t));
-	cs_headers = tcp_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
-	cs_all = tcp_checksum_calc(cs_headers, pdu->text, pdu->text_size);
 
-	return cs_all;
+	return inet_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
 }
 
 static void tcp_pdu_set_checksum(tcp_pdu_t *pdu, uint16_t checksum)
@@ -260,11 +361,14 @@ int tcp_pdu_decode(tcp_pdu_t *pdu, tcp_sockpair_t *sp, tcp_segment_t **seg)
 	tcp_segment_t *nseg;
 	tcp_header_t *hdr;
 
-	nseg = tcp_segment_make_data(0, pdu->text, pdu->text_size);
+	/* Segment text references the PDU buffer, it is not copied */
+	nseg = tcp_segment_make_pbuf(0, pdu->pbuf, pdu->text, pdu->text_size);
 	if (nseg == NULL)
 		return ENOMEM;
 
 	tcp_header_decode(pdu->header, nseg);
+	tcp_header_decode_opts((uint8_t *) pdu->header + sizeof(tcp_header_t),
+	    pdu->header_size - sizeof(tcp_header_t), nseg);
 	nseg->len += seq_no_control_len(nseg->ctrl);
 
 	hdr = (tcp_header_t *)pdu->header;
@@ -278,10 +382,15 @@ int tcp_pdu_decode(tcp_pdu_t *pdu, tcp_sockpair_t *sp, tcp_segment_t **seg)
 	return EOK;
 }
 
-/** Encode outgoing PDU */
+/** Encode outgoing PDU.
+ *
+ * Header and text are encoded into a single buffer so that the PDU can be
+ * passed to the network layer as is.
+ */
 int tcp_pdu_encode(tcp_sockpair_t *sp, tcp_segment_t *seg, tcp_pdu_t **pdu)
 {
 	tcp_pdu_t *npdu;
+	size_t hdr_size;
 	size_t text_size;
 	uint16_t checksum;
 
@@ -289,20 +398,30 @@ int tcp_pdu_encode(tcp_sockpair_t *sp, tcp_segment_t *seg, tcp_pdu_t **pdu)
 	if (npdu == NULL)
 		return ENOMEM;
 
-	npdu->src_addr = sp->local.addr;
-	npdu->dest_addr = sp->foreign.addr;
-	tcp_header_encode(sp, seg, &npdu->header, &npdu->header_size);
-
+	hdr_size = sizeof(tcp_header_t) + tcp_header_opts_size(seg);
 	text_size = tcp_segment_text_size(seg);
-	npdu->text = calloc(1, text_size);
-	if (npdu->text == NULL)
+
+	npdu->pbuf = pbuf_alloc_shared(INET_HEADROOM, hdr_size + text_size,
+	    INET_TAILROOM);
+	if (npdu->pbuf == NULL) {
+		tcp_pdu_delete(npdu);
 		return ENOMEM;
+	}
 
+	npdu->src_addr = sp->local.addr;
+	npdu->dest_addr = sp->foreign.addr;
+
+	npdu->header = npdu->pbuf->data;
+	npdu->header_size = hdr_size;
+	npdu->text = npdu->pbuf->data + hdr_size;
 	npdu->text_size = text_size;
-	memcpy(npdu->text, seg->data, text_size);
 
-	/* Checksum calculation */
-	checksum = tcp_pdu_checksum_calc(npdu);
+	tcp_header_encode(sp, seg, npdu->header, hdr_size);
+
+	/* Copy text and compute checksum in one pass */
+	checksum = tcp_pdu_hdr_checksum_calc(npdu);
+	checksum = tcp_segment_text_copy_cksum(seg, npdu->text, text_size,
+	    checksum);
 	tcp_pdu_set_checksum(npdu, checksum);
 
 	*pdu = npdu;
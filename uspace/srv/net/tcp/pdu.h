@@ -35,11 +35,12 @@
 #ifndef PDU_H
 #define PDU_H
 
+#include <net/pbuf.h>
 #include <sys/types.h>
 #include "std.h"
 #include "tcp_type.h"
 
-extern tcp_pdu_t *tcp_pdu_create(void *, size_t, void *, size_t);
+extern tcp_pdu_t *tcp_pdu_create(pbuf_t *, size_t);
 extern void tcp_pdu_delete(tcp_pdu_t *);
 extern int tcp_pdu_decode(tcp_pdu_t *, tcp_sockpair_t *, tcp_segment_t **);
 extern int tcp_pdu_encode(tcp_sockpair_t *, tcp_segment_t *, tcp_pdu_t **);
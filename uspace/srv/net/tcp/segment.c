@@ -36,6 +36,7 @@
 
 #include <io/log.h>
 #include <mem.h>
+#include <net/checksum.h>
 #include <stdlib.h>
 #include "segment.h"
 #include "seq_no.h"
@@ -50,10 +51,14 @@ tcp_segment_t *tcp_segment_new(void)
 /** Delete segment. */
 void tcp_segment_delete(tcp_segment_t *seg)
 {
+	if (seg->pbuf != NULL)
+		pbuf_delref(seg->pbuf);
 	free(seg);
 }
 
 /** Create duplicate of segment.
+ *
+ * The duplicate shares text data with the original segment.
  *
  * @param seg	Segment
  * @return 	Duplicate segment
@@ -61,7 +66,6 @@ void tcp_segment_delete(tcp_segment_t *seg)
 tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 {
 	tcp_segment_t *scopy;
-	size_t tsize;
 
 	scopy = tcp_segment_new();
 	if (scopy == NULL)
@@ -73,16 +77,17 @@ tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 	scopy->len = seg->len;
 	scopy->wnd = seg->wnd;
 	scopy->up = seg->up;
-
-	tsize = tcp_segment_text_size(seg);
-	scopy->data = calloc(tsize, 1);
-	if (scopy->data == NULL) {
-		free(scopy);
-		return NULL;
-	}
-
-	memcpy(scopy->data, seg->data, tsize);
-	scopy->dfptr = scopy->data;
+	scopy->opts = seg->opts;
+	scopy->wscale = seg->wscale;
+	scopy->ts_val = seg->ts_val;
+	scopy->ts_ecr = seg->ts_ecr;
+	scopy->sack_cnt = seg->sack_cnt;
+	memcpy(scopy->sack, seg->sack, sizeof(seg->sack));
+
+	scopy->data = seg->data;
+	scopy->pbuf = seg->pbuf;
+	if (scopy->pbuf != NULL)
+		pbuf_addref(scopy->pbuf);
 
 	return scopy;
 }
@@ -146,17 +151,51 @@ tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
 	seg->ctrl = ctrl;
 	seg->len = seq_no_control_len(ctrl) + size;
 
-	seg->dfptr = seg->data = malloc(size);
-	if (seg->dfptr == NULL) {
+	if (size == 0)
+		return seg;
+
+	seg->pbuf = pbuf_alloc(0, size, 0);
+	if (seg->pbuf == NULL) {
 		free(seg);
 		return NULL;
 	}
 
+	seg->data = seg->pbuf->data;
 	memcpy(seg->data, data, size);
 
 	return seg;
 }
 
+/** Create a segment referencing text in a packet buffer.
+ *
+ * @param ctrl	Control flags
+ * @param pbuf	Buffer holding the text, a reference is added to it
+ * @param data	Text, must point into @a pbuf
+ * @param size	Text size in bytes
+ * @return	Segment
+ */
+tcp_segment_t *tcp_segment_make_pbuf(tcp_control_t ctrl, pbuf_t *pbuf,
+    void *data, size_t size)
+{
+	tcp_segment_t *seg;
+
+	seg = tcp_segment_new();
+	if (seg == NULL)
+		return NULL;
+
+	seg->ctrl = ctrl;
+	seg->len = seq_no_control_len(ctrl) + size;
+
+	if (size == 0)
+		return seg;
+
+	seg->data = data;
+	seg->pbuf = pbuf;
+	pbuf_addref(pbuf);
+
+	return seg;
+}
+
 
 /** Trim segment from left and right by the specified amount.
  *
@@ -231,6 +270,21 @@ void tcp_segment_text_copy(tcp_segment_t *seg, void *buf, size_t size)
 	memcpy(buf, seg->data, size);
 }
 
+/** Copy out text data from segment, computing its checksum on the way.
+ *
+ * @param seg		Segment
+ * @param buf		Destination buffer
+ * @param size		Size of destination buffer
+ * @param ivalue	Checksum of PDU data preceding the text
+ * @return		Checksum including the copied text
+ */
+uint16_t tcp_segment_text_copy_cksum(tcp_segment_t *seg, void *buf,
+    size_t size, uint16_t ivalue)
+{
+	assert(size <= tcp_segment_text_size(seg));
+	return inet_checksum_copy(ivalue, buf, seg->data, size);
+}
+
 /** Return number of bytes in segment text.
  *
  * @param seg	Segment
@@ -254,6 +308,12 @@ void tcp_segment_dump(tcp_segment_t *seg)
 	log_msg(LVL_DEBUG2, " - len = % " PRIu32, seg->len);
 	log_msg(LVL_DEBUG2, " - wnd = % " PRIu32, seg->wnd);
 	log_msg(LVL_DEBUG2, " - up = % " PRIu32, seg->up);
+	if ((seg->opts & SOPT_WSCALE) != 0)
+		log_msg(LVL_DEBUG2, " - wscale = %u", (unsigned) seg->wscale);
+	if ((seg->opts & SOPT_TS) != 0) {
+		log_msg(LVL_DEBUG2, " - ts_val = %" PRIu32 ", ts_ecr = %"
+		    PRIu32, seg->ts_val, seg->ts_ecr);
+	}
 }
 
 /**
@@ -35,6 +35,7 @@
 #ifndef SEGMENT_H
 #define SEGMENT_H
 
+#include <net/pbuf.h>
 #include <sys/types.h>
 #include "tcp_type.h"
 
@@ -44,8 +45,12 @@ extern tcp_segment_t *tcp_segment_dup(tcp_segment_t *);
 extern tcp_segment_t *tcp_segment_make_ctrl(tcp_control_t);
 extern tcp_segment_t *tcp_segment_make_rst(tcp_segment_t *);
 extern tcp_segment_t *tcp_segment_make_data(tcp_control_t, void *, size_t);
+extern tcp_segment_t *tcp_segment_make_pbuf(tcp_control_t, pbuf_t *, void *,
+    size_t);
 extern void tcp_segment_trim(tcp_segment_t *, uint32_t, uint32_t);
 extern void tcp_segment_text_copy(tcp_segment_t *, void *, size_t);
+extern uint16_t tcp_segment_text_copy_cksum(tcp_segment_t *, void *, size_t,
+    uint16_t);
 extern size_t tcp_segment_text_size(tcp_segment_t *);
 extern void tcp_segment_dump(tcp_segment_t *);
 
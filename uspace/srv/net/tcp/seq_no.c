@@ -60,6 +60,16 @@ static bool seq_no_lt_le(uint32_t a, uint32_t b, uint32_t c)
 	}
 }
 
+/** a < b modulo sequence space
+ *
+ * Two-point comparison, only meaningful if @a a and @a b are less
+ * than 2^31 apart.
+ */
+bool seq_no_lt(uint32_t a, uint32_t b)
+{
+	return (int32_t) (a - b) < 0;
+}
+
 /** Determine wheter ack is acceptable (new acknowledgement) */
 bool seq_no_ack_acceptable(tcp_conn_t *conn, uint32_t seg_ack)
 {
@@ -38,6 +38,7 @@
 #include <sys/types.h>
 #include "tcp_type.h"
 
+extern bool seq_no_lt(uint32_t, uint32_t);
 extern bool seq_no_ack_acceptable(tcp_conn_t *, uint32_t);
 extern bool seq_no_ack_duplicate(tcp_conn_t *, uint32_t);
 extern bool seq_no_in_rcv_wnd(tcp_conn_t *, uint32_t);
@@ -36,13 +36,17 @@
  */
 
 #include <async.h>
+#include <abi/ipc/methods.h>
 #include <errno.h>
 #include <inet/inet.h>
 #include <io/log.h>
 #include <ipc/services.h>
 #include <ipc/socket.h>
+#include <macros.h>
+#include <mem.h>
 #include <net/socket.h>
 #include <ns.h>
+#include <stdlib.h>
 
 #include "sock.h"
 #include "std.h"
@@ -301,7 +305,7 @@ static void tcp_sock_listen(tcp_client_t *client, ipc_callid_t callid, ipc_call_
 		}
 
 		trc = tcp_uc_open(&lsocket, &fsocket, ap_passive,
-		    tcp_open_nonblock, &conn);
+		    tcp_open_nonblock, &socket->buf_opts, &conn);
 		if (conn == NULL) {
 			/* XXX Clean up */
 			fibril_mutex_unlock(&socket->lock);
@@ -310,6 +314,8 @@ static void tcp_sock_listen(tcp_client_t *client, ipc_callid_t callid, ipc_call_
 		}
 
 		tcp_uc_set_cstate_cb(conn, tcp_sock_cstate_cb, lconn);
+		if (socket->nodelay)
+			tcp_uc_set_nodelay(conn, true);
 
 		assert(trc == TCP_EOK);
 		conn->name = (char *)"S";
@@ -390,10 +396,14 @@ static void tcp_sock_connect(tcp_client_t *client, ipc_callid_t callid, ipc_call
 	fsocket.addr.ipv4 = uint32_t_be2host(addr->sin_addr.s_addr);
 	fsocket.port = uint16_t_be2host(addr->sin_port);
 
-	trc = tcp_uc_open(&lsocket, &fsocket, ap_active, 0, &socket->conn);
+	trc = tcp_uc_open(&lsocket, &fsocket, ap_active, 0, &socket->buf_opts,
+	    &socket->conn);
 
-	if (socket->conn != NULL)
+	if (socket->conn != NULL) {
 		socket->conn->name = (char *)"C";
+		if (socket->nodelay)
+			tcp_uc_set_nodelay(socket->conn, true);
+	}
 
 	fibril_mutex_unlock(&socket->lock);
 
@@ -472,7 +482,7 @@ static void tcp_sock_accept(tcp_client_t *client, ipc_callid_t callid, ipc_call_
 	fsocket.port = TCP_PORT_ANY;
 
 	trc = tcp_uc_open(&lsocket, &fsocket, ap_passive, tcp_open_nonblock,
-	    &rconn);
+	    &socket->buf_opts, &rconn);
 	if (rconn == NULL) {
 		/* XXX Clean up */
 		fibril_mutex_unlock(&socket->lock);
@@ -481,6 +491,8 @@ static void tcp_sock_accept(tcp_client_t *client, ipc_callid_t callid, ipc_call_
 	}
 
 	tcp_uc_set_cstate_cb(rconn, tcp_sock_cstate_cb, lconn);
+	if (socket->nodelay)
+		tcp_uc_set_nodelay(rconn, true);
 
 	assert(trc == TCP_EOK);
 	rconn->name = (char *)"S";
@@ -497,6 +509,8 @@ static void tcp_sock_accept(tcp_client_t *client, ipc_callid_t callid, ipc_call_
 	}
 
 	asocket->conn = conn;
+	asocket->buf_opts = socket->buf_opts;
+	asocket->nodelay = socket->nodelay;
 	log_msg(LVL_DEBUG, "tcp_sock_accept():create asocket\n");
 
 	rc = tcp_sock_finish_setup(asocket, &asock_id);
@@ -524,6 +538,28 @@ static void tcp_sock_accept(tcp_client_t *client, ipc_callid_t callid, ipc_call_
 	fibril_mutex_unlock(&socket->lock);
 }
 
+static int tcp_sock_uc_send(tcp_conn_t *conn, void *data, size_t size)
+{
+	tcp_error_t trc;
+
+	trc = tcp_uc_send(conn, data, size, 0);
+
+	switch (trc) {
+	case TCP_EOK:
+		return EOK;
+	case TCP_ENOTEXIST:
+		return ENOTCONN;
+	case TCP_ECLOSING:
+		return ENOTCONN;
+	case TCP_ERESET:
+		return ECONNABORTED;
+	default:
+		assert(false);
+	}
+
+	return EINVAL;
+}
+
 static void tcp_sock_send(tcp_client_t *client, ipc_callid_t callid, ipc_call_t call)
 {
 	int socket_id;
@@ -535,7 +571,6 @@ static void tcp_sock_send(tcp_client_t *client, ipc_callid_t callid, ipc_call_t
 	ipc_callid_t wcallid;
 	size_t length;
 	uint8_t buffer[TCP_SOCK_FRAGMENT_SIZE];
-	tcp_error_t trc;
 	int rc;
 
 	log_msg(LVL_DEBUG, "tcp_sock_send()");
@@ -575,25 +610,7 @@ static void tcp_sock_send(tcp_client_t *client, ipc_callid_t callid, ipc_call_t
 			return;
 		}
 
-		trc = tcp_uc_send(socket->conn, buffer, length, 0);
-
-		switch (trc) {
-		case TCP_EOK:
-			rc = EOK;
-			break;
-		case TCP_ENOTEXIST:
-			rc = ENOTCONN;
-			break;
-		case TCP_ECLOSING:
-			rc = ENOTCONN;
-			break;
-		case TCP_ERESET:
-			rc = ECONNABORTED;
-			break;
-		default:
-			assert(false);
-		}
-
+		rc = tcp_sock_uc_send(socket->conn, buffer, length);
 		if (rc != EOK) {
 			fibril_mutex_unlock(&socket->lock);
 			async_answer_0(callid, rc);
@@ -608,6 +625,100 @@ static void tcp_sock_send(tcp_client_t *client, ipc_callid_t callid, ipc_call_t
 	fibril_mutex_unlock(&socket->lock);
 }
 
+/** Send data from a file of the client.
+ *
+ * The data is obtained by data reads on the callback connection, which
+ * the client passes on to VFS. The kernel then copies the data from the
+ * file system server directly into our buffer.
+ */
+static void tcp_sock_sendfile(tcp_client_t *client, ipc_callid_t callid, ipc_call_t call)
+{
+	int socket_id;
+	size_t count;
+	size_t sent;
+	size_t xfer;
+	size_t length;
+	socket_core_t *sock_core;
+	tcp_sockdata_t *socket;
+	async_exch_t *exch;
+	ipc_call_t answer;
+	aid_t req;
+	sysarg_t retval;
+	uint8_t *buffer;
+	int rc;
+
+	log_msg(LVL_DEBUG, "tcp_sock_sendfile()");
+	socket_id = SOCKET_GET_SOCKET_ID(call);
+	count = IPC_GET_ARG2(call);
+
+	sock_core = socket_cores_find(&client->sockets, socket_id);
+	if (sock_core == NULL) {
+		async_answer_0(callid, ENOTSOCK);
+		return;
+	}
+
+	socket = (tcp_sockdata_t *)sock_core->specific_data;
+	fibril_mutex_lock(&socket->lock);
+
+	if (socket->conn == NULL) {
+		fibril_mutex_unlock(&socket->lock);
+		async_answer_0(callid, ENOTCONN);
+		return;
+	}
+
+	buffer = malloc(TCP_SOCK_SENDFILE_CHUNK);
+	if (buffer == NULL) {
+		fibril_mutex_unlock(&socket->lock);
+		async_answer_0(callid, ENOMEM);
+		return;
+	}
+
+	sent = 0;
+	rc = EOK;
+
+	while (sent < count) {
+		xfer = min(count - sent, TCP_SOCK_SENDFILE_CHUNK);
+
+		exch = async_exchange_begin(client->sess);
+		req = async_send_5(exch, IPC_M_DATA_READ, (sysarg_t) buffer,
+		    xfer, 0, (sysarg_t) socket_id, sent, &answer);
+		async_exchange_end(exch);
+
+		if (req == 0) {
+			rc = ENOMEM;
+			break;
+		}
+
+		async_wait_for(req, &retval);
+		if (retval != EOK) {
+			rc = retval;
+			break;
+		}
+
+		/* End of file */
+		length = IPC_GET_ARG2(answer);
+		if (length == 0)
+			break;
+
+		rc = tcp_sock_uc_send(socket->conn, buffer, length);
+		if (rc != EOK)
+			break;
+
+		sent += length;
+	}
+
+	free(buffer);
+	fibril_mutex_unlock(&socket->lock);
+
+	/* Report the error next time if some data has been sent */
+	if (sent == 0 && rc != EOK) {
+		async_answer_0(callid, rc);
+		return;
+	}
+
+	async_answer_1(callid, EOK, sent);
+}
+
 static void tcp_sock_sendto(tcp_client_t *client, ipc_callid_t callid, ipc_call_t call)
 {
 	log_msg(LVL_DEBUG, "tcp_sock_sendto()");
@@ -797,14 +908,160 @@ static void tcp_sock_close(tcp_client_t *client, ipc_callid_t callid, ipc_call_t
 
 static void tcp_sock_getsockopt(tcp_client_t *client, ipc_callid_t callid, ipc_call_t call)
 {
+	int socket_id;
+	int opt_name;
+	socket_core_t *sock_core;
+	tcp_sockdata_t *socket;
+	tcp_buf_opts_t bopts;
+	ipc_callid_t rcallid;
+	size_t length;
+	size_t optlen;
+	int value;
+
 	log_msg(LVL_DEBUG, "tcp_sock_getsockopt()");
-	async_answer_0(callid, ENOTSUP);
+
+	socket_id = SOCKET_GET_SOCKET_ID(call);
+	opt_name = SOCKET_GET_OPT_NAME(call);
+
+	sock_core = socket_cores_find(&client->sockets, socket_id);
+	if (sock_core == NULL) {
+		async_answer_0(callid, ENOTSOCK);
+		return;
+	}
+
+	socket = (tcp_sockdata_t *)sock_core->specific_data;
+	fibril_mutex_lock(&socket->lock);
+
+	if (socket->conn != NULL)
+		tcp_uc_get_buf_opts(socket->conn, &bopts);
+	else
+		bopts = socket->buf_opts;
+
+	fibril_mutex_unlock(&socket->lock);
+
+	switch (opt_name) {
+	case SO_RCVBUF:
+		value = bopts.rcv_buf_size;
+		break;
+	case SO_SNDBUF:
+		value = bopts.snd_buf_size;
+		break;
+	case TCP_NODELAY:
+		value = socket->nodelay ? 1 : 0;
+		break;
+	default:
+		async_answer_0(callid, ENOTSUP);
+		return;
+	}
+
+	/* Option length, then option value */
+	optlen = sizeof(value);
+	if (!async_data_read_receive(&rcallid, &length)) {
+		async_answer_0(callid, EINVAL);
+		return;
+	}
+
+	async_data_read_finalize(rcallid, &optlen, min(length, sizeof(optlen)));
+
+	if (!async_data_read_receive(&rcallid, &length)) {
+		async_answer_0(callid, EINVAL);
+		return;
+	}
+
+	async_data_read_finalize(rcallid, &value, min(length, sizeof(value)));
+	async_answer_0(callid, EOK);
 }
 
 static void tcp_sock_setsockopt(tcp_client_t *client, ipc_callid_t callid, ipc_call_t call)
 {
+	int socket_id;
+	int opt_name;
+	socket_core_t *sock_core;
+	tcp_sockdata_t *socket;
+	tcp_buf_opts_t bopts;
+	tcp_error_t trc;
+	void *data;
+	size_t length;
+	int value;
+	int rc;
+
 	log_msg(LVL_DEBUG, "tcp_sock_setsockopt()");
-	async_answer_0(callid, ENOTSUP);
+
+	socket_id = SOCKET_GET_SOCKET_ID(call);
+	opt_name = SOCKET_GET_OPT_NAME(call);
+
+	rc = async_data_write_accept(&data, false, 0, 0, 0, &length);
+	if (rc != EOK) {
+		async_answer_0(callid, rc);
+		return;
+	}
+
+	if (length != sizeof(value)) {
+		free(data);
+		async_answer_0(callid, EINVAL);
+		return;
+	}
+
+	memcpy(&value, data, sizeof(value));
+	free(data);
+
+	sock_core = socket_cores_find(&client->sockets, socket_id);
+	if (sock_core == NULL) {
+		async_answer_0(callid, ENOTSOCK);
+		return;
+	}
+
+	socket = (tcp_sockdata_t *)sock_core->specific_data;
+
+	if (opt_name == TCP_NODELAY) {
+		fibril_mutex_lock(&socket->lock);
+		socket->nodelay = value != 0;
+		if (socket->conn != NULL)
+			tcp_uc_set_nodelay(socket->conn, socket->nodelay);
+		fibril_mutex_unlock(&socket->lock);
+		async_answer_0(callid, EOK);
+		return;
+	}
+
+	if (value <= 0) {
+		async_answer_0(callid, EINVAL);
+		return;
+	}
+
+	bopts.rcv_buf_size = 0;
+	bopts.snd_buf_size = 0;
+
+	switch (opt_name) {
+	case SO_RCVBUF:
+		bopts.rcv_buf_size = value;
+		break;
+	case SO_SNDBUF:
+		bopts.snd_buf_size = value;
+		break;
+	default:
+		async_answer_0(callid, ENOTSUP);
+		return;
+	}
+
+	fibril_mutex_lock(&socket->lock);
+
+	/* Remembered for connections opened later (listen, accept) */
+	if (bopts.rcv_buf_size != 0)
+		socket->buf_opts.rcv_buf_size = bopts.rcv_buf_size;
+	if (bopts.snd_buf_size != 0)
+		socket->buf_opts.snd_buf_size = bopts.snd_buf_size;
+
+	if (socket->conn != NULL) {
+		trc = tcp_uc_set_buf_opts(socket->conn, &bopts);
+		if (trc != TCP_EOK) {
+			fibril_mutex_unlock(&socket->lock);
+			async_answer_0(callid, ENOMEM);
+			return;
+		}
+	}
+
+	fibril_mutex_unlock(&socket->lock);
+	async_answer_0(callid, EOK);
 }
 
 /** Called when connection state changes. */
@@ -916,6 +1173,9 @@ static void tcp_sock_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case NET_SOCKET_SEND:
 			tcp_sock_send(&client, callid, call);
 			break;
+		case NET_SOCKET_SENDFILE:
+			tcp_sock_sendfile(&client, callid, call);
+			break;
 		case NET_SOCKET_SENDTO:
 			tcp_sock_sendto(&client, callid, call);
 			break;
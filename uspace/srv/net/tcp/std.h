@@ -92,9 +92,31 @@ enum opt_kind {
 	/** No-operation */
 	OPT_NOP			= 1,
 	/** Maximum segment size */
-	OPT_MAX_SEG_SIZE	= 2
+	OPT_MAX_SEG_SIZE	= 2,
+	/** Window scale */
+	OPT_WINDOW_SCALE	= 3,
+	/** SACK permitted */
+	OPT_SACK_PERMITTED	= 4,
+	/** SACK */
+	OPT_SACK		= 5,
+	/** Timestamps */
+	OPT_TIMESTAMP		= 8
 };
 
+/** Option lengths (including kind and length octets) */
+enum opt_len {
+	OPT_WINDOW_SCALE_LEN	= 3,
+	OPT_SACK_PERMITTED_LEN	= 2,
+	/** SACK option length without the blocks */
+	OPT_SACK_LEN		= 2,
+	/** Size of one SACK block */
+	OPT_SACK_BLOCK_LEN	= 8,
+	OPT_TIMESTAMP_LEN	= 10
+};
+
+/** Largest window scale shift permitted (RFC 7323) */
+#define TCP_WSCALE_MAX		14
+
 #endif
 
 /** @}
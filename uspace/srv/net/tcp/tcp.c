@@ -41,8 +41,11 @@
 #include <inet/inet.h>
 #include <io/log.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
 #include <task.h>
 
+#include "conn.h"
 #include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
@@ -55,6 +58,19 @@
 
 #define IP_PROTO_TCP 6
 
+/** Default number of bytes transferred by the benchmark */
+#define BENCH_SIZE_DEF (4 * 1024 * 1024)
+
+/** Default number of connections opened by the demultiplexing test */
+#define DEMUX_COUNT_DEF 1000
+
+/** Benchmark parameters */
+typedef struct {
+	unsigned loss;
+	unsigned delay;
+	size_t size;
+} tcp_bench_args_t;
+
 static int tcp_inet_ev_recv(inet_dgram_t *dgram);
 static void tcp_received_pdu(tcp_pdu_t *pdu);
 
@@ -107,8 +123,8 @@ static int tcp_inet_ev_recv(inet_dgram_t *dgram)
 
 	log_msg(LVL_DEBUG, "pdu_raw_size=%zu, hdr_size=%zu",
 	    pdu_raw_size, hdr_size);
-	pdu = tcp_pdu_create(pdu_raw, hdr_size, pdu_raw + hdr_size,
-	    pdu_raw_size - hdr_size);
+	/* PDU shares the datagram buffer, nothing is copied */
+	pdu = tcp_pdu_create(dgram->pbuf, hdr_size);
 	if (pdu == NULL) {
 		log_msg(LVL_WARN, "Failed creating PDU. Dropped.");
 		return ENOMEM;
@@ -129,26 +145,15 @@ static int tcp_inet_ev_recv(inet_dgram_t *dgram)
 void tcp_transmit_pdu(tcp_pdu_t *pdu)
 {
 	int rc;
-	uint8_t *pdu_raw;
-	size_t pdu_raw_size;
 	inet_dgram_t dgram;
 
-	pdu_raw_size = pdu->header_size + pdu->text_size;
-	pdu_raw = malloc(pdu_raw_size);
-	if (pdu_raw == NULL) {
-		log_msg(LVL_ERROR, "Failed to transmit PDU. Out of memory.");
-		return;
-	}
-
-	memcpy(pdu_raw, pdu->header, pdu->header_size);
-	memcpy(pdu_raw + pdu->header_size, pdu->text,
-	    pdu->text_size);
-
+	/* Header is immediately followed by text in the PDU buffer */
 	dgram.src.ipv4 = pdu->src_addr.ipv4;
 	dgram.dest.ipv4 = pdu->dest_addr.ipv4;
 	dgram.tos = 0;
-	dgram.data = pdu_raw;
-	dgram.size = pdu_raw_size;
+	dgram.data = pdu->header;
+	dgram.size = pdu->header_size + pdu->text_size;
+	dgram.pbuf = pdu->pbuf;
 
 	rc = inet_send(&dgram, INET_TTL_MAX, 0);
 	if (rc != EOK)
@@ -172,12 +177,19 @@ static void tcp_received_pdu(tcp_pdu_t *pdu)
 	tcp_rqueue_insert_seg(&rident, dseg);
 }
 
-static int tcp_init(void)
+/** Core initialization shared by normal operation and benchmark mode. */
+static int tcp_init_core(void)
 {
 	int rc;
 
 	log_msg(LVL_DEBUG, "tcp_init()");
 
+	rc = tcp_conn_init();
+	if (rc != EOK) {
+		log_msg(LVL_ERROR, "Failed initializing connection map.");
+		return ENOMEM;
+	}
+
 	tcp_rqueue_init();
 	tcp_rqueue_fibril_start();
 
@@ -186,6 +198,17 @@ static int tcp_init(void)
 
 	if (0) tcp_test();
 
+	return EOK;
+}
+
+static int tcp_init(void)
+{
+	int rc;
+
+	rc = tcp_init_core();
+	if (rc != EOK)
+		return rc;
+
 	rc = inet_init(IP_PROTO_TCP, &tcp_inet_ev_ops);
 	if (rc != EOK) {
 		log_msg(LVL_ERROR, "Failed connecting to internet service.");
@@ -201,6 +224,98 @@ static int tcp_init(void)
 	return EOK;
 }
 
+/** Benchmark fibril. */
+static int tcp_bench_fibril(void *arg)
+{
+	tcp_bench_args_t *bargs = (tcp_bench_args_t *) arg;
+
+	tcp_bench(bargs->loss, bargs->delay, bargs->size);
+	exit(0);
+
+	/* Not reached */
+	return 0;
+}
+
+/** Run loopback benchmark through the network condition simulator.
+ *
+ * Usage: tcp --bench [<loss per mille> [<delay ms> [<size>]]]
+ */
+static int tcp_bench_main(int argc, char **argv)
+{
+	static tcp_bench_args_t bargs;
+	fid_t fid;
+	int rc;
+
+	bargs.loss = 0;
+	bargs.delay = 0;
+	bargs.size = BENCH_SIZE_DEF;
+
+	if (argc > 2)
+		bargs.loss = strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		bargs.delay = strtoul(argv[3], NULL, 10);
+	if (argc > 4)
+		bargs.size = strtoul(argv[4], NULL, 10);
+
+	rc = tcp_init_core();
+	if (rc != EOK)
+		return 1;
+
+	fid = fibril_create(tcp_bench_fibril, &bargs);
+	if (fid == 0) {
+		printf(NAME ": Failed creating benchmark fibril.\n");
+		return 1;
+	}
+
+	fibril_add_ready(fid);
+	async_manager();
+
+	/* Not reached */
+	return 0;
+}
+
+/** Demultiplexing test fibril. */
+static int tcp_demux_fibril(void *arg)
+{
+	unsigned *count = (unsigned *) arg;
+
+	exit(tcp_demux_test(*count) == EOK ? 0 : 1);
+
+	/* Not reached */
+	return 0;
+}
+
+/** Run demultiplexing test through the network condition simulator.
+ *
+ * Usage: tcp --demux [<connections>]
+ */
+static int tcp_demux_main(int argc, char **argv)
+{
+	static unsigned count;
+	fid_t fid;
+	int rc;
+
+	count = DEMUX_COUNT_DEF;
+	if (argc > 2)
+		count = strtoul(argv[2], NULL, 10);
+
+	rc = tcp_init_core();
+	if (rc != EOK)
+		return 1;
+
+	fid = fibril_create(tcp_demux_fibril, &count);
+	if (fid == 0) {
+		printf(NAME ": Failed creating test fibril.\n");
+		return 1;
+	}
+
+	fibril_add_ready(fid);
+	async_manager();
+
+	/* Not reached */
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int rc;
@@ -213,6 +328,11 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
+	if (argc > 1 && str_cmp(argv[1], "--bench") == 0)
+		return tcp_bench_main(argc, argv);
+	if (argc > 1 && str_cmp(argv[1], "--demux") == 0)
+		return tcp_demux_main(argc, argv);
+
 	rc = tcp_init();
 	if (rc != EOK)
 		return 1;
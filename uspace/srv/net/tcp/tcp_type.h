@@ -40,7 +40,9 @@
 #include <bool.h>
 #include <fibril.h>
 #include <fibril_synch.h>
+#include <net/pbuf.h>
 #include <socket_core.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
 struct tcp_conn;
@@ -110,6 +112,27 @@ typedef enum {
 	CTL_ACK		= 0x8
 } tcp_control_t;
 
+/** Segment options present */
+typedef enum {
+	/** Window scale option */
+	SOPT_WSCALE	= 0x1,
+	/** Timestamps option */
+	SOPT_TS		= 0x2,
+	/** SACK permitted option */
+	SOPT_SACK_PERM	= 0x4,
+	/** SACK option */
+	SOPT_SACK	= 0x8
+} tcp_sopt_t;
+
+/** Maximum number of SACK blocks in a segment */
+#define TCP_SACK_BLOCKS_MAX	4
+
+/** SACK block, covers sequence numbers start <= n < end */
+typedef struct {
+	uint32_t start;
+	uint32_t end;
+} tcp_sack_blk_t;
+
 typedef struct {
 	uint32_t ipv4;
 } netaddr_t;
@@ -145,6 +168,8 @@ typedef struct {
 
 	/** Retransmission timer */
 	fibril_timer_t *timer;
+	/** Delayed ACK timer */
+	fibril_timer_t *dack_timer;
 } tcp_tqueue_t;
 
 typedef enum {
@@ -156,11 +181,57 @@ typedef enum {
 	tcp_open_nonblock = 1
 } tcp_open_flags_t;
 
+/** Connection buffer settings supplied by the user */
+typedef struct {
+	/** Receive buffer size, zero to auto-tune */
+	size_t rcv_buf_size;
+	/** Send buffer size, zero for default */
+	size_t snd_buf_size;
+} tcp_buf_opts_t;
+
+/** Connection counters */
+typedef struct {
+	/** Segments transmitted, including retransmissions */
+	uint64_t segs_sent;
+	/** Segments received */
+	uint64_t segs_rcvd;
+	/** ACKs saved by delaying them or piggybacking them on data */
+	uint64_t acks_suppressed;
+} tcp_conn_stats_t;
+
 typedef struct tcp_conn tcp_conn_t;
 
 /** Connection state change callback function */
 typedef void (*tcp_cstate_cb_t)(tcp_conn_t *, void *);
 
+/** Congestion control algorithm.
+ *
+ * Loss detection and recovery is common to all algorithms, the algorithm
+ * decides how the congestion window grows and how much it is reduced.
+ */
+typedef struct {
+	/** Algorithm name */
+	const char *name;
+	/** Set up algorithm state of new connection, may be @c NULL */
+	int (*init)(tcp_conn_t *);
+	/** Free algorithm state of connection, may be @c NULL */
+	void (*fini)(tcp_conn_t *);
+	/** New data was acknowledged outside of fast recovery */
+	void (*acked)(tcp_conn_t *, uint32_t);
+	/** Loss was detected, return new slow start threshold */
+	uint32_t (*ssthresh)(tcp_conn_t *);
+} tcp_cc_ops_t;
+
+/** Loss recovery state */
+typedef enum {
+	/** No loss recovery in progress */
+	rs_open,
+	/** Fast recovery after duplicate ACKs */
+	rs_fast,
+	/** Recovery after retransmission timeout */
+	rs_rto
+} tcp_rstate_t;
+
 /** Connection */
 struct tcp_conn {
 	char *name;
@@ -207,6 +278,14 @@ struct tcp_conn {
 	uint8_t *rcv_buf;
 	/** Receive buffer size */
 	size_t rcv_buf_size;
+	/** Receive buffer size limit */
+	size_t rcv_buf_max;
+	/** Receive buffer size is auto-tuned */
+	bool rcv_buf_auto;
+	/** Auto-tuning: bytes consumed by user in current measurement */
+	size_t rcv_space_bytes;
+	/** Auto-tuning: start of current measurement (ms) */
+	uint32_t rcv_space_time;
 	/** Receive buffer number of bytes used */
 	size_t rcv_buf_used;
 	/** Receive buffer contains FIN */
@@ -248,12 +327,68 @@ struct tcp_conn {
 	uint32_t rcv_up;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Window scaling was negotiated */
+	bool wscale_ok;
+	/** Shift applied to window we advertise */
+	uint8_t rcv_wscale;
+	/** Shift applied to window advertised by peer */
+	uint8_t snd_wscale;
+
+	/** Timestamps were negotiated */
+	bool ts_ok;
+	/** Most recent timestamp received from peer (TS.Recent) */
+	uint32_t ts_recent;
+	/** Smoothed round-trip time (ms), zero if not measured yet */
+	uint32_t srtt;
+	/** Round-trip time variation (ms) */
+	uint32_t rttvar;
+	/** Retransmission timeout (ms) */
+	uint32_t rto;
+
+	/** SACK was negotiated */
+	bool sack_ok;
+	/** Start of out-of-order data received most recently */
+	uint32_t sack_last;
+
+	/** Congestion control algorithm */
+	tcp_cc_ops_t *cc;
+	/** Congestion control algorithm state */
+	void *cc_data;
+	/** Congestion window */
+	uint32_t cwnd;
+	/** Slow start threshold */
+	uint32_t ssthresh;
+	/** Bytes acked since last congestion window increase */
+	uint32_t cwnd_acked;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** Loss recovery state */
+	tcp_rstate_t rstate;
+	/** SND.NXT when loss recovery started */
+	uint32_t recover;
+	/** Next sequence number to retransmit during loss recovery */
+	uint32_t rtx_nxt;
+	/** Highest sequence number SACKed by peer */
+	uint32_t sack_high;
+
+	/** Number of received segments not acknowledged yet */
+	unsigned dack_pending;
+	/** Right edge of receive window last advertised to peer */
+	uint32_t rcv_adv;
+	/** Disable Nagle algorithm (TCP_NODELAY) */
+	bool nodelay;
+
+	/** Counters */
+	tcp_conn_stats_t stats;
 };
 
 /** Data returned by Status user call */
 typedef struct {
 	/** Connection state */
 	tcp_cstate_t cstate;
+	/** Connection counters */
+	tcp_conn_stats_t stats;
 } tcp_conn_status_t;
 
 typedef struct {
@@ -271,10 +406,23 @@ typedef struct {
 	/** Segment urgent pointer */
 	uint32_t up;
 
+	/** Options present in segment */
+	tcp_sopt_t opts;
+	/** Window scale shift (SOPT_WSCALE) */
+	uint8_t wscale;
+	/** Timestamp value (SOPT_TS) */
+	uint32_t ts_val;
+	/** Timestamp echo reply (SOPT_TS) */
+	uint32_t ts_ecr;
+	/** Number of SACK blocks (SOPT_SACK) */
+	unsigned sack_cnt;
+	/** SACK blocks (SOPT_SACK) */
+	tcp_sack_blk_t sack[TCP_SACK_BLOCKS_MAX];
+
 	/** Segment data, may be moved when trimming segment */
 	void *data;
-	/** Segment data, original pointer used to free data */
-	void *dfptr;
+	/** Buffer holding segment data or @c NULL, shared with duplicates */
+	pbuf_t *pbuf;
 } tcp_segment_t;
 
 
@@ -287,7 +435,8 @@ typedef struct {
 /** NCSim queue entry */
 typedef struct {
 	link_t link;
-	suseconds_t delay;
+	/** Time when the segment is to be delivered */
+	struct timeval due;
 	tcp_sockpair_t sp;
 	tcp_segment_t *seg;
 } tcp_squeue_entry_t;
@@ -302,6 +451,12 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Time of first transmission (ms) */
+	uint32_t xmit_time;
+	/** Segment has been retransmitted */
+	bool rexmit;
+	/** Segment has been SACKed by peer */
+	bool sacked;
 } tcp_tqueue_entry_t;
 
 typedef enum {
@@ -324,6 +479,8 @@ typedef struct {
 	void *text;
 	/** Text size */
 	size_t text_size;
+	/** Buffer holding header immediately followed by text */
+	pbuf_t *pbuf;
 } tcp_pdu_t;
 
 typedef struct {
@@ -333,6 +490,12 @@ typedef struct {
 
 #define TCP_SOCK_FRAGMENT_SIZE 1024
 
+/** Size of one data read from the client when sending a file */
+#define TCP_SOCK_SENDFILE_CHUNK (16 * 1024)
+
+/** Sender maximum segment size (MSS option is not negotiated) */
+#define TCP_SMSS 4096
+
 typedef struct tcp_sockdata {
 	/** Lock */
 	fibril_mutex_t lock;
@@ -357,6 +520,10 @@ typedef struct tcp_sockdata {
 	fibril_mutex_t recv_buffer_lock;
 	fibril_condvar_t recv_buffer_cv;
 	tcp_error_t recv_error;
+	/** Buffer settings for connections opened on this socket */
+	tcp_buf_opts_t buf_opts;
+	/** Disable Nagle algorithm on connections opened on this socket */
+	bool nodelay;
 } tcp_sockdata_t;
 
 typedef struct tcp_sock_lconn {
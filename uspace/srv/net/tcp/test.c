@@ -37,8 +37,15 @@
 #include <async.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <fibril.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <macros.h>
 #include <str.h>
+#include <sys/time.h>
+#include "conn.h"
+#include "ncsim.h"
 #include "tcp_type.h"
 #include "ucall.h"
 
@@ -46,6 +53,33 @@
 
 #define RCV_BUF_SIZE 64
 
+/** Size of buffer used by the benchmark for each user call */
+#define BENCH_XFER_SIZE 16384
+
+/** Benchmark state shared by server and client fibrils */
+typedef struct {
+	/** Number of bytes to transfer */
+	size_t size;
+	/** Number of bytes received by server */
+	size_t rcvd;
+	/** Number of received bytes not matching the sent pattern */
+	size_t errors;
+	/** Time when the client started sending */
+	struct timeval start;
+	/** Time when the server received end of data */
+	struct timeval end;
+	/** Server connection counters */
+	tcp_conn_stats_t srv_stats;
+	/** Client connection counters */
+	tcp_conn_stats_t cli_stats;
+	/** Server finished */
+	bool done;
+	fibril_mutex_t lock;
+	fibril_condvar_t done_cv;
+} tcp_bench_t;
+
+static tcp_bench_t bench;
+
 static int test_srv(void *arg)
 {
 	tcp_conn_t *conn;
@@ -61,7 +95,7 @@ static int test_srv(void *arg)
 	fsock.port = 1024;
 	fsock.addr.ipv4 = 0x7f000001;
 	printf("S: User open...\n");
-	tcp_uc_open(&lsock, &fsock, ap_passive, 0, &conn);
+	tcp_uc_open(&lsock, &fsock, ap_passive, 0, NULL, &conn);
 	conn->name = (char *) "S";
 
 	while (true) {
@@ -102,7 +136,7 @@ static int test_cli(void *arg)
 
 	async_usleep(1000*1000*3);
 	printf("C: User open...\n");
-	tcp_uc_open(&lsock, &fsock, ap_active, 0, &conn);
+	tcp_uc_open(&lsock, &fsock, ap_active, 0, NULL, &conn);
 	conn->name = (char *) "C";
 
 	async_usleep(1000*1000*10);
@@ -116,6 +150,341 @@ static int test_cli(void *arg)
 	return 0;
 }
 
+/** Benchmark data pattern byte at offset @a off. */
+static uint8_t bench_pattern(size_t off)
+{
+	return (uint8_t) (off % 251);
+}
+
+static int bench_srv(void *arg)
+{
+	tcp_conn_t *conn;
+	tcp_sock_t lsock;
+	tcp_sock_t fsock;
+	uint8_t *buf;
+	size_t rcvd;
+	size_t i;
+	xflags_t xflags;
+	tcp_error_t trc;
+	tcp_conn_status_t cstatus;
+
+	buf = malloc(BENCH_XFER_SIZE);
+	if (buf == NULL) {
+		printf("S: Out of memory.\n");
+		goto done;
+	}
+
+	lsock.port = 80;
+	lsock.addr.ipv4 = 0x7f000001;
+	fsock.port = 1024;
+	fsock.addr.ipv4 = 0x7f000001;
+
+	trc = tcp_uc_open(&lsock, &fsock, ap_passive, 0, NULL, &conn);
+	if (trc != TCP_EOK) {
+		printf("S: Failed opening connection.\n");
+		goto done;
+	}
+
+	conn->name = (char *) "S";
+
+	while (true) {
+		trc = tcp_uc_receive(conn, buf, BENCH_XFER_SIZE, &rcvd,
+		    &xflags);
+		if (trc != TCP_EOK || rcvd == 0)
+			break;
+
+		for (i = 0; i < rcvd; i++) {
+			if (buf[i] != bench_pattern(bench.rcvd + i))
+				++bench.errors;
+		}
+
+		bench.rcvd += rcvd;
+	}
+
+	gettimeofday(&bench.end, NULL);
+
+	tcp_uc_status(conn, &cstatus);
+	bench.srv_stats = cstatus.stats;
+
+	tcp_uc_close(conn);
+done:
+	free(buf);
+
+	fibril_mutex_lock(&bench.lock);
+	bench.done = true;
+	fibril_condvar_broadcast(&bench.done_cv);
+	fibril_mutex_unlock(&bench.lock);
+
+	return 0;
+}
+
+static int bench_cli(void *arg)
+{
+	tcp_conn_t *conn;
+	tcp_sock_t lsock;
+	tcp_sock_t fsock;
+	uint8_t *buf;
+	size_t sent;
+	size_t xfer;
+	size_t i;
+	tcp_error_t trc;
+	tcp_conn_status_t cstatus;
+
+	buf = malloc(BENCH_XFER_SIZE);
+	if (buf == NULL) {
+		printf("C: Out of memory.\n");
+		return 0;
+	}
+
+	lsock.port = 1024;
+	lsock.addr.ipv4 = 0x7f000001;
+	fsock.port = 80;
+	fsock.addr.ipv4 = 0x7f000001;
+
+	/* Give the server a chance to start listening */
+	async_usleep(100 * 1000);
+
+	gettimeofday(&bench.start, NULL);
+
+	trc = tcp_uc_open(&lsock, &fsock, ap_active, 0, NULL, &conn);
+	if (trc != TCP_EOK) {
+		printf("C: Failed opening connection.\n");
+		free(buf);
+		return 0;
+	}
+
+	conn->name = (char *) "C";
+
+	sent = 0;
+	while (sent < bench.size) {
+		xfer = min(bench.size - sent, BENCH_XFER_SIZE);
+		for (i = 0; i < xfer; i++)
+			buf[i] = bench_pattern(sent + i);
+
+		trc = tcp_uc_send(conn, buf, xfer, 0);
+		if (trc != TCP_EOK) {
+			printf("C: Send failed.\n");
+			break;
+		}
+
+		sent += xfer;
+	}
+
+	tcp_uc_status(conn, &cstatus);
+	bench.cli_stats = cstatus.stats;
+
+	tcp_uc_close(conn);
+	free(buf);
+	return 0;
+}
+
+/** Measure goodput of a loopback transfer through the network simulator.
+ *
+ * @param loss		Probability of dropping a segment (per mille)
+ * @param delay		One-way delay (ms)
+ * @param size		Number of bytes to transfer
+ */
+void tcp_bench(unsigned loss, unsigned delay, size_t size)
+{
+	fid_t srv_fid;
+	fid_t cli_fid;
+	suseconds_t elapsed;
+	size_t delivered;
+	size_t dropped;
+	uint64_t goodput;
+
+	printf("tcp_bench(): %zu bytes, loss %u/1000, delay %u ms\n",
+	    size, loss, delay);
+
+	bench.size = size;
+	bench.rcvd = 0;
+	bench.errors = 0;
+	bench.done = false;
+	fibril_mutex_initialize(&bench.lock);
+	fibril_condvar_initialize(&bench.done_cv);
+
+	/* Jitter of a tenth of the delay causes some reordering */
+	tcp_ncsim_configure(loss, delay * 1000, delay * 100);
+
+	srv_fid = fibril_create(bench_srv, NULL);
+	cli_fid = fibril_create(bench_cli, NULL);
+	if (srv_fid == 0 || cli_fid == 0) {
+		printf("Failed to create benchmark fibrils.\n");
+		return;
+	}
+
+	fibril_add_ready(srv_fid);
+	fibril_add_ready(cli_fid);
+
+	fibril_mutex_lock(&bench.lock);
+	while (!bench.done)
+		fibril_condvar_wait(&bench.done_cv, &bench.lock);
+	fibril_mutex_unlock(&bench.lock);
+
+	tcp_ncsim_stats(&delivered, &dropped);
+
+	elapsed = tv_sub(&bench.end, &bench.start);
+	if (elapsed <= 0)
+		elapsed = 1;
+
+	goodput = (uint64_t) bench.rcvd * 1000000 / elapsed;
+
+	printf("Received %zu of %zu bytes (%zu corrupted) in %ld.%03ld s\n",
+	    bench.rcvd, size, bench.errors, (long) (elapsed / 1000000),
+	    (long) (elapsed / 1000 % 1000));
+	printf("Goodput: %" PRIu64 " B/s\n", goodput);
+	printf("Segments delivered: %zu, dropped: %zu\n", delivered, dropped);
+	printf("Client: %" PRIu64 " segments sent, %" PRIu64 " received\n",
+	    bench.cli_stats.segs_sent, bench.cli_stats.segs_rcvd);
+	printf("Server: %" PRIu64 " segments sent, %" PRIu64 " received, "
+	    "%" PRIu64 " ACKs suppressed\n", bench.srv_stats.segs_sent,
+	    bench.srv_stats.segs_rcvd, bench.srv_stats.acks_suppressed);
+}
+
+/** Wait until connection leaves the states of connection establishment.
+ *
+ * @return	True if the connection has been established.
+ */
+static bool demux_wait_established(tcp_conn_t *conn)
+{
+	bool established;
+
+	fibril_mutex_lock(&conn->lock);
+	while (conn->cstate == st_listen ||
+	    conn->cstate == st_syn_sent ||
+	    conn->cstate == st_syn_received) {
+		fibril_condvar_wait(&conn->cstate_cv, &conn->lock);
+	}
+
+	established = (conn->cstate == st_established);
+	fibril_mutex_unlock(&conn->lock);
+
+	return established;
+}
+
+/** Test demultiplexing of many connections accepted on one local port.
+ *
+ * Open @a count listening connections on the same port and the same number
+ * of clients connecting to it. Each accepted connection must receive the
+ * data sent by its own client and the lookup of its socket pair must find
+ * it by an exact match.
+ *
+ * @param count		Number of connections
+ * @return		EOK if the test passed, EIO if it failed or ENOMEM
+ */
+int tcp_demux_test(unsigned count)
+{
+	tcp_conn_t **srv;
+	tcp_conn_t **cli;
+	tcp_conn_t *conn;
+	tcp_sock_t lsock;
+	tcp_sock_t fsock;
+	tcp_sockpair_t sp;
+	uint16_t msg;
+	size_t rcvd;
+	xflags_t xflags;
+	tcp_error_t trc;
+	unsigned errors;
+	unsigned i;
+
+	printf("tcp_demux_test(): %u connections\n", count);
+
+	srv = calloc(count, sizeof(tcp_conn_t *));
+	cli = calloc(count, sizeof(tcp_conn_t *));
+	if (srv == NULL || cli == NULL) {
+		free(srv);
+		free(cli);
+		return ENOMEM;
+	}
+
+	tcp_ncsim_configure(0, 0, 0);
+	errors = 0;
+
+	lsock.port = 80;
+	lsock.addr.ipv4 = 0x7f000001;
+	fsock.port = TCP_PORT_ANY;
+	fsock.addr.ipv4 = TCP_IPV4_ANY;
+
+	for (i = 0; i < count; i++) {
+		trc = tcp_uc_open(&lsock, &fsock, ap_passive,
+		    tcp_open_nonblock, NULL, &srv[i]);
+		if (trc != TCP_EOK) {
+			printf("S: Failed opening connection %u.\n", i);
+			++errors;
+			goto done;
+		}
+
+		srv[i]->name = (char *) "S";
+	}
+
+	fsock = lsock;
+	for (i = 0; i < count; i++) {
+		lsock.port = 1024 + i;
+		trc = tcp_uc_open(&lsock, &fsock, ap_active,
+		    tcp_open_nonblock, NULL, &cli[i]);
+		if (trc != TCP_EOK) {
+			printf("C: Failed opening connection %u.\n", i);
+			++errors;
+			goto done;
+		}
+
+		cli[i]->name = (char *) "C";
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!demux_wait_established(cli[i]) ||
+		    !demux_wait_established(srv[i])) {
+			printf("Connection %u not established.\n", i);
+			++errors;
+			goto done;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		msg = i;
+		trc = tcp_uc_send(cli[i], &msg, sizeof(msg), 0);
+		if (trc != TCP_EOK) {
+			printf("C: Send failed on connection %u.\n", i);
+			++errors;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		/* Data must arrive from the client the connection was accepted from */
+		trc = tcp_uc_receive(srv[i], &msg, sizeof(msg), &rcvd,
+		    &xflags);
+		if (trc != TCP_EOK || rcvd != sizeof(msg) ||
+		    msg != srv[i]->ident.foreign.port - 1024) {
+			printf("S: Wrong data on connection %u.\n", i);
+			++errors;
+		}
+
+		sp = srv[i]->ident;
+		conn = tcp_conn_find_ref(&sp);
+		if (conn != srv[i]) {
+			printf("Lookup of connection %u failed.\n", i);
+			++errors;
+		}
+
+		if (conn != NULL)
+			tcp_conn_delref(conn);
+	}
+
+done:
+	for (i = 0; i < count; i++) {
+		if (cli[i] != NULL)
+			tcp_uc_close(cli[i]);
+		if (srv[i] != NULL)
+			tcp_uc_close(srv[i]);
+	}
+
+	free(srv);
+	free(cli);
+
+	printf("tcp_demux_test(): %u errors\n", errors);
+	return errors == 0 ? EOK : EIO;
+}
+
 void tcp_test(void)
 {
 	fid_t srv_fid;
@@ -35,7 +35,11 @@
 #ifndef TEST_H
 #define TEST_H
 
+#include <sys/types.h>
+
 extern void tcp_test(void);
+extern void tcp_bench(unsigned, unsigned, size_t);
+extern int tcp_demux_test(unsigned);
 
 #endif
 
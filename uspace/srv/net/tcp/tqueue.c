@@ -42,7 +42,9 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include "cc.h"
 #include "conn.h"
+#include "iqueue.h"
 #include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
@@ -52,11 +54,20 @@
 #include "tcp.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
+/** Number of duplicate ACKs that trigger fast retransmit */
+#define DUPACK_THRESHOLD	3
+
+/** Delayed ACK timeout (us) */
+#define DACK_TIMEOUT		(200 * 1000)
+/** Acknowledge at least every DACK_SEGS received segments (RFC 5681, 4.2) */
+#define DACK_SEGS		2
 
 static void retransmit_timeout_func(void *arg);
+static void dack_timeout_func(void *arg);
 static void tcp_tqueue_timer_set(tcp_conn_t *conn);
 static void tcp_tqueue_timer_clear(tcp_conn_t *conn);
+static void tcp_tqueue_dack_timer_clear(tcp_conn_t *conn);
+static bool tcp_tqueue_rexmit_next(tcp_conn_t *conn);
 
 int tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn)
 {
@@ -65,6 +76,13 @@ int tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn)
 	if (tqueue->timer == NULL)
 		return ENOMEM;
 
+	tqueue->dack_timer = fibril_timer_create();
+	if (tqueue->dack_timer == NULL) {
+		fibril_timer_destroy(tqueue->timer);
+		tqueue->timer = NULL;
+		return ENOMEM;
+	}
+
 	list_initialize(&tqueue->list);
 
 	return EOK;
@@ -73,6 +91,7 @@ int tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn)
 void tcp_tqueue_clear(tcp_tqueue_t *tqueue)
 {
 	tcp_tqueue_timer_clear(tqueue->conn);
+	tcp_tqueue_dack_timer_clear(tqueue->conn);
 }
 
 void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
@@ -81,6 +100,11 @@ void tcp_tqueue_fini(tcp_tqueue_t *tqueue)
 		fibril_timer_destroy(tqueue->timer);
 		tqueue->timer = NULL;
 	}
+
+	if (tqueue->dack_timer != NULL) {
+		fibril_timer_destroy(tqueue->dack_timer);
+		tqueue->dack_timer = NULL;
+	}
 }
 
 void tcp_tqueue_ctrl_seg(tcp_conn_t *conn, tcp_control_t ctrl)
@@ -93,6 +117,11 @@ void tcp_tqueue_ctrl_seg(tcp_conn_t *conn, tcp_control_t ctrl)
 	tcp_tqueue_seg(conn, seg);
 }
 
+/** Transmit segment, keeping a copy for retransmission.
+ *
+ * @param conn		Connection
+ * @param seg		Segment, consumed by this function
+ */
 void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *rt_seg;
@@ -110,6 +139,7 @@ void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		if (rt_seg == NULL) {
 			log_msg(LVL_ERROR, "Memory allocation failed.");
 			/* XXX Handle properly */
+			tcp_segment_delete(seg);
 			return;
 		}
 
@@ -117,20 +147,25 @@ void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		if (tqe == NULL) {
 			log_msg(LVL_ERROR, "Memory allocation failed.");
 			/* XXX Handle properly */
+			tcp_segment_delete(rt_seg);
+			tcp_segment_delete(seg);
 			return;
 		}
 
 		tqe->conn = conn;
 		tqe->seg = rt_seg;
+		tqe->xmit_time = tcp_conn_ts_now();
 		rt_seg->seq = conn->snd_nxt;
 
 		list_append(&tqe->link, &conn->retransmit.list);
 
-		/* Set retransmission timer */
-		tcp_tqueue_timer_set(conn);
+		/* Start retransmission timer unless running (RFC 6298, 5.1) */
+		if (conn->retransmit.timer->state != fts_active)
+			tcp_tqueue_timer_set(conn);
 	}
 
 	tcp_prepare_transmit_segment(conn, seg);
+	tcp_segment_delete(seg);
 }
 
 void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
@@ -155,19 +190,26 @@ void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 void tcp_tqueue_new_data(tcp_conn_t *conn)
 {
+	uint32_t wnd;
+	uint32_t flight;
 	size_t avail_wnd;
 	size_t xfer_seqlen;
 	size_t snd_buf_seqlen;
 	size_t data_size;
+	size_t seg_size;
+	size_t off;
 	tcp_control_t ctrl;
 	bool send_fin;
+	bool last;
 
 	tcp_segment_t *seg;
 
 	log_msg(LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
+	/* Number of free sequence numbers in send and congestion window */
+	wnd = min(conn->snd_wnd, conn->cwnd);
+	flight = conn->snd_nxt - conn->snd_una;
+	avail_wnd = flight < wnd ? wnd - flight : 0;
 	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
 	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
@@ -178,53 +220,186 @@ void tcp_tqueue_new_data(tcp_conn_t *conn)
 	if (xfer_seqlen == 0)
 		return;
 
-	/* XXX Do not always send immediately */
-
 	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
 	data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
-	if (send_fin) {
-		log_msg(LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
+	/*
+	 * Coalesce data into full-sized segments, FIN goes with the last one.
+	 * A segment shorter than SMSS is only sent if it carries FIN, if no
+	 * data is outstanding, or if it empties the send buffer and the Nagle
+	 * algorithm is disabled (RFC 1122, 4.2.3.4 and RFC 896).
+	 */
+	off = 0;
+	while (off < data_size || send_fin) {
+		seg_size = min(data_size - off, TCP_SMSS);
+		last = off + seg_size == data_size;
+
+		if (seg_size < TCP_SMSS && !(last && send_fin) &&
+		    conn->snd_nxt != conn->snd_una &&
+		    !(conn->nodelay && off + seg_size == conn->snd_buf_used)) {
+			log_msg(LVL_DEBUG, "%s: Holding %zu bytes (Nagle).",
+			    conn->name, seg_size);
+			break;
+		}
+
+		if (last && send_fin) {
+			log_msg(LVL_DEBUG, "%s: Sending out FIN.", conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
+
+		seg = tcp_segment_make_data(ctrl, conn->snd_buf + off,
+		    seg_size);
+		if (seg == NULL) {
+			log_msg(LVL_ERROR, "Memory allocation failure.");
+			break;
+		}
+
+		off += seg_size;
+
+		if (ctrl == CTL_FIN) {
+			send_fin = false;
+			conn->snd_buf_fin = false;
+			tcp_conn_fin_sent(conn);
+		}
+
+		tcp_tqueue_seg(conn, seg);
 	}
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LVL_ERROR, "Memory allocation failure.");
+	if (off == 0)
 		return;
-	}
 
 	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
-
-	if (send_fin)
-		conn->snd_buf_fin = false;
+	memmove(conn->snd_buf, conn->snd_buf + off, conn->snd_buf_used - off);
+	conn->snd_buf_used -= off;
 
 	fibril_condvar_broadcast(&conn->snd_buf_cv);
+}
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+/** Retransmit segment from retransmission queue.
+ *
+ * @param conn		Connection
+ * @param tqe		Retransmission queue entry
+ */
+static void tcp_tqueue_rexmit(tcp_conn_t *conn, tcp_tqueue_entry_t *tqe)
+{
+	tcp_segment_t *rt_seg;
 
-	tcp_tqueue_seg(conn, seg);
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LVL_ERROR, "Memory allocation failed.");
+		/* XXX Handle properly */
+		return;
+	}
+
+	log_msg(LVL_DEBUG, "### %s: retransmitting segment SEG.SEQ=%" PRIu32
+	    " SEG.LEN=%" PRIu32, conn->name, rt_seg->seq, rt_seg->len);
+
+	tqe->rexmit = true;
+	tcp_conn_transmit_segment(conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+}
+
+/** Retransmit next presumably lost segment during loss recovery.
+ *
+ * Segments between SND.UNA and the recovery point that have not been
+ * SACKed are retransmitted in order. In fast recovery with SACK
+ * information only holes below the highest SACKed sequence number are
+ * considered lost, without SACK information this is NewReno's
+ * retransmission of the first unacknowledged segment.
+ *
+ * @param conn		Connection
+ * @return		@c true if a segment was retransmitted
+ */
+static bool tcp_tqueue_rexmit_next(tcp_conn_t *conn)
+{
+	tcp_tqueue_entry_t *tqe;
+	bool have_sack;
+
+	if (seq_no_lt(conn->rtx_nxt, conn->snd_una))
+		conn->rtx_nxt = conn->snd_una;
+
+	have_sack = conn->rstate == rs_fast &&
+	    seq_no_lt(conn->snd_una, conn->sack_high);
+
+	list_foreach(conn->retransmit.list, link) {
+		tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
+
+		if (!seq_no_lt(tqe->seg->seq, conn->recover))
+			break;
+		if (have_sack && !seq_no_lt(tqe->seg->seq, conn->sack_high))
+			break;
+		if (tqe->sacked || seq_no_lt(tqe->seg->seq, conn->rtx_nxt))
+			continue;
+
+		tcp_tqueue_rexmit(conn, tqe);
+		conn->rtx_nxt = tqe->seg->seq + tqe->seg->len;
+		return true;
+	}
+
+	return false;
+}
+
+/** Process SACK blocks from incoming segment.
+ *
+ * Mark segments in the retransmission queue that the peer has received.
+ *
+ * @param conn		Connection
+ * @param seg		Incoming segment with SACK option
+ */
+void tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_tqueue_entry_t *tqe;
+	tcp_sack_blk_t *blk;
+	unsigned i;
+
+	for (i = 0; i < seg->sack_cnt; i++) {
+		blk = &seg->sack[i];
+
+		/* Ignore blocks outside of SND.UNA .. SND.NXT */
+		if (!seq_no_lt(blk->start, blk->end) ||
+		    seq_no_lt(blk->start, conn->snd_una) ||
+		    seq_no_lt(conn->snd_nxt, blk->end))
+			continue;
+
+		if (seq_no_lt(conn->sack_high, blk->end))
+			conn->sack_high = blk->end;
+
+		list_foreach(conn->retransmit.list, link) {
+			tqe = list_get_instance(link, tcp_tqueue_entry_t,
+			    link);
+
+			if (!seq_no_lt(tqe->seg->seq, blk->end))
+				break;
+
+			if (!seq_no_lt(tqe->seg->seq, blk->start) &&
+			    !seq_no_lt(blk->end, tqe->seg->seq + tqe->seg->len))
+				tqe->sacked = true;
+		}
+	}
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
  * more data.
  *
  * This should be called when SND.UNA is updated due to incoming ACK.
+ *
+ * @param conn		Connection
+ * @param acked		Number of newly acknowledged sequence numbers
  */
-void tcp_tqueue_ack_received(tcp_conn_t *conn)
+void tcp_tqueue_ack_received(tcp_conn_t *conn, uint32_t acked)
 {
 	link_t *cur, *next;
+	uint32_t xmit_time;
+	bool have_rtt;
 
 	log_msg(LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
 
+	have_rtt = false;
+	xmit_time = 0;
 	cur = conn->retransmit.list.head.next;
 
 	while (cur != &conn->retransmit.list.head) {
@@ -246,36 +421,185 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 				conn->fin_is_acked = true;
 			}
 
+			/* Karn's algorithm: do not time retransmitted segments */
+			if (!tqe->rexmit) {
+				xmit_time = tqe->xmit_time;
+				have_rtt = true;
+			}
+
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
-
-			/* Reset retransmission timer */
-			tcp_tqueue_timer_set(conn);
 		}
 
 		cur = next;
 	}
 
-	/* Clear retransmission timer if the queue is empty. */
+	/* Without timestamps measure RTT using the retransmission queue */
+	if (have_rtt && !conn->ts_ok && conn->rstate == rs_open)
+		tcp_conn_rtt_sample(conn, tcp_conn_ts_now() - xmit_time);
+
+	/*
+	 * Clear retransmission timer if the queue is empty, otherwise
+	 * restart it (RFC 6298, 5.2 and 5.3).
+	 */
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
+	else if (acked > 0)
+		tcp_tqueue_timer_set(conn);
+
+	if (acked > 0)
+		conn->dupacks = 0;
+
+	switch (conn->rstate) {
+	case rs_open:
+		tcp_cc_acked(conn, acked);
+		break;
+	case rs_fast:
+		if (!seq_no_lt(conn->snd_una, conn->recover)) {
+			/* Full acknowledgement, leave fast recovery */
+			conn->cwnd = min(conn->ssthresh,
+			    (conn->snd_nxt - conn->snd_una) + TCP_SMSS);
+			conn->rstate = rs_open;
+			log_msg(LVL_DEBUG, "%s: fast recovery done, cwnd=%"
+			    PRIu32, conn->name, conn->cwnd);
+			break;
+		}
+
+		/* Partial acknowledgement (RFC 6582, section 3.2, step 3) */
+		tcp_tqueue_rexmit_next(conn);
+		conn->cwnd = conn->cwnd > acked ? conn->cwnd - acked : 0;
+		if (acked >= TCP_SMSS)
+			conn->cwnd += TCP_SMSS;
+		conn->cwnd = max(conn->cwnd, TCP_SMSS);
+		break;
+	case rs_rto:
+		/* Slow start, retransmitting as the window opens */
+		tcp_cc_acked(conn, acked);
+
+		if (!seq_no_lt(conn->snd_una, conn->recover)) {
+			conn->rstate = rs_open;
+			break;
+		}
+
+		if (seq_no_lt(conn->rtx_nxt, conn->snd_una))
+			conn->rtx_nxt = conn->snd_una;
+
+		while (conn->rtx_nxt - conn->snd_una < conn->cwnd &&
+		    tcp_tqueue_rexmit_next(conn))
+			;
+		break;
+	}
 
 	/* Possibly transmit more data */
 	tcp_tqueue_new_data(conn);
 }
 
+/** Duplicate ACK received.
+ *
+ * Enter fast retransmit after DUPACK_THRESHOLD duplicate ACKs, inflate
+ * congestion window with each further duplicate ACK in fast recovery
+ * (RFC 5681 and RFC 6582).
+ *
+ * @param conn		Connection
+ */
+void tcp_tqueue_dupack(tcp_conn_t *conn)
+{
+	log_msg(LVL_DEBUG, "%s: tcp_tqueue_dupack()", conn->name);
+
+	++conn->dupacks;
+
+	switch (conn->rstate) {
+	case rs_open:
+		if (conn->dupacks < DUPACK_THRESHOLD)
+			break;
+
+		log_msg(LVL_DEBUG, "%s: fast retransmit, SND.UNA=%" PRIu32,
+		    conn->name, conn->snd_una);
+
+		tcp_cc_loss(conn);
+		conn->rstate = rs_fast;
+		conn->recover = conn->snd_nxt;
+		conn->rtx_nxt = conn->snd_una;
+		tcp_tqueue_rexmit_next(conn);
+		conn->cwnd = conn->ssthresh + DUPACK_THRESHOLD * TCP_SMSS;
+		break;
+	case rs_fast:
+		conn->cwnd += TCP_SMSS;
+		/* Each duplicate ACK with SACK can reveal another hole */
+		if (conn->sack_ok)
+			tcp_tqueue_rexmit_next(conn);
+		break;
+	case rs_rto:
+		break;
+	}
+
+	tcp_tqueue_new_data(conn);
+}
+
 void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	/* Window in SYN segments is never scaled (RFC 7323) */
+	if ((seg->ctrl & CTL_SYN) != 0)
+		seg->wnd = min(conn->rcv_wnd, UINT16_MAX);
+	else
+		seg->wnd = min(conn->rcv_wnd >> conn->rcv_wscale, UINT16_MAX);
+
+	/*
+	 * We offer window scaling and timestamps in our SYN, they are
+	 * used further on only if the peer offered them as well.
+	 */
+	seg->opts = 0;
+	if ((seg->ctrl & CTL_SYN) != 0 &&
+	    ((seg->ctrl & CTL_ACK) == 0 || conn->wscale_ok)) {
+		seg->opts |= SOPT_WSCALE;
+		seg->wscale = conn->rcv_wscale;
+	}
+
+	if (((seg->ctrl & CTL_SYN) != 0 && (seg->ctrl & CTL_ACK) == 0) ||
+	    conn->ts_ok) {
+		seg->opts |= SOPT_TS;
+		seg->ts_val = tcp_conn_ts_now();
+		seg->ts_ecr = conn->ts_ok ? conn->ts_recent : 0;
+	}
+
+	if ((seg->ctrl & CTL_SYN) != 0 &&
+	    ((seg->ctrl & CTL_ACK) == 0 || conn->sack_ok))
+		seg->opts |= SOPT_SACK_PERM;
+
+	/* Report out-of-order data, as much as fits in option space */
+	if ((seg->ctrl & CTL_SYN) == 0 && conn->sack_ok &&
+	    !list_empty(&conn->incoming.list)) {
+		seg->sack_cnt = tcp_iqueue_sack_blocks(&conn->incoming,
+		    conn->sack_last, seg->sack,
+		    conn->ts_ok ? TCP_SACK_BLOCKS_MAX - 1 : TCP_SACK_BLOCKS_MAX);
+		if (seg->sack_cnt > 0)
+			seg->opts |= SOPT_SACK;
+	}
 
-	if ((seg->ctrl & CTL_ACK) != 0)
+	if ((seg->ctrl & CTL_ACK) != 0) {
 		seg->ack = conn->rcv_nxt;
-	else
+
+		/*
+		 * This acknowledges everything received so far. Only a bare
+		 * ACK costs a segment of its own, others ride on data.
+		 */
+		if (conn->dack_pending > 0) {
+			conn->stats.acks_suppressed += conn->dack_pending -
+			    (seg->len == 0 ? 1 : 0);
+			conn->dack_pending = 0;
+			tcp_tqueue_dack_timer_clear(conn);
+		}
+
+		conn->rcv_adv = conn->rcv_nxt + ((seg->ctrl & CTL_SYN) != 0 ?
+		    seg->wnd : seg->wnd << conn->rcv_wscale);
+	} else {
 		seg->ack = 0;
+	}
 
+	++conn->stats.segs_sent;
 	tcp_transmit_segment(&conn->ident, seg);
 }
 
@@ -289,14 +613,21 @@ void tcp_transmit_segment(tcp_sockpair_t *sp, tcp_segment_t *seg)
 	    seg->seq, seg->wnd);
 
 	tcp_segment_dump(seg);
-/*
-	tcp_pdu_prepare(conn, seg, &data, &len);
-	tcp_pdu_transmit(data, len);
-*/
-//	tcp_rqueue_bounce_seg(sp, seg);
-//	tcp_ncsim_bounce_seg(sp, seg);
 
 	tcp_pdu_t *pdu;
+	tcp_segment_t *dseg;
+
+	if (tcp_ncsim_enabled()) {
+		/* Loop back through network condition simulator */
+		dseg = tcp_segment_dup(seg);
+		if (dseg == NULL) {
+			log_msg(LVL_WARN, "Not enough memory. Segment dropped.");
+			return;
+		}
+
+		tcp_ncsim_bounce_seg(sp, dseg);
+		return;
+	}
 
 	if (tcp_pdu_encode(sp, seg, &pdu) != EOK) {
 		log_msg(LVL_WARN, "Not enough memory. Segment dropped.");
@@ -307,11 +638,29 @@ void tcp_transmit_segment(tcp_sockpair_t *sp, tcp_segment_t *seg)
 	tcp_pdu_delete(pdu);
 }
 
+/** Delayed ACK timeout handler.
+ *
+ * @param arg	Connection
+ */
+static void dack_timeout_func(void *arg)
+{
+	tcp_conn_t *conn = (tcp_conn_t *) arg;
+
+	log_msg(LVL_DEBUG, "%s: dack_timeout_func(%p)", conn->name, conn);
+
+	fibril_mutex_lock(&conn->lock);
+
+	if (conn->cstate != st_closed && conn->dack_pending > 0)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+
+	fibril_mutex_unlock(&conn->lock);
+	tcp_conn_delref(conn);
+}
+
 static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
 	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -335,25 +684,88 @@ static void retransmit_timeout_func(void *arg)
 
 	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LVL_ERROR, "Memory allocation failed.");
-		fibril_mutex_unlock(&conn->lock);
-		tcp_conn_delref(conn);
-		/* XXX Handle properly */
-		return;
+	/*
+	 * Reduce the window only for the first timeout of a segment
+	 * (RFC 5681, section 3.1), go back to slow start and retransmit
+	 * everything outstanding as the window opens again. SACK
+	 * information is discarded as the peer may have reneged
+	 * (RFC 2018, section 8).
+	 */
+	if (!tqe->rexmit)
+		tcp_cc_timeout(conn);
+	else
+		conn->cwnd = TCP_SMSS;
+
+	conn->rstate = rs_rto;
+	conn->recover = conn->snd_nxt;
+	conn->rtx_nxt = conn->snd_una;
+	conn->dupacks = 0;
+	conn->sack_high = conn->snd_una;
+
+	list_foreach(conn->retransmit.list, link) {
+		list_get_instance(link, tcp_tqueue_entry_t, link)->sacked =
+		    false;
 	}
 
-	log_msg(LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_tqueue_rexmit_next(conn);
 
-	/* Reset retransmission timer */
+	/* Back off the timer (RFC 6298, 5.5) */
+	tcp_conn_rto_backoff(conn);
 	tcp_tqueue_timer_set(tqe->conn);
 
 	fibril_mutex_unlock(&conn->lock);
 	tcp_conn_delref(conn);
 }
 
+/** Acknowledge received data, possibly delaying the ACK.
+ *
+ * The ACK is sent once DACK_SEGS segments are pending or when the delayed
+ * ACK timer expires, whichever comes first, unless it gets piggybacked on
+ * an outgoing segment before (RFC 1122, 4.2.3.2).
+ *
+ * @param conn		Connection
+ */
+void tcp_tqueue_ack_delayed(tcp_conn_t *conn)
+{
+	++conn->dack_pending;
+
+	if (conn->dack_pending >= DACK_SEGS) {
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+		return;
+	}
+
+	if (conn->retransmit.dack_timer->state != fts_active) {
+		tcp_conn_addref(conn);
+		fibril_timer_set(conn->retransmit.dack_timer, DACK_TIMEOUT,
+		    dack_timeout_func, (void *) conn);
+	}
+}
+
+/** Send window update if the receive window opened enough.
+ *
+ * Receiver side silly window syndrome avoidance (RFC 1122, 4.2.3.3).
+ *
+ * @param conn		Connection
+ */
+void tcp_tqueue_wnd_update(tcp_conn_t *conn)
+{
+	uint32_t right;
+	uint32_t thresh;
+
+	right = conn->rcv_nxt + conn->rcv_wnd;
+	thresh = min(conn->rcv_buf_size / 2, TCP_SMSS);
+
+	if (seq_no_lt(conn->rcv_adv, right) && right - conn->rcv_adv >= thresh)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+}
+
+/** Clear delayed ACK timer */
+static void tcp_tqueue_dack_timer_clear(tcp_conn_t *conn)
+{
+	if (fibril_timer_clear(conn->retransmit.dack_timer) == fts_active)
+		tcp_conn_delref(conn);
+}
+
 /** Set or re-set retransmission timer */
 static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 {
@@ -363,7 +775,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set(conn->retransmit.timer, conn->rto * 1000,
 	    retransmit_timeout_func, (void *) conn);
 }
 
@@ -44,7 +44,11 @@ extern void tcp_tqueue_fini(tcp_tqueue_t *);
 extern void tcp_tqueue_ctrl_seg(tcp_conn_t *, tcp_control_t);
 extern void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
 extern void tcp_tqueue_new_data(tcp_conn_t *);
-extern void tcp_tqueue_ack_received(tcp_conn_t *);
+extern void tcp_tqueue_ack_received(tcp_conn_t *, uint32_t);
+extern void tcp_tqueue_dupack(tcp_conn_t *);
+extern void tcp_tqueue_sack_received(tcp_conn_t *, tcp_segment_t *);
+extern void tcp_tqueue_ack_delayed(tcp_conn_t *);
+extern void tcp_tqueue_wnd_update(tcp_conn_t *);
 extern void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 extern void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 extern void tcp_transmit_segment(tcp_sockpair_t *, tcp_segment_t *);
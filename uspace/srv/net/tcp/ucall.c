@@ -34,6 +34,7 @@
  * @file TCP entry points (close to those defined in the RFC)
  */
 
+#include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
@@ -53,6 +54,7 @@
  * @param fsock		Foreign socket
  * @param acpass	Active/passive
  * @param oflags	Open flags
+ * @param bopts		Buffer settings or @c NULL for defaults
  * @param conn		Connection
  *
  * Unlike in the spec we allow specifying the local address. This means
@@ -65,7 +67,7 @@
  * establishment.
  */
 tcp_error_t tcp_uc_open(tcp_sock_t *lsock, tcp_sock_t *fsock, acpass_t acpass,
-    tcp_open_flags_t oflags, tcp_conn_t **conn)
+    tcp_open_flags_t oflags, tcp_buf_opts_t *bopts, tcp_conn_t **conn)
 {
 	tcp_conn_t *nconn;
 
@@ -74,6 +76,16 @@ tcp_error_t tcp_uc_open(tcp_sock_t *lsock, tcp_sock_t *fsock, acpass_t acpass,
 	    oflags == tcp_open_nonblock ? "nonblock" : "none", conn);
 
 	nconn = tcp_conn_new(lsock, fsock);
+	if (nconn == NULL) {
+		*conn = NULL;
+		return TCP_ENORES;
+	}
+
+	if (bopts != NULL && tcp_conn_set_buf_opts(nconn, bopts) != EOK) {
+		log_msg(LVL_WARN, "Failed setting buffer sizes, using "
+		    "defaults.");
+	}
+
 	tcp_conn_add(nconn);
 
 	if (acpass == ap_active) {
@@ -216,11 +228,14 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 	conn->rcv_buf_used -= xfer_size;
 	conn->rcv_wnd += xfer_size;
 
+	/* Possibly grow the receive buffer */
+	tcp_conn_rcv_buf_consumed(conn, xfer_size);
+
 	/* TODO */
 	*xflags = 0;
 
-	/* Send new size of receive window */
-	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/* Send new size of receive window if it opened enough */
+	tcp_tqueue_wnd_update(conn);
 
 	log_msg(LVL_DEBUG, "%s: tcp_uc_receive() - returning %zu bytes",
 	    conn->name, xfer_size);
@@ -265,6 +280,7 @@ void tcp_uc_status(tcp_conn_t *conn, tcp_conn_status_t *cstatus)
 {
 	log_msg(LVL_DEBUG, "tcp_uc_status()");
 	cstatus->cstate = conn->cstate;
+	cstatus->stats = conn->stats;
 }
 
 /** Delete connection user call.
@@ -279,6 +295,54 @@ void tcp_uc_delete(tcp_conn_t *conn)
 	tcp_conn_delete(conn);
 }
 
+/** Set connection buffer sizes (not in spec).
+ *
+ * @param conn		Connection
+ * @param bopts		Buffer settings, zero fields are left unchanged
+ */
+tcp_error_t tcp_uc_set_buf_opts(tcp_conn_t *conn, tcp_buf_opts_t *bopts)
+{
+	int rc;
+
+	log_msg(LVL_DEBUG, "%s: tcp_uc_set_buf_opts()", conn->name);
+
+	fibril_mutex_lock(&conn->lock);
+	rc = tcp_conn_set_buf_opts(conn, bopts);
+	fibril_mutex_unlock(&conn->lock);
+
+	return rc == EOK ? TCP_EOK : TCP_ENORES;
+}
+
+/** Get connection buffer sizes (not in spec). */
+void tcp_uc_get_buf_opts(tcp_conn_t *conn, tcp_buf_opts_t *bopts)
+{
+	log_msg(LVL_DEBUG, "%s: tcp_uc_get_buf_opts()", conn->name);
+
+	fibril_mutex_lock(&conn->lock);
+	tcp_conn_get_buf_opts(conn, bopts);
+	fibril_mutex_unlock(&conn->lock);
+}
+
+/** Enable or disable the Nagle algorithm (not in spec).
+ *
+ * @param conn		Connection
+ * @param nodelay	@c true to send small segments without delay
+ */
+void tcp_uc_set_nodelay(tcp_conn_t *conn, bool nodelay)
+{
+	log_msg(LVL_DEBUG, "%s: tcp_uc_set_nodelay(%d)", conn->name,
+	    (int) nodelay);
+
+	fibril_mutex_lock(&conn->lock);
+	conn->nodelay = nodelay;
+
+	/* Flush data held back by the Nagle algorithm */
+	if (nodelay && conn->cstate != st_closed)
+		tcp_tqueue_new_data(conn);
+
+	fibril_mutex_unlock(&conn->lock);
+}
+
 void tcp_uc_set_cstate_cb(tcp_conn_t *conn, tcp_cstate_cb_t cb, void *arg)
 {
 	log_msg(LVL_DEBUG, "tcp_uc_set_ctate_cb(%p, %p, %p)",
@@ -318,12 +382,7 @@ void tcp_as_segment_arrived(tcp_sockpair_t *sp, tcp_segment_t *seg)
 		return;
 	}
 
-	if (conn->ident.foreign.addr.ipv4 == TCP_IPV4_ANY)
-		conn->ident.foreign.addr.ipv4 = sp->foreign.addr.ipv4;
-	if (conn->ident.foreign.port == TCP_PORT_ANY)
-		conn->ident.foreign.port = sp->foreign.port;
-	if (conn->ident.local.addr.ipv4 == TCP_IPV4_ANY)
-		conn->ident.local.addr.ipv4 = sp->local.addr.ipv4;
+	tcp_conn_ident_complete(conn, sp);
 
 	tcp_conn_segment_arrived(conn, seg);
 
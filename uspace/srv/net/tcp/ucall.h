@@ -35,6 +35,7 @@
 #ifndef UCALL_H
 #define UCALL_H
 
+#include <bool.h>
 #include <sys/types.h>
 #include "tcp_type.h"
 
@@ -42,13 +43,16 @@
  * User calls
  */
 extern tcp_error_t tcp_uc_open(tcp_sock_t *, tcp_sock_t *, acpass_t,
-    tcp_open_flags_t, tcp_conn_t **);
+    tcp_open_flags_t, tcp_buf_opts_t *, tcp_conn_t **);
 extern tcp_error_t tcp_uc_send(tcp_conn_t *, void *, size_t, xflags_t);
 extern tcp_error_t tcp_uc_receive(tcp_conn_t *, void *, size_t, size_t *, xflags_t *);
 extern tcp_error_t tcp_uc_close(tcp_conn_t *);
 extern void tcp_uc_abort(tcp_conn_t *);
 extern void tcp_uc_status(tcp_conn_t *, tcp_conn_status_t *);
 extern void tcp_uc_delete(tcp_conn_t *);
+extern tcp_error_t tcp_uc_set_buf_opts(tcp_conn_t *, tcp_buf_opts_t *);
+extern void tcp_uc_get_buf_opts(tcp_conn_t *, tcp_buf_opts_t *);
+extern void tcp_uc_set_nodelay(tcp_conn_t *, bool);
 extern void tcp_uc_set_cstate_cb(tcp_conn_t *, tcp_cstate_cb_t, void *);
 
 /*
@@ -34,6 +34,7 @@
  * @file UDP associations
  */
 
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <bool.h>
 #include <fibril_synch.h>
@@ -47,7 +48,24 @@
 #include "udp_inet.h"
 #include "udp_type.h"
 
-LIST_INITIALIZE(assoc_list);
+#define ASSOC_HASH_BUCKETS	256
+#define ASSOC_LISTEN_BUCKETS	64
+
+/** Keys of the association map */
+enum {
+	ASSOC_KEY_LADDR,
+	ASSOC_KEY_LPORT,
+	ASSOC_KEY_FADDR,
+	ASSOC_KEY_FPORT,
+	ASSOC_KEYS
+};
+
+/** Associations with a fully specified socket pair, hashed by the pair */
+static hash_table_t assoc_hash;
+/** Associations with a wildcard in the socket pair, hashed by local port */
+static hash_table_t assoc_listen_hash;
+/** Associations not bound to a local port, never matched */
+static LIST_INITIALIZE(assoc_unbound);
 FIBRIL_MUTEX_INITIALIZE(assoc_list_lock);
 
 static udp_assoc_t *udp_assoc_find_ref(udp_sockpair_t *);
@@ -55,6 +73,127 @@ static int udp_assoc_queue_msg(udp_assoc_t *, udp_sockpair_t *, udp_msg_t *);
 static bool udp_socket_match(udp_sock_t *, udp_sock_t *);
 static bool udp_sockpair_match(udp_sockpair_t *, udp_sockpair_t *);
 
+/** Convert socket pair to association map key. */
+static void udp_sockpair_key(udp_sockpair_t *sp, unsigned long key[])
+{
+	key[ASSOC_KEY_LADDR] = sp->local.addr.ipv4;
+	key[ASSOC_KEY_LPORT] = sp->local.port;
+	key[ASSOC_KEY_FADDR] = sp->foreign.addr.ipv4;
+	key[ASSOC_KEY_FPORT] = sp->foreign.port;
+}
+
+/** Convert association map key to socket pair. */
+static void udp_key_sockpair(unsigned long key[], udp_sockpair_t *sp)
+{
+	sp->local.addr.ipv4 = key[ASSOC_KEY_LADDR];
+	sp->local.port = key[ASSOC_KEY_LPORT];
+	sp->foreign.addr.ipv4 = key[ASSOC_KEY_FADDR];
+	sp->foreign.port = key[ASSOC_KEY_FPORT];
+}
+
+/** Determine whether socket pair contains a wildcard. */
+static bool udp_sockpair_wildcard(udp_sockpair_t *sp)
+{
+	return sp->local.addr.ipv4 == UDP_IPV4_ANY ||
+	    sp->local.port == UDP_PORT_ANY ||
+	    sp->foreign.addr.ipv4 == UDP_IPV4_ANY ||
+	    sp->foreign.port == UDP_PORT_ANY;
+}
+
+static hash_index_t assoc_hash_hash(unsigned long key[])
+{
+	unsigned long h;
+
+	h = key[ASSOC_KEY_LADDR] ^ (key[ASSOC_KEY_FADDR] * 31) ^
+	    (key[ASSOC_KEY_LPORT] << 16) ^ key[ASSOC_KEY_FPORT];
+	h ^= h >> 16;
+
+	return h % ASSOC_HASH_BUCKETS;
+}
+
+static int assoc_hash_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_instance(item, udp_assoc_t, link);
+	unsigned long akey[ASSOC_KEYS];
+
+	assert(keys == ASSOC_KEYS);
+	udp_sockpair_key(&assoc->ident, akey);
+
+	return key[ASSOC_KEY_LADDR] == akey[ASSOC_KEY_LADDR] &&
+	    key[ASSOC_KEY_LPORT] == akey[ASSOC_KEY_LPORT] &&
+	    key[ASSOC_KEY_FADDR] == akey[ASSOC_KEY_FADDR] &&
+	    key[ASSOC_KEY_FPORT] == akey[ASSOC_KEY_FPORT];
+}
+
+static hash_index_t assoc_listen_hash_hash(unsigned long key[])
+{
+	return key[ASSOC_KEY_LPORT] % ASSOC_LISTEN_BUCKETS;
+}
+
+/** Match socket pair given by @a key against the association pattern. */
+static int assoc_listen_hash_compare(unsigned long key[], hash_count_t keys,
+    link_t *item)
+{
+	udp_assoc_t *assoc = hash_table_get_instance(item, udp_assoc_t, link);
+	udp_sockpair_t sp;
+
+	assert(keys == ASSOC_KEYS);
+	udp_key_sockpair(key, &sp);
+
+	return udp_sockpair_match(&sp, &assoc->ident);
+}
+
+static void assoc_hash_remove_callback(link_t *item)
+{
+}
+
+static hash_table_operations_t assoc_hash_ops = {
+	.hash = assoc_hash_hash,
+	.compare = assoc_hash_compare,
+	.remove_callback = assoc_hash_remove_callback
+};
+
+static hash_table_operations_t assoc_listen_hash_ops = {
+	.hash = assoc_listen_hash_hash,
+	.compare = assoc_listen_hash_compare,
+	.remove_callback = assoc_hash_remove_callback
+};
+
+/** Initialize association map. */
+int udp_assoc_init(void)
+{
+	if (!hash_table_create(&assoc_hash, ASSOC_HASH_BUCKETS, ASSOC_KEYS,
+	    &assoc_hash_ops))
+		return ENOMEM;
+
+	if (!hash_table_create(&assoc_listen_hash, ASSOC_LISTEN_BUCKETS,
+	    ASSOC_KEYS, &assoc_listen_hash_ops)) {
+		hash_table_destroy(&assoc_hash);
+		return ENOMEM;
+	}
+
+	return EOK;
+}
+
+/** Insert association into the association map according to its socket pair.
+ *
+ * The association map lock must be held by the caller.
+ */
+static void udp_assoc_insert(udp_assoc_t *assoc)
+{
+	unsigned long key[ASSOC_KEYS];
+
+	udp_sockpair_key(&assoc->ident, key);
+
+	if (assoc->ident.local.port == UDP_PORT_ANY)
+		list_append(&assoc->link, &assoc_unbound);
+	else if (udp_sockpair_wildcard(&assoc->ident))
+		hash_table_insert(&assoc_listen_hash, key, &assoc->link);
+	else
+		hash_table_insert(&assoc_hash, key, &assoc->link);
+}
+
 /** Create new association structure.
  *
  * @param lsock		Local socket (will be deeply copied)
@@ -168,7 +307,7 @@ void udp_assoc_add(udp_assoc_t *assoc)
 {
 	udp_assoc_addref(assoc);
 	fibril_mutex_lock(&assoc_list_lock);
-	list_append(&assoc->link, &assoc_list);
+	udp_assoc_insert(assoc);
 	fibril_mutex_unlock(&assoc_list_lock);
 }
 
@@ -192,9 +331,13 @@ void udp_assoc_remove(udp_assoc_t *assoc)
 void udp_assoc_set_foreign(udp_assoc_t *assoc, udp_sock_t *fsock)
 {
 	log_msg(LVL_DEBUG, "udp_assoc_set_foreign(%p, %p)", assoc, fsock);
+	fibril_mutex_lock(&assoc_list_lock);
+	list_remove(&assoc->link);
 	fibril_mutex_lock(&assoc->lock);
 	assoc->ident.foreign = *fsock;
 	fibril_mutex_unlock(&assoc->lock);
+	udp_assoc_insert(assoc);
+	fibril_mutex_unlock(&assoc_list_lock);
 }
 
 /** Set local socket in association.
@@ -205,9 +348,13 @@ void udp_assoc_set_foreign(udp_assoc_t *assoc, udp_sock_t *fsock)
 void udp_assoc_set_local(udp_assoc_t *assoc, udp_sock_t *lsock)
 {
 	log_msg(LVL_DEBUG, "udp_assoc_set_local(%p, %p)", assoc, lsock);
+	fibril_mutex_lock(&assoc_list_lock);
+	list_remove(&assoc->link);
 	fibril_mutex_lock(&assoc->lock);
 	assoc->ident.local = *lsock;
 	fibril_mutex_unlock(&assoc->lock);
+	udp_assoc_insert(assoc);
+	fibril_mutex_unlock(&assoc_list_lock);
 }
 
 /** Send message to association.
@@ -371,6 +518,8 @@ static bool udp_sockpair_match(udp_sockpair_t *sp, udp_sockpair_t *pattern)
  *
  * An association is uniquely identified by a socket pair. Look up our
  * association map and return association structure based on socket pair.
+ * An association with a fully specified socket pair takes precedence over
+ * one with a wildcard. Unbound associations are never matched.
  * The association reference count is bumped by one.
  *
  * @param sp	Socket pair
@@ -378,31 +527,29 @@ static bool udp_sockpair_match(udp_sockpair_t *sp, udp_sockpair_t *pattern)
  */
 static udp_assoc_t *udp_assoc_find_ref(udp_sockpair_t *sp)
 {
+	unsigned long key[ASSOC_KEYS];
+	link_t *link;
+
 	log_msg(LVL_DEBUG, "udp_assoc_find_ref(%p)", sp);
 
+	udp_sockpair_key(sp, key);
+
 	fibril_mutex_lock(&assoc_list_lock);
 
-	list_foreach(assoc_list, link) {
-		udp_assoc_t *assoc = list_get_instance(link, udp_assoc_t, link);
-		udp_sockpair_t *asp = &assoc->ident;
-		log_msg(LVL_DEBUG, "compare with assoc (f:(%x,%u), l:(%x,%u))",
-		    asp->foreign.addr.ipv4, asp->foreign.port,
-		    asp->local.addr.ipv4, asp->local.port);
-
-		/* Skip unbound associations */
-		if (asp->local.port == UDP_PORT_ANY)
-			continue;
-
-		if (udp_sockpair_match(sp, asp)) {
-			log_msg(LVL_DEBUG, "Returning assoc %p", assoc);
-			udp_assoc_addref(assoc);
-			fibril_mutex_unlock(&assoc_list_lock);
-			return assoc;
-		}
+	link = hash_table_find(&assoc_hash, key);
+	if (link == NULL)
+		link = hash_table_find(&assoc_listen_hash, key);
+
+	if (link == NULL) {
+		fibril_mutex_unlock(&assoc_list_lock);
+		return NULL;
 	}
 
+	udp_assoc_t *assoc = hash_table_get_instance(link, udp_assoc_t, link);
+	log_msg(LVL_DEBUG, "Returning assoc %p", assoc);
+	udp_assoc_addref(assoc);
 	fibril_mutex_unlock(&assoc_list_lock);
-	return NULL;
+	return assoc;
 }
 
 
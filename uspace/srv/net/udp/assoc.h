@@ -38,6 +38,7 @@
 #include <sys/types.h>
 #include "udp_type.h"
 
+extern int udp_assoc_init(void);
 extern udp_assoc_t *udp_assoc_new(udp_sock_t *, udp_sock_t *);
 extern void udp_assoc_delete(udp_assoc_t *);
 extern void udp_assoc_add(udp_assoc_t *);
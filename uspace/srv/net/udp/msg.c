@@ -49,6 +49,8 @@ udp_msg_t *udp_msg_new(void)
 /** Delete segment. */
 void udp_msg_delete(udp_msg_t *msg)
 {
+	if (msg->pbuf != NULL)
+		pbuf_delref(msg->pbuf);
 	free(msg);
 }
 
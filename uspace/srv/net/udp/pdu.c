@@ -37,7 +37,9 @@
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/inet.h>
 #include <mem.h>
+#include <net/checksum.h>
 #include <stdlib.h>
 
 #include "msg.h"
@@ -45,44 +47,6 @@
 #include "std.h"
 #include "udp_type.h"
 
-#define UDP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t udp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t udp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2*i] << 8) | bdata[2*i + 1];
-		sum = udp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2*words] << 8);
-		sum = udp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void udp_phdr_setup(udp_pdu_t *pdu, udp_phdr_t *phdr)
 {
 	phdr->src_addr = host2uint32_t_be(pdu->src.ipv4);
@@ -99,22 +63,24 @@ udp_pdu_t *udp_pdu_new(void)
 
 void udp_pdu_delete(udp_pdu_t *pdu)
 {
-	free(pdu->data);
+	if (pdu->pbuf != NULL)
+		pbuf_delref(pdu->pbuf);
+	else
+		free(pdu->data);
 	free(pdu);
 }
 
-static uint16_t udp_pdu_checksum_calc(udp_pdu_t *pdu)
+/** Compute checksum of pseudo-header and UDP header. */
+static uint16_t udp_pdu_hdr_checksum_calc(udp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
-	uint16_t cs_all;
 	udp_phdr_t phdr;
 
 	udp_phdr_setup(pdu, &phdr);
-	cs_phdr = udp_checksum_calc(UDP_CHECKSUM_INIT, (void *)&phdr,
+	cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, (void *)&phdr,
 	    sizeof(udp_phdr_t));
-	cs_all = udp_checksum_calc(cs_phdr, pdu->data, pdu->data_size);
 
-	return cs_all;
+	return inet_checksum_calc(cs_phdr, pdu->data, sizeof(udp_header_t));
 }
 
 static void udp_pdu_set_checksum(udp_pdu_t *pdu, uint16_t checksum)
@@ -160,8 +126,12 @@ int udp_pdu_decode(udp_pdu_t *pdu, udp_sockpair_t *sp, udp_msg_t **msg)
 	if (nmsg == NULL)
 		return ENOMEM;
 
+	/* Message data references the PDU buffer, it is not copied */
 	nmsg->data = text;
 	nmsg->data_size = length - sizeof(udp_header_t);
+	nmsg->pbuf = pdu->pbuf;
+	if (nmsg->pbuf != NULL)
+		pbuf_addref(nmsg->pbuf);
 
 	*msg = nmsg;
 	return EOK;
@@ -182,23 +152,31 @@ int udp_pdu_encode(udp_sockpair_t *sp, udp_msg_t *msg, udp_pdu_t **pdu)
 	npdu->dest = sp->foreign.addr;
 
 	npdu->data_size = sizeof(udp_header_t) + msg->data_size;
-	npdu->data = calloc(1, npdu->data_size);
-	if (npdu->data == NULL) {
+	npdu->pbuf = pbuf_alloc_shared(INET_HEADROOM, npdu->data_size,
+	    INET_TAILROOM);
+	if (npdu->pbuf == NULL) {
 		udp_pdu_delete(npdu);
 		return ENOMEM;
 	}
 
+	npdu->data = npdu->pbuf->data;
+
 	hdr = (udp_header_t *)npdu->data;
 	hdr->src_port = host2uint16_t_be(sp->local.port);
 	hdr->dest_port = host2uint16_t_be(sp->foreign.port);
 	hdr->length = host2uint16_t_be(npdu->data_size);
 	hdr->checksum = 0;
 
-	memcpy((uint8_t *)npdu->data + sizeof(udp_header_t), msg->data,
+	/* Copy payload and compute checksum in one pass */
+	checksum = udp_pdu_hdr_checksum_calc(npdu);
+	checksum = inet_checksum_copy(checksum,
+	    (uint8_t *)npdu->data + sizeof(udp_header_t), msg->data,
 	    msg->data_size);
 
-	/* Checksum calculation */
-	checksum = udp_pdu_checksum_calc(npdu);
+	/* Zero means no checksum, transmit as all ones (RFC 768) */
+	if (checksum == 0)
+		checksum = 0xffff;
+
 	udp_pdu_set_checksum(npdu, checksum);
 
 	*pdu = npdu;
@@ -40,6 +40,7 @@
 #include <stdio.h>
 #include <task.h>
 
+#include "assoc.h"
 #include "udp_inet.h"
 #include "sock.h"
 
@@ -51,6 +52,12 @@ static int udp_init(void)
 
 	log_msg(LVL_DEBUG, "udp_init()");
 
+	rc = udp_assoc_init();
+	if (rc != EOK) {
+		log_msg(LVL_ERROR, "Failed initializing association map.");
+		return ENOMEM;
+	}
+
 	rc = udp_inet_init();
 	if (rc != EOK) {
 		log_msg(LVL_ERROR, "Failed connecting to internet service.");
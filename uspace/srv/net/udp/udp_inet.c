@@ -63,8 +63,18 @@ static int udp_inet_ev_recv(inet_dgram_t *dgram)
 	log_msg(LVL_DEBUG, "udp_inet_ev_recv()");
 
 	pdu = udp_pdu_new();
-	pdu->data = dgram->data;
-	pdu->data_size = dgram->size;
+	if (pdu == NULL)
+		return ENOMEM;
+
+	/* Copies the data only if it is borrowed from inetsrv */
+	pdu->pbuf = pbuf_keep(dgram->pbuf);
+	if (pdu->pbuf == NULL) {
+		udp_pdu_delete(pdu);
+		return ENOMEM;
+	}
+
+	pdu->data = pdu->pbuf->data;
+	pdu->data_size = pdu->pbuf->size;
 
 	pdu->src.ipv4 = dgram->src.ipv4;
 	pdu->dest.ipv4 = dgram->dest.ipv4;
@@ -90,6 +100,7 @@ int udp_transmit_pdu(udp_pdu_t *pdu)
 	dgram.tos = 0;
 	dgram.data = pdu->data;
 	dgram.size = pdu->data_size;
+	dgram.pbuf = pdu->pbuf;
 
 	rc = inet_send(&dgram, INET_TTL_MAX, 0);
 	if (rc != EOK)
@@ -37,6 +37,7 @@
 
 #include <fibril.h>
 #include <fibril_synch.h>
+#include <net/pbuf.h>
 #include <socket_core.h>
 #include <sys/types.h>
 
@@ -85,6 +86,8 @@ typedef struct {
 	void *data;
 	/** Message data size */
 	size_t data_size;
+	/** Buffer holding received message data or @c NULL */
+	pbuf_t *pbuf;
 } udp_msg_t;
 
 /** Encoded PDU */
@@ -98,6 +101,8 @@ typedef struct {
 	void *data;
 	/** Encoded PDU data size */
 	size_t data_size;
+	/** Buffer holding @c data or @c NULL */
+	pbuf_t *pbuf;
 } udp_pdu_t;
 
 typedef struct {
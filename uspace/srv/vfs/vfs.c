@@ -37,6 +37,7 @@
 
 #include <vfs/vfs.h>
 #include <ipc/services.h>
+#include <abi/ipc/methods.h>
 #include <abi/ipc/event.h>
 #include <event.h>
 #include <ns.h>
@@ -96,6 +97,21 @@ static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case VFS_IN_WRITE:
 			vfs_write(callid, &call);
 			break;
+		case VFS_IN_PREAD:
+			vfs_pread(callid, &call);
+			break;
+		case VFS_IN_PWRITE:
+			vfs_pwrite(callid, &call);
+			break;
+		case VFS_IN_READV:
+			vfs_readv(callid, &call);
+			break;
+		case VFS_IN_WRITEV:
+			vfs_writev(callid, &call);
+			break;
+		case VFS_IN_READDIRPLUS:
+			vfs_readdirplus(callid, &call);
+			break;
 		case VFS_IN_SEEK:
 			vfs_seek(callid, &call);
 			break;
@@ -129,6 +145,9 @@ static void vfs_connection(ipc_callid_t iid, ipc_call_t *icall, void *arg)
 		case VFS_IN_MTAB_GET:
 			vfs_get_mtab(callid, &call);
 			break;
+		case IPC_M_PAGE_IN:
+			vfs_page_in(callid, &call);
+			break;
 		default:
 			async_answer_0(callid, ENOTSUP);
 			break;
@@ -169,6 +188,14 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 	
+	/*
+	 * Initialize the dentry cache.
+	 */
+	if (!vfs_dentries_init()) {
+		printf("%s: Failed to initialize the dentry cache\n", NAME);
+		return ENOMEM;
+	}
+	
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
@@ -157,11 +157,12 @@ extern vfs_pair_t rootfs;	/**< Root file system. */
 /** Each instance of this type describes one path lookup in progress. */
 typedef struct {
 	link_t	plb_link;	/**< Active PLB entries list link. */
-	unsigned index;		/**< Index of the first character in PLB. */
+	size_t index;		/**< Index of the first character in PLB. */
 	size_t len;		/**< Number of characters in this PLB entry. */
 } plb_entry_t;
 
 extern fibril_mutex_t plb_mutex;/**< Mutex protecting plb and plb_entries. */
+extern fibril_condvar_t plb_cv;	/**< Signalled when a PLB slot is freed. */
 extern uint8_t *plb;		/**< Path Lookup Buffer */
 extern list_t plb_entries;	/**< List of active PLB entries. */
 
@@ -177,8 +178,19 @@ extern vfs_info_t *fs_handle_to_info(fs_handle_t);
 extern int vfs_lookup_internal(char *, int, vfs_lookup_res_t *,
     vfs_pair_t *, ...);
 
+extern bool vfs_dentries_init(void);
+extern bool vfs_dentry_lookup(vfs_pair_t *, const char *, size_t, int,
+    vfs_lookup_res_t *, int *);
+extern void vfs_dentry_insert(vfs_pair_t *, const char *, size_t,
+    vfs_node_type_t, vfs_triplet_t *);
+extern void vfs_dentry_set_type(vfs_pair_t *, const char *, size_t,
+    vfs_node_type_t);
+extern void vfs_dentry_invalidate(const char *, size_t);
+extern void vfs_dentry_flush(void);
+
 extern bool vfs_nodes_init(void);
 extern vfs_node_t *vfs_node_get(vfs_lookup_res_t *);
+extern bool vfs_node_peek(vfs_triplet_t *, aoff64_t *, unsigned *);
 extern void vfs_node_put(vfs_node_t *);
 extern void vfs_node_forget(vfs_node_t *);
 extern unsigned vfs_nodes_refcount_sum_get(fs_handle_t, service_id_t);
@@ -195,6 +207,7 @@ extern int vfs_wait_handle_internal(void);
 extern vfs_file_t *vfs_file_get(int);
 extern void vfs_file_put(vfs_file_t *);
 extern int vfs_fd_assign(vfs_file_t *, int);
+extern int vfs_fd_assign_desc(vfs_file_t *);
 extern int vfs_fd_alloc(bool desc);
 extern int vfs_fd_free(int);
 
@@ -211,6 +224,11 @@ extern void vfs_dup(ipc_callid_t, ipc_call_t *);
 extern void vfs_close(ipc_callid_t, ipc_call_t *);
 extern void vfs_read(ipc_callid_t, ipc_call_t *);
 extern void vfs_write(ipc_callid_t, ipc_call_t *);
+extern void vfs_pread(ipc_callid_t, ipc_call_t *);
+extern void vfs_pwrite(ipc_callid_t, ipc_call_t *);
+extern void vfs_readv(ipc_callid_t, ipc_call_t *);
+extern void vfs_writev(ipc_callid_t, ipc_call_t *);
+extern void vfs_readdirplus(ipc_callid_t, ipc_call_t *);
 extern void vfs_seek(ipc_callid_t, ipc_call_t *);
 extern void vfs_truncate(ipc_callid_t, ipc_call_t *);
 extern void vfs_fstat(ipc_callid_t, ipc_call_t *);
@@ -221,6 +239,8 @@ extern void vfs_rename(ipc_callid_t, ipc_call_t *);
 extern void vfs_wait_handle(ipc_callid_t, ipc_call_t *);
 extern void vfs_get_mtab(ipc_callid_t, ipc_call_t *);
 
+extern void vfs_page_in(ipc_callid_t, ipc_call_t *);
+
 #endif
 
 /**
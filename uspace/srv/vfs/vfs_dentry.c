@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file	vfs_dentry.c
+ * @brief	Cache of resolved and unresolvable paths.
+ *
+ * The cache remembers the outcome of recent path lookups so that repeated
+ * lookups of the same canonical path can be answered without sending
+ * VFS_OUT_LOOKUP to the file system servers along the path. Both successful
+ * lookups (positive entries) and lookups which failed with ENOENT (negative
+ * entries) are cached.
+ *
+ * All path lookups are done while holding namespace_rwlock and all operations
+ * which modify the namespace hold it for writing. The namespace therefore
+ * cannot change between a lookup and the insertion of its outcome into the
+ * cache. Namespace modifications invalidate the affected paths, mounting and
+ * unmounting flushes the whole cache.
+ *
+ * Only file systems which declare that their namespace cannot change behind
+ * the back of VFS have their lookups cached.
+ */
+
+#include "vfs.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <str.h>
+#include <mem.h>
+#include <fibril_synch.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+
+/** Maximum number of cached entries. */
+#define DENTRIES_MAX		512
+
+#define DENTRIES_BUCKETS_LOG	7
+#define DENTRIES_BUCKETS	(1 << DENTRIES_BUCKETS_LOG)
+
+#define DKEY_FS_HANDLE		0
+#define DKEY_SERVICE_ID		1
+#define DKEY_PATH		2
+#define DKEY_LEN		3
+
+#define DKEYS			4
+
+typedef struct {
+	/** Dentry hash table link. */
+	link_t dh_link;
+	/** Link in the LRU list. */
+	link_t lru_link;
+
+	/** Root of the file system tree in which the path was resolved. */
+	vfs_pair_t root;
+	/** Canonical path, not NULL-terminated. */
+	char *path;
+	/** Length of path. */
+	size_t len;
+
+	/** True if the lookup of the path failed with ENOENT. */
+	bool negative;
+	/** Resolved node, valid only for positive entries. */
+	vfs_triplet_t triplet;
+	/** Type of the resolved node, if known. */
+	vfs_node_type_t type;
+} dentry_t;
+
+/** Mutex protecting the dentry hash table and the LRU list. */
+static FIBRIL_MUTEX_INITIALIZE(dentries_mutex);
+
+static hash_table_t dentries;
+
+/** Dentries ordered from the least to the most recently used. */
+static LIST_INITIALIZE(dentries_lru);
+static size_t dentries_count = 0;
+
+static hash_index_t dentries_hash(unsigned long []);
+static int dentries_compare(unsigned long [], hash_count_t, link_t *);
+static void dentries_remove_callback(link_t *);
+
+static hash_table_operations_t dentries_ops = {
+	.hash = dentries_hash,
+	.compare = dentries_compare,
+	.remove_callback = dentries_remove_callback
+};
+
+hash_index_t dentries_hash(unsigned long key[])
+{
+	const char *path = (const char *) key[DKEY_PATH];
+	size_t len = (size_t) key[DKEY_LEN];
+	hash_index_t h = key[DKEY_FS_HANDLE] ^ key[DKEY_SERVICE_ID];
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h << 5) - h + (uint8_t) path[i];
+
+	return h & (DENTRIES_BUCKETS - 1);
+}
+
+int dentries_compare(unsigned long key[], hash_count_t keys, link_t *item)
+{
+	dentry_t *dentry = hash_table_get_instance(item, dentry_t, dh_link);
+
+	return (dentry->root.fs_handle == (fs_handle_t) key[DKEY_FS_HANDLE]) &&
+	    (dentry->root.service_id == (service_id_t) key[DKEY_SERVICE_ID]) &&
+	    (dentry->len == (size_t) key[DKEY_LEN]) &&
+	    (bcmp(dentry->path, (const char *) key[DKEY_PATH],
+	    dentry->len) == 0);
+}
+
+void dentries_remove_callback(link_t *item)
+{
+}
+
+/** Initialize the dentry cache.
+ *
+ * @return True on success, false on failure.
+ *
+ */
+bool vfs_dentries_init(void)
+{
+	return hash_table_create(&dentries, DENTRIES_BUCKETS, DKEYS,
+	    &dentries_ops);
+}
+
+/** Remove a dentry from the cache and free it.
+ *
+ * Must be called with dentries_mutex held.
+ *
+ */
+static void dentry_destroy(dentry_t *dentry)
+{
+	list_remove(&dentry->dh_link);
+	list_remove(&dentry->lru_link);
+	dentries_count--;
+
+	free(dentry->path);
+	free(dentry);
+}
+
+static dentry_t *dentry_find(vfs_pair_t *root, const char *path, size_t len)
+{
+	unsigned long key[] = {
+		[DKEY_FS_HANDLE] = root->fs_handle,
+		[DKEY_SERVICE_ID] = root->service_id,
+		[DKEY_PATH] = (unsigned long) path,
+		[DKEY_LEN] = len
+	};
+
+	link_t *link = hash_table_find(&dentries, key);
+	if (!link)
+		return NULL;
+
+	return hash_table_get_instance(link, dentry_t, dh_link);
+}
+
+/** Look up a canonical path in the dentry cache.
+ *
+ * A positive entry is only a hit if the size and the link count of the node
+ * can be provided as well. This is the case if the node is active in VFS or if
+ * the lookup is a part of an open operation; in the latter case, the caller is
+ * responsible for opening the node in the file system server, which will also
+ * supply the remaining attributes.
+ *
+ * @param root   Root of the file system tree.
+ * @param path   Canonical path.
+ * @param len    Length of path.
+ * @param lflag  Lookup flags.
+ * @param result Structure where the lookup result will be stored.
+ * @param rc     Place to store the result of the cached lookup.
+ *
+ * @return True on a cache hit, false on a cache miss.
+ *
+ */
+bool vfs_dentry_lookup(vfs_pair_t *root, const char *path, size_t len,
+    int lflag, vfs_lookup_res_t *result, int *rc)
+{
+	fibril_mutex_lock(&dentries_mutex);
+
+	dentry_t *dentry = dentry_find(root, path, len);
+	if (!dentry) {
+		fibril_mutex_unlock(&dentries_mutex);
+		return false;
+	}
+
+	list_remove(&dentry->lru_link);
+	list_append(&dentry->lru_link, &dentries_lru);
+
+	if (dentry->negative) {
+		fibril_mutex_unlock(&dentries_mutex);
+		*rc = ENOENT;
+		return true;
+	}
+
+	if (((lflag & L_FILE) || (lflag & L_DIRECTORY)) &&
+	    (dentry->type == VFS_NODE_UNKNOWN)) {
+		/* Let the file system server check the type. */
+		fibril_mutex_unlock(&dentries_mutex);
+		return false;
+	}
+
+	if ((lflag & L_FILE) && (dentry->type == VFS_NODE_DIRECTORY)) {
+		fibril_mutex_unlock(&dentries_mutex);
+		*rc = EISDIR;
+		return true;
+	}
+
+	if ((lflag & L_DIRECTORY) && (dentry->type == VFS_NODE_FILE)) {
+		fibril_mutex_unlock(&dentries_mutex);
+		*rc = ENOTDIR;
+		return true;
+	}
+
+	result->triplet = dentry->triplet;
+	fibril_mutex_unlock(&dentries_mutex);
+
+	if (!(lflag & L_OPEN) && !vfs_node_peek(&result->triplet,
+	    &result->size, &result->lnkcnt))
+		return false;
+
+	if (lflag & L_FILE)
+		result->type = VFS_NODE_FILE;
+	else if (lflag & L_DIRECTORY)
+		result->type = VFS_NODE_DIRECTORY;
+	else
+		result->type = VFS_NODE_UNKNOWN;
+
+	*rc = EOK;
+	return true;
+}
+
+/** Remember the outcome of a path lookup.
+ *
+ * @param root    Root of the file system tree.
+ * @param path    Canonical path.
+ * @param len     Length of path.
+ * @param type    Type of the resolved node, if known.
+ * @param triplet Resolved node or NULL if the lookup failed with ENOENT.
+ *
+ */
+void vfs_dentry_insert(vfs_pair_t *root, const char *path, size_t len,
+    vfs_node_type_t type, vfs_triplet_t *triplet)
+{
+	fibril_mutex_lock(&dentries_mutex);
+
+	dentry_t *dentry = dentry_find(root, path, len);
+	if (!dentry) {
+		dentry = malloc(sizeof(dentry_t));
+		if (!dentry) {
+			fibril_mutex_unlock(&dentries_mutex);
+			return;
+		}
+
+		dentry->path = malloc(len);
+		if (!dentry->path) {
+			free(dentry);
+			fibril_mutex_unlock(&dentries_mutex);
+			return;
+		}
+
+		memcpy(dentry->path, path, len);
+		dentry->len = len;
+		dentry->root = *root;
+		dentry->negative = true;
+		dentry->type = VFS_NODE_UNKNOWN;
+		link_initialize(&dentry->dh_link);
+		link_initialize(&dentry->lru_link);
+
+		unsigned long key[] = {
+			[DKEY_FS_HANDLE] = root->fs_handle,
+			[DKEY_SERVICE_ID] = root->service_id,
+			[DKEY_PATH] = (unsigned long) dentry->path,
+			[DKEY_LEN] = len
+		};
+
+		hash_table_insert(&dentries, key, &dentry->dh_link);
+		dentries_count++;
+	} else
+		list_remove(&dentry->lru_link);
+
+	list_append(&dentry->lru_link, &dentries_lru);
+
+	if (triplet) {
+		/* Do not forget the type of a node which did not change. */
+		if ((dentry->negative) || (type != VFS_NODE_UNKNOWN) ||
+		    (dentry->triplet.fs_handle != triplet->fs_handle) ||
+		    (dentry->triplet.service_id != triplet->service_id) ||
+		    (dentry->triplet.index != triplet->index))
+			dentry->type = type;
+
+		dentry->negative = false;
+		dentry->triplet = *triplet;
+	} else {
+		dentry->negative = true;
+		dentry->type = VFS_NODE_UNKNOWN;
+	}
+
+	/* Evict the least recently used entries over the budget. */
+	while (dentries_count > DENTRIES_MAX) {
+		dentry_t *victim = list_get_instance(list_first(&dentries_lru),
+		    dentry_t, lru_link);
+		dentry_destroy(victim);
+	}
+
+	fibril_mutex_unlock(&dentries_mutex);
+}
+
+/** Record the type of a node reached via a cached path.
+ *
+ * @param root Root of the file system tree.
+ * @param path Canonical path.
+ * @param len  Length of path.
+ * @param type Type of the node.
+ *
+ */
+void vfs_dentry_set_type(vfs_pair_t *root, const char *path, size_t len,
+    vfs_node_type_t type)
+{
+	fibril_mutex_lock(&dentries_mutex);
+
+	dentry_t *dentry = dentry_find(root, path, len);
+	if ((dentry) && (!dentry->negative))
+		dentry->type = type;
+
+	fibril_mutex_unlock(&dentries_mutex);
+}
+
+/** Invalidate a path and everything underneath it.
+ *
+ * This needs to be called before the file system namespace is modified at
+ * the given path.
+ *
+ * @param path Canonical path.
+ * @param len  Length of path.
+ *
+ */
+void vfs_dentry_invalidate(const char *path, size_t len)
+{
+	fibril_mutex_lock(&dentries_mutex);
+
+	link_t *cur = dentries_lru.head.next;
+	while (cur != &dentries_lru.head) {
+		dentry_t *dentry = list_get_instance(cur, dentry_t, lru_link);
+		cur = cur->next;
+
+		if (dentry->len < len)
+			continue;
+
+		if (bcmp(dentry->path, path, len) != 0)
+			continue;
+
+		if ((dentry->len == len) || (dentry->path[len] == '/') ||
+		    ((len == 1) && (path[0] == '/')))
+			dentry_destroy(dentry);
+	}
+
+	fibril_mutex_unlock(&dentries_mutex);
+}
+
+/** Drop all cached lookups.
+ *
+ * This needs to be called whenever a file system is mounted or unmounted.
+ *
+ */
+void vfs_dentry_flush(void)
+{
+	fibril_mutex_lock(&dentries_mutex);
+
+	while (!list_empty(&dentries_lru)) {
+		dentry_t *dentry = list_get_instance(list_first(&dentries_lru),
+		    dentry_t, lru_link);
+		dentry_destroy(dentry);
+	}
+
+	fibril_mutex_unlock(&dentries_mutex);
+}
+
+/**
+ * @}
+ */
@@ -300,6 +300,35 @@ int vfs_fd_assign(vfs_file_t *file, int fd)
 	return EOK;
 }
 
+/** Assign a file to the highest available file descriptor.
+ *
+ * @param file File to assign.
+ *
+ * @return File descriptor on success or EMFILE if there is no
+ *         available file descriptor.
+ *
+ */
+int vfs_fd_assign_desc(vfs_file_t *file)
+{
+	if (!vfs_files_init(VFS_DATA))
+		return ENOMEM;
+	
+	int fd;
+	
+	fibril_mutex_lock(&VFS_DATA->lock);
+	for (fd = MAX_OPEN_FILES - 1; fd >= 0; fd--) {
+		if (FILES[fd] == NULL) {
+			FILES[fd] = file;
+			vfs_file_addref(VFS_DATA, FILES[fd]);
+			fibril_mutex_unlock(&VFS_DATA->lock);
+			return fd;
+		}
+	}
+	fibril_mutex_unlock(&VFS_DATA->lock);
+	
+	return EMFILE;
+}
+
 static vfs_file_t *_vfs_file_get(vfs_client_data_t *vfs_data, int fd)
 {
 	if (!vfs_files_init(vfs_data))
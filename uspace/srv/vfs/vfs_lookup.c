@@ -46,12 +46,141 @@
 #include <adt/list.h>
 #include <vfs/canonify.h>
 
-#define min(a, b)  ((a) < (b) ? (a) : (b))
-
 FIBRIL_MUTEX_INITIALIZE(plb_mutex);
-LIST_INITIALIZE(plb_entries);	/**< PLB entry ring buffer. */
+FIBRIL_CONDVAR_INITIALIZE(plb_cv);
+LIST_INITIALIZE(plb_entries);	/**< PLB entries sorted by their index. */
 uint8_t *plb = NULL;
 
+/** Claim a contiguous slot in PLB for a path of the given length.
+ *
+ * The slot is found using the first-fit strategy. If there is currently no
+ * slot large enough, the caller is blocked until some of the lookups in
+ * progress complete.
+ *
+ * @param entry PLB entry describing the slot.
+ * @param len   Length of the path.
+ *
+ * @return EOK on success or ELIMIT if the path can never fit into PLB.
+ *
+ */
+static int plb_entry_claim(plb_entry_t *entry, size_t len)
+{
+	if (len > PLB_SIZE)
+		return ELIMIT;
+
+	link_initialize(&entry->plb_link);
+	entry->len = len;
+
+	fibril_mutex_lock(&plb_mutex);
+
+	while (true) {
+		size_t first = 0;	/* the first free index */
+
+		list_foreach(plb_entries, cur) {
+			plb_entry_t *used = list_get_instance(cur, plb_entry_t,
+			    plb_link);
+
+			if (used->index - first >= len) {
+				entry->index = first;
+				list_insert_before(&entry->plb_link, cur);
+				fibril_mutex_unlock(&plb_mutex);
+				return EOK;
+			}
+
+			first = used->index + used->len;
+		}
+
+		if (PLB_SIZE - first >= len) {
+			entry->index = first;
+			list_append(&entry->plb_link, &plb_entries);
+			fibril_mutex_unlock(&plb_mutex);
+			return EOK;
+		}
+
+		/*
+		 * The buffer cannot absorb the path at the moment.
+		 */
+		fibril_condvar_wait(&plb_cv, &plb_mutex);
+	}
+}
+
+/** Release a PLB slot claimed by plb_entry_claim().
+ *
+ * @param entry PLB entry describing the slot.
+ *
+ */
+static void plb_entry_release(plb_entry_t *entry)
+{
+	fibril_mutex_lock(&plb_mutex);
+	list_remove(&entry->plb_link);
+	/*
+	 * Erasing the path from PLB will come handy for debugging purposes.
+	 */
+	memset(&plb[entry->index], 0, entry->len);
+	fibril_condvar_broadcast(&plb_cv);
+	fibril_mutex_unlock(&plb_mutex);
+}
+
+/** Open a node reached via a cached path.
+ *
+ * If the file system server fails to open the node, the cached path is
+ * invalidated.
+ *
+ * @param root   Root of the file system tree.
+ * @param path   Canonical path.
+ * @param len    Length of path.
+ * @param result Lookup result with the node triplet filled in. The size and
+ *               the link count of the node will be filled in on success.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int vfs_lookup_open_cached(vfs_pair_t *root, char *path, size_t len,
+    vfs_lookup_res_t *result)
+{
+	async_exch_t *exch = vfs_exchange_grab(result->triplet.fs_handle);
+	
+	ipc_call_t answer;
+	aid_t req = async_send_2(exch, VFS_OUT_OPEN_NODE,
+	    (sysarg_t) result->triplet.service_id,
+	    (sysarg_t) result->triplet.index, &answer);
+	
+	vfs_exchange_release(exch);
+	
+	sysarg_t rc;
+	async_wait_for(req, &rc);
+	if (rc != EOK) {
+		vfs_dentry_invalidate(path, len);
+		return (int) rc;
+	}
+	
+	result->size =
+	    (aoff64_t) MERGE_LOUP32(IPC_GET_ARG1(answer), IPC_GET_ARG2(answer));
+	result->lnkcnt = (unsigned int) IPC_GET_ARG3(answer);
+	
+	/* Remember the type of the node for future lookups. */
+	if (IPC_GET_ARG4(answer) & L_FILE)
+		vfs_dentry_set_type(root, path, len, VFS_NODE_FILE);
+	else if (IPC_GET_ARG4(answer) & L_DIRECTORY)
+		vfs_dentry_set_type(root, path, len, VFS_NODE_DIRECTORY);
+	
+	return EOK;
+}
+
+/** Check whether lookups on a file system instance can be cached.
+ *
+ * @param fs_handle File system handle.
+ *
+ * @return True if the outcome of lookups can be cached.
+ *
+ */
+static bool vfs_lookup_cacheable(fs_handle_t fs_handle)
+{
+	vfs_info_t *info = fs_handle_to_info(fs_handle);
+	
+	return (info) && (info->lookup_cacheable);
+}
+
 /** Perform a path lookup.
  *
  * @param path    Path to be resolved; it must be a NULL-terminated
@@ -92,110 +221,88 @@ int vfs_lookup_internal(char *path, int lflag, vfs_lookup_res_t *result,
 		va_end(ap);
 	}
 	
-	fibril_mutex_lock(&plb_mutex);
-
-	plb_entry_t entry;
-	link_initialize(&entry.plb_link);
-	entry.len = len;
-
-	size_t first;	/* the first free index */
-	size_t last;	/* the last free index */
-
-	if (list_empty(&plb_entries)) {
-		first = 0;
-		last = PLB_SIZE - 1;
-	} else {
-		plb_entry_t *oldest = list_get_instance(
-		    list_first(&plb_entries), plb_entry_t, plb_link);
-		plb_entry_t *newest = list_get_instance(
-		    list_last(&plb_entries), plb_entry_t, plb_link);
-
-		first = (newest->index + newest->len) % PLB_SIZE;
-		last = (oldest->index - 1) % PLB_SIZE;
-	}
-
-	if (first <= last) {
-		if ((last - first) + 1 < len) {
-			/*
-			 * The buffer cannot absorb the path.
-			 */
-			fibril_mutex_unlock(&plb_mutex);
-			return ELIMIT;
-		}
-	} else {
-		if (PLB_SIZE - ((first - last) + 1) < len) {
-			/*
-			 * The buffer cannot absorb the path.
-			 */
-			fibril_mutex_unlock(&plb_mutex);
-			return ELIMIT;
-		}
-	}
-
-	/*
-	 * We know the first free index in PLB and we also know that there is
-	 * enough space in the buffer to hold our path.
-	 */
-
-	entry.index = first;
-	entry.len = len;
-
 	/*
-	 * Claim PLB space by inserting the entry into the PLB entry ring
-	 * buffer.
+	 * Lookups which modify the namespace invalidate the affected part of
+	 * the dentry cache. The remaining lookups can be answered from it.
 	 */
-	list_append(&entry.plb_link, &plb_entries);
+	bool cacheable =
+	    !(lflag & (L_CREATE | L_LINK | L_UNLINK | L_ROOT | L_MP));
+	
+	vfs_lookup_res_t res;
+	int rc;
+	
+	if (!cacheable) {
+		vfs_dentry_invalidate(path, len);
+	} else if (vfs_dentry_lookup(root, path, len, lflag, &res, &rc)) {
+		/*
+		 * Opening the node can still fail if the cached entry is stale.
+		 * In that case, resolve the path the slow way.
+		 */
+		if ((rc != EOK) || !(lflag & L_OPEN) ||
+		    (vfs_lookup_open_cached(root, path, len, &res) == EOK)) {
+			if ((rc == EOK) && (result))
+				*result = res;
+			
+			return rc;
+		}
+	}
+	
+	plb_entry_t entry;
+	rc = plb_entry_claim(&entry, len);
+	if (rc != EOK)
+		return rc;
 	
-	fibril_mutex_unlock(&plb_mutex);
-
 	/*
 	 * Copy the path into PLB.
 	 */
-	size_t cnt1 = min(len, (PLB_SIZE - first) + 1);
-	size_t cnt2 = len - cnt1;
+	memcpy(&plb[entry.index], path, len);
 	
-	memcpy(&plb[first], path, cnt1);
-	memcpy(plb, &path[cnt1], cnt2);
-
 	ipc_call_t answer;
 	async_exch_t *exch = vfs_exchange_grab(root->fs_handle);
-	aid_t req = async_send_5(exch, VFS_OUT_LOOKUP, (sysarg_t) first,
-	    (sysarg_t) (first + len - 1) % PLB_SIZE,
+	aid_t req = async_send_5(exch, VFS_OUT_LOOKUP, (sysarg_t) entry.index,
+	    (sysarg_t) (entry.index + len - 1),
 	    (sysarg_t) root->service_id, (sysarg_t) lflag, (sysarg_t) index,
 	    &answer);
 	
-	sysarg_t rc;
-	async_wait_for(req, &rc);
+	sysarg_t retval;
+	async_wait_for(req, &retval);
 	vfs_exchange_release(exch);
 	
-	fibril_mutex_lock(&plb_mutex);
-	list_remove(&entry.plb_link);
-	/*
-	 * Erasing the path from PLB will come handy for debugging purposes.
-	 */
-	memset(&plb[first], 0, cnt1);
-	memset(plb, 0, cnt2);
-	fibril_mutex_unlock(&plb_mutex);
+	plb_entry_release(&entry);
 	
-	if ((int) rc < EOK)
-		return (int) rc;
-
-	if (!result)
-		return EOK;
+	rc = (int) retval;
+	if (rc < EOK) {
+		/*
+		 * The file system server which failed to find the path
+		 * identifies itself in the answer.
+		 */
+		if ((cacheable) && (rc == ENOENT) &&
+		    (vfs_lookup_cacheable((fs_handle_t) IPC_GET_ARG1(answer))))
+			vfs_dentry_insert(root, path, len, VFS_NODE_UNKNOWN,
+			    NULL);
+		
+		return rc;
+	}
 	
-	result->triplet.fs_handle = (fs_handle_t) rc;
-	result->triplet.service_id = (service_id_t) IPC_GET_ARG1(answer);
-	result->triplet.index = (fs_index_t) IPC_GET_ARG2(answer);
-	result->size =
+	res.triplet.fs_handle = (fs_handle_t) rc;
+	res.triplet.service_id = (service_id_t) IPC_GET_ARG1(answer);
+	res.triplet.index = (fs_index_t) IPC_GET_ARG2(answer);
+	res.size =
 	    (aoff64_t) MERGE_LOUP32(IPC_GET_ARG3(answer), IPC_GET_ARG4(answer));
-	result->lnkcnt = (unsigned int) IPC_GET_ARG5(answer);
+	res.lnkcnt = (unsigned int) IPC_GET_ARG5(answer);
 	
 	if (lflag & L_FILE)
-		result->type = VFS_NODE_FILE;
+		res.type = VFS_NODE_FILE;
 	else if (lflag & L_DIRECTORY)
-		result->type = VFS_NODE_DIRECTORY;
+		res.type = VFS_NODE_DIRECTORY;
 	else
-		result->type = VFS_NODE_UNKNOWN;
+		res.type = VFS_NODE_UNKNOWN;
+	
+	if ((cacheable) && (vfs_lookup_cacheable(res.triplet.fs_handle)))
+		vfs_dentry_insert(root, path, len, res.type, &res.triplet);
+	
+	if (result)
+		*result = res;
 	
 	return EOK;
 }
@@ -226,6 +226,36 @@ vfs_node_t *vfs_node_get(vfs_lookup_res_t *result)
 	return node;
 }
 
+/** Peek at an active VFS node.
+ *
+ * @param triplet Identity of the node.
+ * @param size    Place to store the cached size of the node.
+ * @param lnkcnt  Place to store the link count of the node.
+ *
+ * @return True if the node is active in VFS, false otherwise.
+ *
+ */
+bool vfs_node_peek(vfs_triplet_t *triplet, aoff64_t *size, unsigned *lnkcnt)
+{
+	unsigned long key[] = {
+		[KEY_FS_HANDLE] = triplet->fs_handle,
+		[KEY_DEV_HANDLE] = triplet->service_id,
+		[KEY_INDEX] = triplet->index
+	};
+
+	fibril_mutex_lock(&nodes_mutex);
+	link_t *tmp = hash_table_find(&nodes, key);
+	if (tmp) {
+		vfs_node_t *node = hash_table_get_instance(tmp, vfs_node_t,
+		    nh_link);
+		*size = node->size;
+		*lnkcnt = node->lnkcnt;
+	}
+	fibril_mutex_unlock(&nodes_mutex);
+
+	return tmp != NULL;
+}
+
 /** Return VFS node when no longer needed by the caller.
  *
  * This function will remove the reference on the VFS node created by
@@ -254,6 +254,9 @@ static int vfs_mount_internal(ipc_callid_t rid, service_id_t service_id,
 		/* Add reference to the mounted root. */
 		mr_node = vfs_node_get(&mr_res); 
 		assert(mr_node);
+		
+		/* Paths underneath the mount point now lead elsewhere. */
+		vfs_dentry_flush();
 	} else {
 		/* Mount failed, drop reference to mp_node. */
 		if (mp_node)
@@ -538,9 +541,11 @@ void vfs_unmount(ipc_callid_t rid, ipc_call_t *request)
 	
 	/*
 	 * All went well, the mounted file system was successfully unmounted.
-	 * The only thing left is to forget the unmounted root VFS node.
+	 * The only thing left is to forget the unmounted root VFS node and
+	 * the cached paths.
 	 */
 	vfs_node_forget(mr_node);
+	vfs_dentry_flush();
 	fibril_rwlock_write_unlock(&namespace_rwlock);
 
 	fibril_mutex_lock(&mtab_list_lock);
@@ -731,16 +736,18 @@ void vfs_close(ipc_callid_t rid, ipc_call_t *request)
 	async_answer_0(rid, ret);
 }
 
-static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read)
+static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read,
+    bool positional)
 {
 	/*
-	 * The following code strongly depends on the fact that the files data
-	 * structure can be only accessed by a single fibril and all file
-	 * operations are serialized (i.e. the reads and writes cannot
-	 * interleave and a file cannot be closed while it is being read).
+	 * Reads and writes which use the current position in the open file
+	 * are serialized by the open file's lock. Positional reads and writes
+	 * leave the current position alone and synchronize only on the node
+	 * contents, so they can proceed in parallel with each other as well
+	 * as with any other operation on the same open file.
 	 *
-	 * Additional synchronization needs to be added once the table of
-	 * open files supports parallel access!
+	 * The open file itself cannot go away while it is being read or
+	 * written because of the reference obtained by vfs_file_get().
 	 */
 	
 	int fd = IPC_GET_ARG1(*request);
@@ -752,11 +759,26 @@ static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read)
 		return;
 	}
 	
+	/*
+	 * Receive the data transfer before locking anything, so that a client
+	 * which fails to send it cannot block the file or its node.
+	 */
+	ipc_callid_t callid;
+	bool xfer = (read) ? async_data_read_receive(&callid, NULL) :
+	    async_data_write_receive(&callid, NULL);
+	if (!xfer) {
+		vfs_file_put(file);
+		async_answer_0(callid, EINVAL);
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+	
 	/*
 	 * Lock the open file structure so that no other thread can manipulate
 	 * the same open file at a time.
 	 */
-	fibril_mutex_lock(&file->lock);
+	if (!positional)
+		fibril_mutex_lock(&file->lock);
 	
 	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
 	assert(fs_info);
@@ -781,6 +803,15 @@ static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read)
 		fibril_rwlock_read_lock(&namespace_rwlock);
 	}
 	
+	aoff64_t pos;
+	if (positional)
+		pos = MERGE_LOUP32(IPC_GET_ARG2(*request), IPC_GET_ARG3(*request));
+	else {
+		if ((!read) && (file->append))
+			file->pos = file->node->size;
+		pos = file->pos;
+	}
+	
 	async_exch_t *fs_exch = vfs_exchange_grab(file->node->fs_handle);
 	
 	/*
@@ -792,22 +823,25 @@ static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read)
 	 */
 	sysarg_t rc;
 	ipc_call_t answer;
-	if (read) {
-		rc = async_data_read_forward_4_1(fs_exch, VFS_OUT_READ,
-		    file->node->service_id, file->node->index,
-		    LOWER32(file->pos), UPPER32(file->pos), &answer);
+	aid_t msg = async_send_4(fs_exch, read ? VFS_OUT_READ : VFS_OUT_WRITE,
+	    file->node->service_id, file->node->index, LOWER32(pos),
+	    UPPER32(pos), &answer);
+	if (msg == 0) {
+		async_answer_0(callid, ENOMEM);
+		rc = ENOMEM;
 	} else {
-		if (file->append)
-			file->pos = file->node->size;
-		
-		rc = async_data_write_forward_4_1(fs_exch, VFS_OUT_WRITE,
-		    file->node->service_id, file->node->index,
-		    LOWER32(file->pos), UPPER32(file->pos), &answer);
+		rc = async_forward_fast(callid, fs_exch, 0, 0, 0,
+		    IPC_FF_ROUTE_FROM_ME);
+		if (rc != EOK) {
+			async_forget(msg);
+			async_answer_0(callid, rc);
+		} else
+			async_wait_for(msg, &rc);
 	}
 	
 	vfs_exchange_release(fs_exch);
 	
-	size_t bytes = IPC_GET_ARG1(answer);
+	size_t bytes = (rc == EOK) ? IPC_GET_ARG1(answer) : 0;
 	
 	if (file->node->type == VFS_NODE_DIRECTORY)
 		fibril_rwlock_read_unlock(&namespace_rwlock);
@@ -825,9 +859,11 @@ static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read)
 	}
 	
 	/* Update the position pointer and unlock the open file. */
-	if (rc == EOK)
-		file->pos += bytes;
-	fibril_mutex_unlock(&file->lock);
+	if (!positional) {
+		if (rc == EOK)
+			file->pos += bytes;
+		fibril_mutex_unlock(&file->lock);
+	}
 	vfs_file_put(file);	
 
 	/*
@@ -839,12 +875,366 @@ static void vfs_rdwr(ipc_callid_t rid, ipc_call_t *request, bool read)
 
 void vfs_read(ipc_callid_t rid, ipc_call_t *request)
 {
-	vfs_rdwr(rid, request, true);
+	vfs_rdwr(rid, request, true, false);
 }
 
 void vfs_write(ipc_callid_t rid, ipc_call_t *request)
 {
-	vfs_rdwr(rid, request, false);
+	vfs_rdwr(rid, request, false, false);
+}
+
+void vfs_pread(ipc_callid_t rid, ipc_call_t *request)
+{
+	vfs_rdwr(rid, request, true, true);
+}
+
+void vfs_pwrite(ipc_callid_t rid, ipc_call_t *request)
+{
+	vfs_rdwr(rid, request, false, true);
+}
+
+/** Size of the buffer through which vectored requests move data. */
+#define RDWRV_BUF_SIZE  (4 * VFS_XFER_MAX)
+
+/** Finish the data transfers of a vectored request which will not be made.
+ *
+ * Read transfers move no data and write transfers are refused with @a rc.
+ */
+static void vfs_rdwrv_drain(bool read, size_t cnt, int rc)
+{
+	ipc_callid_t callid;
+	
+	while (cnt-- > 0) {
+		if (read) {
+			if (async_data_read_receive(&callid, NULL))
+				(void) async_data_read_finalize(callid, NULL, 0);
+			else
+				async_answer_0(callid, EINVAL);
+		} else
+			async_data_write_void(rc);
+	}
+}
+
+/** Move one batch of a vectored request between VFS and the FS server.
+ *
+ * The whole batch is served by one VFS_OUT_READV or VFS_OUT_WRITEV request.
+ * The request is followed by the array of transfer sizes and by one data
+ * transfer per extent, all made from or into @a buf.
+ *
+ * @param exch   Exchange with the FS server.
+ * @param node   Node being read or written.
+ * @param read   True for reading, false for writing.
+ * @param pos    Position in the file.
+ * @param sizes  Sizes of the transfers.
+ * @param cnt    Number of the transfers.
+ * @param buf    Buffer holding the data.
+ * @param answer Place to store the answer of the FS server.
+ *
+ * @return EOK on success or an error code from errno.h.
+ *
+ */
+static int vfs_rdwrv_batch(async_exch_t *exch, vfs_node_t *node, bool read,
+    aoff64_t pos, size_t *sizes, size_t cnt, uint8_t *buf,
+    ipc_call_t *answer)
+{
+	aid_t msg = async_send_5(exch, read ? VFS_OUT_READV : VFS_OUT_WRITEV,
+	    node->service_id, node->index, LOWER32(pos), UPPER32(pos), cnt,
+	    answer);
+	
+	int rc = async_data_write_start(exch, sizes, cnt * sizeof(size_t));
+	if (rc != EOK) {
+		async_forget(msg);
+		return rc;
+	}
+	
+	/* All the transfers need to be made for the FS server to finish. */
+	size_t i;
+	for (i = 0; i < cnt; i++) {
+		if (read)
+			(void) async_data_read_start(exch, buf, sizes[i]);
+		else
+			(void) async_data_write_start(exch, buf, sizes[i]);
+		
+		buf += sizes[i];
+	}
+	
+	sysarg_t retval;
+	async_wait_for(msg, &retval);
+	
+	return (int) retval;
+}
+
+/** Read or write several buffers in one request.
+ *
+ * The request is followed by the array of sizes of the data transfers and by
+ * the given number of IPC_M_DATA_READ or IPC_M_DATA_WRITE transfers. The
+ * transfers cover consecutive ranges of the file.
+ *
+ * The data are moved in batches through a buffer of RDWRV_BUF_SIZE bytes, so
+ * that the node is never locked while waiting for the client. Write data are
+ * received before the node is locked and read data are handed to the client
+ * after it is unlocked. Each batch is sent to the FS server as one request.
+ *
+ * Once a batch fails or moves less data than requested, the remaining read
+ * transfers move no data and the remaining write transfers are refused with
+ * the error which stopped the request, or EIO after a short transfer.
+ */
+static void vfs_rdwrv(ipc_callid_t rid, ipc_call_t *request, bool read)
+{
+	int fd = IPC_GET_ARG1(*request);
+	size_t cnt = IPC_GET_ARG2(*request);
+	bool positional = IPC_GET_ARG5(*request);
+	
+	if ((cnt == 0) || (cnt > VFS_XFER_CNT)) {
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+	
+	size_t *sizes;
+	int rc = async_data_write_accept((void **) &sizes, false,
+	    cnt * sizeof(size_t), cnt * sizeof(size_t), 0, NULL);
+	if (rc != EOK) {
+		async_answer_0(rid, rc);
+		return;
+	}
+	
+	size_t i;
+	for (i = 0; i < cnt; i++) {
+		if (sizes[i] > VFS_XFER_MAX) {
+			free(sizes);
+			async_answer_0(rid, EINVAL);
+			return;
+		}
+	}
+	
+	uint8_t *buf = malloc(RDWRV_BUF_SIZE);
+	if (!buf) {
+		free(sizes);
+		async_answer_0(rid, ENOMEM);
+		return;
+	}
+	
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		vfs_rdwrv_drain(read, cnt, ENOENT);
+		free(buf);
+		free(sizes);
+		async_answer_0(rid, ENOENT);
+		return;
+	}
+	
+	if (!positional)
+		fibril_mutex_lock(&file->lock);
+	
+	vfs_info_t *fs_info = fs_handle_to_info(file->node->fs_handle);
+	assert(fs_info);
+	
+	bool shared = (read) ||
+	    ((fs_info->concurrent_read_write) && (fs_info->write_retains_size));
+	
+	aoff64_t pos = 0;
+	if (positional)
+		pos = MERGE_LOUP32(IPC_GET_ARG3(*request), IPC_GET_ARG4(*request));
+	else
+		pos = file->pos;
+	
+	rc = EOK;
+	int stop_rc = EIO;
+	size_t total = 0;
+	size_t next = 0;
+	bool done = false;
+	
+	if (file->node->type == VFS_NODE_DIRECTORY) {
+		/* Directories can be read only one entry at a time. */
+		rc = EISDIR;
+		stop_rc = EISDIR;
+		done = true;
+	}
+	
+	while ((!done) && (next < cnt)) {
+		size_t first = next;
+		size_t bcnt = 0;
+		size_t bsize = 0;
+		size_t off;
+		size_t j;
+		int xrc = EOK;
+		
+		while ((first + bcnt < cnt) && ((bcnt == 0) ||
+		    (bsize + sizes[first + bcnt] <= RDWRV_BUF_SIZE)))
+			bsize += sizes[first + bcnt++];
+		
+		if (!read) {
+			/* Receive the data before locking the node. */
+			off = 0;
+			for (j = 0; j < bcnt; j++) {
+				ipc_callid_t callid;
+				size_t size;
+				
+				next++;
+				if ((!async_data_write_receive(&callid, &size)) ||
+				    (size != sizes[first + j])) {
+					async_answer_0(callid, EINVAL);
+					xrc = EINVAL;
+					break;
+				}
+				
+				(void) async_data_write_finalize(callid, buf + off,
+				    size);
+				off += size;
+			}
+			
+			bcnt = j;
+			bsize = off;
+		}
+		
+		size_t bytes = 0;
+		if (bcnt > 0) {
+			if (shared)
+				fibril_rwlock_read_lock(&file->node->contents_rwlock);
+			else
+				fibril_rwlock_write_lock(&file->node->contents_rwlock);
+			
+			if ((!positional) && (!read) && (file->append) &&
+			    (first == 0))
+				pos = file->node->size;
+			
+			async_exch_t *fs_exch =
+			    vfs_exchange_grab(file->node->fs_handle);
+			ipc_call_t answer;
+			int brc = vfs_rdwrv_batch(fs_exch, file->node, read,
+			    pos + total, &sizes[first], bcnt, buf, &answer);
+			vfs_exchange_release(fs_exch);
+			
+			if (brc == EOK) {
+				bytes = IPC_GET_ARG1(answer);
+				
+				/* Update the cached version of node's size. */
+				if ((!read) && (!shared))
+					file->node->size = MERGE_LOUP32(
+					    IPC_GET_ARG2(answer),
+					    IPC_GET_ARG3(answer));
+			} else if (xrc == EOK)
+				xrc = brc;
+			
+			if (shared)
+				fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+			else
+				fibril_rwlock_write_unlock(&file->node->contents_rwlock);
+		}
+		
+		if (read) {
+			/* Hand the data to the client after unlocking the node. */
+			off = 0;
+			for (j = 0; j < bcnt; j++) {
+				ipc_callid_t callid;
+				size_t size;
+				
+				next++;
+				if (!async_data_read_receive(&callid, &size)) {
+					async_answer_0(callid, EINVAL);
+					off += sizes[first + j];
+					continue;
+				}
+				
+				size_t avail = (off < bytes) ?
+				    min(bytes - off, sizes[first + j]) : 0;
+				(void) async_data_read_finalize(callid, buf + off,
+				    min(size, avail));
+				off += sizes[first + j];
+			}
+		}
+		
+		total += bytes;
+		
+		if (xrc != EOK) {
+			if (total == 0)
+				rc = xrc;
+			stop_rc = xrc;
+			done = true;
+		} else if (bytes < bsize)
+			done = true;
+	}
+	
+	/* Let the client finish the request. */
+	vfs_rdwrv_drain(read, cnt - next, stop_rc);
+	
+	if (!positional) {
+		file->pos = pos + total;
+		fibril_mutex_unlock(&file->lock);
+	}
+	vfs_file_put(file);
+	
+	free(buf);
+	free(sizes);
+	
+	async_answer_1(rid, rc, total);
+}
+
+void vfs_readv(ipc_callid_t rid, ipc_call_t *request)
+{
+	vfs_rdwrv(rid, request, true);
+}
+
+void vfs_writev(ipc_callid_t rid, ipc_call_t *request)
+{
+	vfs_rdwrv(rid, request, false);
+}
+
+void vfs_readdirplus(ipc_callid_t rid, ipc_call_t *request)
+{
+	int fd = IPC_GET_ARG1(*request);
+	
+	/* Lookup the file structure corresponding to the file descriptor. */
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		async_answer_0(rid, ENOENT);
+		return;
+	}
+	
+	fibril_mutex_lock(&file->lock);
+	
+	if (file->node->type != VFS_NODE_DIRECTORY) {
+		fibril_mutex_unlock(&file->lock);
+		vfs_file_put(file);
+		async_answer_0(rid, ENOTDIR);
+		return;
+	}
+	
+	/*
+	 * Make sure that no one is modifying the namespace while the entries
+	 * are being read.
+	 */
+	fibril_rwlock_read_lock(&file->node->contents_rwlock);
+	fibril_rwlock_read_lock(&namespace_rwlock);
+	
+	/*
+	 * Forward the IPC_M_DATA_READ request to the FS server together with
+	 * the VFS_OUT_READDIRPLUS request. The answer carries the number of
+	 * bytes read and the position following the last returned entry.
+	 */
+	async_exch_t *fs_exch = vfs_exchange_grab(file->node->fs_handle);
+	
+	ipc_call_t answer;
+	sysarg_t rc = async_data_read_forward_4_1(fs_exch, VFS_OUT_READDIRPLUS,
+	    file->node->service_id, file->node->index, LOWER32(file->pos),
+	    UPPER32(file->pos), &answer);
+	
+	vfs_exchange_release(fs_exch);
+	
+	fibril_rwlock_read_unlock(&namespace_rwlock);
+	fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+	
+	size_t bytes = 0;
+	if (rc == EOK) {
+		bytes = IPC_GET_ARG1(answer);
+		file->pos = MERGE_LOUP32(IPC_GET_ARG2(answer),
+		    IPC_GET_ARG3(answer));
+	}
+	
+	fibril_mutex_unlock(&file->lock);
+	vfs_file_put(file);
+	
+	async_answer_1(rid, rc, bytes);
 }
 
 void vfs_seek(ipc_callid_t rid, ipc_call_t *request)
@@ -1314,7 +1704,7 @@ void vfs_dup(ipc_callid_t rid, ipc_call_t *request)
 	int newfd = IPC_GET_ARG2(*request);
 	
 	/* If the file descriptors are the same, do nothing. */
-	if (oldfd == newfd) {
+	if ((newfd >= 0) && (oldfd == newfd)) {
 		async_answer_1(rid, EOK, newfd);
 		return;
 	}
@@ -1332,11 +1722,21 @@ void vfs_dup(ipc_callid_t rid, ipc_call_t *request)
 	 */
 	fibril_mutex_lock(&oldfile->lock);
 	
-	/* Make sure newfd is closed. */
-	(void) vfs_fd_free(newfd);
-	
-	/* Assign the old file to newfd. */
-	int ret = vfs_fd_assign(oldfile, newfd);
+	int ret;
+	if (newfd < 0) {
+		/* Assign the old file to the highest available descriptor. */
+		ret = vfs_fd_assign_desc(oldfile);
+		if (ret >= 0) {
+			newfd = ret;
+			ret = EOK;
+		}
+	} else {
+		/* Make sure newfd is closed. */
+		(void) vfs_fd_free(newfd);
+		
+		/* Assign the old file to newfd. */
+		ret = vfs_fd_assign(oldfile, newfd);
+	}
 	fibril_mutex_unlock(&oldfile->lock);
 	vfs_file_put(oldfile);
 	
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2012 HelenOS project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup fs
+ * @{
+ */
+
+/**
+ * @file	vfs_pager.c
+ * @brief	VFS acting as the pager of memory mapped files.
+ */
+
+#include <as.h>
+#include <async.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include "vfs.h"
+
+/** Read data from a node without touching the position of any open file.
+ *
+ * @param node   VFS node to read from.
+ * @param pos    Position within the node.
+ * @param buf    Destination buffer.
+ * @param size   Number of bytes to read.
+ * @param nread  Place to store the number of bytes actually read.
+ *
+ * @return EOK on success or a negative error code.
+ *
+ */
+static int vfs_pager_read(vfs_node_t *node, aoff64_t pos, void *buf,
+    size_t size, size_t *nread)
+{
+	async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
+	
+	ipc_call_t answer;
+	aid_t msg = async_send_4(exch, VFS_OUT_READ, node->service_id,
+	    node->index, LOWER32(pos), UPPER32(pos), &answer);
+	int rc = async_data_read_start(exch, buf, size);
+	
+	vfs_exchange_release(exch);
+	
+	sysarg_t rc_orig;
+	async_wait_for(msg, &rc_orig);
+	
+	if (rc_orig != EOK)
+		return (int) rc_orig;
+	
+	if (rc != EOK)
+		return rc;
+	
+	*nread = IPC_GET_ARG1(answer);
+	return EOK;
+}
+
+/** Provide a page of a memory mapped file to the kernel.
+ *
+ * The request is sent by the kernel when it resolves a page fault in an
+ * address space area which has VFS as its pager. The area identifiers are
+ * the file descriptor of the mapped file and the file offset of the area.
+ *
+ * @param rid     Call hash of the IPC_M_PAGE_IN request.
+ * @param request IPC_M_PAGE_IN request.
+ *
+ */
+void vfs_page_in(ipc_callid_t rid, ipc_call_t *request)
+{
+	aoff64_t offset = IPC_GET_ARG1(*request);
+	size_t page_size = IPC_GET_ARG2(*request);
+	int fd = IPC_GET_ARG3(*request);
+	aoff64_t base = MERGE_LOUP32(IPC_GET_ARG4(*request),
+	    IPC_GET_ARG5(*request));
+	
+	vfs_file_t *file = vfs_file_get(fd);
+	if (!file) {
+		async_answer_0(rid, EBADF);
+		return;
+	}
+	
+	if (file->node->type == VFS_NODE_DIRECTORY) {
+		vfs_file_put(file);
+		async_answer_0(rid, EINVAL);
+		return;
+	}
+	
+	uint8_t *page = as_area_create(AS_AREA_ANY, page_size,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	if (page == AS_MAP_FAILED) {
+		vfs_file_put(file);
+		async_answer_0(rid, ENOMEM);
+		return;
+	}
+	
+	/*
+	 * Read the page contents. The file position is left untouched so
+	 * there is no need to lock the open file structure.
+	 */
+	fibril_rwlock_read_lock(&file->node->contents_rwlock);
+	
+	int rc = EOK;
+	size_t total = 0;
+	while (total < page_size) {
+		size_t nread = 0;
+		rc = vfs_pager_read(file->node, base + offset + total,
+		    page + total, page_size - total, &nread);
+		if ((rc != EOK) || (nread == 0))
+			break;
+		
+		total += nread;
+	}
+	
+	fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+	vfs_file_put(file);
+	
+	if (rc != EOK) {
+		as_area_destroy(page);
+		async_answer_0(rid, rc);
+		return;
+	}
+	
+	/*
+	 * Zero the part of the page beyond the end of the file. This also
+	 * makes sure the page is resident so that the kernel can take it.
+	 */
+	memset(page + total, 0, page_size - total);
+	
+	/*
+	 * The kernel takes its own reference to the frame while processing
+	 * the answer, so the page can be unmapped right away.
+	 */
+	async_answer_1(rid, EOK, (sysarg_t) page);
+	as_area_destroy(page);
+}
+
+/**
+ * @}
+ */